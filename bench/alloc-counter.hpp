@@ -0,0 +1,95 @@
+#pragma once
+
+// counts heap allocations made through operator new and through OpenSSL,
+// so that benchmarks and tests can account for allocations per operation
+//
+// defines the global replacement allocation functions: include it from
+// exactly one translation unit of a program
+
+#include <openssl/crypto.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// GCC sees the malloc/free pairing inside the replacement operators once
+// they are inlined and mistakes it for a mismatched new/delete
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace ncbi::bench
+{
+    inline std::atomic<size_t> cxxAllocations { 0 };
+    inline std::atomic<size_t> cryptoAllocations { 0 };
+
+    struct AllocationSnapshot
+    {
+        size_t cxx;
+        size_t crypto;
+
+        static AllocationSnapshot take() noexcept
+        {
+            return { cxxAllocations.load(std::memory_order_relaxed),
+                     cryptoAllocations.load(std::memory_order_relaxed) };
+        }
+    };
+
+    namespace detail
+    {
+        inline void* cryptoMalloc(size_t size, const char*, int)
+        {
+            cryptoAllocations.fetch_add(1, std::memory_order_relaxed);
+            return std::malloc(size);
+        }
+
+        inline void* cryptoRealloc(void* ptr, size_t size, const char*, int)
+        {
+            cryptoAllocations.fetch_add(1, std::memory_order_relaxed);
+            return std::realloc(ptr, size);
+        }
+
+        inline void cryptoFree(void* ptr, const char*, int)
+        {
+            std::free(ptr);
+        }
+
+        // must run before OpenSSL allocates anything
+        inline const bool cryptoHooked =
+            CRYPTO_set_mem_functions(cryptoMalloc, cryptoRealloc, cryptoFree) != 0;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    ncbi::bench::cxxAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size != 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,95 @@
+// the price of the coroutine interface: verification through co_await
+// against the plain call, cached and uncached, where neither suspends
+
+#include <ncbi/async-verify.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    // executes inline; nothing in these benchmarks suspends
+    class InlineExecutor final : public Executor
+    {
+    public:
+        void post(std::function<void()> task) override { task(); }
+    };
+
+    struct Fixture
+    {
+        PKey key = generateKey(JWTAlg::ES256);
+        std::string token = makeToken(JWTAlg::ES256, key.get(), "bench-1", benchPayload);
+        std::unique_ptr<JWKSCache> keys;
+        InlineExecutor executor;
+
+        Fixture()
+        {
+            std::string jwks = R"({"keys":[)" + publicJWK(JWTAlg::ES256, key.get(), "bench-1") + "]}";
+            keys = std::make_unique<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            keys->start();
+        }
+    };
+
+    Fixture& fixture()
+    {
+        static Fixture f;
+        return f;
+    }
+
+    Task<JWTStatus> verifyTask(const AsyncJWTVerifier& verifier, std::string_view token)
+    {
+        VerificationResult result = co_await verifier.verify(token, benchNow);
+        co_return result.status;
+    }
+
+    void BM_Sync(benchmark::State& state)
+    {
+        Fixture& f = fixture();
+        VerifiedTokenCache cache;
+        JWTVerifier verifier(*f.keys, { .cache = state.range(0) != 0 ? &cache : nullptr });
+
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+        }
+        state.SetLabel(state.range(0) != 0 ? "cached" : "uncached");
+    }
+
+    // a Task per token, driven to completion by syncWait()
+    void BM_CoAwait(benchmark::State& state)
+    {
+        Fixture& f = fixture();
+        VerifiedTokenCache cache;
+        AsyncJWTVerifier verifier(*f.keys, f.executor, { .cache = state.range(0) != 0 ? &cache : nullptr });
+
+        for (auto _ : state)
+        {
+            if (syncWait(verifyTask(verifier, f.token)) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+        }
+        state.SetLabel(state.range(0) != 0 ? "cached" : "uncached");
+    }
+
+    BENCHMARK(BM_Sync)->Arg(1)->Arg(0);
+    BENCHMARK(BM_CoAwait)->Arg(1)->Arg(0);
+}
+
+BENCHMARK_MAIN();
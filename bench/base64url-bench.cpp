@@ -0,0 +1,87 @@
+// base64url throughput per kernel; compare bytes_per_second across the
+// kernel argument, where 0 is the scalar path
+
+#include <ncbi/base64url.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+using namespace ncbi;
+
+namespace
+{
+    std::string randomBytes(size_t size)
+    {
+        std::mt19937_64 rng(size);
+        std::string data(size, '\0');
+        for (char& ch : data)
+            ch = static_cast<char>(rng());
+        return data;
+    }
+
+    bool selectKernel(benchmark::State& state)
+    {
+        auto kernel = static_cast<Base64URLKernel>(state.range(0));
+        if (!base64urlSelectKernel(kernel))
+        {
+            state.SkipWithError("kernel not supported by this CPU");
+            return false;
+        }
+        return true;
+    }
+
+    void BM_Encode(benchmark::State& state)
+    {
+        if (!selectKernel(state))
+            return;
+
+        std::string data = randomBytes(static_cast<size_t>(state.range(1)));
+        std::string out(base64urlEncodedSize(data.size()), '\0');
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(base64urlEncode(data.data(), data.size(), out.data()));
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    }
+
+    // throughput is counted in encoded characters consumed
+    void BM_Decode(benchmark::State& state)
+    {
+        if (!selectKernel(state))
+            return;
+
+        std::string data = randomBytes(static_cast<size_t>(state.range(1)));
+        std::string text(base64urlEncodedSize(data.size()), '\0');
+        base64urlEncode(data.data(), data.size(), text.data());
+        std::string out(base64urlDecodedSize(text.size()), '\0');
+
+        for (auto _ : state)
+        {
+            size_t written;
+            benchmark::DoNotOptimize(base64urlDecode(text, out.data(), written));
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+    }
+
+    // kernel x size; 48 bytes is a small JWT header, 768 a typical
+    // payload, 64 KiB measures the steady state
+    void kernelsAndSizes(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "kernel", "bytes" });
+        for (int kernel = 0; kernel <= 3; ++kernel)
+        {
+            for (int size : { 48, 256, 768, 4096, 65536 })
+                b->Args({ kernel, size });
+        }
+    }
+
+    BENCHMARK(BM_Encode)->Apply(kernelsAndSizes);
+    BENCHMARK(BM_Decode)->Apply(kernelsAndSizes);
+}
+
+BENCHMARK_MAIN();
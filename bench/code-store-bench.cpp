@@ -0,0 +1,124 @@
+// authorization code stores under a login storm: MemoryCodeStore, one
+// map behind one mutex, against ShardedCodeStore
+//
+//     IssueConsume/<store>    issue a code, then redeem it
+//     Storm/<store>           1024 codes issued, then redeemed in another order
+//     Sustained               1M codes per simulated second, one in ten
+//                             never redeemed, expire() once a second
+//
+// items are codes; 1M/s is the target for the sharded store
+
+#include <ncbi/code-store.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+    constexpr int64_t lifetime = 60;
+
+    AuthorizationGrant grant()
+    {
+        AuthorizationGrant g;
+        g.clientId = "bench-client";
+        g.subject = "user-1";
+        g.scope = "openid profile";
+        g.redirectURI = "https://app.example.org/cb";
+        g.codeChallenge = "E9Melhoa2OwvFrEMTJguCHaoeK1t8URWbuGJSstw-cM";
+        g.expires = benchNow + lifetime;
+        return g;
+    }
+
+    std::unique_ptr<AuthorizationCodeStore> makeStore(bool sharded)
+    {
+        if (!sharded)
+            return std::make_unique<MemoryCodeStore>();
+        ShardedCodeStoreOptions options;
+        options.start = benchNow;
+        return std::make_unique<ShardedCodeStore>(options);
+    }
+
+    // shared by the threads of a multi-threaded run
+    std::unique_ptr<AuthorizationCodeStore> shared;
+
+    void IssueConsume(benchmark::State& state, bool sharded)
+    {
+        if (state.thread_index() == 0)
+            shared = makeStore(sharded);
+        AuthorizationGrant prototype = grant();
+        AuthorizationGrant out;
+
+        for (auto _ : state)
+        {
+            std::string code = shared->issue(prototype);
+            if (!shared->consume(code, benchNow, out))
+                state.SkipWithError("code not redeemed");
+        }
+        state.SetItemsProcessed(state.iterations());
+
+        if (state.thread_index() == 0)
+            shared.reset();
+    }
+
+    void Storm(benchmark::State& state, bool sharded)
+    {
+        constexpr size_t batch = 1024;
+        std::unique_ptr<AuthorizationCodeStore> store = makeStore(sharded);
+        AuthorizationGrant prototype = grant();
+        AuthorizationGrant out;
+        std::vector<std::string> codes(batch);
+
+        for (auto _ : state)
+        {
+            for (std::string& code : codes)
+                code = store->issue(prototype);
+            // a stride coprime to the batch visits every code once
+            for (size_t i = 0; i < batch; ++i)
+            {
+                if (!store->consume(codes[(i * 389) % batch], benchNow, out))
+                    state.SkipWithError("code not redeemed");
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+    }
+
+    void Sustained(benchmark::State& state)
+    {
+        constexpr int64_t perSecond = 1000000;
+        ShardedCodeStoreOptions options;
+        options.start = benchNow;
+        options.capacity = size_t(1) << 22;
+        ShardedCodeStore store(options);
+        AuthorizationGrant prototype = grant();
+        prototype.expires = benchNow + 2;
+        AuthorizationGrant out;
+
+        int64_t issued = 0;
+        for (auto _ : state)
+        {
+            int64_t now = benchNow + issued / perSecond;
+            prototype.expires = now + 2;
+            std::string code = store.issue(prototype);
+            if (issued % 10 != 0 && !store.consume(code, now, out))
+                state.SkipWithError("code not redeemed");
+            if (++issued % perSecond == 0)
+                store.expire(benchNow + issued / perSecond);
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["live"] = static_cast<double>(store.size());
+    }
+}
+
+BENCHMARK_CAPTURE(IssueConsume, memory, false)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_CAPTURE(IssueConsume, sharded, true)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_CAPTURE(Storm, memory, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(Storm, sharded, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK(Sustained)->Iterations(5000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,149 @@
+// hot reload of the verifier configuration through VerifierConfigFeed
+//
+//     Verify/<reloading>      HS256 verification with a result cache, 64
+//                             tenants, optionally while the configuration
+//                             is swapped every 100 µs
+//     Apply/<tenants>         VerifierConfigFeed::apply() of a changed
+//                             policy with every key set cache carried over
+//
+// Verify reports the cache hit ratio, which stays high across swaps
+// because cached results are revalidated rather than dropped
+
+#include "token-fixtures.hpp"
+
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/verifier-config.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+    constexpr std::string_view secretA = "secret-of-configuration-A-32byte";
+    constexpr std::string_view secretB = "secret-of-configuration-B-32byte";
+    constexpr std::string_view header = R"({"alg":"HS256","typ":"JWT","kid":"k"})";
+
+    // serves key sets "stand-in:keys-a" and "stand-in:keys-b"
+    std::shared_ptr<FunctionFetcher> keyServer()
+    {
+        return std::make_shared<FunctionFetcher>([](const std::string& uri)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"keys":[)" +
+                publicJWK(JWTAlg::HS256, nullptr, "k", uri.back() == 'a' ? secretA : secretB) + "]}";
+            return response;
+        });
+    }
+
+    std::string tenantName(size_t i)
+    {
+        return "https://tenant-" + std::to_string(i) + ".example.org";
+    }
+
+    std::string token(std::string_view secret, std::string_view iss, std::string_view aud, int64_t exp)
+    {
+        return makeHS256Token(header, R"({"iss":")" + std::string(iss) + R"(","aud":")" + std::string(aud) +
+            R"(","sub":"user-1","exp":)" + std::to_string(exp) + R"(,"jti":"j-1"})", secret);
+    }
+
+    // 64 tenants sharing one key set, with "generation" in the last
+    // tenant's audiences so that successive configurations differ
+    VerifierConfig tenants(size_t count, size_t generation)
+    {
+        VerifierConfig config;
+        for (size_t i = 0; i < count; ++i)
+        {
+            IssuerConfig& tenant = config.issuers.emplace_back();
+            tenant.issuer = tenantName(i);
+            tenant.jwksURI = "stand-in:keys-a";
+            tenant.audiences = { "api-" + std::to_string(i) };
+            if (i + 1 == count)
+                tenant.audiences.push_back("api-generation-" + std::to_string(generation));
+        }
+        return config;
+    }
+
+    void Verify(benchmark::State& state)
+    {
+        constexpr size_t count = 64;
+        IssuerRegistry registry;
+        VerifierConfigFeed feed(registry, "stand-in:config", keyServer());
+        feed.apply(tenants(count, 0));
+
+        VerifiedTokenCache cache;
+        JWTVerifierOptions options;
+        options.cache = &cache;
+        JWTVerifier verifier(registry, options);
+
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < count; ++i)
+            tokens.push_back(token(secretA, tenantName(i), "api-" + std::to_string(i), benchNow + 600));
+
+        std::atomic<bool> stop { false };
+        std::jthread reloader;
+        if (state.range(0) != 0)
+        {
+            reloader = std::jthread([&]
+            {
+                for (size_t generation = 1; !stop.load(std::memory_order_relaxed); ++generation)
+                {
+                    feed.apply(tenants(count, generation));
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            });
+        }
+
+        VerifiedTokenCache::Stats before = cache.stats();
+        std::shared_ptr<const VerifiedToken> result;
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            if (verifier.verify(tokens[i], benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result.get());
+            if (++i == tokens.size())
+                i = 0;
+        }
+        stop = true;
+        if (reloader.joinable())
+            reloader.join();
+
+        VerifiedTokenCache::Stats after = cache.stats();
+        double hits = static_cast<double>(after.hits - before.hits);
+        double lookups = hits + static_cast<double>(after.misses - before.misses);
+        state.counters["hit_ratio"] = lookups > 0 ? hits / lookups : 0;
+        state.counters["generation"] = static_cast<double>(registry.snapshot().generation());
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Apply(benchmark::State& state)
+    {
+        size_t count = static_cast<size_t>(state.range(0));
+        IssuerRegistry registry;
+        VerifierConfigFeed feed(registry, "stand-in:config", keyServer());
+        VerifierConfig configs[] = { tenants(count, 0), tenants(count, 1) };
+        feed.apply(configs[0]);
+
+        size_t generation = 0;
+        for (auto _ : state)
+            feed.apply(configs[++generation % 2]);
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(Verify)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(Apply)->Arg(1)->Arg(64)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
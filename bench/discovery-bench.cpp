@@ -0,0 +1,139 @@
+// OpenID Connect discovery against a stand-in server: a FunctionFetcher
+// that serves each issuer's openid-configuration and the corpus JWKS
+// after a simulated network delay
+//
+//     Lookup/<issuers>        the per-request path: snapshot and find by issuer
+//     LookupKey/<issuers>     the same, then the provider's key by "kid"
+//     ColdStart/<issuers>     add every issuer and wait for the prefetch
+//
+// the lookup cases fail if any fetch happens while they run, which is
+// the promise DiscoveryCache makes to requests for a known issuer
+
+#include "token-corpus.hpp"
+
+#include <ncbi/oidc-discovery.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr std::string_view wellKnown = "/.well-known/openid-configuration";
+    constexpr std::chrono::milliseconds latency { 2 };
+
+    std::string issuerName(size_t i)
+    {
+        return "https://issuer-" + std::to_string(i) + ".example.org";
+    }
+
+    // the stand-in server, counting the requests it answers
+    struct StandIn
+    {
+        std::string jwks = corpusJWKS(std::size(corpusAlgs));
+        std::atomic<uint64_t> requests { 0 };
+        std::shared_ptr<FunctionFetcher> fetcher = std::make_shared<FunctionFetcher>([this](const std::string& uri)
+        {
+            requests.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(latency);
+
+            FetchResponse response;
+            response.status = 200;
+            response.cacheControl = "max-age=3600";
+            if (uri.size() > wellKnown.size() && uri.compare(uri.size() - wellKnown.size(), wellKnown.size(), wellKnown) == 0)
+            {
+                std::string issuer = uri.substr(0, uri.size() - wellKnown.size());
+                response.body = R"({"issuer":")" + issuer + R"(","jwks_uri":")" + issuer + R"(/jwks",)"
+                    R"("authorization_endpoint":")" + issuer + R"(/authorize","token_endpoint":")" + issuer + R"(/token",)"
+                    R"("response_types_supported":["code"],"scopes_supported":["openid","profile","email"],)"
+                    R"("id_token_signing_alg_values_supported":["RS256","ES256"],"code_challenge_methods_supported":["S256"]})";
+            }
+            else
+                response.body = jwks;
+            return response;
+        });
+    };
+
+    void start(DiscoveryCache& cache, size_t issuers)
+    {
+        for (size_t i = 0; i < issuers; ++i)
+            cache.add(issuerName(i));
+        if (!cache.waitUntilReady(std::chrono::minutes(1)))
+            throw std::runtime_error("discovery failed");
+    }
+
+    void Lookup(benchmark::State& state)
+    {
+        size_t issuers = static_cast<size_t>(state.range(0));
+        StandIn server;
+        DiscoveryCache cache(server.fetcher);
+        start(cache, issuers);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < issuers; ++i)
+            names.push_back(issuerName(i));
+
+        uint64_t before = server.requests.load();
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            DiscoveryCache::Snapshot snapshot = cache.snapshot();
+            benchmark::DoNotOptimize(snapshot.find(names[i++ % names.size()]));
+        }
+        if (server.requests.load() != before)
+            state.SkipWithError("a lookup fetched");
+    }
+
+    void LookupKey(benchmark::State& state)
+    {
+        size_t issuers = static_cast<size_t>(state.range(0));
+        StandIn server;
+        DiscoveryCache cache(server.fetcher);
+        start(cache, issuers);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < issuers; ++i)
+            names.push_back(issuerName(i));
+        std::string kid = corpusKid(JWTAlg::ES256);
+
+        uint64_t before = server.requests.load();
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            DiscoveryCache::Snapshot snapshot = cache.snapshot();
+            const DiscoveryCache::Provider* provider = snapshot.find(names[i++ % names.size()]);
+            JWKSCache::Snapshot keys = provider->keys->snapshot();
+            if (keys.find(kid, JWTAlg::ES256) == nullptr)
+                state.SkipWithError("key not found");
+        }
+        if (server.requests.load() != before)
+            state.SkipWithError("a lookup fetched");
+    }
+
+    // the wait a request would pay if metadata were fetched on demand:
+    // two round trips per issuer
+    void ColdStart(benchmark::State& state)
+    {
+        size_t issuers = static_cast<size_t>(state.range(0));
+        StandIn server;
+        for (auto _ : state)
+        {
+            DiscoveryCache cache(server.fetcher);
+            start(cache, issuers);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(Lookup)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(LookupKey)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(ColdStart)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,226 @@
+// DPoP (RFC 9449): a bound access token verified together with the proof
+// presented alongside it, against the access token alone
+//
+//     Token                   HS256 access token alone, through a result
+//                             cache, as without DPoP
+//     Bound/<alg>             the same token and a fresh proof signed with
+//                             ES256 or EdDSA, through DPoPVerifier
+//     Proof/<alg>             the proof alone
+//     Replay/<shards>         DPoPReplayCache::insert() of fresh "jti"
+//                             values, with the clock moving a second every
+//                             4096 of them, so generations keep rotating
+//
+// every proof carries a new "jti", so each one goes through the replay
+// cache as it would in service; proofs are signed ahead of time
+// Bound is dominated by the proof signature, while Token costs a cache
+// hit: the difference is the price of sender-constraining the token
+
+#include "token-fixtures.hpp"
+
+#include <ncbi/dpop.hpp>
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/verified-cache.hpp>
+
+#include <openssl/sha.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+    constexpr size_t proofCount = 4096;
+
+    const DPoPRequest request { "POST", "https://api.example.org/orders?page=2", {}, {} };
+
+    std::string proof(JWTAlg alg, EVP_PKEY* pkey, std::string_view jwk, std::string_view jti, std::string_view ath)
+    {
+        std::string header = R"({"typ":"dpop+jwt","alg":")" + std::string(algName(alg)) + R"(","jwk":)" +
+            std::string(jwk) + '}';
+        std::string payload = R"({"jti":")" + std::string(jti) + R"(","htm":"POST",)"
+            R"("htu":"https://api.example.org/orders","iat":)" + std::to_string(benchNow) +
+            R"(,"ath":")" + std::string(ath) + R"("})";
+        std::string signingInput = base64url(header) + '.' + base64url(payload);
+        return signingInput + '.' + base64url(signJWS(alg, pkey, signingInput));
+    }
+
+    std::string tokenHash(std::string_view token)
+    {
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(token.data()), token.size(), digest);
+        return base64url(std::string_view(reinterpret_cast<const char*>(digest), sizeof digest));
+    }
+
+    // a client with its proof key, an access token bound to that key, and
+    // proofs for it, each with its own "jti"
+    struct Client
+    {
+        JWTAlg alg;
+        PKey key;
+        std::string jwk;
+        std::string token;
+        std::vector<std::string> proofs;
+
+        Client(JWTAlg alg, size_t proofs, std::string_view prefix)
+            : alg(alg)
+            , key(generateKey(alg))
+            , jwk(publicJWK(alg, key.get(), "client"))
+        {
+            std::string jkt = jwkThumbprint(JWK::parse(jwk));
+            token = makeHS256Token(benchHeader, R"({"iss":"https://login.example.org","sub":"user-1234567",)"
+                R"("aud":"https://api.example.org","exp":4102444800,"iat":1700000000,)"
+                R"("scope":"orders:read orders:write","cnf":{"jkt":")" + jkt + R"("}})", benchSecret);
+            for (size_t i = 0; i < proofs; ++i)
+                this->proofs.push_back(makeProof(std::string(prefix) + "-" + std::to_string(i)));
+        }
+
+        std::string makeProof(std::string_view jti) const
+        {
+            return proof(alg, key.get(), jwk, jti, tokenHash(token));
+        }
+    };
+
+    std::shared_ptr<FunctionFetcher> keyServer()
+    {
+        std::string jwks = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+        return std::make_shared<FunctionFetcher>([jwks](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = jwks;
+            return response;
+        });
+    }
+
+    // the access token verifier every benchmark shares, with a result
+    // cache as a resource server would run it
+    struct TokenVerifier
+    {
+        JWKSCache keys { "stand-in:jwks", keyServer() };
+        VerifiedTokenCache cache;
+        JWTVerifier verifier;
+
+        TokenVerifier()
+            : verifier(keys, options(cache))
+        {
+            keys.start();
+        }
+
+        static JWTVerifierOptions options(VerifiedTokenCache& cache)
+        {
+            JWTVerifierOptions options;
+            options.cache = &cache;
+            return options;
+        }
+    };
+
+    void Token(benchmark::State& state)
+    {
+        TokenVerifier tokens;
+        Client client(JWTAlg::ES256, 0, "token");
+
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (tokens.verifier.verify(client.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result.get());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // verifies proofs until they run out, then starts over with a new
+    // verifier, and so a new replay cache, outside the timed region
+    template<class Verify>
+    void runProofs(benchmark::State& state, const Client& client, Verify verify)
+    {
+        auto dpop = std::make_unique<DPoPVerifier>();
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            if (i == client.proofs.size())
+            {
+                state.PauseTiming();
+                dpop = std::make_unique<DPoPVerifier>();
+                i = 0;
+                state.ResumeTiming();
+            }
+            if (verify(*dpop, client.proofs[i++]) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Bound(benchmark::State& state)
+    {
+        JWTAlg alg = state.range(0) == 0 ? JWTAlg::ES256 : JWTAlg::EdDSA;
+        state.SetLabel(std::string(algName(alg)));
+        TokenVerifier tokens;
+        Client client(alg, proofCount, "bound");
+
+        std::shared_ptr<const VerifiedToken> result;
+        runProofs(state, client, [&](const DPoPVerifier& dpop, const std::string& proof)
+        {
+            JWTStatus status = dpop.verify(tokens.verifier, client.token, proof, request, benchNow, result);
+            benchmark::DoNotOptimize(result.get());
+            return status;
+        });
+    }
+
+    void Proof(benchmark::State& state)
+    {
+        JWTAlg alg = state.range(0) == 0 ? JWTAlg::ES256 : JWTAlg::EdDSA;
+        state.SetLabel(std::string(algName(alg)));
+        Client client(alg, proofCount, "proof");
+
+        DPoPRequest bound = request;
+        bound.accessToken = client.token;
+        DPoPProof accepted;
+        runProofs(state, client, [&](const DPoPVerifier& dpop, const std::string& proof)
+        {
+            JWTStatus status = dpop.verify(proof, bound, benchNow, accepted);
+            benchmark::DoNotOptimize(accepted.iat);
+            return status;
+        });
+    }
+
+    void Replay(benchmark::State& state)
+    {
+        DPoPReplayCacheOptions options;
+        options.shards = static_cast<unsigned>(state.range(0));
+        DPoPReplayCache cache(options);
+
+        // numbered "jti" values, a new second every 4096 of them
+        char jti[] = "e1b2c3d4-5f6a-4b7c-8d9e-000000000000";
+        constexpr size_t digits = 12;
+        uint64_t n = 0;
+        for (auto _ : state)
+        {
+            uint64_t v = n++;
+            for (size_t d = 0; d < digits; ++d, v /= 10)
+                jti[sizeof jti - 2 - d] = static_cast<char>('0' + v % 10);
+            if (cache.insert(std::string_view(jti, sizeof jti - 1), benchNow + static_cast<int64_t>(n / proofCount)) !=
+                DPoPReplayCache::Result::fresh)
+            {
+                state.SkipWithError("fresh jti refused");
+            }
+        }
+        DPoPReplayCache::Stats stats = cache.stats();
+        state.counters["rotations"] = static_cast<double>(stats.rotations);
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(Token);
+BENCHMARK(Bound)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(Proof)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(Replay)->Arg(1)->Arg(16);
+
+BENCHMARK_MAIN();
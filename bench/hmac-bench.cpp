@@ -0,0 +1,146 @@
+// HS256, HS384 and HS512 verification over the signing inputs of the
+// small, medium and large corpus tokens: HMACVerifier, which absorbs the
+// key once, against a naive HMAC that keys OpenSSL's one-shot HMAC() for
+// every token, and against an EVP_MAC context re-initialized per token
+
+#include "token-corpus.hpp"
+
+#include <ncbi/jws.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr JWTAlg algs[] = { JWTAlg::HS256, JWTAlg::HS384, JWTAlg::HS512 };
+    constexpr CorpusSize sizes[] = { CorpusSize::small, CorpusSize::medium, CorpusSize::large };
+
+    // signing inputs with their decoded signatures
+    struct Corpus
+    {
+        std::vector<std::string> inputs;
+        std::vector<std::string> signatures;
+
+        Corpus(JWTAlg alg, CorpusSize size)
+        {
+            CorpusOptions options;
+            options.size = size;
+            for (const std::string& token : corpusTokens(alg, options))
+            {
+                size_t dot = token.rfind('.');
+                inputs.push_back(token.substr(0, dot));
+                std::string signature(algDigestSize(alg), '\0');
+                size_t written;
+                base64urlDecode(std::string_view(token).substr(dot + 1), signature.data(), written);
+                signatures.push_back(std::move(signature));
+            }
+        }
+    };
+
+    template <typename Verify>
+    void run(benchmark::State& state, JWTAlg alg, CorpusSize size, Verify verify)
+    {
+        Corpus corpus(alg, size);
+        size_t i = 0;
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            size_t n = i++ % corpus.inputs.size();
+            if (!verify(corpus.inputs[n], reinterpret_cast<const unsigned char*>(corpus.signatures[n].data())))
+                state.SkipWithError("MAC mismatch");
+            bytes += static_cast<int64_t>(corpus.inputs[n].size());
+        }
+        state.SetBytesProcessed(bytes);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    const EVP_MD* digest(JWTAlg alg)
+    {
+        return alg == JWTAlg::HS256 ? EVP_sha256() : alg == JWTAlg::HS384 ? EVP_sha384() : EVP_sha512();
+    }
+
+    void Naive(benchmark::State& state, JWTAlg alg, CorpusSize size)
+    {
+        std::string secret = corpusSecret();
+        size_t macSize = algDigestSize(alg);
+        run(state, alg, size, [&](std::string_view input, const unsigned char* signature)
+        {
+            unsigned char mac[EVP_MAX_MD_SIZE];
+            unsigned int written = 0;
+            HMAC(digest(alg), secret.data(), static_cast<int>(secret.size()),
+                reinterpret_cast<const unsigned char*>(input.data()), input.size(), mac, &written);
+            return written == macSize && CRYPTO_memcmp(mac, signature, macSize) == 0;
+        });
+    }
+
+    void EVPMAC(benchmark::State& state, JWTAlg alg, CorpusSize size)
+    {
+        std::string secret = corpusSecret();
+        size_t macSize = algDigestSize(alg);
+        EVP_MAC* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+        EVP_MAC_CTX* ctx = EVP_MAC_CTX_new(mac);
+        std::string name(EVP_MD_get0_name(digest(alg)));
+        OSSL_PARAM params[] =
+        {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, name.data(), 0),
+            OSSL_PARAM_construct_end()
+        };
+        EVP_MAC_init(ctx, reinterpret_cast<const unsigned char*>(secret.data()), secret.size(), params);
+
+        run(state, alg, size, [&](std::string_view input, const unsigned char* signature)
+        {
+            unsigned char out[EVP_MAX_MD_SIZE];
+            size_t written = 0;
+            EVP_MAC_init(ctx, nullptr, 0, nullptr);
+            EVP_MAC_update(ctx, reinterpret_cast<const unsigned char*>(input.data()), input.size());
+            EVP_MAC_final(ctx, out, &written, sizeof out);
+            return written == macSize && CRYPTO_memcmp(out, signature, macSize) == 0;
+        });
+        EVP_MAC_CTX_free(ctx);
+        EVP_MAC_free(mac);
+    }
+
+    void Precomputed(benchmark::State& state, JWTAlg alg, CorpusSize size)
+    {
+        HMACVerifier verifier(alg, corpusSecret());
+        size_t macSize = algDigestSize(alg);
+        run(state, alg, size, [&](std::string_view input, const unsigned char* signature)
+        {
+            return verifier.verify(input, signature, macSize);
+        });
+    }
+
+    void registerAll()
+    {
+        for (JWTAlg alg : algs)
+        {
+            for (CorpusSize size : sizes)
+            {
+                std::string suffix = '/' + std::string(algName(alg)) + '/' + toString(size);
+                benchmark::RegisterBenchmark(("Naive" + suffix).c_str(), Naive, alg, size);
+                benchmark::RegisterBenchmark(("EVPMAC" + suffix).c_str(), EVPMAC, alg, size);
+                benchmark::RegisterBenchmark(("Precomputed" + suffix).c_str(), Precomputed, alg, size);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    registerAll();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
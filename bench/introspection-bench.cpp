@@ -0,0 +1,85 @@
+// RFC 7662 introspection against an in-process stand-in server with a
+// fixed response latency: cached lookups, and bursts of concurrent
+// lookups for a token nobody has asked about yet
+
+#include <ncbi/introspection.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr auto serverLatency = std::chrono::milliseconds(2);
+
+    std::shared_ptr<Fetcher> standInServer()
+    {
+        return std::make_shared<FunctionFetcher>(nullptr,
+            [](const std::string&, const FetchRequest& request)
+            {
+                std::this_thread::sleep_for(serverLatency);
+                FetchResponse response;
+                response.status = 200;
+                response.body = request.body.starts_with("token=revoked")
+                    ? R"({"active":false})"
+                    : R"({"active":true,"scope":"openid sra:read","client_id":"bench",)"
+                      R"("sub":"user-1234567","exp":4102444800,"iss":"https://auth.ncbi.nlm.nih.gov"})";
+                return response;
+            });
+    }
+
+    void BM_CachedLookup(benchmark::State& state)
+    {
+        static IntrospectionClient client("stand-in:introspect", standInServer(),
+            { .clientId = "bench", .clientSecret = "secret" });
+
+        std::shared_ptr<const IntrospectionResult> result;
+        for (auto _ : state)
+        {
+            if (client.introspect("opaque-token-0123456789", result) != JWTStatus::ok)
+                state.SkipWithError("introspection failed");
+        }
+    }
+    BENCHMARK(BM_CachedLookup)->ThreadRange(1, 8)->UseRealTime();
+
+    // "callers" threads ask for the same fresh token at once; with
+    // coalescing the server sees one request per burst
+    void BM_ColdBurst(benchmark::State& state)
+    {
+        IntrospectionClient client("stand-in:introspect", standInServer(),
+            { .clientId = "bench", .clientSecret = "secret" });
+        int callers = static_cast<int>(state.range(0));
+
+        uint64_t burst = 0;
+        for (auto _ : state)
+        {
+            std::string token = "opaque-token-" + std::to_string(burst++);
+            std::atomic<int> ready { 0 };
+            std::vector<std::jthread> threads;
+            for (int i = 0; i < callers; ++i)
+            {
+                threads.emplace_back([&]
+                {
+                    ready.fetch_add(1);
+                    while (ready.load() < callers)
+                        std::this_thread::yield();
+
+                    std::shared_ptr<const IntrospectionResult> result;
+                    benchmark::DoNotOptimize(client.introspect(token, result));
+                });
+            }
+        }
+
+        IntrospectionClient::Stats stats = client.stats();
+        state.counters["requests/burst"] = static_cast<double>(stats.requests) / static_cast<double>(burst);
+        state.counters["coalesced"] = static_cast<double>(stats.coalesced);
+    }
+    BENCHMARK(BM_ColdBurst)->RangeMultiplier(4)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,196 @@
+// issuer resolution for a multi-tenant verifier: IssuerRegistry's
+// perfect hash against comparing "iss" with each trusted issuer in turn
+//
+//     Resolve/<tenants>       snapshot and find, cycling through the issuers
+//     ResolveMiss/<tenants>   the same for issuers that are not trusted
+//     Linear/<tenants>        a scan of the policy list comparing issuers
+//     Verify/<tenants>        full HS256 verification through JWTVerifier
+//     Compile/<tenants>       reload(), building the perfect hash
+//
+// items are lookups, tokens or issuers; Resolve should stay flat as the
+// tenant count grows, where Linear grows with it
+
+#include "token-fixtures.hpp"
+
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwt-verifier.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    std::string issuerName(size_t i)
+    {
+        return "https://login.tenant-" + std::to_string(i) + ".example.org/oauth2/v2.0";
+    }
+
+    // one HS256 key set, shared by every tenant; the lookups never touch it
+    std::shared_ptr<JWKSCache> sharedKeys()
+    {
+        static std::shared_ptr<JWKSCache> keys = []
+        {
+            std::string jwks = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            auto cache = std::make_shared<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            cache->start();
+            return cache;
+        }();
+        return keys;
+    }
+
+    std::vector<IssuerPolicy> policies(size_t tenants)
+    {
+        std::vector<IssuerPolicy> list(tenants);
+        for (size_t i = 0; i < tenants; ++i)
+        {
+            list[i].issuer = issuerName(i);
+            list[i].keys = sharedKeys();
+            list[i].audiences = { "https://api.tenant-" + std::to_string(i) + ".example.org" };
+            list[i].algorithms = { JWTAlg::HS256 };
+        }
+        return list;
+    }
+
+    std::vector<std::string> names(size_t tenants, size_t from = 0)
+    {
+        std::vector<std::string> list;
+        for (size_t i = 0; i < tenants; ++i)
+            list.push_back(issuerName(from + i));
+        return list;
+    }
+
+    void Resolve(benchmark::State& state)
+    {
+        size_t tenants = static_cast<size_t>(state.range(0));
+        IssuerRegistry registry(policies(tenants));
+        std::vector<std::string> issuers = names(tenants);
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            IssuerRegistry::Snapshot snapshot = registry.snapshot();
+            const IssuerPolicy* policy = snapshot.find(issuers[i]);
+            if (policy == nullptr)
+                state.SkipWithError("issuer not found");
+            benchmark::DoNotOptimize(policy);
+            if (++i == issuers.size())
+                i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void ResolveMiss(benchmark::State& state)
+    {
+        size_t tenants = static_cast<size_t>(state.range(0));
+        IssuerRegistry registry(policies(tenants));
+        std::vector<std::string> issuers = names(tenants, tenants);
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            IssuerRegistry::Snapshot snapshot = registry.snapshot();
+            const IssuerPolicy* policy = snapshot.find(issuers[i]);
+            if (policy != nullptr)
+                state.SkipWithError("untrusted issuer found");
+            benchmark::DoNotOptimize(policy);
+            if (++i == issuers.size())
+                i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Linear(benchmark::State& state)
+    {
+        size_t tenants = static_cast<size_t>(state.range(0));
+        std::vector<IssuerPolicy> list = policies(tenants);
+        std::vector<std::string> issuers = names(tenants);
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            const IssuerPolicy* policy = nullptr;
+            for (const IssuerPolicy& p : list)
+            {
+                if (p.issuer == issuers[i])
+                {
+                    policy = &p;
+                    break;
+                }
+            }
+            if (policy == nullptr)
+                state.SkipWithError("issuer not found");
+            benchmark::DoNotOptimize(policy);
+            if (++i == issuers.size())
+                i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Verify(benchmark::State& state)
+    {
+        size_t tenants = static_cast<size_t>(state.range(0));
+        IssuerRegistry registry(policies(tenants));
+        JWTVerifier verifier(registry);
+
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < tenants; ++i)
+        {
+            std::string payload = R"({"iss":")" + issuerName(i) + R"(","sub":"user-1234567",)"
+                R"("aud":"https://api.tenant-)" + std::to_string(i) + R"(.example.org","exp":4102444800,)"
+                R"("iat":1700000000,"jti":"b7c1e3a4-5d2f-4e8a-9b3c-1f2e3d4c5b6a","scope":"openid profile"})";
+            tokens.push_back(makeHS256Token(benchHeader, payload, benchSecret));
+        }
+
+        std::shared_ptr<const VerifiedToken> result;
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            if (verifier.verify(tokens[i], benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result.get());
+            if (++i == tokens.size())
+                i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Compile(benchmark::State& state)
+    {
+        size_t tenants = static_cast<size_t>(state.range(0));
+        std::vector<IssuerPolicy> list = policies(tenants);
+        IssuerRegistry registry;
+
+        // the same caches every time, so none is dropped
+        for (auto _ : state)
+            benchmark::DoNotOptimize(registry.reload(list).size());
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tenants));
+    }
+
+    void tenantCounts(benchmark::internal::Benchmark* b)
+    {
+        b->Arg(1)->Arg(16)->Arg(64)->Arg(256)->Arg(4096);
+    }
+}
+
+BENCHMARK(Resolve)->Apply(tenantCounts);
+BENCHMARK(ResolveMiss)->Apply(tenantCounts);
+BENCHMARK(Linear)->Apply(tenantCounts);
+BENCHMARK(Verify)->Arg(1)->Arg(256);
+BENCHMARK(Compile)->Apply(tenantCounts)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+// JWE decryption: AES-GCM throughput by payload size with "dir", where
+// content decryption is all the work, and the per-token cost of each key
+// management algorithm at the small corpus size
+//
+//     Decrypt/dir/<enc>/<size>      the corpus sizes, then 4 KiB to 1 MiB
+//     Decrypt/<alg>/A256GCM/small
+//
+// bytes per second count the plaintext
+
+#include "jwe-fixtures.hpp"
+#include "token-corpus.hpp"
+
+#include <ncbi/jwe.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr JWEEnc encs[] = { JWEEnc::A128GCM, JWEEnc::A256GCM };
+    constexpr CorpusSize sizes[] = { CorpusSize::small, CorpusSize::medium, CorpusSize::large };
+    constexpr size_t bulkSizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+    constexpr JWEAlg keyAlgs[] =
+    {
+        JWEAlg::A128KW, JWEAlg::A256KW, JWEAlg::RSA_OAEP, JWEAlg::RSA_OAEP_256,
+        JWEAlg::ECDH_ES, JWEAlg::ECDH_ES_A128KW, JWEAlg::ECDH_ES_A256KW
+    };
+
+    void run(benchmark::State& state, const JWEDecrypter& decrypter, const std::vector<std::string>& tokens)
+    {
+        size_t capacity = 0;
+        for (const std::string& token : tokens)
+            capacity = std::max(capacity, token.size());
+        std::string buf(capacity, '\0');
+
+        size_t i = 0;
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::string_view plaintext;
+            if (decrypter.decrypt(tokens[i++ % tokens.size()], buf.data(), buf.size(), plaintext) != JWTStatus::ok)
+                state.SkipWithError("decryption failed");
+            bytes += static_cast<int64_t>(plaintext.size());
+        }
+        state.SetBytesProcessed(bytes);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void DirCorpus(benchmark::State& state, JWEEnc enc, CorpusSize size)
+    {
+        std::string key = corpusSecret().substr(0, jweKeySize(enc));
+        CorpusOptions options;
+        options.size = size;
+        std::vector<std::string> tokens;
+        for (const std::string& payload : corpusPayloads(options))
+            tokens.push_back(makeJWE(JWEAlg::dir, enc, nullptr, key, payload));
+        run(state, SymmetricJWEDecrypter(JWEAlg::dir, key), tokens);
+    }
+
+    void DirBulk(benchmark::State& state, JWEEnc enc, size_t size)
+    {
+        std::string key = corpusSecret().substr(0, jweKeySize(enc));
+        CorpusRandom random(CorpusOptions().seed);
+        std::vector<std::string> tokens;
+        for (int n = 0; n < 4; ++n)
+        {
+            std::string payload(size, '\0');
+            for (char& c : payload)
+                c = static_cast<char>('a' + random.below(26));
+            tokens.push_back(makeJWE(JWEAlg::dir, enc, nullptr, key, payload));
+        }
+        run(state, SymmetricJWEDecrypter(JWEAlg::dir, key), tokens);
+    }
+
+    void KeyManagement(benchmark::State& state, JWEAlg alg)
+    {
+        constexpr JWEEnc enc = JWEEnc::A256GCM;
+        std::string secret = corpusSecret();
+        std::unique_ptr<JWEDecrypter> decrypter;
+        EVP_PKEY* pkey = nullptr;
+        if (alg == JWEAlg::A128KW || alg == JWEAlg::A256KW)
+        {
+            secret.resize(alg == JWEAlg::A128KW ? 16 : 32);
+            decrypter = std::make_unique<SymmetricJWEDecrypter>(alg, secret);
+        }
+        else
+        {
+            // the corpus signing keys serve: RSA-2048, and P-256 for ECDH
+            bool rsa = alg == JWEAlg::RSA_OAEP || alg == JWEAlg::RSA_OAEP_256;
+            pkey = corpusKey(rsa ? JWTAlg::RS256 : JWTAlg::ES256);
+            decrypter = std::make_unique<PrivateKeyJWEDecrypter>(alg, privatePEM(pkey));
+        }
+
+        CorpusOptions options;
+        options.tokens = 64;
+        std::vector<std::string> tokens;
+        for (const std::string& payload : corpusPayloads(options))
+            tokens.push_back(makeJWE(alg, enc, pkey, secret, payload));
+        run(state, *decrypter, tokens);
+    }
+
+    void registerAll()
+    {
+        for (JWEEnc enc : encs)
+        {
+            std::string prefix = "Decrypt/dir/" + std::string(jweEncName(enc)) + '/';
+            for (CorpusSize size : sizes)
+                benchmark::RegisterBenchmark((prefix + toString(size)).c_str(), DirCorpus, enc, size);
+            for (size_t size : bulkSizes)
+            {
+                benchmark::RegisterBenchmark((prefix + std::to_string(size / 1024) + "KiB").c_str(),
+                    DirBulk, enc, size)->Unit(benchmark::kMicrosecond);
+            }
+        }
+        for (JWEAlg alg : keyAlgs)
+        {
+            benchmark::RegisterBenchmark(("Decrypt/" + std::string(jweAlgName(alg)) + "/A256GCM/small").c_str(),
+                KeyManagement, alg)->Unit(benchmark::kMicrosecond);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    registerAll();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,187 @@
+// JWE compact serializations built with OpenSSL directly, for the
+// decryption benchmarks: an encryptor for every key management
+// algorithm JWEDecrypter supports
+
+#pragma once
+
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwe.hpp>
+
+#include <openssl/rand.h>
+
+#include <cstdint>
+
+namespace ncbi::bench
+{
+    inline std::string randomBytes(size_t size)
+    {
+        std::string out(size, '\0');
+        RAND_bytes(reinterpret_cast<unsigned char*>(out.data()), static_cast<int>(size));
+        return out;
+    }
+
+    // RFC 3394 key wrap of "cek" under "kek"
+    inline std::string aesWrap(std::string_view kek, std::string_view cek)
+    {
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        EVP_CIPHER_CTX_set_flags(ctx, EVP_CIPHER_CTX_FLAG_WRAP_ALLOW);
+        EVP_EncryptInit_ex(ctx, kek.size() == 16 ? EVP_aes_128_wrap() : EVP_aes_256_wrap(), nullptr,
+            reinterpret_cast<const unsigned char*>(kek.data()), nullptr);
+        std::string out(cek.size() + 8, '\0');
+        int written = 0, final = 0;
+        auto* p = reinterpret_cast<unsigned char*>(out.data());
+        EVP_EncryptUpdate(ctx, p, &written, reinterpret_cast<const unsigned char*>(cek.data()), static_cast<int>(cek.size()));
+        EVP_EncryptFinal_ex(ctx, p + written, &final);
+        EVP_CIPHER_CTX_free(ctx);
+        return out;
+    }
+
+    inline std::string rsaOAEP(EVP_PKEY* pkey, bool sha256, std::string_view cek)
+    {
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(pkey, nullptr);
+        EVP_PKEY_encrypt_init(ctx);
+        EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
+        EVP_PKEY_CTX_set_rsa_oaep_md(ctx, sha256 ? EVP_sha256() : EVP_sha1());
+        EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, sha256 ? EVP_sha256() : EVP_sha1());
+        size_t size = 0;
+        const auto* in = reinterpret_cast<const unsigned char*>(cek.data());
+        EVP_PKEY_encrypt(ctx, nullptr, &size, in, cek.size());
+        std::string out(size, '\0');
+        EVP_PKEY_encrypt(ctx, reinterpret_cast<unsigned char*>(out.data()), &size, in, cek.size());
+        EVP_PKEY_CTX_free(ctx);
+        out.resize(size);
+        return out;
+    }
+
+    // RFC 7518 section 4.6.2 Concat KDF with SHA-256, no party information
+    inline std::string concatKDF(std::string_view z, std::string_view algorithm, size_t size)
+    {
+        auto be32 = [](std::string& s, uint32_t v)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+                s += static_cast<char>(v >> shift);
+        };
+        std::string info;
+        be32(info, static_cast<uint32_t>(algorithm.size()));
+        info += algorithm;
+        be32(info, 0);
+        be32(info, 0);
+        be32(info, static_cast<uint32_t>(size * 8));
+
+        std::string out;
+        for (uint32_t counter = 1; out.size() < size; ++counter)
+        {
+            std::string round;
+            be32(round, counter);
+            round += z;
+            round += info;
+            unsigned char digest[32];
+            EVP_Digest(round.data(), round.size(), digest, nullptr, EVP_sha256(), nullptr);
+            out.append(reinterpret_cast<const char*>(digest), sizeof digest);
+        }
+        out.resize(size);
+        return out;
+    }
+
+    // an ephemeral key on the recipient's curve, its "epk" member, and the
+    // agreed secret Z
+    inline std::string ecdhEphemeral(EVP_PKEY* recipient, std::string& z)
+    {
+        PKey ephemeral;
+        std::string epk;
+        if (EVP_PKEY_is_a(recipient, "X25519"))
+        {
+            ephemeral.reset(EVP_PKEY_Q_keygen(nullptr, nullptr, "X25519"));
+            unsigned char raw[32];
+            size_t size = sizeof raw;
+            EVP_PKEY_get_raw_public_key(ephemeral.get(), raw, &size);
+            epk = R"({"kty":"OKP","crv":"X25519","x":")" +
+                base64url(std::string_view(reinterpret_cast<const char*>(raw), size)) + R"("})";
+        }
+        else
+        {
+            char group[64];
+            EVP_PKEY_get_utf8_string_param(recipient, OSSL_PKEY_PARAM_GROUP_NAME, group, sizeof group, nullptr);
+            std::string_view name(group);
+            JWTAlg alg = name == "prime256v1" ? JWTAlg::ES256 : name == "secp384r1" ? JWTAlg::ES384 : JWTAlg::ES512;
+            const char* crv = alg == JWTAlg::ES256 ? "P-256" : alg == JWTAlg::ES384 ? "P-384" : "P-521";
+            ephemeral.reset(EVP_EC_gen(crv));
+            size_t width = ecCoordinateSize(alg);
+            epk = R"({"kty":"EC","crv":")" + std::string(crv) +
+                R"(","x":")" + base64url(bignumBytes(ephemeral.get(), OSSL_PKEY_PARAM_EC_PUB_X, width)) +
+                R"(","y":")" + base64url(bignumBytes(ephemeral.get(), OSSL_PKEY_PARAM_EC_PUB_Y, width)) + R"("})";
+        }
+
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(ephemeral.get(), nullptr);
+        EVP_PKEY_derive_init(ctx);
+        EVP_PKEY_derive_set_peer(ctx, recipient);
+        size_t size = 0;
+        EVP_PKEY_derive(ctx, nullptr, &size);
+        z.assign(size, '\0');
+        EVP_PKEY_derive(ctx, reinterpret_cast<unsigned char*>(z.data()), &size);
+        EVP_PKEY_CTX_free(ctx);
+        z.resize(size);
+        return epk;
+    }
+
+    // encrypts "plaintext" for a recipient holding "pkey" (RSA-OAEP and
+    // ECDH-ES) or the shared "secret" (dir, A128KW and A256KW)
+    inline std::string makeJWE(JWEAlg alg, JWEEnc enc, EVP_PKEY* pkey, std::string_view secret,
+        std::string_view plaintext, std::string_view kid = "bench-jwe")
+    {
+        size_t cekSize = jweKeySize(enc);
+        std::string cek = alg == JWEAlg::dir ? std::string(secret) : randomBytes(cekSize);
+        std::string encryptedKey;
+        std::string header = R"({"alg":")" + std::string(jweAlgName(alg)) + R"(","enc":")" +
+            std::string(jweEncName(enc)) + R"(","kid":")" + std::string(kid) + '"';
+
+        switch (alg)
+        {
+        case JWEAlg::A128KW:
+        case JWEAlg::A256KW:
+            encryptedKey = aesWrap(secret, cek);
+            break;
+        case JWEAlg::RSA_OAEP:
+        case JWEAlg::RSA_OAEP_256:
+            encryptedKey = rsaOAEP(pkey, alg == JWEAlg::RSA_OAEP_256, cek);
+            break;
+        case JWEAlg::ECDH_ES:
+        case JWEAlg::ECDH_ES_A128KW:
+        case JWEAlg::ECDH_ES_A256KW:
+        {
+            std::string z;
+            header += R"(,"epk":)" + ecdhEphemeral(pkey, z);
+            if (alg == JWEAlg::ECDH_ES)
+                cek = concatKDF(z, jweEncName(enc), cekSize);
+            else
+            {
+                size_t kekSize = alg == JWEAlg::ECDH_ES_A128KW ? 16 : 32;
+                encryptedKey = aesWrap(concatKDF(z, jweAlgName(alg), kekSize), cek);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        header = base64url(header + '}');
+
+        std::string iv = randomBytes(12);
+        std::string ciphertext(plaintext.size(), '\0');
+        unsigned char tag[16];
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        EVP_EncryptInit_ex(ctx, enc == JWEEnc::A128GCM ? EVP_aes_128_gcm() : EVP_aes_256_gcm(), nullptr,
+            reinterpret_cast<const unsigned char*>(cek.data()), reinterpret_cast<const unsigned char*>(iv.data()));
+        int written = 0;
+        EVP_EncryptUpdate(ctx, nullptr, &written, reinterpret_cast<const unsigned char*>(header.data()),
+            static_cast<int>(header.size()));
+        EVP_EncryptUpdate(ctx, reinterpret_cast<unsigned char*>(ciphertext.data()), &written,
+            reinterpret_cast<const unsigned char*>(plaintext.data()), static_cast<int>(plaintext.size()));
+        EVP_EncryptFinal_ex(ctx, nullptr, &written);
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, sizeof tag, tag);
+        EVP_CIPHER_CTX_free(ctx);
+
+        return header + '.' + base64url(encryptedKey) + '.' + base64url(iv) + '.' + base64url(ciphertext) + '.' +
+            base64url(std::string_view(reinterpret_cast<const char*>(tag), sizeof tag));
+    }
+}
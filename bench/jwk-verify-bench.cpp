@@ -0,0 +1,105 @@
+// per-verify cost of importing a JWK into OpenSSL every time, against the
+// verifier JWKSet builds once at load, and what building one costs
+
+#include <ncbi/jwk.hpp>
+#include <ncbi/jws.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    struct Fixture
+    {
+        PKey key;
+        std::unique_ptr<const JWKSet> keys;
+        std::string signingInput;
+        std::string signature;
+
+        explicit Fixture(JWTAlg alg)
+            : key(generateKey(alg))
+            , keys(JWKSet::parse(R"({"keys":[)" + publicJWK(alg, key.get(), "bench-1") + "]}"))
+            , signingInput(base64url(benchHeader) + '.' + base64url(benchPayload))
+            , signature(signJWS(alg, key.get(), signingInput))
+        {
+        }
+
+        const unsigned char* sig() const { return reinterpret_cast<const unsigned char*>(signature.data()); }
+    };
+
+    const Fixture& fixture(JWTAlg alg)
+    {
+        static std::map<JWTAlg, std::unique_ptr<Fixture>> fixtures;
+        auto& f = fixtures[alg];
+        if (f == nullptr)
+            f = std::make_unique<Fixture>(alg);
+        return *f;
+    }
+
+    JWTAlg argAlg(const benchmark::State& state) { return static_cast<JWTAlg>(state.range(0)); }
+
+    void BM_ImportPerVerify(benchmark::State& state)
+    {
+        JWTAlg alg = argAlg(state);
+        const Fixture& f = fixture(alg);
+        const JWK& key = *f.keys->begin();
+        for (auto _ : state)
+        {
+            if (!verifyWithJWK(key, alg, f.signingInput, f.sig(), f.signature.size()))
+                state.SkipWithError("verification failed");
+        }
+        state.SetLabel(std::string(algName(alg)));
+    }
+
+    void BM_Precomputed(benchmark::State& state)
+    {
+        JWTAlg alg = argAlg(state);
+        const Fixture& f = fixture(alg);
+        const JWSVerifier* verifier = f.keys->verifier(*f.keys->begin(), alg);
+        for (auto _ : state)
+        {
+            if (!verifier->verify(f.signingInput, f.sig(), f.signature.size()))
+                state.SkipWithError("verification failed");
+        }
+        state.SetLabel(std::string(algName(alg)));
+    }
+
+    // the one-off cost moved to JWKS load time
+    void BM_BuildVerifier(benchmark::State& state)
+    {
+        JWTAlg alg = argAlg(state);
+        const Fixture& f = fixture(alg);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(makeJWSVerifier(*f.keys->begin(), alg));
+        state.SetLabel(std::string(algName(alg)));
+    }
+
+    void algorithms(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::RS256, JWTAlg::PS256, JWTAlg::ES256, JWTAlg::EdDSA })
+            b->Arg(static_cast<int>(alg));
+    }
+
+    BENCHMARK(BM_ImportPerVerify)->Apply(algorithms)->Unit(benchmark::kMicrosecond);
+    BENCHMARK(BM_Precomputed)->Apply(algorithms)->Unit(benchmark::kMicrosecond);
+    BENCHMARK(BM_BuildVerifier)->Apply(algorithms)->Unit(benchmark::kMicrosecond);
+
+    // one verifier shared by every thread
+    void BM_PrecomputedShared(benchmark::State& state)
+    {
+        const Fixture& f = fixture(JWTAlg::RS256);
+        const JWSVerifier* verifier = f.keys->verifier(*f.keys->begin(), JWTAlg::RS256);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(verifier->verify(f.signingInput, f.sig(), f.signature.size()));
+    }
+    BENCHMARK(BM_PrecomputedShared)->ThreadRange(1, 8)->UseRealTime()->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,84 @@
+// lock-free key resolution through JWKSCache, alone and while the key set
+// is being republished underneath the readers
+
+#include <ncbi/jwks-cache.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace ncbi;
+
+namespace
+{
+    std::string keySetJSON(int keys)
+    {
+        std::string json = R"({"keys":[)";
+        for (int i = 0; i < keys; ++i)
+        {
+            if (i != 0)
+                json += ',';
+            json += R"({"kty":"oct","alg":"HS256","kid":"key-)" + std::to_string(i) +
+                R"(","k":"MDEyMzQ1Njc4OWFiY2RlZjAxMjM0NTY3ODlhYmNkZWY"})";
+        }
+        json += "]}";
+        return json;
+    }
+
+    JWKSCache& sharedCache()
+    {
+        static JWKSCache cache("stand-in:jwks", std::make_shared<FunctionFetcher>(
+            [](const std::string&)
+            {
+                FetchResponse response;
+                response.status = 200;
+                response.body = keySetJSON(16);
+                response.cacheControl = "max-age=3600";
+                return response;
+            }));
+        static bool started = (cache.start(), true);
+        (void)started;
+        return cache;
+    }
+
+    void BM_Resolve(benchmark::State& state)
+    {
+        JWKSCache& cache = sharedCache();
+        for (auto _ : state)
+        {
+            JWKSCache::Snapshot snapshot = cache.snapshot();
+            benchmark::DoNotOptimize(snapshot.find("key-7", JWTAlg::HS256));
+        }
+    }
+    BENCHMARK(BM_Resolve)->ThreadRange(1, 8)->UseRealTime();
+
+    // readers resolving while another thread republishes continuously
+    void BM_ResolveDuringRefresh(benchmark::State& state)
+    {
+        JWKSCache& cache = sharedCache();
+
+        std::atomic<bool> stop { false };
+        std::jthread writer;
+        if (state.thread_index() == 0)
+        {
+            writer = std::jthread([&cache, &stop]
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                    cache.refresh();
+            });
+        }
+
+        for (auto _ : state)
+        {
+            JWKSCache::Snapshot snapshot = cache.snapshot();
+            benchmark::DoNotOptimize(snapshot.find("key-7", JWTAlg::HS256));
+        }
+
+        stop.store(true, std::memory_order_relaxed);
+    }
+    BENCHMARK(BM_ResolveDuringRefresh)->ThreadRange(1, 4)->UseRealTime();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+// offline batch verification: tokens/sec and tokens/sec per core for each
+// algorithm, against verifying the same corpus one token at a time
+
+#include <ncbi/jws-batch.hpp>
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int keysPerAlg = 4;
+    constexpr size_t corpusSize = 2048;
+
+    // tokens spread over a few keys in shuffled order, as a replayed log
+    // would present them
+    struct Corpus
+    {
+        std::unique_ptr<const JWKSet> keys;
+        std::vector<std::string> tokens;
+        std::vector<std::string_view> views;
+    };
+
+    const Corpus& corpus(JWTAlg alg)
+    {
+        static std::map<JWTAlg, Corpus> corpora;
+        Corpus& c = corpora[alg];
+        if (!c.tokens.empty())
+            return c;
+
+        std::vector<PKey> keys;
+        std::string jwks = R"({"keys":[)";
+        for (int k = 0; k < keysPerAlg; ++k)
+        {
+            keys.push_back(generateKey(alg));
+            jwks += (k != 0 ? "," : "") + publicJWK(alg, keys.back().get(), "key-" + std::to_string(k));
+        }
+        c.keys = JWKSet::parse(jwks + "]}");
+
+        std::mt19937 rng(42);
+        for (size_t i = 0; i < corpusSize; ++i)
+        {
+            int k = static_cast<int>(rng() % keysPerAlg);
+            c.tokens.push_back(makeToken(alg, keys[k].get(), "key-" + std::to_string(k), benchPayload));
+        }
+        c.views.assign(c.tokens.begin(), c.tokens.end());
+        return c;
+    }
+
+    void reportRates(benchmark::State& state, int cores)
+    {
+        double tokens = static_cast<double>(state.iterations() * corpusSize);
+        state.counters["tokens/s"] = benchmark::Counter(tokens, benchmark::Counter::kIsRate);
+        state.counters["tokens/s/core"] = benchmark::Counter(tokens / cores, benchmark::Counter::kIsRate);
+        state.SetLabel(std::string(algName(static_cast<JWTAlg>(state.range(0)))));
+    }
+
+    // the baseline: one header parse, key lookup and key import per token
+    void BM_VerifyEach(benchmark::State& state)
+    {
+        const Corpus& c = corpus(static_cast<JWTAlg>(state.range(0)));
+        for (auto _ : state)
+        {
+            for (std::string_view token : c.views)
+            {
+                JWTView view;
+                char headerBuf[512];
+                std::string_view headerJSON;
+                JWTHeader header;
+                unsigned char signature[maxSignatureSize];
+                size_t signatureSize;
+                JWTView::parse(token, view);
+                view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON);
+                JWTHeader::parse(headerJSON, header);
+                view.decodeSignature(signature, sizeof signature, signatureSize);
+                const JWK* key = c.keys->find(header.kid.rawString(), header.alg);
+                if (!verifyWithJWK(*key, header.alg, view.signingInput(), signature, signatureSize))
+                    state.SkipWithError("verification failed");
+            }
+        }
+        reportRates(state, 1);
+    }
+
+    void BM_VerifyBatch(benchmark::State& state)
+    {
+        const Corpus& c = corpus(static_cast<JWTAlg>(state.range(0)));
+        int cores = static_cast<int>(state.range(1));
+
+        // the calling thread works too, so "cores" threads in all
+        std::unique_ptr<ThreadPool> pool;
+        if (cores > 1)
+            pool = std::make_unique<ThreadPool>(cores - 1);
+
+        for (auto _ : state)
+        {
+            std::vector<JWTStatus> status = verifyJWSBatch(c.views, *c.keys, { .pool = pool.get() });
+            if (std::count(status.begin(), status.end(), JWTStatus::ok) != static_cast<long>(corpusSize))
+                state.SkipWithError("verification failed");
+        }
+        reportRates(state, cores);
+    }
+
+    void algorithms(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::HS256, JWTAlg::RS256, JWTAlg::PS256, JWTAlg::ES256, JWTAlg::EdDSA })
+            b->Args({ static_cast<int>(alg), 1 });
+    }
+
+    void algorithmsByCores(benchmark::internal::Benchmark* b)
+    {
+        int maxCores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (JWTAlg alg : { JWTAlg::HS256, JWTAlg::RS256, JWTAlg::PS256, JWTAlg::ES256, JWTAlg::EdDSA })
+        {
+            for (int cores = 1; cores <= maxCores; cores *= 2)
+                b->Args({ static_cast<int>(alg), cores });
+        }
+    }
+
+    BENCHMARK(BM_VerifyEach)->Apply(algorithms)->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_VerifyBatch)->Apply(algorithmsByCores)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+// the per-request object model on the heap and in a RequestArena: full
+// verification into shared VerifiedTokens, the same verification into an
+// ArenaJWT, and decoding alone; heap allocations and arena spills are
+// counted per token
+
+#include "alloc-counter.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/request-arena.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    struct Fixture
+    {
+        std::string token = makeToken(JWTAlg::HS256, nullptr, "bench-1", benchPayload);
+        std::unique_ptr<JWKSCache> keys;
+
+        Fixture()
+        {
+            std::string jwks = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            keys = std::make_unique<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            keys->start();
+        }
+    };
+
+    Fixture& fixture()
+    {
+        static Fixture f;
+        return f;
+    }
+
+    void reportAllocations(benchmark::State& state, const AllocationSnapshot& before)
+    {
+        AllocationSnapshot after = AllocationSnapshot::take();
+        auto per = [&state](size_t n) {
+            return benchmark::Counter(static_cast<double>(n) / static_cast<double>(state.iterations()));
+        };
+        state.counters["allocs/token"] = per(after.cxx - before.cxx);
+        state.counters["crypto_allocs/token"] = per(after.crypto - before.crypto);
+    }
+
+    void BM_VerifyShared(benchmark::State& state)
+    {
+        Fixture& f = fixture();
+        JWTVerifier verifier(*f.keys);
+
+        std::shared_ptr<const VerifiedToken> result;
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            std::string_view sub;
+            benchmark::DoNotOptimize(result->claims().getString("sub", sub));
+            result.reset();
+        }
+        reportAllocations(state, before);
+    }
+
+    void BM_VerifyArena(benchmark::State& state)
+    {
+        Fixture& f = fixture();
+        JWTVerifier verifier(*f.keys);
+        RequestArena arena(4096);
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            arena.release();
+            ArenaJWT result(arena.resource());
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result.hasScope("sra:read"));
+        }
+        reportAllocations(state, before);
+        state.counters["spills"] = static_cast<double>(arena.spills());
+    }
+
+    void BM_DecodeArena(benchmark::State& state)
+    {
+        Fixture& f = fixture();
+        RequestArena arena(4096);
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            arena.release();
+            ArenaJWT result(arena.resource());
+            if (decodeJWT(f.token, result) != JWTStatus::ok)
+                state.SkipWithError("decoding failed");
+            benchmark::DoNotOptimize(result.find("email"));
+        }
+        reportAllocations(state, before);
+        state.counters["spills"] = static_cast<double>(arena.spills());
+    }
+
+    BENCHMARK(BM_VerifyShared);
+    BENCHMARK(BM_VerifyArena);
+    BENCHMARK(BM_DecodeArena);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+// claim extraction: the single-pass JWTClaimsParser against looking each
+// claim up with JWTClaimsView, on a typical payload and on large ones
+// dominated by members the parser has to skip
+
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    // benchPayload plus an unregistered member of about "bytes" bytes,
+    // shaped like RFC 9396 authorization details
+    std::string largePayload(size_t bytes)
+    {
+        std::string details = R"("authorization_details":[)";
+        for (int i = 0; details.size() < bytes; ++i)
+        {
+            if (i != 0)
+                details += ',';
+            details += R"({"type":"sra_access","locations":["https://sra.ncbi.nlm.nih.gov/run/SRR)" +
+                std::to_string(1000000 + i) + R"("],"actions":["read","download"],)"
+                R"("description":"controlled-access run data released under dbGaP study phs000001.v1.p1"})";
+        }
+        details += ']';
+
+        std::string payload(benchPayload);
+        payload.insert(1, details + ',');
+        return payload;
+    }
+
+    void BM_Parser(benchmark::State& state, std::string payload)
+    {
+        JWTClaimsParser parser({ "email", "name" });
+        JWTClaims claims;
+        for (auto _ : state)
+        {
+            if (parser.parse(payload, claims) != JWTStatus::ok)
+                state.SkipWithError("parse failed");
+            benchmark::DoNotOptimize(claims);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+    }
+
+    // the same claims, each found by its own scan from the top
+    void BM_ViewLookups(benchmark::State& state, std::string payload)
+    {
+        JWTClaimsView view(payload);
+        for (auto _ : state)
+        {
+            JSONValueView value;
+            int64_t date;
+            for (std::string_view name : { "iss", "sub", "aud", "jti", "scope", "email", "name" })
+                benchmark::DoNotOptimize(view.find(name, value));
+            for (std::string_view name : { "exp", "nbf", "iat" })
+                benchmark::DoNotOptimize(view.getNumericDate(name, date));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+    }
+
+    BENCHMARK_CAPTURE(BM_Parser, typical, std::string(benchPayload));
+    BENCHMARK_CAPTURE(BM_ViewLookups, typical, std::string(benchPayload));
+    BENCHMARK_CAPTURE(BM_Parser, large_4k, largePayload(4096));
+    BENCHMARK_CAPTURE(BM_ViewLookups, large_4k, largePayload(4096));
+    BENCHMARK_CAPTURE(BM_Parser, large_64k, largePayload(65536));
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,59 @@
+// validating a payload against a compile-time schema, against extracting
+// the same claims with JWTClaimsParser and checking them by hand
+
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt-schema.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    using BenchSchema = JWTSchema<
+        RequiredClaim<"iss", ClaimType::string, Allowed<"https://auth.ncbi.nlm.nih.gov">>,
+        RequiredClaim<"sub", ClaimType::string>,
+        RequiredClaim<"aud", ClaimType::audience,
+            Allowed<"https://sra.ncbi.nlm.nih.gov", "https://trace.ncbi.nlm.nih.gov">>,
+        RequiredClaim<"exp", ClaimType::numericDate>,
+        OptionalClaim<"nbf", ClaimType::numericDate>,
+        OptionalClaim<"iat", ClaimType::numericDate>,
+        OptionalClaim<"jti", ClaimType::string>,
+        OptionalClaim<"scope", ClaimType::string>,
+        OptionalClaim<"email", ClaimType::string>>;
+
+    void BM_Schema(benchmark::State& state)
+    {
+        BenchSchema::Claims claims;
+        for (auto _ : state)
+        {
+            if (BenchSchema::validate(benchPayload, claims) != JWTStatus::ok)
+                state.SkipWithError("validation failed");
+            benchmark::DoNotOptimize(claims);
+        }
+    }
+    BENCHMARK(BM_Schema);
+
+    void BM_ParserAndChecks(benchmark::State& state)
+    {
+        JWTClaimsParser parser({ "email" });
+        JWTClaims claims;
+        for (auto _ : state)
+        {
+            bool ok = parser.parse(benchPayload, claims) == JWTStatus::ok &&
+                claims.iss.stringEquals("https://auth.ncbi.nlm.nih.gov") &&
+                claims.has(JWTClaim::sub) &&
+                claims.has(JWTClaim::exp) &&
+                (claims.audience("https://sra.ncbi.nlm.nih.gov") || claims.audience("https://trace.ncbi.nlm.nih.gov"));
+            if (!ok)
+                state.SkipWithError("validation failed");
+            benchmark::DoNotOptimize(claims);
+        }
+    }
+    BENCHMARK(BM_ParserAndChecks);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,122 @@
+// cost of the zero-copy token view: splitting, header decoding, signature
+// verification and lazy claim lookup, with allocations counted per token
+
+#include "alloc-counter.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <benchmark/benchmark.h>
+
+using namespace ncbi;
+
+namespace
+{
+    void reportAllocations(benchmark::State& state, const bench::AllocationSnapshot& before)
+    {
+        bench::AllocationSnapshot after = bench::AllocationSnapshot::take();
+        auto per = [&state](size_t n) {
+            return benchmark::Counter(static_cast<double>(n) / static_cast<double>(state.iterations()));
+        };
+        state.counters["allocs/token"] = per(after.cxx - before.cxx);
+        state.counters["crypto_allocs/token"] = per(after.crypto - before.crypto);
+    }
+
+    void BM_Split(benchmark::State& state)
+    {
+        std::string token = bench::makeHS256Token(bench::benchHeader, bench::benchPayload, bench::benchSecret);
+
+        bench::AllocationSnapshot before = bench::AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            JWTView view;
+            benchmark::DoNotOptimize(JWTView::parse(token, view));
+            benchmark::DoNotOptimize(view);
+        }
+        reportAllocations(state, before);
+    }
+    BENCHMARK(BM_Split);
+
+    void BM_DecodeHeader(benchmark::State& state)
+    {
+        std::string token = bench::makeHS256Token(bench::benchHeader, bench::benchPayload, bench::benchSecret);
+
+        bench::AllocationSnapshot before = bench::AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            JWTView view;
+            JWTView::parse(token, view);
+
+            char buf[256];
+            std::string_view json;
+            view.decodeHeader(buf, sizeof buf, json);
+
+            JWTHeader header;
+            benchmark::DoNotOptimize(JWTHeader::parse(json, header));
+        }
+        reportAllocations(state, before);
+    }
+    BENCHMARK(BM_DecodeHeader);
+
+    // the verify-only path: split, decode header, verify HS256
+    void BM_VerifyOnly(benchmark::State& state)
+    {
+        std::string token = bench::makeHS256Token(bench::benchHeader, bench::benchPayload, bench::benchSecret);
+        HMACVerifier verifier(JWTAlg::HS256, bench::benchSecret);
+
+        bench::AllocationSnapshot before = bench::AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            JWTView view;
+            JWTView::parse(token, view);
+
+            char buf[256];
+            std::string_view json;
+            view.decodeHeader(buf, sizeof buf, json);
+
+            JWTHeader header;
+            JWTHeader::parse(json, header);
+
+            JWTStatus status = verifyJWS(view, header, verifier);
+            if (status != JWTStatus::ok)
+                state.SkipWithError(toString(status));
+        }
+        reportAllocations(state, before);
+    }
+    BENCHMARK(BM_VerifyOnly);
+
+    // verify, then decode the payload and look up the expiry only
+    void BM_VerifyAndCheckExpiry(benchmark::State& state)
+    {
+        std::string token = bench::makeHS256Token(bench::benchHeader, bench::benchPayload, bench::benchSecret);
+        HMACVerifier verifier(JWTAlg::HS256, bench::benchSecret);
+
+        bench::AllocationSnapshot before = bench::AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            JWTView view;
+            JWTView::parse(token, view);
+
+            char headerBuf[256];
+            std::string_view headerJSON;
+            view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON);
+
+            JWTHeader header;
+            JWTHeader::parse(headerJSON, header);
+            verifyJWS(view, header, verifier);
+
+            char payloadBuf[1024];
+            std::string_view payloadJSON;
+            view.decodePayload(payloadBuf, sizeof payloadBuf, payloadJSON);
+
+            int64_t exp = 0;
+            JWTClaimsView(payloadJSON).getNumericDate("exp", exp);
+            benchmark::DoNotOptimize(exp);
+        }
+        reportAllocations(state, before);
+    }
+    BENCHMARK(BM_VerifyAndCheckExpiry);
+}
+
+BENCHMARK_MAIN();
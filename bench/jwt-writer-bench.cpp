@@ -0,0 +1,194 @@
+// token issuance into a caller's buffer with JWTWriter, against building
+// the same token piecewise in std::strings; heap allocations are counted
+// per token
+//
+//     Write/<alg>/<extra>     JWTWriter::size() and write() into a reused buffer
+//     Strings/<alg>/<extra>   claims JSON, encoding and signature appended to strings
+//
+// <extra> is the size of a "groups" claim added to the access token
+// claims, to move the token from a service token to a large OIDC one
+
+#include "alloc-counter.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwt-writer.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    std::shared_ptr<const JWSSigner> signer(JWTAlg alg)
+    {
+        static std::map<JWTAlg, std::shared_ptr<const JWSSigner>> signers;
+        std::shared_ptr<const JWSSigner>& s = signers[alg];
+        if (s == nullptr)
+        {
+            if (algFamily(alg) == JWTAlgFamily::hmac)
+                s = std::make_shared<HMACSigner>(alg, benchSecret, "bench-1");
+            else
+                s = std::make_shared<PrivateKeySigner>(alg, privatePEM(generateKey(alg).get()), "bench-1");
+        }
+        return s;
+    }
+
+    // a JSON array of group names of about "bytes" bytes
+    std::string groups(size_t bytes)
+    {
+        std::string json = "[";
+        for (size_t i = 0; json.size() < bytes; ++i)
+        {
+            if (i != 0)
+                json += ',';
+            json += "\"phs" + std::to_string(100000 + i) + ".v1.p1.c1\"";
+        }
+        return json + ']';
+    }
+
+    // the claims TokenEndpoint issues, and optionally groups
+    struct Claims
+    {
+        std::string groupsJSON;
+        std::vector<JWTClaimValue> claims;
+
+        explicit Claims(size_t extra)
+            : groupsJSON(groups(extra))
+        {
+            claims = {
+                JWTClaimValue("iss", "https://auth.ncbi.nlm.nih.gov"),
+                JWTClaimValue("aud", "https://api.ncbi.nlm.nih.gov"),
+                JWTClaimValue("sub", "user-1234567"),
+                JWTClaimValue("client_id", "bench-client"),
+                JWTClaimValue("iat", benchNow),
+                JWTClaimValue("exp", benchNow + 300),
+                JWTClaimValue("jti", "b7c1e3a45d2f4e8a9b3c1f2e"),
+                JWTClaimValue("scope", "openid profile email sra:read")
+            };
+            if (extra != 0)
+                claims.push_back(JWTClaimValue::json("groups", groupsJSON));
+        }
+    };
+
+    // the claims set as code that builds strings piecewise writes it
+    void appendString(std::string& out, std::string_view text)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        out += '"';
+        for (char ch : text)
+        {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += ch;
+            }
+            else if (c < 0x20)
+            {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 15];
+            }
+            else
+                out += ch;
+        }
+        out += '"';
+    }
+
+    std::string piecewiseJSON(const std::vector<JWTClaimValue>& claims)
+    {
+        std::string json = "{";
+        for (const JWTClaimValue& claim : claims)
+        {
+            if (json.size() > 1)
+                json += ',';
+            appendString(json, claim.name());
+            json += ':';
+            switch (claim.type())
+            {
+            case JWTClaimValue::Type::string: appendString(json, claim.text()); break;
+            case JWTClaimValue::Type::number: json += std::to_string(claim.number()); break;
+            case JWTClaimValue::Type::boolean: json += claim.number() != 0 ? "true" : "false"; break;
+            case JWTClaimValue::Type::json: json += claim.text(); break;
+            }
+        }
+        return json + '}';
+    }
+
+    void reportAllocations(benchmark::State& state, const AllocationSnapshot& before)
+    {
+        AllocationSnapshot after = AllocationSnapshot::take();
+        state.counters["allocs/token"] =
+            static_cast<double>(after.cxx - before.cxx) / static_cast<double>(state.iterations());
+        state.counters["crypto_allocs/token"] =
+            static_cast<double>(after.crypto - before.crypto) / static_cast<double>(state.iterations());
+    }
+
+    void Write(benchmark::State& state, JWTAlg alg)
+    {
+        Claims c(static_cast<size_t>(state.range(0)));
+        JWTWriter writer(signer(alg));
+        std::unique_ptr<SigningContext> context = writer.signer().newContext();
+        std::vector<char> buffer(writer.size(c.claims));
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (auto _ : state)
+        {
+            size_t size = writer.size(c.claims);
+            if (size > buffer.size() || writer.write(c.claims, *context, buffer.data(), buffer.size()) != size)
+                state.SkipWithError("write failed");
+            benchmark::DoNotOptimize(buffer.data());
+        }
+        reportAllocations(state, before);
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(buffer.size()));
+    }
+
+    void Strings(benchmark::State& state, JWTAlg alg)
+    {
+        Claims c(static_cast<size_t>(state.range(0)));
+        std::shared_ptr<const JWSSigner> s = signer(alg);
+        std::unique_ptr<SigningContext> context = s->newContext();
+        std::string header = base64url(R"({"alg":")" + std::string(algName(alg)) + R"(","typ":"JWT","kid":"bench-1"})");
+        std::vector<unsigned char> signature(s->signatureSize());
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::string token = header + '.' + base64url(piecewiseJSON(c.claims));
+            size_t size = 0;
+            if (!context->sign(token, signature.data(), size))
+                state.SkipWithError("signing failed");
+            token += '.';
+            token += base64url(std::string_view(reinterpret_cast<const char*>(signature.data()), size));
+            bytes += token.size();
+            benchmark::DoNotOptimize(token.data());
+        }
+        reportAllocations(state, before);
+        state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    }
+
+    void extras(benchmark::internal::Benchmark* b)
+    {
+        b->Arg(0)->Arg(1000)->Arg(8000);
+    }
+}
+
+BENCHMARK_CAPTURE(Write, HS256, JWTAlg::HS256)->Apply(extras);
+BENCHMARK_CAPTURE(Strings, HS256, JWTAlg::HS256)->Apply(extras);
+BENCHMARK_CAPTURE(Write, ES256, JWTAlg::ES256)->Arg(0);
+BENCHMARK_CAPTURE(Strings, ES256, JWTAlg::ES256)->Arg(0);
+BENCHMARK_CAPTURE(Write, RS256, JWTAlg::RS256)->Arg(0);
+BENCHMARK_CAPTURE(Strings, RS256, JWTAlg::RS256)->Arg(0);
+BENCHMARK_CAPTURE(Write, EdDSA, JWTAlg::EdDSA)->Arg(0);
+BENCHMARK_CAPTURE(Strings, EdDSA, JWTAlg::EdDSA)->Arg(0);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,170 @@
+// refresh-token grants/sec against the log-backed store on local disk:
+// issue and rotate from concurrent threads, with and without waiting for
+// fdatasync, reporting how many appends each group commit carried
+//
+// the log is created under $NCBI_BENCH_DIR, or the temporary directory,
+// and removed afterwards
+
+#include <ncbi/refresh-log.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace ncbi;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t grantsPerThread = 512;
+    constexpr int64_t benchNow = 1700000000;
+
+    std::string logPath()
+    {
+        const char* dir = std::getenv("NCBI_BENCH_DIR");
+        std::filesystem::path base = dir != nullptr ? std::filesystem::path(dir) : std::filesystem::temp_directory_path();
+        return (base / ("refresh-log-bench." + std::to_string(::getpid()))).string();
+    }
+
+    AuthorizationGrant benchGrant(size_t i)
+    {
+        return { "spa", "user-" + std::to_string(i), "openid sra:read", "", "", benchNow + 86400 };
+    }
+
+    enum class Operation { issue, rotate };
+
+    void runGrants(benchmark::State& state, Operation operation)
+    {
+        int threads = static_cast<int>(state.range(0));
+        bool sync = state.range(1) != 0;
+
+        std::string path = logPath();
+        std::filesystem::remove(path);
+        LogRefreshTokenStoreOptions options;
+        options.sync = sync;
+        options.growBy = size_t(16) << 20;
+        auto store = std::make_unique<LogRefreshTokenStore>(path, options);
+
+        size_t grants = 0;
+        std::atomic<bool> failed { false };
+        for (auto _ : state)
+        {
+            // tokens to rotate are issued outside the measurement
+            std::vector<std::vector<std::string>> tokens(static_cast<size_t>(threads));
+            if (operation == Operation::rotate)
+            {
+                for (auto& mine : tokens)
+                {
+                    for (size_t i = 0; i < grantsPerThread; ++i)
+                        mine.push_back(store->issue(benchGrant(i)));
+                }
+            }
+
+            std::latch start(threads + 1);
+            std::vector<std::jthread> workers;
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&, t]
+                {
+                    const std::vector<std::string>& mine = tokens[static_cast<size_t>(t)];
+                    AuthorizationGrant grant;
+                    std::string successor;
+                    start.arrive_and_wait();
+
+                    for (size_t i = 0; i < grantsPerThread; ++i)
+                    {
+                        if (operation == Operation::issue)
+                            store->issue(benchGrant(i));
+                        else if (store->rotate(mine[i], "spa", {}, benchNow, grant, successor) != RotateResult::rotated)
+                            failed.store(true, std::memory_order_relaxed);
+                    }
+                });
+            }
+
+            start.arrive_and_wait();
+            Clock::time_point begin = Clock::now();
+            workers.clear();
+            state.SetIterationTime(std::chrono::duration<double>(Clock::now() - begin).count());
+            grants += grantsPerThread * static_cast<size_t>(threads);
+        }
+        if (failed.load())
+            state.SkipWithError("rotation failed");
+
+        LogRefreshTokenStore::Stats stats = store->stats();
+        state.counters["grants/s"] = benchmark::Counter(static_cast<double>(grants), benchmark::Counter::kIsRate);
+        if (stats.syncs != 0)
+            state.counters["appends/sync"] = static_cast<double>(stats.appends) / static_cast<double>(stats.syncs);
+        state.counters["log_MiB"] = static_cast<double>(stats.logBytes) / (1 << 20);
+        state.SetLabel(sync ? "fdatasync" : "no sync");
+
+        store.reset();
+        std::filesystem::remove(path);
+    }
+
+    void BM_Issue(benchmark::State& state)
+    {
+        runGrants(state, Operation::issue);
+    }
+
+    void BM_Rotate(benchmark::State& state)
+    {
+        runGrants(state, Operation::rotate);
+    }
+
+    // the log as it stands after a day of rotations: compaction keeps the
+    // live tokens and the retired ones that can still be replayed
+    void BM_Compact(benchmark::State& state)
+    {
+        std::string path = logPath();
+        std::filesystem::remove(path);
+        LogRefreshTokenStoreOptions options;
+        options.sync = false;
+        LogRefreshTokenStore store(path, options);
+
+        size_t tokens = static_cast<size_t>(state.range(0));
+        AuthorizationGrant grant;
+        std::string successor;
+        for (size_t i = 0; i < tokens; ++i)
+        {
+            AuthorizationGrant g = benchGrant(i);
+            g.expires = benchNow + static_cast<int64_t>(i % 2 == 0 ? 60 : 86400);
+            store.rotate(store.issue(g), "spa", {}, benchNow, grant, successor);
+        }
+
+        for (auto _ : state)
+            store.compact(benchNow);
+        state.counters["records/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * store.stats().live), benchmark::Counter::kIsRate);
+        std::filesystem::remove(path);
+    }
+
+    int maxThreads()
+    {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) * 4;
+    }
+
+    void threadsBySync(benchmark::internal::Benchmark* b)
+    {
+        for (int sync : { 0, 1 })
+        {
+            for (int threads = 1; threads <= maxThreads(); threads *= 2)
+                b->Args({ threads, sync });
+        }
+    }
+
+    BENCHMARK(BM_Issue)->Apply(threadsBySync)->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_Rotate)->Apply(threadsBySync)->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_Compact)->Arg(100000)->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,152 @@
+// revocation checks by "jti": lookups of tokens that are not revoked, the
+// common case, against lists of growing size; lookups of revoked ones;
+// lookups while a writer swaps in deltas; and the cost of a delta itself
+
+#include <ncbi/revocation.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+    constexpr size_t probes = 4096;
+
+    // uuid-sized identifiers, distinct between the revoked and probed sets
+    std::string jti(char prefix, size_t i)
+    {
+        std::string id(36, '0');
+        id[0] = prefix;
+        std::string n = std::to_string(i);
+        id.replace(id.size() - n.size(), n.size(), n);
+        return id;
+    }
+
+    std::string fullDocument(size_t revoked)
+    {
+        std::string document = "revocations 1\n";
+        for (size_t i = 0; i < revoked; ++i)
+            document += "+ " + jti('r', i) + " " + std::to_string(benchNow + 3600) + "\n";
+        return document;
+    }
+
+    std::vector<std::string> probeSet(char prefix)
+    {
+        std::vector<std::string> ids;
+        for (size_t i = 0; i < probes; ++i)
+            ids.push_back(jti(prefix, i * 7919));
+        return ids;
+    }
+
+    void BM_NotRevoked(benchmark::State& state)
+    {
+        RevocationList list;
+        list.apply(fullDocument(static_cast<size_t>(state.range(0))));
+        std::vector<std::string> ids = probeSet('a');
+
+        size_t i = 0;
+        size_t hits = 0;
+        for (auto _ : state)
+        {
+            bool revoked = list.revoked(ids[i++ % probes]);
+            hits += revoked;
+            benchmark::DoNotOptimize(revoked);
+        }
+        if (hits != 0)
+            state.SkipWithError("token reported revoked");
+    }
+
+    void BM_Revoked(benchmark::State& state)
+    {
+        size_t size = static_cast<size_t>(state.range(0));
+        RevocationList list;
+        list.apply(fullDocument(size));
+        std::vector<std::string> ids;
+        for (size_t i = 0; i < probes; ++i)
+            ids.push_back(jti('r', i * 7919 % size));
+
+        size_t i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(list.revoked(ids[i++ % probes]));
+    }
+
+    // readers keep going while deltas replace the snapshot beneath them
+    void BM_NotRevokedDuringSwaps(benchmark::State& state)
+    {
+        static RevocationList list;
+        static std::atomic<bool> stop;
+        static std::jthread writer;
+        static std::atomic<uint64_t> swaps;
+        if (state.thread_index() == 0)
+        {
+            list.apply(fullDocument(static_cast<size_t>(state.range(0))));
+            stop = false;
+            swaps = 0;
+            writer = std::jthread([]
+            {
+                for (uint64_t serial = list.serial(); !stop.load(std::memory_order_relaxed); ++serial)
+                {
+                    list.apply("revocations " + std::to_string(serial + 1) + " after " + std::to_string(serial) +
+                        "\n+ " + jti('d', serial) + " " + std::to_string(benchNow + 60) + "\n");
+                    swaps.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        std::vector<std::string> ids = probeSet('a');
+
+        size_t i = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(list.revoked(ids[i++ % probes]));
+
+        if (state.thread_index() == 0)
+        {
+            stop = true;
+            writer.join();
+            state.counters["swaps"] = static_cast<double>(swaps.load());
+        }
+    }
+
+    // a delta of 64 changes against a list of the given size
+    void BM_ApplyDelta(benchmark::State& state)
+    {
+        auto list = std::make_unique<RevocationList>();
+        list->apply(fullDocument(static_cast<size_t>(state.range(0))));
+
+        std::vector<std::string> deltas;
+        for (uint64_t serial = 1; serial <= 64; ++serial)
+        {
+            std::string delta = "revocations " + std::to_string(serial + 1) + " after " + std::to_string(serial) + "\n";
+            for (size_t i = 0; i < 64; ++i)
+                delta += "+ " + jti('d', serial * 64 + i) + " " + std::to_string(benchNow + 60) + "\n";
+            deltas.push_back(std::move(delta));
+        }
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            if (i == deltas.size())
+            {
+                state.PauseTiming();
+                list = std::make_unique<RevocationList>();
+                list->apply(fullDocument(static_cast<size_t>(state.range(0))));
+                i = 0;
+                state.ResumeTiming();
+            }
+            list->apply(deltas[i++]);
+        }
+    }
+
+    BENCHMARK(BM_NotRevoked)->Arg(0)->Arg(1000)->Arg(100000)->Arg(1000000);
+    BENCHMARK(BM_Revoked)->Arg(1000)->Arg(100000)->Arg(1000000);
+    BENCHMARK(BM_NotRevokedDuringSwaps)->Arg(10000)->ThreadRange(1, 4)->UseRealTime();
+    BENCHMARK(BM_ApplyDelta)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_MAIN();
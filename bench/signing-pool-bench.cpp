@@ -0,0 +1,155 @@
+// JWS signing throughput as threads are added: one context shared under a
+// lock, the per-CPU SigningPool, and a context owned by each thread, the
+// ceiling the pool should track; and the latency of an ECDSA signature
+// with and without a presigned nonce
+
+#include <ncbi/signing-pool.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    // a typical header and claims segment, already encoded
+    const std::string signingInput = base64url(R"({"alg":"ES256","typ":"at+jwt","kid":"bench-1"})") + '.' +
+        base64url(R"({"iss":"https://auth.ncbi.nlm.nih.gov","sub":"user-1","aud":"https://api.ncbi.nlm.nih.gov",)"
+            R"("client_id":"svc","iat":1700000000,"exp":1700000300,"jti":"0123456789abcdef0123456789abcdef","scope":"sra:read"})");
+
+    std::shared_ptr<const JWSSigner> signer(JWTAlg alg, size_t presignedNonces = 0)
+    {
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        static std::map<std::pair<JWTAlg, size_t>, std::shared_ptr<const JWSSigner>> signers;
+        auto& s = signers[{ alg, presignedNonces }];
+        if (s == nullptr)
+        {
+            static std::map<JWTAlg, std::string> pems;
+            std::string& pem = pems[alg];
+            if (pem.empty())
+                pem = privatePEM(generateKey(alg).get());
+            s = std::make_shared<PrivateKeySigner>(alg, pem, "bench-1", PrivateKeySignerOptions { .presignedNonces = presignedNonces });
+        }
+        return s;
+    }
+
+    JWTAlg argAlg(const benchmark::State& state) { return static_cast<JWTAlg>(state.range(0)); }
+
+    template<class Sign>
+    void signLoop(benchmark::State& state, Sign&& sign)
+    {
+        unsigned char signature[1024];
+        size_t size;
+        for (auto _ : state)
+        {
+            if (!sign(signature, size))
+                state.SkipWithError("signing failed");
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetLabel(std::string(algName(argAlg(state))));
+    }
+
+    // the contended baseline
+    void BM_SharedContext(benchmark::State& state)
+    {
+        static std::mutex mutex;
+        static std::unique_ptr<SigningContext> context;
+        if (state.thread_index() == 0)
+            context = signer(argAlg(state))->newContext();
+        signLoop(state, [&](unsigned char* signature, size_t& size)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return context->sign(signingInput, signature, size);
+        });
+    }
+
+    void BM_SigningPool(benchmark::State& state)
+    {
+        static std::unique_ptr<SigningPool> pool;
+        if (state.thread_index() == 0)
+            pool = std::make_unique<SigningPool>(signer(argAlg(state)));
+        signLoop(state, [&](unsigned char* signature, size_t& size)
+        {
+            return pool->sign(signingInput, signature, size);
+        });
+    }
+
+    void BM_ThreadContext(benchmark::State& state)
+    {
+        std::unique_ptr<SigningContext> context = signer(argAlg(state))->newContext();
+        signLoop(state, [&](unsigned char* signature, size_t& size)
+        {
+            return context->sign(signingInput, signature, size);
+        });
+    }
+
+    // the signature alone, its nonce prepared beforehand outside the timing
+    void BM_PresignedNonce(benchmark::State& state)
+    {
+        constexpr size_t reserve = 256;
+        std::unique_ptr<SigningContext> context = signer(argAlg(state), reserve)->newContext();
+        context->precompute();
+
+        unsigned char signature[1024];
+        size_t size;
+        size_t left = reserve;
+        for (auto _ : state)
+        {
+            if (left-- == 0)
+            {
+                state.PauseTiming();
+                context->precompute();
+                left = reserve - 1;
+                state.ResumeTiming();
+            }
+            if (!context->sign(signingInput, signature, size))
+                state.SkipWithError("signing failed");
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetLabel(std::string(algName(argAlg(state))));
+    }
+
+    void BM_FreshNonce(benchmark::State& state)
+    {
+        std::unique_ptr<SigningContext> context = signer(argAlg(state))->newContext();
+        signLoop(state, [&](unsigned char* signature, size_t& size)
+        {
+            return context->sign(signingInput, signature, size);
+        });
+    }
+
+    int maxThreads()
+    {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    void scaling(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::RS256, JWTAlg::ES256, JWTAlg::EdDSA })
+            b->Arg(static_cast<int>(alg));
+        b->ThreadRange(1, maxThreads())->UseRealTime()->Unit(benchmark::kMicrosecond);
+    }
+
+    void ecdsa(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::ES256, JWTAlg::ES384, JWTAlg::ES512 })
+            b->Arg(static_cast<int>(alg));
+        b->Unit(benchmark::kMicrosecond);
+    }
+
+    BENCHMARK(BM_SharedContext)->Apply(scaling);
+    BENCHMARK(BM_SigningPool)->Apply(scaling);
+    BENCHMARK(BM_ThreadContext)->Apply(scaling);
+    BENCHMARK(BM_FreshNonce)->Apply(ecdsa);
+    BENCHMARK(BM_PresignedNonce)->Apply(ecdsa);
+}
+
+BENCHMARK_MAIN();
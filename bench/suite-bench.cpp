@@ -0,0 +1,270 @@
+// the regression suite: every stage of token handling over the
+// deterministic corpus of token-corpus.hpp, at three payload sizes
+//
+//     Base64urlDecode/<size>, ClaimsParse/<size>
+//     Sign/<alg>/<size>, Verify/<alg>/<size>
+//     Decrypt/<alg>/<size>
+//     JWKSParse/<keys>, JWKSLookup/<keys>
+//
+// names are stable across runs, and the corpus seed, OpenSSL version and
+// base64url kernel are written into the context, so that results from
+//
+//     suite-bench --benchmark_out=suite.json --benchmark_out_format=json
+//
+// can be compared from commit to commit (Google Benchmark's
+// tools/compare.py reads the file as it is)
+
+#include "jwe-fixtures.hpp"
+#include "token-corpus.hpp"
+
+#include <ncbi/jwe.hpp>
+#include <ncbi/jws-signer.hpp>
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/verify-metrics.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <openssl/crypto.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+    constexpr CorpusSize sizes[] = { CorpusSize::small, CorpusSize::medium, CorpusSize::large };
+    constexpr JWEAlg jweAlgs[] = { JWEAlg::dir, JWEAlg::A256KW, JWEAlg::RSA_OAEP_256, JWEAlg::ECDH_ES };
+
+    CorpusOptions corpusOptions(CorpusSize size)
+    {
+        CorpusOptions options;
+        options.size = size;
+        return options;
+    }
+
+    // everything before the signature
+    std::string_view signingInput(std::string_view token)
+    {
+        return token.substr(0, token.rfind('.'));
+    }
+
+    std::shared_ptr<FunctionFetcher> serve(std::string body)
+    {
+        return std::make_shared<FunctionFetcher>([body = std::move(body)](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = body;
+            return response;
+        });
+    }
+
+    void Base64urlDecode(benchmark::State& state, CorpusSize size)
+    {
+        std::vector<std::string> segments;
+        for (const std::string& payload : corpusPayloads(corpusOptions(size)))
+            segments.push_back(base64url(payload));
+        std::string out(64 * 1024, '\0');
+
+        size_t i = 0;
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            const std::string& segment = segments[i++ % segments.size()];
+            size_t written;
+            if (!base64urlDecode(segment, out.data(), written))
+                state.SkipWithError("decoding failed");
+            bytes += static_cast<int64_t>(segment.size());
+        }
+        state.SetBytesProcessed(bytes);
+    }
+
+    void ClaimsParse(benchmark::State& state, CorpusSize size)
+    {
+        std::vector<std::string> payloads = corpusPayloads(corpusOptions(size));
+        JWTClaimsParser parser;
+
+        size_t i = 0;
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            const std::string& payload = payloads[i++ % payloads.size()];
+            JWTClaims claims;
+            if (parser.parse(payload, claims) != JWTStatus::ok)
+                state.SkipWithError("parsing failed");
+            benchmark::DoNotOptimize(claims.exp);
+            bytes += static_cast<int64_t>(payload.size());
+        }
+        state.SetBytesProcessed(bytes);
+    }
+
+    void Sign(benchmark::State& state, JWTAlg alg, CorpusSize size)
+    {
+        std::unique_ptr<JWSSigner> signer;
+        if (algFamily(alg) == JWTAlgFamily::hmac)
+            signer = std::make_unique<HMACSigner>(alg, corpusSecret(), corpusKid(alg));
+        else
+            signer = std::make_unique<PrivateKeySigner>(alg, privatePEM(corpusKey(alg)), corpusKid(alg));
+        std::unique_ptr<SigningContext> context = signer->newContext();
+
+        std::vector<std::string> tokens = corpusTokens(alg, corpusOptions(size));
+        std::vector<unsigned char> signature(signer->signatureSize());
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            size_t written;
+            if (!context->sign(signingInput(tokens[i++ % tokens.size()]), signature.data(), written))
+                state.SkipWithError("signing failed");
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void Verify(benchmark::State& state, JWTAlg alg, CorpusSize size)
+    {
+        JWKSCache keys("stand-in:jwks", serve(corpusJWKS(std::size(corpusAlgs))));
+        keys.start();
+        JWTVerifier verifier(keys);
+        std::vector<std::string> tokens = corpusTokens(alg, corpusOptions(size));
+
+        size_t i = 0;
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (verifier.verify(tokens[i++ % tokens.size()], benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            result.reset();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // A256GCM content under each family of key management; the corpus
+    // signing keys serve as recipient keys
+    void Decrypt(benchmark::State& state, JWEAlg alg, CorpusSize size)
+    {
+        std::string secret = corpusSecret().substr(0, 32);
+        EVP_PKEY* pkey = alg == JWEAlg::RSA_OAEP_256 ? corpusKey(JWTAlg::RS256)
+            : alg == JWEAlg::ECDH_ES ? corpusKey(JWTAlg::ES256)
+            : nullptr;
+        std::unique_ptr<JWEDecrypter> decrypter;
+        if (pkey == nullptr)
+            decrypter = std::make_unique<SymmetricJWEDecrypter>(alg, secret);
+        else
+            decrypter = std::make_unique<PrivateKeyJWEDecrypter>(alg, privatePEM(pkey));
+
+        std::vector<std::string> tokens;
+        for (const std::string& payload : corpusPayloads(corpusOptions(size)))
+            tokens.push_back(makeJWE(alg, JWEEnc::A256GCM, pkey, secret, payload));
+        std::string buf(64 * 1024, '\0');
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            std::string_view plaintext;
+            if (decrypter->decrypt(tokens[i++ % tokens.size()], buf.data(), buf.size(), plaintext) != JWTStatus::ok)
+                state.SkipWithError("decryption failed");
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // a provider's key set, parsed and every key imported
+    void JWKSParse(benchmark::State& state, size_t keys)
+    {
+        std::string jwks = corpusJWKS(keys);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(JWKSet::parse(jwks));
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(jwks.size()));
+    }
+
+    // the lookup each verification makes: a snapshot and a find by "kid"
+    void JWKSLookup(benchmark::State& state, size_t keys)
+    {
+        JWKSCache cache("stand-in:jwks", serve(corpusJWKS(keys)));
+        cache.start();
+        std::vector<std::pair<std::string, JWTAlg>> kids;
+        for (size_t i = 0; i < keys; ++i)
+        {
+            JWTAlg alg = corpusAlgs[i % std::size(corpusAlgs)];
+            kids.emplace_back(corpusKid(alg, i / std::size(corpusAlgs)), alg);
+        }
+
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            const auto& [kid, alg] = kids[i++ % kids.size()];
+            JWKSCache::Snapshot snapshot = cache.snapshot();
+            if (snapshot.find(kid, alg) == nullptr)
+                state.SkipWithError("key not found");
+        }
+    }
+
+    void registerSuite()
+    {
+        for (CorpusSize size : sizes)
+        {
+            std::string suffix = std::string("/") + toString(size);
+            benchmark::RegisterBenchmark(("Base64urlDecode" + suffix).c_str(), Base64urlDecode, size);
+            benchmark::RegisterBenchmark(("ClaimsParse" + suffix).c_str(), ClaimsParse, size);
+        }
+        for (JWTAlg alg : corpusAlgs)
+        {
+            for (CorpusSize size : sizes)
+            {
+                std::string suffix = '/' + std::string(algName(alg)) + '/' + toString(size);
+                benchmark::RegisterBenchmark(("Sign" + suffix).c_str(), Sign, alg, size);
+                benchmark::RegisterBenchmark(("Verify" + suffix).c_str(), Verify, alg, size);
+            }
+        }
+        for (JWEAlg alg : jweAlgs)
+        {
+            for (CorpusSize size : sizes)
+            {
+                std::string name = "Decrypt/" + std::string(jweAlgName(alg)) + '/' + toString(size);
+                benchmark::RegisterBenchmark(name.c_str(), Decrypt, alg, size);
+            }
+        }
+        for (size_t keys : { 1, 8, 64 })
+        {
+            benchmark::RegisterBenchmark(("JWKSParse/" + std::to_string(keys)).c_str(), JWKSParse, keys)
+                ->Unit(benchmark::kMicrosecond);
+        }
+        for (size_t keys : { 8, 64, 512 })
+            benchmark::RegisterBenchmark(("JWKSLookup/" + std::to_string(keys)).c_str(), JWKSLookup, keys);
+    }
+
+    const char* kernelName(Base64URLKernel kernel)
+    {
+        switch (kernel)
+        {
+        case Base64URLKernel::scalar: return "scalar";
+        case Base64URLKernel::sse41:  return "sse41";
+        case Base64URLKernel::avx2:   return "avx2";
+        case Base64URLKernel::avx512: return "avx512";
+        }
+        return "unknown";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    CorpusOptions defaults;
+    benchmark::AddCustomContext("corpus_seed", std::to_string(defaults.seed));
+    benchmark::AddCustomContext("corpus_tokens", std::to_string(defaults.tokens));
+    benchmark::AddCustomContext("openssl", OpenSSL_version(OPENSSL_VERSION));
+    benchmark::AddCustomContext("base64url_kernel", kernelName(base64urlKernel()));
+    benchmark::AddCustomContext("verify_metrics", NCBI_OAUTH_METRICS ? "on" : "off");
+
+    registerSuite();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,203 @@
+// load test of the token endpoint: in-process clients, one thread each,
+// send token requests back to back through their own worker; reports
+// issued tokens/sec and the latency distribution of single requests
+
+#include <ncbi/token-endpoint.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t requestsPerClient = 256;
+    constexpr int64_t benchNow = 1700000000;
+
+    // RFC 7636 appendix B
+    constexpr std::string_view codeVerifier = "dBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk";
+    constexpr std::string_view codeChallenge = "E9Melhoa2OwvFrEMTJguCHaoeK1t8URWbuGJSstw-cM";
+
+    // "svc:secret" for the client_credentials client
+    constexpr std::string_view basicAuthorization = "Basic c3ZjOnNlY3JldA==";
+
+    struct Server
+    {
+        std::shared_ptr<MemoryCodeStore> codes = std::make_shared<MemoryCodeStore>();
+        std::shared_ptr<MemoryRefreshTokenStore> refreshTokens = std::make_shared<MemoryRefreshTokenStore>();
+        std::unique_ptr<TokenEndpoint> endpoint;
+    };
+
+    Server& server(JWTAlg alg)
+    {
+        static std::map<JWTAlg, Server> servers;
+        Server& s = servers[alg];
+        if (s.endpoint != nullptr)
+            return s;
+
+        std::shared_ptr<const JWSSigner> signer;
+        if (algFamily(alg) == JWTAlgFamily::hmac)
+            signer = std::make_shared<HMACSigner>(alg, benchSecret, "bench-1");
+        else
+            signer = std::make_shared<PrivateKeySigner>(alg, privatePEM(generateKey(alg).get()), "bench-1");
+
+        auto clients = std::make_shared<ClientRegistry>(std::vector<OAuthClient>
+        {
+            { "svc", "secret", { "sra:read", "sra:write" }, { GrantType::clientCredentials } },
+            { "spa", "", { "openid", "sra:read" }, { GrantType::authorizationCode, GrantType::refreshToken } }
+        });
+
+        s.endpoint = std::make_unique<TokenEndpoint>(signer, clients, s.codes, s.refreshTokens,
+            TokenEndpointOptions { .issuer = "https://auth.ncbi.nlm.nih.gov", .audience = "https://api.ncbi.nlm.nih.gov" });
+        return s;
+    }
+
+    enum class Flow { clientCredentials, authorizationCode, refreshToken };
+
+    // the request bodies one client sends in a round; codes and refresh
+    // tokens are minted beforehand, outside the measurement
+    std::vector<std::string> requestBodies(Flow flow, Server& s)
+    {
+        std::vector<std::string> bodies;
+        bodies.reserve(requestsPerClient);
+        for (size_t i = 0; i < requestsPerClient; ++i)
+        {
+            AuthorizationGrant grant { "spa", "user-" + std::to_string(i), "openid sra:read", "", "", benchNow + 600 };
+            switch (flow)
+            {
+            case Flow::clientCredentials:
+                bodies.push_back("grant_type=client_credentials&scope=sra%3Aread");
+                break;
+            case Flow::authorizationCode:
+                grant.redirectURI = "https://app.example/cb";
+                grant.codeChallenge = codeChallenge;
+                bodies.push_back("grant_type=authorization_code&client_id=spa&code=" + s.codes->issue(grant) +
+                    "&redirect_uri=https%3A%2F%2Fapp.example%2Fcb&code_verifier=" + std::string(codeVerifier));
+                break;
+            case Flow::refreshToken:
+                bodies.push_back("grant_type=refresh_token&client_id=spa&refresh_token=" + s.refreshTokens->issue(grant));
+                break;
+            }
+        }
+        return bodies;
+    }
+
+    void runLoad(benchmark::State& state, Flow flow)
+    {
+        JWTAlg alg = static_cast<JWTAlg>(state.range(0));
+        int clients = static_cast<int>(state.range(1));
+        Server& s = server(alg);
+        std::string_view authorization = flow == Flow::clientCredentials ? basicAuthorization : std::string_view();
+
+        std::vector<double> latencies;
+        std::atomic<bool> failed { false };
+        for (auto _ : state)
+        {
+            std::vector<std::vector<std::string>> bodies;
+            for (int c = 0; c < clients; ++c)
+                bodies.push_back(requestBodies(flow, s));
+
+            std::vector<std::vector<double>> observed(static_cast<size_t>(clients));
+            std::latch start(clients + 1);
+            std::vector<std::jthread> threads;
+            for (int c = 0; c < clients; ++c)
+            {
+                threads.emplace_back([&, c]
+                {
+                    // per-thread state is set up before the clock starts
+                    TokenEndpoint::Worker worker(*s.endpoint);
+                    std::vector<double>& mine = observed[static_cast<size_t>(c)];
+                    mine.reserve(requestsPerClient);
+                    start.arrive_and_wait();
+
+                    for (const std::string& body : bodies[static_cast<size_t>(c)])
+                    {
+                        Clock::time_point t0 = Clock::now();
+                        TokenResponse response = worker.handle({ authorization, body }, benchNow);
+                        Clock::time_point t1 = Clock::now();
+                        if (response.status != 200)
+                            failed.store(true, std::memory_order_relaxed);
+                        mine.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+                    }
+                });
+            }
+
+            start.arrive_and_wait();
+            Clock::time_point begin = Clock::now();
+            threads.clear();
+            state.SetIterationTime(std::chrono::duration<double>(Clock::now() - begin).count());
+
+            for (const auto& mine : observed)
+                latencies.insert(latencies.end(), mine.begin(), mine.end());
+        }
+        if (failed.load())
+            state.SkipWithError("token request failed");
+
+        auto percentile = [&](double p)
+        {
+            size_t i = std::min(latencies.size() - 1, static_cast<size_t>(p * static_cast<double>(latencies.size())));
+            std::nth_element(latencies.begin(), latencies.begin() + static_cast<long>(i), latencies.end());
+            return latencies[i];
+        };
+        double issued = static_cast<double>(latencies.size());
+        state.counters["tokens/s"] = benchmark::Counter(issued, benchmark::Counter::kIsRate);
+        state.counters["p50_us"] = percentile(0.50);
+        state.counters["p99_us"] = percentile(0.99);
+        state.SetLabel(std::string(algName(alg)));
+    }
+
+    void BM_ClientCredentials(benchmark::State& state)
+    {
+        runLoad(state, Flow::clientCredentials);
+    }
+
+    // code exchange including PKCE verification and a refresh token
+    void BM_AuthorizationCode(benchmark::State& state)
+    {
+        runLoad(state, Flow::authorizationCode);
+    }
+
+    // refresh with rotation
+    void BM_RefreshToken(benchmark::State& state)
+    {
+        runLoad(state, Flow::refreshToken);
+    }
+
+    int maxClients()
+    {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    void algorithmsByClients(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::HS256, JWTAlg::RS256, JWTAlg::ES256, JWTAlg::EdDSA })
+        {
+            for (int clients = 1; clients <= maxClients(); clients *= 2)
+                b->Args({ static_cast<int>(alg), clients });
+        }
+    }
+
+    void es256ByClients(benchmark::internal::Benchmark* b)
+    {
+        for (int clients = 1; clients <= maxClients(); clients *= 2)
+            b->Args({ static_cast<int>(JWTAlg::ES256), clients });
+    }
+
+    BENCHMARK(BM_ClientCredentials)->Apply(algorithmsByClients)->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_AuthorizationCode)->Apply(es256ByClients)->UseManualTime()->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_RefreshToken)->Apply(es256ByClients)->UseManualTime()->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,212 @@
+#pragma once
+
+// tokens for benchmarks, built with OpenSSL directly so that the code under
+// measurement is not also the code that produced its input
+
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwa.hpp>
+
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ncbi::bench
+{
+    inline std::string base64url(std::string_view data)
+    {
+        std::string out(base64urlEncodedSize(data.size()), '\0');
+        base64urlEncode(data.data(), data.size(), out.data());
+        return out;
+    }
+
+    inline std::string makeHS256Token(std::string_view headerJSON,
+        std::string_view payloadJSON, std::string_view secret)
+    {
+        std::string token = base64url(headerJSON) + '.' + base64url(payloadJSON);
+
+        unsigned char mac[EVP_MAX_MD_SIZE];
+        unsigned int macSize = 0;
+        HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+            reinterpret_cast<const unsigned char*>(token.data()), token.size(), mac, &macSize);
+
+        token += '.';
+        token += base64url(std::string_view(reinterpret_cast<const char*>(mac), macSize));
+        return token;
+    }
+
+    inline constexpr std::string_view benchSecret = "0123456789abcdef0123456789abcdef";
+
+    inline constexpr std::string_view benchHeader = R"({"alg":"HS256","typ":"JWT","kid":"bench-1"})";
+
+    inline constexpr std::string_view benchPayload =
+        R"({"iss":"https://auth.ncbi.nlm.nih.gov","sub":"user-1234567",)"
+        R"("aud":["https://api.ncbi.nlm.nih.gov","https://sra.ncbi.nlm.nih.gov"],)"
+        R"("exp":4102444800,"nbf":1700000000,"iat":1700000000,"jti":"b7c1e3a4-5d2f-4e8a-9b3c-1f2e3d4c5b6a",)"
+        R"("scope":"openid profile email sra:read","name":"Example User","email":"user@example.org"})";
+
+    struct PKeyFree { void operator()(EVP_PKEY* p) const noexcept { EVP_PKEY_free(p); } };
+    using PKey = std::unique_ptr<EVP_PKEY, PKeyFree>;
+
+    // a fresh private key suited to "alg"; HMAC algorithms need none
+    inline PKey generateKey(JWTAlg alg)
+    {
+        EVP_PKEY* pkey = nullptr;
+        switch (alg)
+        {
+        case JWTAlg::RS256: case JWTAlg::RS384: case JWTAlg::RS512:
+        case JWTAlg::PS256: case JWTAlg::PS384: case JWTAlg::PS512:
+            pkey = EVP_RSA_gen(2048);
+            break;
+        case JWTAlg::ES256: pkey = EVP_EC_gen("P-256"); break;
+        case JWTAlg::ES384: pkey = EVP_EC_gen("P-384"); break;
+        case JWTAlg::ES512: pkey = EVP_EC_gen("P-521"); break;
+        case JWTAlg::EdDSA: pkey = EVP_PKEY_Q_keygen(nullptr, nullptr, "ED25519"); break;
+        default: break;
+        }
+        if (pkey == nullptr && algFamily(alg) != JWTAlgFamily::hmac)
+            throw std::runtime_error("key generation failed");
+        return PKey(pkey);
+    }
+
+    // "pkey" as an unencrypted PKCS #8 PEM private key
+    inline std::string privatePEM(EVP_PKEY* pkey)
+    {
+        BIO* bio = BIO_new(BIO_s_mem());
+        if (bio == nullptr || PEM_write_bio_PrivateKey(bio, pkey, nullptr, nullptr, 0, nullptr, nullptr) != 1)
+        {
+            BIO_free(bio);
+            throw std::runtime_error("cannot write private key");
+        }
+        char* data = nullptr;
+        long size = BIO_get_mem_data(bio, &data);
+        std::string pem(data, static_cast<size_t>(size));
+        BIO_free(bio);
+        return pem;
+    }
+
+    inline std::string bignumBytes(EVP_PKEY* pkey, const char* name, size_t width = 0)
+    {
+        BIGNUM* bn = nullptr;
+        if (!EVP_PKEY_get_bn_param(pkey, name, &bn))
+            throw std::runtime_error("missing key parameter");
+        size_t size = width != 0 ? width : static_cast<size_t>(BN_num_bytes(bn));
+        std::string out(size, '\0');
+        BN_bn2binpad(bn, reinterpret_cast<unsigned char*>(out.data()), static_cast<int>(size));
+        BN_free(bn);
+        return out;
+    }
+
+    inline size_t ecCoordinateSize(JWTAlg alg)
+    {
+        return alg == JWTAlg::ES256 ? 32 : alg == JWTAlg::ES384 ? 48 : 66;
+    }
+
+    // the public half of "pkey" as a JWK; for HMAC "pkey" is ignored and
+    // "secret" becomes the "k" member
+    inline std::string publicJWK(JWTAlg alg, EVP_PKEY* pkey, std::string_view kid,
+        std::string_view secret = benchSecret)
+    {
+        std::string json = R"({"kid":")" + std::string(kid) + R"(","alg":")" + std::string(algName(alg)) + '"';
+        switch (algFamily(alg))
+        {
+        case JWTAlgFamily::hmac:
+            json += R"(,"kty":"oct","k":")" + base64url(secret) + '"';
+            break;
+        case JWTAlgFamily::rsa:
+        case JWTAlgFamily::rsaPSS:
+            json += R"(,"kty":"RSA","n":")" + base64url(bignumBytes(pkey, OSSL_PKEY_PARAM_RSA_N)) +
+                R"(","e":")" + base64url(bignumBytes(pkey, OSSL_PKEY_PARAM_RSA_E)) + '"';
+            break;
+        case JWTAlgFamily::ecdsa:
+        {
+            size_t width = ecCoordinateSize(alg);
+            const char* crv = alg == JWTAlg::ES256 ? "P-256" : alg == JWTAlg::ES384 ? "P-384" : "P-521";
+            json += R"(,"kty":"EC","crv":")" + std::string(crv) +
+                R"(","x":")" + base64url(bignumBytes(pkey, OSSL_PKEY_PARAM_EC_PUB_X, width)) +
+                R"(","y":")" + base64url(bignumBytes(pkey, OSSL_PKEY_PARAM_EC_PUB_Y, width)) + '"';
+            break;
+        }
+        case JWTAlgFamily::eddsa:
+        {
+            unsigned char raw[32];
+            size_t size = sizeof raw;
+            EVP_PKEY_get_raw_public_key(pkey, raw, &size);
+            json += R"(,"kty":"OKP","crv":"Ed25519","x":")" +
+                base64url(std::string_view(reinterpret_cast<const char*>(raw), size)) + '"';
+            break;
+        }
+        case JWTAlgFamily::none:
+            break;
+        }
+        return json + '}';
+    }
+
+    // signs "header.payload" with "pkey" (or "secret" for HMAC) and
+    // returns the signature as JWS carries it
+    inline std::string signJWS(JWTAlg alg, EVP_PKEY* pkey, std::string_view signingInput,
+        std::string_view secret = benchSecret)
+    {
+        const EVP_MD* md = algDigestSize(alg) == 32 ? EVP_sha256()
+            : algDigestSize(alg) == 48 ? EVP_sha384()
+            : algDigestSize(alg) == 64 ? EVP_sha512()
+            : nullptr;
+        const auto* data = reinterpret_cast<const unsigned char*>(signingInput.data());
+
+        if (algFamily(alg) == JWTAlgFamily::hmac)
+        {
+            unsigned char mac[EVP_MAX_MD_SIZE];
+            unsigned int macSize = 0;
+            HMAC(md, secret.data(), static_cast<int>(secret.size()), data, signingInput.size(), mac, &macSize);
+            return std::string(reinterpret_cast<const char*>(mac), macSize);
+        }
+
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        EVP_PKEY_CTX* pctx = nullptr;
+        EVP_DigestSignInit(ctx, &pctx, md, nullptr, pkey);
+        if (algFamily(alg) == JWTAlgFamily::rsaPSS)
+        {
+            EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING);
+            EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, RSA_PSS_SALTLEN_DIGEST);
+            EVP_PKEY_CTX_set_rsa_mgf1_md(pctx, md);
+        }
+        size_t size = 0;
+        EVP_DigestSign(ctx, nullptr, &size, data, signingInput.size());
+        std::vector<unsigned char> sig(size);
+        EVP_DigestSign(ctx, sig.data(), &size, data, signingInput.size());
+        EVP_MD_CTX_free(ctx);
+        sig.resize(size);
+
+        if (algFamily(alg) != JWTAlgFamily::ecdsa)
+            return std::string(sig.begin(), sig.end());
+
+        // DER to fixed-width R || S
+        const unsigned char* p = sig.data();
+        ECDSA_SIG* ecdsa = d2i_ECDSA_SIG(nullptr, &p, static_cast<long>(sig.size()));
+        size_t width = ecCoordinateSize(alg);
+        std::string out(2 * width, '\0');
+        BN_bn2binpad(ECDSA_SIG_get0_r(ecdsa), reinterpret_cast<unsigned char*>(out.data()), static_cast<int>(width));
+        BN_bn2binpad(ECDSA_SIG_get0_s(ecdsa), reinterpret_cast<unsigned char*>(out.data() + width), static_cast<int>(width));
+        ECDSA_SIG_free(ecdsa);
+        return out;
+    }
+
+    inline std::string makeToken(JWTAlg alg, EVP_PKEY* pkey, std::string_view kid, std::string_view payloadJSON,
+        std::string_view secret = benchSecret)
+    {
+        std::string header = R"({"alg":")" + std::string(algName(alg)) + R"(","typ":"JWT","kid":")" + std::string(kid) + R"("})";
+        std::string token = base64url(header) + '.' + base64url(payloadJSON);
+        std::string signature = signJWS(alg, pkey, token, secret);
+        return token + '.' + base64url(signature);
+    }
+}
@@ -0,0 +1,125 @@
+// full JWT verification against a JWKS, with and without the verified-token
+// cache in front of it, and the cache's lookup cost on its own
+
+#include <ncbi/jwt-verifier.hpp>
+
+#include "token-fixtures.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    struct Fixture
+    {
+        JWTAlg alg;
+        PKey key;
+        std::string token;
+        std::unique_ptr<JWKSCache> keys;
+
+        explicit Fixture(JWTAlg alg)
+            : alg(alg)
+            , key(generateKey(alg))
+            , token(makeToken(alg, key.get(), "bench-1", benchPayload))
+        {
+            std::string jwks = R"({"keys":[)" + publicJWK(alg, key.get(), "bench-1") + "]}";
+            keys = std::make_unique<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            keys->start();
+        }
+    };
+
+    Fixture& fixture(JWTAlg alg)
+    {
+        static std::vector<std::unique_ptr<Fixture>> fixtures;
+        for (auto& f : fixtures)
+        {
+            if (f->alg == alg)
+                return *f;
+        }
+        fixtures.push_back(std::make_unique<Fixture>(alg));
+        return *fixtures.back();
+    }
+
+    void BM_VerifyUncached(benchmark::State& state)
+    {
+        Fixture& f = fixture(static_cast<JWTAlg>(state.range(0)));
+        JWTVerifier verifier(*f.keys);
+
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetLabel(std::string(algName(f.alg)));
+    }
+
+    void BM_VerifyCached(benchmark::State& state)
+    {
+        Fixture& f = fixture(static_cast<JWTAlg>(state.range(0)));
+        VerifiedTokenCache cache;
+        JWTVerifier verifier(*f.keys, { .cache = &cache });
+
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetLabel(std::string(algName(f.alg)));
+    }
+
+    void algorithms(benchmark::internal::Benchmark* b)
+    {
+        for (JWTAlg alg : { JWTAlg::HS256, JWTAlg::RS256, JWTAlg::PS256, JWTAlg::ES256, JWTAlg::EdDSA })
+            b->Arg(static_cast<int>(alg));
+    }
+    BENCHMARK(BM_VerifyUncached)->Apply(algorithms);
+    BENCHMARK(BM_VerifyCached)->Apply(algorithms);
+
+    // lookups spread over a working set larger than one shard, from
+    // several threads, so the shard locks and CLOCK bits see contention
+    void BM_CacheLookup(benchmark::State& state)
+    {
+        static VerifiedTokenCache cache;
+        static std::vector<std::string> tokens = []
+        {
+            std::vector<std::string> out;
+            for (int i = 0; i < 4096; ++i)
+            {
+                auto entry = std::make_shared<VerifiedToken>();
+                entry->token = makeHS256Token(benchHeader,
+                    R"({"sub":"user-)" + std::to_string(i) + R"(","exp":4102444800})", benchSecret);
+                entry->exp = 4102444800;
+                out.push_back(entry->token);
+                cache.insert(std::move(entry), benchNow);
+            }
+            return out;
+        }();
+
+        size_t i = static_cast<size_t>(state.thread_index()) * 997;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(cache.find(tokens[i++ & 4095], benchNow));
+        }
+    }
+    BENCHMARK(BM_CacheLookup)->ThreadRange(1, 8)->UseRealTime();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+// the cost of per-stage verification metrics: a probe timing five stages
+// alone, HS256 and ES256 verification with the probe in place, and taking
+// a snapshot and rendering it for Prometheus; each verification run
+// reports the median and 99th percentile of every stage it reached
+//
+// building the library and this file with -DNCBI_OAUTH_METRICS=0 gives
+// the same verifications with the probe compiled out, for comparison
+
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/verify-metrics.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t benchNow = 1800000000;
+
+    struct Fixture
+    {
+        std::string token;
+        std::unique_ptr<JWKSCache> keys;
+
+        explicit Fixture(JWTAlg alg)
+        {
+            PKey pkey = generateKey(alg);
+            token = makeToken(alg, pkey.get(), "bench-1", benchPayload);
+            std::string jwks = R"({"keys":[)" + publicJWK(alg, pkey.get(), "bench-1") + "]}";
+            keys = std::make_unique<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            keys->start();
+        }
+    };
+
+    Fixture& fixture(JWTAlg alg)
+    {
+        static Fixture hs256(JWTAlg::HS256);
+        static Fixture es256(JWTAlg::ES256);
+        return alg == JWTAlg::HS256 ? hs256 : es256;
+    }
+
+    // the growth of each stage over the run, as p50 and p99 in nanoseconds
+    void reportStages(benchmark::State& state, const VerifyMetrics& before)
+    {
+        VerifyMetrics after = verifyMetrics();
+        for (size_t s = 0; s < verifyStageCount; ++s)
+        {
+            LatencyHistogram run = after.stages[s].latency;
+            LatencyHistogram earlier = before.stages[s].latency;
+            // histograms only grow, so the run is the difference
+            LatencyHistogram delta;
+            for (size_t b = 0; b < LatencyHistogram::bucketCount; ++b)
+                if (run.bucket(b) > earlier.bucket(b))
+                    delta.add(LatencyHistogram::bucketLow(b), run.bucket(b) - earlier.bucket(b));
+            if (delta.count() == 0)
+                continue;
+            std::string name = toString(static_cast<VerifyStage>(s));
+            state.counters[name + "_p50_ns"] = static_cast<double>(delta.percentile(0.5));
+            state.counters[name + "_p99_ns"] = static_cast<double>(delta.percentile(0.99));
+        }
+    }
+
+    void BM_Probe(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            VerifyProbe probe(VerifyStage::decode);
+            probe.enter(VerifyStage::parse);
+            probe.enter(VerifyStage::keyResolve);
+            probe.enter(VerifyStage::signature);
+            probe.enter(VerifyStage::claims);
+            benchmark::DoNotOptimize(probe.finish(JWTStatus::ok));
+        }
+    }
+
+    void BM_Verify(benchmark::State& state)
+    {
+        Fixture& f = fixture(static_cast<JWTAlg>(state.range(0)));
+        JWTVerifier verifier(*f.keys);
+
+        VerifyMetrics before = verifyMetrics();
+        std::shared_ptr<const VerifiedToken> result;
+        for (auto _ : state)
+        {
+            if (verifier.verify(f.token, benchNow, result) != JWTStatus::ok)
+                state.SkipWithError("verification failed");
+            result.reset();
+        }
+        reportStages(state, before);
+    }
+
+    void BM_Snapshot(benchmark::State& state)
+    {
+        // a record to add up, whatever ran before
+        VerifyProbe(VerifyStage::decode).finish(JWTStatus::malformed);
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            std::string text = toPrometheus(verifyMetrics());
+            bytes = text.size();
+            benchmark::DoNotOptimize(text.data());
+        }
+        state.counters["bytes"] = static_cast<double>(bytes);
+    }
+
+    BENCHMARK(BM_Probe)->ThreadRange(1, 4);
+    BENCHMARK(BM_Verify)->Arg(static_cast<int64_t>(JWTAlg::HS256))->Arg(static_cast<int64_t>(JWTAlg::ES256));
+    BENCHMARK(BM_Snapshot)->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <ncbi/async.hpp>
+#include <ncbi/introspection.hpp>
+#include <ncbi/jwt-verifier.hpp>
+
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace ncbi
+{
+    struct VerificationResult
+    {
+        JWTStatus status = JWTStatus::serverError;
+        std::shared_ptr<const VerifiedToken> token;
+    };
+
+    // JWTVerifier for coroutines:
+    //
+    //     VerificationResult v = co_await verifier.verify(token);
+    //
+    // the common case, a known key or a cached result, completes inside
+    // co_await without suspending; only a token naming a key the current
+    // JWKS lacks suspends, until the refresh it triggers has completed,
+    // and is then resumed through the executor and checked once more
+    // when no refresh can happen soon (see JWKSCache::whenRefreshed) the
+    // result is unknownKey straight away, as from JWTVerifier
+    //
+    // the token must stay valid until the co_await completes, and the
+    // cache and executor until every verification has
+    class AsyncJWTVerifier
+    {
+    public:
+        AsyncJWTVerifier(JWKSCache& keys, Executor& executor, JWTVerifierOptions options = {});
+
+        class [[nodiscard]] Verification
+        {
+        public:
+            bool await_ready();
+            bool await_suspend(std::coroutine_handle<> awaiting);
+            VerificationResult await_resume();
+
+        private:
+            friend class AsyncJWTVerifier;
+            Verification(const AsyncJWTVerifier& verifier, std::string_view token, std::optional<int64_t> now) noexcept;
+
+            void attempt();
+
+            const AsyncJWTVerifier& verifier_;
+            std::string_view token_;
+            std::optional<int64_t> now_;        // the system clock if empty
+            uint64_t generation_ = 0;
+            bool retry_ = false;
+            VerificationResult result_;
+        };
+
+        Verification verify(std::string_view token) const noexcept;
+        Verification verify(std::string_view token, int64_t now) const noexcept;
+
+        const JWTVerifier& verifier() const noexcept { return verifier_; }
+
+    private:
+        JWKSCache& keys_;
+        Executor& executor_;
+        JWTVerifier verifier_;
+    };
+
+    struct IntrospectionOutcome
+    {
+        JWTStatus status = JWTStatus::serverError;
+        std::shared_ptr<const IntrospectionResult> result;
+    };
+
+    // IntrospectionClient for coroutines
+    //
+    // a cached result is returned without suspending; otherwise the
+    // request, or the wait on another caller's request for the same token,
+    // runs on the executor, which therefore should be a pool that may
+    // block rather than the event loop itself, and the coroutine resumes
+    // there once the answer is in
+    class AsyncIntrospectionClient
+    {
+    public:
+        AsyncIntrospectionClient(IntrospectionClient& client, Executor& executor) noexcept
+            : client_(client)
+            , executor_(executor)
+        {
+        }
+
+        class [[nodiscard]] Introspection
+        {
+        public:
+            bool await_ready();
+            void await_suspend(std::coroutine_handle<> awaiting);
+            IntrospectionOutcome await_resume() noexcept { return std::move(outcome_); }
+
+        private:
+            friend class AsyncIntrospectionClient;
+            Introspection(const AsyncIntrospectionClient& client, std::string_view token) noexcept
+                : client_(client)
+                , token_(token)
+            {
+            }
+
+            const AsyncIntrospectionClient& client_;
+            std::string_view token_;
+            IntrospectionOutcome outcome_;
+        };
+
+        Introspection introspect(std::string_view token) const noexcept { return Introspection(*this, token); }
+
+    private:
+        IntrospectionClient& client_;
+        Executor& executor_;
+    };
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <ncbi/thread-pool.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <semaphore>
+#include <type_traits>
+#include <utility>
+
+namespace ncbi
+{
+    // where suspended operations are resumed
+    //
+    // an event loop supplies its own implementation that queues the task
+    // onto the loop; tasks should be run in the order posted
+    class Executor
+    {
+    public:
+        virtual ~Executor() = default;
+
+        virtual void post(std::function<void()> task) = 0;
+    };
+
+    // resumes on the workers of a ThreadPool
+    class ThreadPoolExecutor final : public Executor
+    {
+    public:
+        explicit ThreadPoolExecutor(ThreadPool& pool) noexcept
+            : pool_(pool)
+        {
+        }
+
+        void post(std::function<void()> task) override { pool_.post(std::move(task)); }
+
+    private:
+        ThreadPool& pool_;
+    };
+
+    template<class T = void>
+    class Task;
+
+    namespace detail
+    {
+        struct TaskPromiseBase
+        {
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+            std::exception_ptr error;
+
+            // resumes whoever awaited the task, without growing the stack
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template<class Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> done) const noexcept
+                {
+                    return done.promise().continuation;
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        template<class T>
+        struct TaskPromise : TaskPromiseBase
+        {
+            std::optional<T> value;
+
+            Task<T> get_return_object() noexcept;
+
+            template<class U>
+            void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+            T take()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase
+        {
+            Task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept {}
+
+            void take()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+        };
+    }
+
+    // a lazily started coroutine yielding T, resumed by whoever awaits it
+    //
+    // enough of a coroutine type to write verification pipelines without
+    // an external runtime; frameworks with their own task types can await
+    // this library's operations directly instead
+    template<class T>
+    class [[nodiscard]] Task
+    {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+
+        Task(Task&& other) noexcept
+            : handle_(std::exchange(other.handle_, nullptr))
+        {
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        auto operator co_await() & noexcept { return Awaiter { handle_ }; }
+        auto operator co_await() && noexcept { return Awaiter { handle_ }; }
+
+    private:
+        friend promise_type;
+
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() const { return handle.promise().take(); }
+        };
+
+        explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+            : handle_(handle)
+        {
+        }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace detail
+    {
+        template<class T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+        }
+
+        // the coroutine syncWait() drives; it signals the waiting thread
+        // from its final suspension point, after which it may be destroyed
+        struct SyncWaitPromise;
+
+        struct SyncWaitTask
+        {
+            using promise_type = SyncWaitPromise;
+            std::coroutine_handle<SyncWaitPromise> handle;
+        };
+
+        struct SyncWaitPromise
+        {
+            std::binary_semaphore* done = nullptr;
+
+            SyncWaitTask get_return_object() noexcept
+            {
+                return { std::coroutine_handle<SyncWaitPromise>::from_promise(*this) };
+            }
+
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<SyncWaitPromise> self) const noexcept
+                {
+                    self.promise().done->release();
+                }
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+
+        template<class T, class Result>
+        SyncWaitTask syncWaitDriver(Task<T>& task, Result& result, std::exception_ptr& error)
+        {
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                    co_await task;
+                else
+                    result.emplace(co_await task);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    // runs "task" to completion, blocking the calling thread while it is
+    // suspended, and returns its result or rethrows its exception
+    // for tests, tools and the edges of a program, never an event loop
+    template<class T>
+    T syncWait(Task<T> task)
+    {
+        using Result = std::conditional_t<std::is_void_v<T>, std::optional<bool>, std::optional<T>>;
+
+        Result result;
+        std::exception_ptr error;
+        std::binary_semaphore done(0);
+
+        detail::SyncWaitTask driver = detail::syncWaitDriver(task, result, error);
+        driver.handle.promise().done = &done;
+        driver.handle.resume();
+        done.acquire();
+        driver.handle.destroy();
+
+        if (error)
+            std::rethrow_exception(error);
+        if constexpr (!std::is_void_v<T>)
+            return std::move(*result);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace ncbi
+{
+    enum class Base64URLMode : unsigned char
+    {
+        // RFC 7515 section 2: URL-safe alphabet only, no padding, whitespace
+        // or line breaks, and the unused trailing bits of the final
+        // character must be zero, so every value has exactly one encoding
+        strict,
+
+        // additionally accepts '=' padding to a multiple of four characters
+        // and nonzero trailing bits, for interoperating with producers that
+        // emit plain RFC 4648 section 5 output
+        lenient
+    };
+
+    // vectorized implementations, chosen once from the CPU at startup
+    enum class Base64URLKernel : unsigned char
+    {
+        scalar,
+        sse41,
+        avx2,
+        avx512      // AVX-512 F, BW and VBMI
+    };
+
+    // length of the unpadded base64url encoding of "bytes" octets
+    constexpr size_t base64urlEncodedSize(size_t bytes) noexcept
+    {
+        return bytes / 3 * 4 + (bytes % 3 != 0 ? bytes % 3 + 1 : 0);
+    }
+
+    // number of octets an unpadded encoding of "chars" characters decodes to
+    // a length of 1 modulo 4 can never be valid; it yields the same size as
+    // one character less so that callers may size buffers without checking
+    constexpr size_t base64urlDecodedSize(size_t chars) noexcept
+    {
+        return chars / 4 * 3 + (chars % 4 > 1 ? chars % 4 - 1 : 0);
+    }
+
+    // writes base64urlEncodedSize(bytes) characters to "dst", without padding
+    // returns the number of characters written
+    size_t base64urlEncode(const void* src, size_t bytes, char* dst) noexcept;
+
+    // decodes "src" into "dst", which must hold base64urlDecodedSize(src.size())
+    // octets, storing the decoded length in "written"
+    bool base64urlDecode(std::string_view src, void* dst, size_t& written,
+        Base64URLMode mode = Base64URLMode::strict) noexcept;
+
+    // the kernel in use, by default the widest the CPU supports
+    Base64URLKernel base64urlKernel() noexcept;
+
+    bool base64urlKernelSupported(Base64URLKernel kernel) noexcept;
+
+    // switches every thread to "kernel", for benchmarks and for ruling out
+    // a kernel in the field; fails if the CPU does not support it
+    bool base64urlSelectKernel(Base64URLKernel kernel) noexcept;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ncbi/grant-store.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    struct ShardedCodeStoreOptions
+    {
+        size_t capacity = size_t(1) << 18;      // slots across all shards, rounded up to a power of two
+        unsigned shards = 16;                   // rounded up to a power of two
+
+        // NumericDate the expiry wheels start from; 0 for the current time
+        int64_t start = 0;
+    };
+
+    // authorization codes for login storms
+    //
+    // a code is 256 random bits, and its first 64 bits index the table
+    // directly: a sharded open-addressing table of one cache line per
+    // slot, probed over a fixed window of 16 slots, so that a consumed or
+    // expired slot becomes free at once without breaking any probe chain
+    // each slot carries a state word that counts its reuses; consume() is
+    // one compare-and-swap from live to claimed on that word, which
+    // exactly one caller wins, and it takes no lock
+    // issue() claims a free slot the same way and records the expiry in
+    // a hierarchical timing wheel per shard (256 one-second buckets, then
+    // 64 of 256 seconds and 64 of 16384 seconds), pushing onto a bucket
+    // with one more compare-and-swap
+    // expire() advances the wheels to "now", detaching whole buckets;
+    // entries for codes consumed meanwhile are recognized by the reuse
+    // count and dropped, so insert, consume and expire are each O(1)
+    // a window with no free slot, which takes a table more than half full,
+    // sends the code to a small locked overflow map in its shard
+    class ShardedCodeStore final : public AuthorizationCodeStore
+    {
+    public:
+        explicit ShardedCodeStore(ShardedCodeStoreOptions options = {});
+        ~ShardedCodeStore() override;
+
+        ShardedCodeStore(const ShardedCodeStore&) = delete;
+        ShardedCodeStore& operator=(const ShardedCodeStore&) = delete;
+
+        std::string issue(AuthorizationGrant grant) override;
+        bool consume(std::string_view code, int64_t now, AuthorizationGrant& grant) override;
+
+        // frees the slots of codes that expired by "now" and returns how
+        // many there were; call it about once a second, from any thread
+        // a shard that another thread is expiring is skipped
+        size_t expire(int64_t now);
+
+        // codes issued and neither consumed nor expired
+        size_t size() const noexcept;
+
+    private:
+        struct Slot;
+        struct Node;
+        struct Shard;
+
+        size_t expireBucket(Shard& shard, std::atomic<Node*>& bucket, int64_t current, int64_t now);
+
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
+        unsigned shardBits_;
+        size_t slotMask_;                       // within a shard
+    };
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwk.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    class JWTVerifier;
+    struct VerifiedToken;
+
+    struct DPoPReplayCacheOptions
+    {
+        // how long a "jti" is remembered at least; no shorter than the
+        // span of "iat" values a verifier accepts, or a proof could be
+        // replayed once forgotten
+        std::chrono::seconds window { 70 };
+
+        // the window is covered by this many generations less one, the
+        // remaining one being the oldest, which is cleared for reuse
+        unsigned generations = 4;
+
+        size_t capacity = 1 << 18;      // "jti" values per generation, across all shards
+        unsigned shards = 16;           // rounded up to a power of two
+    };
+
+    // remembers the "jti" of every DPoP proof accepted within a window, so
+    // each proof is accepted once
+    //
+    // entries carry no expiry of their own: time is cut into generations
+    // of window / (generations - 1) seconds, each with its own hash table
+    // of seeded 64-bit "jti" hashes, and the tables form a ring; a "jti"
+    // is looked up in every live generation and recorded in the current
+    // one, and when time moves into a new generation the table it reuses
+    // is simply cleared, which forgets a whole generation at once with no
+    // timers and no per-entry bookkeeping
+    // the cache is bounded: a generation that has filled up refuses
+    // further proofs until the next one begins, failing closed, since a
+    // proof that cannot be recorded could be replayed
+    // a hash collision can refuse a fresh proof but never admit a replay
+    class DPoPReplayCache
+    {
+        struct Shard;
+
+    public:
+        enum class Result : unsigned char
+        {
+            fresh,              // not seen within the window; recorded now
+            replayed,           // seen within the window
+            full                // not seen, but no room to record it
+        };
+
+        struct Stats
+        {
+            uint64_t fresh = 0;
+            uint64_t replayed = 0;
+            uint64_t full = 0;
+            uint64_t rotations = 0;     // generation tables cleared for reuse
+        };
+
+        // throws JWTException unless the window is positive and there are
+        // at least two generations
+        explicit DPoPReplayCache(DPoPReplayCacheOptions options = {});
+        ~DPoPReplayCache();
+
+        DPoPReplayCache(const DPoPReplayCache&) = delete;
+        DPoPReplayCache& operator=(const DPoPReplayCache&) = delete;
+
+        // records "jti" as seen at "now", a NumericDate
+        Result insert(std::string_view jti, int64_t now) noexcept;
+
+        std::chrono::seconds window() const noexcept { return options_.window; }
+
+        Stats stats() const noexcept;
+
+    private:
+        DPoPReplayCacheOptions options_;
+        int64_t span_;                          // seconds per generation
+        uint64_t seed_;
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
+        size_t tableMask_;                      // slots per generation table, less one
+        size_t tableLimit_;                     // entries per generation table, at most half its slots
+        std::atomic<uint64_t> fresh_ { 0 }, replayed_ { 0 }, full_ { 0 }, rotations_ { 0 };
+    };
+
+    struct DPoPVerifierOptions
+    {
+        // how old a proof's "iat" may be, and how far in the future
+        std::chrono::seconds maxAge { 60 };
+        std::chrono::seconds clockSkew { 5 };
+
+        // empty accepts every asymmetric algorithm; symmetric ones are
+        // never accepted
+        std::vector<JWTAlg> algorithms;
+
+        // optional cache shared with other verifiers, which must outlive
+        // them and whose window must cover maxAge + clockSkew; without one
+        // the verifier keeps its own
+        DPoPReplayCache* replayCache = nullptr;
+
+        // proof keys kept ready for verification, by their JWK text
+        size_t keyCacheSize = 4096;
+    };
+
+    // what the request carries besides the proof
+    struct DPoPRequest
+    {
+        std::string_view method;        // compared exactly with "htm"
+        std::string_view uri;           // compared with "htu", both without query and fragment
+        std::string_view accessToken;   // if not empty, "ath" must be its hash
+        std::string_view nonce;         // if not empty, "nonce" must match it
+    };
+
+    // a proof that has been accepted
+    struct DPoPProof
+    {
+        std::array<char, jwkThumbprintSize> jkt {};    // thumbprint of the key that signed it
+        int64_t iat = 0;
+
+        std::string_view thumbprint() const noexcept { return std::string_view(jkt.data(), jkt.size()); }
+    };
+
+    // verifies DPoP proofs (RFC 9449) and the access tokens bound to them
+    //
+    // a proof is a JWT of type "dpop+jwt" signed by the public key in its
+    // own header; it is accepted if the signature checks out, "htm" and
+    // "htu" name this request, "iat" is recent, "ath" and "nonce" match
+    // when the request asks for them, and its "jti" has not been seen
+    // the "jti" is recorded last, once everything else has passed, so a
+    // forged or misdirected proof cannot burn the "jti" of a genuine one
+    // the keys of recent proofs are kept imported, with their thumbprints,
+    // in a small cache found by a hash of the header's JWK text and
+    // confirmed by comparing that text in full; a client signs every
+    // proof with the same key, so only its first proof pays for the import
+    class DPoPVerifier
+    {
+        struct KeyEntry;
+        struct KeyShard;
+
+    public:
+        // throws JWTException for a negative age or skew, a symmetric
+        // algorithm, or a shared replay cache whose window is too short
+        explicit DPoPVerifier(DPoPVerifierOptions options = {});
+        ~DPoPVerifier();
+
+        DPoPVerifier(const DPoPVerifier&) = delete;
+        DPoPVerifier& operator=(const DPoPVerifier&) = delete;
+
+        // "now" is a NumericDate; on success "result" describes the proof
+        JWTStatus verify(std::string_view proof, const DPoPRequest& request, int64_t now,
+            DPoPProof& result) const;
+
+        // verifies a DPoP-bound access token with "tokens", then the proof
+        // presented with it, which must be signed by the key named in the
+        // token's "cnf" member and carry the token's hash in "ath"
+        // "request.accessToken" is ignored in favor of "accessToken"
+        JWTStatus verify(const JWTVerifier& tokens, std::string_view accessToken, std::string_view proof,
+            const DPoPRequest& request, int64_t now, std::shared_ptr<const VerifiedToken>& result) const;
+
+    private:
+        // as the public verify(), and if "jkt" is not empty the proof key
+        // must have that thumbprint
+        JWTStatus verifyProof(std::string_view proof, const DPoPRequest& request, int64_t now,
+            std::string_view jkt, DPoPProof& result) const;
+
+        // the ready key for the header member "jwk", imported on a miss
+        JWTStatus resolveKey(std::string_view jwk, JWTAlg alg, std::shared_ptr<const KeyEntry>& entry) const;
+
+        DPoPVerifierOptions options_;
+        std::unique_ptr<DPoPReplayCache> ownReplayCache_;
+        DPoPReplayCache* replayCache_;
+        uint64_t seed_;
+        std::unique_ptr<KeyShard[]> keyShards_;
+        size_t keyShardMask_;
+        size_t keySlotMask_;
+    };
+}
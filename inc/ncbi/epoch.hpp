@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace ncbi
+{
+    // epoch-based reclamation for read-mostly data
+    //
+    // readers announce themselves by holding an EpochGuard, which costs one
+    // store to a per-thread slot and never blocks; writers publish a new
+    // immutable object with a single pointer exchange and retire the old
+    // one, which is destroyed only after every reader that could still see
+    // it has left its guard
+    //
+    // guards nest and may be held across calls, but not across a blocking
+    // wait: a thread parked inside a guard holds back reclamation for all
+
+    class EpochGuard
+    {
+    public:
+        EpochGuard() noexcept;
+        ~EpochGuard();
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+    };
+
+    // hands "object" to the reclaimer, which calls "deleter" on it once no
+    // guard that began before the call is still held
+    void retireEpochObject(void* object, void (*deleter)(void*));
+
+    // destroys whatever retired objects are no longer reachable; retirement
+    // does this as well, so calling it is only needed to release memory
+    // promptly after the last publication
+    void reclaimEpochObjects();
+
+    // a pointer to an immutable T that readers load inside an EpochGuard
+    // and writers replace wholesale
+    template<class T>
+    class RCUPointer
+    {
+    public:
+        RCUPointer() noexcept = default;
+
+        explicit RCUPointer(std::unique_ptr<const T> initial) noexcept
+            : ptr_(initial.release())
+        {
+        }
+
+        // no reader may be active when the pointer itself goes away
+        ~RCUPointer()
+        {
+            delete ptr_.load(std::memory_order_relaxed);
+        }
+
+        RCUPointer(const RCUPointer&) = delete;
+        RCUPointer& operator=(const RCUPointer&) = delete;
+
+        // valid until "guard" is released
+        const T* load(const EpochGuard& guard) const noexcept
+        {
+            (void)guard;
+            return ptr_.load(std::memory_order_seq_cst);
+        }
+
+        // installs "next" and retires the object it replaces
+        void publish(std::unique_ptr<const T> next)
+        {
+            const T* old = ptr_.exchange(next.release(), std::memory_order_seq_cst);
+            if (old != nullptr)
+            {
+                retireEpochObject(const_cast<T*>(old),
+                    [](void* p) { delete static_cast<T*>(p); });
+            }
+        }
+
+    private:
+        std::atomic<const T*> ptr_ { nullptr };
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    struct FetchResponse
+    {
+        int status = 0;             // HTTP status; 0 for a transport failure
+        std::string body;
+        std::string cacheControl;   // value of the Cache-Control header, if any
+    };
+
+    // an HTTP POST, as introspection and token requests need
+    struct FetchRequest
+    {
+        std::string contentType;
+        std::string authorization;  // value of the Authorization header, if any
+        std::string body;
+    };
+
+    // source of remote documents such as key sets
+    //
+    // the library does not carry an HTTP client; deployments supply one by
+    // implementing this interface, while FileFetcher and FunctionFetcher
+    // serve local files and in-process stand-ins
+    // implementations must be callable from any thread
+    class Fetcher
+    {
+    public:
+        virtual ~Fetcher() = default;
+        virtual FetchResponse get(const std::string& uri) = 0;
+
+        // fetchers that only read documents need not implement this; the
+        // default answers as a transport failure
+        virtual FetchResponse post(const std::string& uri, const FetchRequest& request);
+    };
+
+    // reads "file://" URIs or plain paths, answering 200 or 404
+    class FileFetcher final : public Fetcher
+    {
+    public:
+        FetchResponse get(const std::string& uri) override;
+    };
+
+    // forwards to a function, typically a stand-in for an HTTP server
+    class FunctionFetcher final : public Fetcher
+    {
+    public:
+        using Handler = std::function<FetchResponse(const std::string& uri)>;
+        using PostHandler = std::function<FetchResponse(const std::string& uri, const FetchRequest& request)>;
+
+        explicit FunctionFetcher(Handler handler, PostHandler postHandler = nullptr)
+            : handler_(std::move(handler))
+            , postHandler_(std::move(postHandler))
+        {
+        }
+
+        FetchResponse get(const std::string& uri) override { return handler_(uri); }
+
+        FetchResponse post(const std::string& uri, const FetchRequest& request) override
+        {
+            return postHandler_ ? postHandler_(uri, request) : Fetcher::post(uri, request);
+        }
+
+    private:
+        Handler handler_;
+        PostHandler postHandler_;
+    };
+
+    // freshness lifetime from a Cache-Control header: "max-age", with
+    // "no-store" and "no-cache" meaning zero; empty if neither is present
+    std::optional<std::chrono::seconds> parseCacheControlMaxAge(std::string_view header) noexcept;
+}
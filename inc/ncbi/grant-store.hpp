@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ncbi
+{
+    // what the resource owner approved at the authorization endpoint, as
+    // an authorization code or refresh token carries it to the token
+    // endpoint
+    struct AuthorizationGrant
+    {
+        std::string clientId;
+        std::string subject;
+        std::string scope;              // space-separated
+        std::string redirectURI;        // codes only; empty if none was sent
+        std::string codeChallenge;      // codes only; S256 PKCE challenge (RFC 7636)
+        int64_t expires = 0;            // NumericDate
+    };
+
+    // single-use authorization codes
+    class AuthorizationCodeStore
+    {
+    public:
+        virtual ~AuthorizationCodeStore() = default;
+
+        // records "grant" under a fresh code and returns the code
+        virtual std::string issue(AuthorizationGrant grant) = 0;
+
+        // removes the code and fills in its grant; false if the code is
+        // unknown, already consumed or past "expires"
+        // at most one of any number of concurrent calls succeeds
+        virtual bool consume(std::string_view code, int64_t now, AuthorizationGrant& grant) = 0;
+    };
+
+    enum class RotateResult : unsigned char
+    {
+        rotated,
+        invalidGrant,       // the token is unknown, retired or expired, or was issued to another client
+        invalidScope        // the scope requested is not within the grant's; the token is left as it was
+    };
+
+    // refresh tokens, rotated on every use (OAuth 2.0 Security BCP,
+    // section 4.14.2)
+    class RefreshTokenStore
+    {
+    public:
+        virtual ~RefreshTokenStore() = default;
+
+        virtual std::string issue(AuthorizationGrant grant) = 0;
+
+        // retires "token" and issues its successor for the same grant,
+        // returning the grant and the successor
+        // a "scope" that is not empty is what the client asks for now; it
+        // may narrow the grant's scope but not widen it (RFC 6749 section
+        // 6), and is checked before the token is retired
+        virtual RotateResult rotate(std::string_view token, std::string_view clientId, std::string_view scope,
+            int64_t now, AuthorizationGrant& grant, std::string& successor) = 0;
+    };
+
+    // a fresh opaque credential: 256 random bits, base64url-encoded
+    std::string randomCredential();
+
+    // true if "requested" is one or more space-separated values, each of
+    // them also among those of "granted"
+    bool scopeWithin(std::string_view requested, std::string_view granted) noexcept;
+
+    // in-process stores behind one mutex each, for single-node servers
+    // and for tests
+    class MemoryCodeStore final : public AuthorizationCodeStore
+    {
+    public:
+        std::string issue(AuthorizationGrant grant) override;
+        bool consume(std::string_view code, int64_t now, AuthorizationGrant& grant) override;
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<std::string, AuthorizationGrant> codes_;
+    };
+
+    class MemoryRefreshTokenStore final : public RefreshTokenStore
+    {
+    public:
+        std::string issue(AuthorizationGrant grant) override;
+        RotateResult rotate(std::string_view token, std::string_view clientId, std::string_view scope,
+            int64_t now, AuthorizationGrant& grant, std::string& successor) override;
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<std::string, AuthorizationGrant> tokens_;
+    };
+}
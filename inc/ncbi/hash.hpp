@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace ncbi
+{
+    // fast non-cryptographic 64-bit hash (wyhash, final version 4)
+    //
+    // suitable for indexing tables keyed by attacker-supplied strings when
+    // seeded with a per-process random value; never use it to decide
+    // whether two tokens are equal
+    namespace detail
+    {
+        constexpr uint64_t hashSecret[4] =
+        {
+            0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+            0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+        };
+
+        inline void mum(uint64_t& a, uint64_t& b) noexcept
+        {
+            __uint128_t r = static_cast<__uint128_t>(a) * b;
+            a = static_cast<uint64_t>(r);
+            b = static_cast<uint64_t>(r >> 64);
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b) noexcept
+        {
+            mum(a, b);
+            return a ^ b;
+        }
+
+        inline uint64_t read8(const uint8_t* p) noexcept
+        {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            return v;
+        }
+
+        inline uint64_t read4(const uint8_t* p) noexcept
+        {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+    }
+
+    inline uint64_t hash64(const void* data, size_t size, uint64_t seed = 0) noexcept
+    {
+        using namespace detail;
+
+        const auto* p = static_cast<const uint8_t*>(data);
+        seed ^= mix(seed ^ hashSecret[0], hashSecret[1]);
+
+        uint64_t a, b;
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                size_t shift = (size >> 3) << 2;
+                a = read4(p) << 32 | read4(p + shift);
+                b = read4(p + size - 4) << 32 | read4(p + size - 4 - shift);
+            }
+            else if (size > 0)
+            {
+                a = uint64_t(p[0]) << 16 | uint64_t(p[size >> 1]) << 8 | p[size - 1];
+                b = 0;
+            }
+            else
+            {
+                a = b = 0;
+            }
+        }
+        else
+        {
+            size_t i = size;
+            if (i > 48)
+            {
+                uint64_t see1 = seed, see2 = seed;
+                do
+                {
+                    seed = mix(read8(p) ^ hashSecret[1], read8(p + 8) ^ seed);
+                    see1 = mix(read8(p + 16) ^ hashSecret[2], read8(p + 24) ^ see1);
+                    see2 = mix(read8(p + 32) ^ hashSecret[3], read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                }
+                while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16)
+            {
+                seed = mix(read8(p) ^ hashSecret[1], read8(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+
+        a ^= hashSecret[1];
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ hashSecret[0] ^ size, b ^ hashSecret[1]);
+    }
+
+    inline uint64_t hash64(std::string_view text, uint64_t seed = 0) noexcept
+    {
+        return hash64(text.data(), text.size(), seed);
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <ncbi/fetch.hpp>
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ncbi
+{
+    // an introspection response (RFC 7662 section 2.2)
+    //
+    // "claims" views the response body: the registered claims, plus the
+    // custom claims "active", "client_id", "username" and "token_type"
+    // at the indices below
+    struct IntrospectionResult
+    {
+        enum : size_t { activeClaim, clientIdClaim, usernameClaim, tokenTypeClaim };
+
+        std::string body;
+        JWTClaims claims;
+        bool active = false;
+
+        IntrospectionResult() = default;
+        IntrospectionResult(const IntrospectionResult&) = delete;
+        IntrospectionResult& operator=(const IntrospectionResult&) = delete;
+    };
+
+    struct IntrospectionOptions
+    {
+        // client credentials, sent with HTTP Basic authentication
+        std::string clientId;
+        std::string clientSecret;
+
+        std::string tokenTypeHint = "access_token";
+
+        // how long results are reused; an active result is never kept
+        // past its "exp"
+        std::chrono::seconds activeTTL { 60 };
+        std::chrono::seconds inactiveTTL { 10 };
+
+        size_t capacity = 65536;        // cached results across all shards
+        unsigned shards = 16;           // rounded up to a power of two
+    };
+
+    // RFC 7662 client for opaque tokens
+    //
+    // concurrent lookups of one token share a single request to the
+    // endpoint: the first caller sends it and the others wait for its
+    // outcome; results are then cached, active and inactive alike, each
+    // for a bounded time
+    // failures to reach the server are not cached, so the next lookup
+    // retries, but they are shared by the callers waiting on that request
+    class IntrospectionClient
+    {
+    public:
+        IntrospectionClient(std::string endpoint, std::shared_ptr<Fetcher> fetcher, IntrospectionOptions options = {});
+        ~IntrospectionClient();
+
+        IntrospectionClient(const IntrospectionClient&) = delete;
+        IntrospectionClient& operator=(const IntrospectionClient&) = delete;
+
+        // ok for an active token; inactive when the server says so, with
+        // "result" still set; serverError when no usable answer came back
+        JWTStatus introspect(std::string_view token, std::shared_ptr<const IntrospectionResult>& result);
+
+        // the cached result alone: never sends a request nor waits for
+        // one; false when "token" has no live entry
+        bool cached(std::string_view token, JWTStatus& status, std::shared_ptr<const IntrospectionResult>& result);
+
+        struct Stats
+        {
+            uint64_t hits = 0;
+            uint64_t coalesced = 0;     // lookups that waited on another's request
+            uint64_t requests = 0;      // requests sent to the endpoint
+        };
+        Stats stats() const noexcept;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Outcome
+        {
+            JWTStatus status;
+            std::shared_ptr<const IntrospectionResult> result;
+        };
+
+        struct Flight
+        {
+            std::string token;
+            std::shared_future<Outcome> outcome;
+        };
+
+        struct Entry
+        {
+            std::string token;
+            std::shared_ptr<const IntrospectionResult> result;
+            Clock::time_point expires;
+        };
+
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<uint64_t, Entry> entries;
+            std::deque<uint64_t> order;             // insertion order, for eviction
+            std::unordered_map<uint64_t, std::shared_ptr<Flight>> flights;
+        };
+
+        bool findCached(Shard& shard, uint64_t hash, std::string_view token,
+            std::shared_ptr<const IntrospectionResult>& result);
+        Outcome request(std::string_view token);
+        void store(Shard& shard, uint64_t hash, std::string_view token, const Outcome& outcome);
+
+        std::string endpoint_;
+        std::shared_ptr<Fetcher> fetcher_;
+        IntrospectionOptions options_;
+        std::string authorization_;
+
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
+        size_t shardCapacity_;
+        uint64_t seed_;
+
+        std::atomic<uint64_t> hits_ { 0 };
+        std::atomic<uint64_t> coalesced_ { 0 };
+        std::atomic<uint64_t> requests_ { 0 };
+    };
+}
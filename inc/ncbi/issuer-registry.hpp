@@ -0,0 +1,99 @@
+#pragma once
+
+#include <ncbi/epoch.hpp>
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwks-cache.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    // what a verifier trusts of one issuer
+    struct IssuerPolicy
+    {
+        std::string issuer;                     // compared exactly with "iss"
+        std::shared_ptr<JWKSCache> keys;        // the issuer's key set, started; required
+        std::vector<std::string> audiences;     // one must appear in "aud"; empty accepts any
+        std::vector<JWTAlg> algorithms;         // empty accepts any the keys accept
+        std::chrono::seconds clockSkew { 60 };  // leeway for "exp" and "nbf"
+
+        bool acceptsAlg(JWTAlg alg) const noexcept;
+    };
+
+    // the trusted issuers of a multi-tenant JWTVerifier
+    //
+    // each reload compiles the issuer names into a minimal perfect hash:
+    // every name hashes to a bucket, and each bucket carries a
+    // displacement, found at compile time, that sends its names to
+    // distinct slots of a table exactly as long as the issuer list
+    // resolving "iss" then costs one hash and one string compare whatever
+    // the number of tenants, and a name outside the set lands on some
+    // slot whose compare fails
+    // the compiled table is immutable and sits behind an RCUPointer, as
+    // the key sets of JWKSCache do: readers take no lock, and a reload
+    // builds a whole new table and swaps it in, so a verification sees
+    // the complete policy set of one configuration or of the next, never
+    // a mixture; the table of a reload is validated before it is published
+    class IssuerRegistry
+    {
+        struct Table;
+        class Compiler;
+
+    public:
+        // a consistent view of the registry, valid while it is held
+        class Snapshot
+        {
+        public:
+            // the policy for "issuer", compared exactly; null if it is not trusted
+            const IssuerPolicy* find(std::string_view issuer) const noexcept;
+
+            size_t size() const noexcept;
+
+            // every policy, in no particular order
+            std::span<const IssuerPolicy> policies() const noexcept;
+
+            // incremented by each reload, for revalidating anything
+            // derived from an earlier configuration
+            uint64_t generation() const noexcept;
+
+        private:
+            friend class IssuerRegistry;
+            explicit Snapshot(const IssuerRegistry& registry) noexcept;
+
+            EpochGuard guard_;
+            const Table* table_ = nullptr;
+        };
+
+        IssuerRegistry();
+        explicit IssuerRegistry(std::vector<IssuerPolicy> policies);
+        ~IssuerRegistry();
+
+        IssuerRegistry(const IssuerRegistry&) = delete;
+        IssuerRegistry& operator=(const IssuerRegistry&) = delete;
+
+        // compiles "policies" and swaps them in for the current set; throws
+        // JWTException on an empty or repeated issuer, a negative skew, or
+        // keys missing or not yet holding a key set, leaving the registry
+        // unchanged
+        // returns the key set caches the old set used and the new one does
+        // not: the retired table is freed by whichever thread reclaims it,
+        // possibly one of their own refreshers, so the caller stops them
+        // (JWKSCache::stop) before letting go of these references
+        [[nodiscard]] std::vector<std::shared_ptr<JWKSCache>> reload(std::vector<IssuerPolicy> policies);
+
+        Snapshot snapshot() const noexcept { return Snapshot(*this); }
+
+    private:
+        RCUPointer<Table> table_;
+        std::mutex reloadMutex_;                // serializes reloads, keeping generations in order
+        uint64_t generation_ = 0;               // guarded by reloadMutex_
+    };
+}
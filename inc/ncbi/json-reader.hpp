@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    enum class JSONType : unsigned char
+    {
+        null, boolean, number, string, array, object
+    };
+
+    // non-owning view of one JSON value inside a document
+    // strings are kept in their escaped form; nothing is copied until a
+    // caller asks for a converted value
+    class JSONValueView
+    {
+    public:
+        JSONType type() const noexcept { return type_; }
+
+        // complete source text of the value, including quotes or brackets
+        std::string_view raw() const noexcept { return raw_; }
+
+        // string contents between the quotes, still escaped
+        std::string_view rawString() const noexcept;
+
+        // true if the string contents contain no escape sequences,
+        // in which case rawString() is already the decoded value
+        bool isPlainString() const noexcept;
+
+        // compares a string value against "text" without decoding into a buffer
+        bool stringEquals(std::string_view text) const noexcept;
+
+        // decodes a string value into "dst", which must hold rawString().size()
+        // bytes; decoding never lengthens a string
+        bool getString(char* dst, size_t& written) const noexcept;
+
+        bool getBool(bool& value) const noexcept;
+
+        // succeeds only for integral numbers that fit, without exponent or fraction
+        bool getInt64(int64_t& value) const noexcept;
+
+        bool getDouble(double& value) const noexcept;
+
+        JSONValueView() noexcept = default;
+        JSONValueView(JSONType type, std::string_view raw) noexcept
+            : raw_(raw), type_(type)
+        {
+        }
+
+    private:
+        std::string_view raw_;
+        JSONType type_ = JSONType::null;
+    };
+
+    // decodes the escaped contents of a JSON string into "dst", which must
+    // hold raw.size() bytes, and returns the decoded length
+    // \uXXXX escapes, including surrogate pairs, are emitted as UTF-8
+    bool unescapeJSONString(std::string_view raw, char* dst, size_t& written) noexcept;
+
+    // compares escaped string contents, such as a member name returned by
+    // JSONReader::nextMember(), against decoded "text"
+    bool rawJSONStringEquals(std::string_view raw, std::string_view text) noexcept;
+
+    // the decoded string value of the member "member", for the parsers of
+    // JWKs, discovery documents and configuration; throws JWTException,
+    // its message prefixed with "owner", if the value is not a string or
+    // holds a bad escape
+    std::string jsonString(const JSONValueView& value, std::string_view owner, std::string_view member);
+
+    // pull parser over a JSON text
+    //
+    // the reader never allocates: it walks the source text and hands out
+    // views into it, so callers pay only for the members they look at
+    // every method returns false once the input has proved invalid, after
+    // which failed() reports true
+    class JSONReader
+    {
+    public:
+        explicit JSONReader(std::string_view text) noexcept;
+
+        // consumes the '{' that must come next
+        bool enterObject() noexcept;
+
+        // advances to the next member of the current object, returning its
+        // escaped name; returns false after consuming the closing '}'
+        // the member value must then be consumed with readValue() or
+        // skipValue() or entered with enterObject()/enterArray()
+        bool nextMember(std::string_view& rawName) noexcept;
+
+        // consumes the '[' that must come next
+        bool enterArray() noexcept;
+
+        // advances to the next array element; returns false after
+        // consuming the closing ']'
+        bool nextElement() noexcept;
+
+        // type of the value that comes next, without consuming it
+        bool peekType(JSONType& type) noexcept;
+
+        // consumes the next value, containers included, and returns its view
+        bool readValue(JSONValueView& value) noexcept;
+
+        bool skipValue() noexcept;
+
+        // true if nothing but whitespace remains
+        bool atEnd() noexcept;
+
+        bool failed() const noexcept { return failed_; }
+
+    private:
+        bool fail() noexcept;
+        void skipSpace() noexcept;
+        bool scanString() noexcept;
+        bool scanNumber() noexcept;
+        bool scanLiteral(std::string_view literal) noexcept;
+        bool scanScalar() noexcept;
+        bool scanContainer() noexcept;
+
+        const char* cur_;
+        const char* end_;
+        bool first_;
+        bool failed_;
+    };
+
+    // scans the top level of a JSON object for a member named "name"
+    // members are compared without decoding their names into a buffer;
+    // scanning stops at the first match
+    bool findJSONMember(std::string_view object, std::string_view name, JSONValueView& value) noexcept;
+}
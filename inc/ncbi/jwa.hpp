@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string_view>
+
+namespace ncbi
+{
+    // JWS "alg" values from RFC 7518 section 3 and RFC 8037
+    enum class JWTAlg : unsigned char
+    {
+        unknown,
+        none,
+        HS256, HS384, HS512,
+        RS256, RS384, RS512,
+        PS256, PS384, PS512,
+        ES256, ES384, ES512,
+        EdDSA
+    };
+
+    enum class JWTAlgFamily : unsigned char
+    {
+        none, hmac, rsa, rsaPSS, ecdsa, eddsa
+    };
+
+    // maps a header "alg" string to its enumerator; unrecognized names
+    // yield JWTAlg::unknown
+    JWTAlg parseAlg(std::string_view name) noexcept;
+
+    // registered name of an algorithm, empty for JWTAlg::unknown
+    std::string_view algName(JWTAlg alg) noexcept;
+
+    JWTAlgFamily algFamily(JWTAlg alg) noexcept;
+
+    // size in bytes of the SHA-2 digest an algorithm hashes with,
+    // or 0 for algorithms that do not prehash (none, EdDSA)
+    unsigned algDigestSize(JWTAlg alg) noexcept;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    // JWE key management (RFC 7518 section 4): how the content encryption
+    // key reaches the recipient
+    enum class JWEAlg : unsigned char
+    {
+        unknown,
+        dir,                            // the key is shared in advance
+        A128KW, A256KW,                 // AES key wrap under a shared key
+        RSA_OAEP, RSA_OAEP_256,         // RSAES-OAEP with SHA-1 or SHA-256
+        ECDH_ES,                        // derived by ECDH with an ephemeral key
+        ECDH_ES_A128KW, ECDH_ES_A256KW  // wrapped under a key so derived
+    };
+
+    // JWE content encryption (RFC 7518 section 5); AES-GCM only
+    enum class JWEEnc : unsigned char
+    {
+        unknown,
+        A128GCM,
+        A256GCM
+    };
+
+    // map header "alg" and "enc" strings to their enumerators and back;
+    // unrecognized names yield unknown
+    JWEAlg parseJWEAlg(std::string_view name) noexcept;
+    std::string_view jweAlgName(JWEAlg alg) noexcept;
+    JWEEnc parseJWEEnc(std::string_view name) noexcept;
+    std::string_view jweEncName(JWEEnc enc) noexcept;
+
+    // content encryption key size in bytes, 0 for unknown
+    size_t jweKeySize(JWEEnc enc) noexcept;
+
+    // non-owning view of a JWE compact serialization
+    // "header.encryptedKey.iv.ciphertext.tag"
+    //
+    // as with JWTView, parsing only locates the dots
+    class JWEView
+    {
+    public:
+        // splits "token" into its five segments; the token text must outlive the view
+        static JWTStatus parse(std::string_view token, JWEView& view) noexcept;
+
+        std::string_view token() const noexcept { return token_; }
+        std::string_view headerSegment() const noexcept { return segment(0); }
+        std::string_view encryptedKeySegment() const noexcept { return segment(1); }
+        std::string_view ivSegment() const noexcept { return segment(2); }
+        std::string_view ciphertextSegment() const noexcept { return segment(3); }
+        std::string_view tagSegment() const noexcept { return segment(4); }
+
+        // buffer sizes sufficient for the decoded header and plaintext
+        size_t headerSize() const noexcept;
+        size_t plaintextSize() const noexcept;
+
+        JWTStatus decodeHeader(char* buf, size_t capacity, std::string_view& json) const noexcept;
+
+    private:
+        std::string_view segment(size_t index) const noexcept;
+
+        std::string_view token_;
+        size_t dots_[4] = {};
+    };
+
+    // the JOSE header members a JWE recipient needs, located in one scan
+    struct JWEHeader
+    {
+        std::string_view json;
+        JWEAlg alg = JWEAlg::unknown;
+        JWEEnc enc = JWEEnc::unknown;
+        JSONValueView kid;
+        JSONValueView typ;
+        JSONValueView cty;
+        JSONValueView epk;              // ECDH-ES ephemeral public key, a JWK object
+        JSONValueView apu;              // ECDH-ES party information, base64url
+        JSONValueView apv;
+        bool hasZip = false;            // compressed plaintext, which is not supported
+        bool hasCrit = false;
+
+        // fails with badJSON unless "json" is a well-formed object
+        static JWTStatus parse(std::string_view json, JWEHeader& header) noexcept;
+    };
+
+    // a recipient's key for one key management algorithm
+    //
+    // immutable and shareable; decrypt() may be called from any number of
+    // threads at once
+    // every failure after the header is reported alike, as decryptionFailed:
+    // a bad RSA-OAEP key block carries on with a random key and fails at the
+    // tag, as RFC 7516 section 11.5 advises, so that no padding oracle is
+    // exposed
+    class JWEDecrypter
+    {
+    public:
+        virtual ~JWEDecrypter() = default;
+
+        virtual JWEAlg alg() const noexcept = 0;
+        const std::string& kid() const noexcept { return kid_; }
+
+        // decrypts "token" in place in "buf": the ciphertext is decoded into
+        // the buffer, which holds at least JWEView::plaintextSize() bytes,
+        // and AES-GCM decrypts it where it lies; "plaintext" is a view into
+        // the buffer, which holds no plaintext if decryption fails
+        // AES-GCM runs on AES-NI with carry-less multiplication, or VAES
+        // where OpenSSL has it for the CPU
+        JWTStatus decrypt(std::string_view token, char* buf, size_t capacity,
+            std::string_view& plaintext) const noexcept;
+
+        // the same for a token whose header has been parsed already, as
+        // by a caller choosing the decrypter by "kid"
+        JWTStatus decrypt(const JWEView& view, const JWEHeader& header, char* buf, size_t capacity,
+            std::string_view& plaintext) const noexcept;
+
+    protected:
+        explicit JWEDecrypter(std::string kid)
+            : kid_(std::move(kid))
+        {
+        }
+
+        // recovers the content encryption key, jweKeySize(header.enc) bytes
+        virtual bool unwrapKey(const JWEHeader& header, const unsigned char* encryptedKey, size_t encryptedKeySize,
+            unsigned char* cek, size_t cekSize) const noexcept = 0;
+
+    private:
+        std::string kid_;
+    };
+
+    // "dir" with the content encryption key itself, 16 or 32 bytes, or
+    // A128KW and A256KW with a key encryption key of 16 or 32 bytes;
+    // throws JWTException if the key size does not suit "alg"
+    class SymmetricJWEDecrypter final : public JWEDecrypter
+    {
+    public:
+        SymmetricJWEDecrypter(JWEAlg alg, std::string_view key, std::string kid = {});
+        ~SymmetricJWEDecrypter() override;
+
+        JWEAlg alg() const noexcept override { return alg_; }
+
+    private:
+        bool unwrapKey(const JWEHeader& header, const unsigned char* encryptedKey, size_t encryptedKeySize,
+            unsigned char* cek, size_t cekSize) const noexcept override;
+
+        std::string key_;
+        JWEAlg alg_;
+    };
+
+    // RSA-OAEP and RSA-OAEP-256 with an RSA key of at least 2048 bits, or
+    // ECDH-ES, ECDH-ES+A128KW and ECDH-ES+A256KW with a P-256, P-384,
+    // P-521 or X25519 key; the private key is PEM, as for
+    // PrivateKeySigner, and JWTException is thrown if it does not suit "alg"
+    class PrivateKeyJWEDecrypter final : public JWEDecrypter
+    {
+    public:
+        PrivateKeyJWEDecrypter(JWEAlg alg, std::string_view pem, std::string kid = {});
+        ~PrivateKeyJWEDecrypter() override;
+
+        JWEAlg alg() const noexcept override { return alg_; }
+
+    private:
+        struct Key;
+
+        bool unwrapKey(const JWEHeader& header, const unsigned char* encryptedKey, size_t encryptedKeySize,
+            unsigned char* cek, size_t cekSize) const noexcept override;
+        bool rsaUnwrap(const unsigned char* encryptedKey, size_t encryptedKeySize,
+            unsigned char* cek, size_t cekSize) const noexcept;
+        bool ecdhAgree(const JWEHeader& header, unsigned char* derived, size_t derivedSize) const noexcept;
+
+        std::unique_ptr<Key> key_;
+        JWEAlg alg_;
+    };
+}
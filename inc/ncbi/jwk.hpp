@@ -0,0 +1,80 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jws.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    // a public or symmetric key from a JWK (RFC 7517)
+    // binary members hold the base64url-decoded octets
+    struct JWK
+    {
+        std::string kid;
+        std::string kty;            // "RSA", "EC", "OKP" or "oct"
+        std::string use;            // "sig", "enc" or empty
+        std::string crv;            // EC and OKP curves
+        JWTAlg alg = JWTAlg::unknown;
+
+        std::string n, e;           // RSA modulus and exponent
+        std::string x, y;           // EC point, OKP public key in x
+        std::string k;              // oct secret
+
+        // true if the key may verify signatures made with "alg"
+        bool accepts(JWTAlg alg) const noexcept;
+
+        // parses one JWK object; throws JWTException if it is malformed
+        static JWK parse(std::string_view json);
+    };
+
+    // length of a JWK thumbprint: a base64url SHA-256 digest
+    constexpr size_t jwkThumbprintSize = 43;
+
+    // the SHA-256 JWK thumbprint of RFC 7638, base64url-encoded, as DPoP
+    // (RFC 9449) and "cnf" (RFC 7800) carry it: computed over the members
+    // the key type requires, so "kid", "alg" and any extras do not count
+    // throws JWTException for "oct" keys, which must never be published,
+    // and for key types this library does not know
+    std::string jwkThumbprint(const JWK& key);
+
+    // an immutable set of keys, indexed by "kid"
+    //
+    // on construction every key gets a ready verifier for each algorithm
+    // it accepts, so public keys are imported into OpenSSL when the set
+    // is loaded rather than when a token is checked
+    class JWKSet
+    {
+    public:
+        JWKSet();
+        explicit JWKSet(std::vector<JWK> keys);
+        ~JWKSet();
+
+        // parses {"keys":[...]}; members of unsupported key types or with
+        // "use":"enc" are skipped as RFC 7517 section 5 asks, while
+        // structurally broken keys throw JWTException
+        static std::unique_ptr<const JWKSet> parse(std::string_view json);
+
+        // the key with "kid" that accepts "alg", or nullptr; lock-free and
+        // allocation-free, a binary search over keys sorted by kid
+        const JWK* find(std::string_view kid, JWTAlg alg) const noexcept;
+
+        // the verifier built for "key", a member of this set, and "alg";
+        // null if the key material could not be imported, for instance an
+        // RSA modulus under 2048 bits
+        const JWSVerifier* verifier(const JWK& key, JWTAlg alg) const noexcept;
+
+        size_t size() const noexcept { return keys_.size(); }
+        const JWK* begin() const noexcept { return keys_.data(); }
+        const JWK* end() const noexcept { return keys_.data() + keys_.size(); }
+
+    private:
+        std::vector<JWK> keys_;
+        std::vector<std::vector<std::unique_ptr<const JWSVerifier>>> verifiers_;   // parallel to keys_
+    };
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <ncbi/epoch.hpp>
+#include <ncbi/fetch.hpp>
+#include <ncbi/jwk.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ncbi
+{
+    struct JWKSCacheOptions
+    {
+        // freshness lifetime when the response carries no max-age
+        std::chrono::seconds defaultMaxAge { 300 };
+
+        // bounds on the lifetime honored from Cache-Control, and the least
+        // time between any two fetches, forced ones included
+        std::chrono::seconds minRefreshInterval { 30 };
+        std::chrono::seconds maxRefreshInterval { 86400 };
+
+        // delay before retrying a failed fetch; the previous key set
+        // stays in service meanwhile
+        std::chrono::seconds retryInterval { 30 };
+    };
+
+    // in-process cache of one JWKS endpoint
+    //
+    // the current key set is an immutable snapshot behind an RCUPointer:
+    // lookups take no lock and allocate nothing, while a background thread
+    // fetches a replacement when the old one's max-age runs out, or sooner
+    // when a lookup misses on an unknown "kid" and asks for one
+    // the refresher cannot join itself, so the last reference to a started
+    // cache must not be released on its own refresher thread; whatever
+    // may free a cache from an epoch reclamation, which runs on whichever
+    // thread publishes next, calls stop() first
+    class JWKSCache
+    {
+    public:
+        // a consistent view of the key set, valid while it is held
+        class Snapshot
+        {
+        public:
+            // the key with "kid" that accepts "alg"; on a miss the cache is
+            // asked to refresh, so a newly rotated key turns up shortly
+            const JWK* find(std::string_view kid, JWTAlg alg) const noexcept;
+
+            // null before the first successful fetch
+            const JWKSet* keys() const noexcept { return keys_; }
+
+            // incremented by each publication, for invalidating anything
+            // derived from an earlier key set
+            uint64_t generation() const noexcept { return generation_; }
+
+        private:
+            friend class JWKSCache;
+            Snapshot(const JWKSCache& cache) noexcept;
+
+            EpochGuard guard_;
+            const JWKSCache& cache_;
+            const JWKSet* keys_ = nullptr;
+            uint64_t generation_ = 0;
+        };
+
+        JWKSCache(std::string uri, std::shared_ptr<Fetcher> fetcher, JWKSCacheOptions options = {});
+        ~JWKSCache();
+
+        JWKSCache(const JWKSCache&) = delete;
+        JWKSCache& operator=(const JWKSCache&) = delete;
+
+        // fetches the first key set, throwing JWTException if that fails,
+        // then starts the background refresher
+        void start();
+
+        // stops and joins the refresher, and runs any whenRefreshed()
+        // callbacks still waiting; the key set stays in service, without
+        // further refreshes; must not be called on the refresher thread
+        void stop() noexcept;
+
+        Snapshot snapshot() const noexcept { return Snapshot(*this); }
+
+        // fetches and publishes now, on the calling thread; returns false
+        // and keeps the current set if the fetch or parse fails
+        bool refresh();
+
+        // asks the background thread for an early refresh, which it performs
+        // once minRefreshInterval has passed since the last fetch
+        void requestRefresh() const noexcept;
+
+        uint64_t generation() const noexcept { return snapshot().generation(); }
+
+        const std::string& uri() const noexcept { return uri_; }
+
+        // fetches that published nothing, whatever the reason: an error
+        // status, an unusable key set, or an exception from the fetcher
+        // or from OpenSSL; the previous key set stayed in service
+        uint64_t failures() const noexcept { return failures_.load(std::memory_order_relaxed); }
+
+        // asks for an early refresh and arranges for "callback" to run on
+        // the refresher thread when the fetch completes, whatever its
+        // outcome; the callback must be brief and must not throw
+        // returns false, without keeping the callback, when there is
+        // nothing to wait for: the key set has already moved past
+        // generation "seen", or no fetch can start soon because the
+        // refresher is not running or minRefreshInterval has not passed
+        bool whenRefreshed(uint64_t seen, std::function<void()> callback);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // the set and its generation are published together, so a reader
+        // never pairs new keys with an old generation
+        struct Published
+        {
+            std::unique_ptr<const JWKSet> keys;
+            uint64_t generation;
+        };
+
+        // fetches, parses and publishes; returns the time of the next refresh
+        Clock::time_point fetchAndPublish(bool& ok);
+        void notifyWaiters() noexcept;
+        void run(std::stop_token stop, Clock::time_point next);
+
+        std::string uri_;
+        std::shared_ptr<Fetcher> fetcher_;
+        JWKSCacheOptions options_;
+
+        RCUPointer<Published> published_;
+        uint64_t generation_ = 0;           // guarded by fetchMutex_
+
+        mutable std::atomic<bool> refreshRequested_ { false };
+        mutable std::mutex mutex_;
+        mutable std::condition_variable_any wakeup_;
+        std::mutex fetchMutex_;            // serializes fetches
+        std::atomic<Clock::time_point> lastFetch_ {};
+        std::atomic<bool> fetching_ { false };
+        std::atomic<uint64_t> failures_ { 0 };
+
+        // callbacks for the end of the current or next fetch, accepted
+        // only while the refresher runs
+        std::mutex waitersMutex_;
+        bool running_ = false;             // guarded by waitersMutex_
+        std::vector<std::function<void()>> waiters_;
+
+        std::jthread refresher_;
+    };
+}
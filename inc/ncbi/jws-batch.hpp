@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ncbi/jwk.hpp>
+#include <ncbi/jwt-error.hpp>
+#include <ncbi/thread-pool.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    struct JWSBatchOptions
+    {
+        // workers to spread the batch over; without one the batch runs on
+        // the calling thread
+        ThreadPool* pool = nullptr;
+
+        // tokens verified per task
+        size_t grainSize = 256;
+    };
+
+    // verifies the signatures of many stored tokens against one key set
+    //
+    // headers are parsed and keys resolved first; tokens are then grouped
+    // by key and algorithm, so each task works through a run of tokens
+    // sharing one of the set's prebuilt verifiers and its key stays hot
+    // only signatures are checked: "exp" and "nbf" are deliberately left
+    // alone, since replayed tokens are usually long expired
+    // returns one status per token, in input order, with the same meaning
+    // as JWTVerifier's
+    std::vector<JWTStatus> verifyJWSBatch(std::span<const std::string_view> tokens,
+        const JWKSet& keys, const JWSBatchOptions& options = {});
+}
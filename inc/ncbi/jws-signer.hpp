@@ -0,0 +1,114 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    // per-thread signing state: OpenSSL contexts set up once for one key,
+    // so that signing a token allocates and looks up nothing
+    // a context belongs to one thread at a time
+    class SigningContext
+    {
+    public:
+        virtual ~SigningContext() = default;
+
+        // writes the JWS encoding of the signature (R || S for ECDSA) into
+        // "signature", which holds at least JWSSigner::signatureSize() bytes
+        virtual bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept = 0;
+
+        // does ahead of time whatever later signatures can be spared, for a
+        // thread with nothing better to do; returns how much was prepared,
+        // zero when the context keeps no such reserve or it is full
+        virtual size_t precompute() noexcept { return 0; }
+    };
+
+    // a signing key with its algorithm and "kid"
+    //
+    // immutable and shareable; the work happens in the SigningContext each
+    // thread creates with newContext() and keeps
+    class JWSSigner
+    {
+    public:
+        virtual ~JWSSigner() = default;
+
+        virtual JWTAlg alg() const noexcept = 0;
+        const std::string& kid() const noexcept { return kid_; }
+
+        // upper bound on the decoded signature
+        virtual size_t signatureSize() const noexcept = 0;
+
+        virtual std::unique_ptr<SigningContext> newContext() const = 0;
+
+    protected:
+        explicit JWSSigner(std::string kid)
+            : kid_(std::move(kid))
+        {
+        }
+
+    private:
+        std::string kid_;
+    };
+
+    // HS256, HS384 and HS512; the secret must be at least as long as the
+    // hash output, or JWTException is thrown
+    class HMACSigner final : public JWSSigner
+    {
+    public:
+        HMACSigner(JWTAlg alg, std::string_view secret, std::string kid);
+
+        JWTAlg alg() const noexcept override { return alg_; }
+        size_t signatureSize() const noexcept override { return algDigestSize(alg_); }
+        std::unique_ptr<SigningContext> newContext() const override;
+
+    private:
+        std::string secret_;
+        JWTAlg alg_;
+    };
+
+    // how ES256, ES384 and ES512 choose the per-signature nonce k; the
+    // other algorithms ignore these
+    struct PrivateKeySignerOptions
+    {
+        // RFC 6979: k derived from the key and the message, so that no
+        // weakness of the random generator can leak the key; requires
+        // OpenSSL 3.2 or later, JWTException otherwise
+        bool deterministicNonces = false;
+
+        // each context keeps up to this many random nonces, with k·G
+        // already computed, for SigningContext::precompute() to fill while
+        // the thread is idle; signing spends one if there is one, and each
+        // is used once and then cleared
+        // a forked child discards the reserves it inherited
+        size_t presignedNonces = 0;
+    };
+
+    // RS*, PS*, ES* and EdDSA with a private key in PEM (PKCS #8 or the
+    // traditional formats OpenSSL reads); throws JWTException if the key
+    // does not suit "alg"
+    class PrivateKeySigner final : public JWSSigner
+    {
+    public:
+        PrivateKeySigner(JWTAlg alg, std::string_view pem, std::string kid,
+            PrivateKeySignerOptions options = {});
+        ~PrivateKeySigner() override;
+
+        JWTAlg alg() const noexcept override { return alg_; }
+        size_t signatureSize() const noexcept override { return signatureSize_; }
+        std::unique_ptr<SigningContext> newContext() const override;
+
+        // the public half as a JWK, for publishing in a JWKS
+        std::string publicJWK() const;
+
+    private:
+        struct Key;
+        std::unique_ptr<Key> key_;
+        JWTAlg alg_;
+        size_t signatureSize_;
+        PrivateKeySignerOptions options_;
+    };
+}
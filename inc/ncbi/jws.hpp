@@ -0,0 +1,94 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    struct JWK;
+
+    // checks JWS signatures for one key and one algorithm
+    // implementations are immutable once built and may be shared by any
+    // number of verifying threads
+    class JWSVerifier
+    {
+    public:
+        virtual ~JWSVerifier() = default;
+
+        virtual JWTAlg alg() const noexcept = 0;
+
+        // "signature" is the base64url-decoded signature segment
+        virtual bool verify(std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) const noexcept = 0;
+    };
+
+    // HS256, HS384 and HS512 with a shared secret
+    //
+    // the secret is absorbed into the inner and outer hash states once, at
+    // construction, so verify() hashes only the signing input and the
+    // inner digest; the MAC is compared in constant time
+    class HMACVerifier final : public JWSVerifier
+    {
+    public:
+        // RFC 7518 section 3.2 requires a secret at least as long as the
+        // hash output; shorter secrets are refused with JWTException
+        HMACVerifier(JWTAlg alg, std::string_view secret);
+        ~HMACVerifier() override;
+
+        JWTAlg alg() const noexcept override { return alg_; }
+
+        bool verify(std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) const noexcept override;
+
+    private:
+        struct Context;
+        std::unique_ptr<Context> context_;
+        JWTAlg alg_;
+    };
+
+    // RS*, PS*, ES* and EdDSA with a public key imported once, up front
+    //
+    // construction does all the per-key work OpenSSL allows to be done
+    // ahead of time: the key is imported, the digest fetched from the
+    // provider, a verification context initialized, and for RSA the
+    // Montgomery context of the modulus is built; verify() then only
+    // copies that context, hashes and performs the public-key operation,
+    // and is safe to call from many threads at once
+    class PublicKeyVerifier final : public JWSVerifier
+    {
+    public:
+        // throws JWTException unless "key" accepts "alg" and imports;
+        // RSA keys shorter than 2048 bits are refused
+        PublicKeyVerifier(const JWK& key, JWTAlg alg);
+        ~PublicKeyVerifier() override;
+
+        JWTAlg alg() const noexcept override { return alg_; }
+
+        bool verify(std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) const noexcept override;
+
+    private:
+        struct Context;
+        std::unique_ptr<Context> context_;
+        JWTAlg alg_;
+    };
+
+    // an HMACVerifier or PublicKeyVerifier for "key", as "alg" requires;
+    // throws JWTException if the key cannot be used with "alg"
+    std::unique_ptr<const JWSVerifier> makeJWSVerifier(const JWK& key, JWTAlg alg);
+
+    // verifies with the key material of a JWK, importing it into OpenSSL
+    // on every call; RSA keys shorter than 2048 bits are refused
+    // prefer JWKSet::verifier(), which imports each key once
+    bool verifyWithJWK(const JWK& key, JWTAlg alg, std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) noexcept;
+
+    // the verify-only path: checks the header algorithm against the key,
+    // decodes the signature onto the stack and verifies it
+    // performs no allocation of its own
+    JWTStatus verifyJWS(const JWTView& token, const JWTHeader& header, const JWSVerifier& verifier) noexcept;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    // one claim of the payload, name decoded
+    struct JWTMember
+    {
+        std::string_view name;
+        JSONValueView value;
+    };
+
+    // a decoded token with its claims, for request code that wants owned
+    // strings and containers rather than views and fixed arrays
+    //
+    // every string and container is allocated from the memory resource
+    // given at construction, normally a RequestArena's, so that the whole
+    // object model of a request sits in one block and is freed with it
+    // views (the JSONValueViews of "header" and "claims", "members",
+    // "scopes") point into the strings held here and into nothing else
+    struct ArenaJWT
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit ArenaJWT(allocator_type allocator = {})
+            : headerJSON(allocator)
+            , payload(allocator)
+            , kid(allocator)
+            , iss(allocator)
+            , sub(allocator)
+            , jti(allocator)
+            , scope(allocator)
+            , audiences(allocator)
+            , scopes(allocator)
+            , members(allocator)
+        {
+        }
+
+        ArenaJWT(const ArenaJWT&) = delete;
+        ArenaJWT& operator=(const ArenaJWT&) = delete;
+
+        std::pmr::string headerJSON;
+        std::pmr::string payload;
+        JWTHeader header;
+        JWTClaims claims;
+
+        // decoded copies of the string members
+        std::pmr::string kid;
+        std::pmr::string iss;
+        std::pmr::string sub;
+        std::pmr::string jti;
+        std::pmr::string scope;
+
+        // every "aud" value, however many; and "scope" split on spaces
+        std::pmr::vector<std::pmr::string> audiences;
+        std::pmr::vector<std::string_view> scopes;
+
+        // every top-level claim, in payload order
+        std::pmr::vector<JWTMember> members;
+
+        int64_t exp = INT64_MAX;
+        int64_t nbf = INT64_MIN;
+        int64_t iat = 0;
+
+        // set by JWTVerifier::verify() once the signature has been checked
+        bool verified = false;
+        uint64_t keyFingerprint = 0;
+
+        const JSONValueView* find(std::string_view name) const noexcept;
+        bool hasAudience(std::string_view audience) const noexcept;
+        bool hasScope(std::string_view name) const noexcept;
+
+        allocator_type get_allocator() const noexcept { return payload.get_allocator(); }
+    };
+
+    // decodes "token" into "result" without checking its signature, for
+    // tokens whose integrity is established otherwise, such as those just
+    // issued or fetched over an authenticated channel
+    // fails with bufferTooSmall if the memory resource runs out
+    JWTStatus decodeJWT(std::string_view token, ArenaJWT& result) noexcept;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    // the claims a resource server normally acts on: the registered claims
+    // of RFC 7519 section 4.1 and "scope" from RFC 8693 section 4.2
+    enum class JWTClaim : unsigned char
+    {
+        iss, sub, aud, exp, nbf, iat, jti, scope
+    };
+
+    // claims extracted from one payload, in a fixed layout
+    //
+    // string claims are views into the payload, still escaped; compare
+    // them with JSONValueView::stringEquals(), which copes with escapes
+    struct JWTClaims
+    {
+        static constexpr size_t maxAudiences = 8;
+        static constexpr size_t maxCustomClaims = 8;
+
+        JSONValueView iss;
+        JSONValueView sub;
+        JSONValueView jti;
+        JSONValueView scope;
+
+        // "aud" as a single string or an array of strings; the first
+        // maxAudiences values are kept, audience() covers the rest
+        JSONValueView audJSON;
+        std::array<JSONValueView, maxAudiences> aud;
+        uint32_t audCount = 0;
+
+        int64_t exp = INT64_MAX;
+        int64_t nbf = INT64_MIN;
+        int64_t iat = 0;
+
+        // values of the custom claims registered with the parser, in
+        // registration order; a missing claim has an empty raw()
+        std::array<JSONValueView, maxCustomClaims> custom;
+
+        // bit per JWTClaim, then bit per custom claim from bit 8
+        uint32_t present = 0;
+
+        bool has(JWTClaim claim) const noexcept { return (present >> static_cast<unsigned>(claim) & 1) != 0; }
+        bool hasCustom(size_t index) const noexcept { return (present >> (8 + index) & 1) != 0; }
+
+        // true if "aud" names "audience", however many values it holds
+        bool audience(std::string_view audience) const noexcept;
+
+        // true if the space-separated "scope" contains "name"
+        bool hasScope(std::string_view name) const noexcept;
+    };
+
+    // single-pass extractor of the claims in JWTClaims
+    //
+    // walks the payload once with JSONReader: wanted members are recorded
+    // as views, every other member is skipped without being decoded, and
+    // the whole object is validated on the way, so a successful parse also
+    // proves the payload well-formed
+    // a wanted claim of the wrong type, or appearing twice, fails the
+    // parse with badClaim rather than letting either copy win
+    class JWTClaimsParser
+    {
+    public:
+        JWTClaimsParser() = default;
+
+        // names of up to maxCustomClaims further claims to extract;
+        // throws JWTException for too many or for a registered name
+        explicit JWTClaimsParser(std::initializer_list<std::string_view> customClaims);
+
+        JWTStatus parse(std::string_view payload, JWTClaims& claims) const noexcept;
+
+    private:
+        std::array<std::string, JWTClaims::maxCustomClaims> custom_;
+        size_t customCount_ = 0;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace ncbi
+{
+    // outcome of examining a single token
+    // per-token paths report failure through this code instead of throwing,
+    // so rejecting a token costs no more than accepting one
+    enum class JWTStatus : unsigned char
+    {
+        ok,
+        malformed,          // not "header.payload.signature"
+        badEncoding,        // a segment is not strict base64url
+        badJSON,            // header or payload is not a JSON object
+        bufferTooSmall,     // caller-supplied buffer cannot hold a decoded segment
+        unsupportedAlg,     // header "alg" is missing, "none" or unknown
+        unsupportedCrit,    // header "crit" names extensions this library does not implement
+        algMismatch,        // header "alg" differs from the key's algorithm
+        unknownKey,         // no key matches the header "kid"
+        unknownIssuer,      // "iss" is missing or names no trusted issuer
+        badSignature,
+        decryptionFailed,   // a JWE did not decrypt, or its authentication tag did not match
+        badClaim,           // a claim has the wrong type or appears twice
+        missingClaim,       // a claim the schema requires is absent
+        rejectedClaim,      // a claim value is not among those the schema allows
+        expired,            // "exp" is in the past, beyond the allowed skew
+        notYetValid,        // "nbf" is in the future, beyond the allowed skew
+        inactive,           // the authorization server reports the token inactive
+        revoked,            // the token's "jti" is on the revocation list
+        replayed,           // a DPoP proof's "jti" was seen before, or there was no room to record it
+        serverError         // the authorization server could not be consulted
+    };
+
+    // the number of statuses, for tables indexed by status
+    constexpr size_t jwtStatusCount = static_cast<size_t>(JWTStatus::serverError) + 1;
+
+    // short, static description suitable for logs
+    const char* toString(JWTStatus status) noexcept;
+
+    // thrown for configuration problems: unusable keys, key sets, policies
+    class JWTException : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace ncbi
+{
+    // compile-time claim schemas
+    //
+    // a service spells out the claims it requires at build time:
+    //
+    //     using AccessTokenSchema = JWTSchema<
+    //         RequiredClaim<"iss", ClaimType::string, Allowed<"https://auth.ncbi.nlm.nih.gov">>,
+    //         RequiredClaim<"aud", ClaimType::audience, Allowed<"https://api.ncbi.nlm.nih.gov">>,
+    //         RequiredClaim<"exp", ClaimType::numericDate>,
+    //         OptionalClaim<"scope", ClaimType::string>>;
+    //
+    //     AccessTokenSchema::Claims claims;
+    //     JWTStatus status = AccessTokenSchema::validate(payload, claims);
+    //     int64_t exp = claims.date<"exp">();
+    //
+    // member names and allowed values are located through perfect hash
+    // tables computed by the compiler, so validation costs one hash and at
+    // most one confirming memcmp per member, never a search
+
+    enum class ClaimType : unsigned char
+    {
+        string,
+        number,
+        numericDate,        // number of seconds, fractions truncated
+        boolean,
+        array,
+        object,
+        audience,           // a string or an array of strings
+        any
+    };
+
+    // a string literal usable as a template argument
+    template<size_t N>
+    struct FixedString
+    {
+        char chars[N] {};
+
+        constexpr FixedString(const char (&text)[N]) noexcept
+        {
+            for (size_t i = 0; i < N; ++i)
+                chars[i] = text[i];
+        }
+
+        constexpr std::string_view view() const noexcept { return std::string_view(chars, N - 1); }
+    };
+
+    // the values a string or audience claim may take; empty allows any
+    template<FixedString... Values>
+    struct Allowed
+    {
+        static constexpr std::array<std::string_view, sizeof...(Values)> values { Values.view()... };
+    };
+
+    template<FixedString Name, ClaimType Type, bool Required, class Values = Allowed<>>
+    struct Claim
+    {
+        static constexpr std::string_view name = Name.view();
+        static constexpr ClaimType type = Type;
+        static constexpr bool required = Required;
+        using AllowedValues = Values;
+
+        static_assert(!name.empty(), "claim names must not be empty");
+        static_assert(Values::values.empty() || Type == ClaimType::string || Type == ClaimType::audience,
+            "only string and audience claims take allowed values");
+    };
+
+    template<FixedString Name, ClaimType Type, class Values = Allowed<>>
+    using RequiredClaim = Claim<Name, Type, true, Values>;
+
+    template<FixedString Name, ClaimType Type, class Values = Allowed<>>
+    using OptionalClaim = Claim<Name, Type, false, Values>;
+
+    namespace detail
+    {
+        // FNV-1a; evaluated by the compiler over the schema and at run
+        // time over member names, which are short
+        constexpr uint64_t schemaHash(std::string_view text) noexcept
+        {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (char ch : text)
+            {
+                h ^= static_cast<unsigned char>(ch);
+                h *= 0x100000001b3ull;
+            }
+            return h;
+        }
+
+        // a minimal-effort perfect hash over N strings: multiply-shift of
+        // their FNV-1a hash into a table at least twice the key count, with
+        // a multiplier the compiler searches for until no two keys share a
+        // slot
+        template<size_t N>
+        class PerfectHash
+        {
+        public:
+            static constexpr unsigned bits = []
+            {
+                unsigned b = 2;
+                while ((size_t(1) << b) < 2 * N)
+                    ++b;
+                return b;
+            }();
+            static constexpr size_t tableSize = size_t(1) << bits;
+            static constexpr uint8_t empty = 0xFF;
+
+            static_assert(N < empty, "too many keys for one perfect hash");
+
+            constexpr explicit PerfectHash(const std::array<std::string_view, N>& keys)
+                : keys_(keys)
+            {
+                uint64_t state = 0x9E3779B97F4A7C15ull;
+                for (unsigned attempt = 0; attempt < 100000; ++attempt)
+                {
+                    // splitmix64 supplies odd candidate multipliers
+                    state += 0x9E3779B97F4A7C15ull;
+                    uint64_t z = state;
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                    multiplier_ = (z ^ (z >> 31)) | 1;
+
+                    if (tryBuild())
+                        return;
+                }
+                throw "no perfect hash found; are two keys equal?";
+            }
+
+            // index of "key" among the keys, or -1
+            constexpr int find(std::string_view key) const noexcept
+            {
+                uint8_t i = slots_[slot(schemaHash(key))];
+                if (i == empty)
+                    return -1;
+
+                std::string_view candidate = keys_[i];
+                if (candidate.size() != key.size())
+                    return -1;
+                if (std::is_constant_evaluated())
+                    return candidate == key ? i : -1;
+                return std::memcmp(candidate.data(), key.data(), key.size()) == 0 ? i : -1;
+            }
+
+        private:
+            constexpr size_t slot(uint64_t hash) const noexcept
+            {
+                return static_cast<size_t>((hash * multiplier_) >> (64 - bits));
+            }
+
+            constexpr bool tryBuild() noexcept
+            {
+                for (auto& s : slots_)
+                    s = empty;
+                for (size_t i = 0; i < N; ++i)
+                {
+                    uint8_t& s = slots_[slot(schemaHash(keys_[i]))];
+                    if (s != empty)
+                        return false;
+                    s = static_cast<uint8_t>(i);
+                }
+                return true;
+            }
+
+            std::array<std::string_view, N> keys_;
+            std::array<uint8_t, tableSize> slots_ {};
+            uint64_t multiplier_ = 1;
+        };
+
+        // a member name or string value as the perfect hash sees it:
+        // escaped text is decoded into "buf", of "capacity" bytes, when it
+        // could still be as short as the longest key; "false" means it
+        // cannot be any key
+        bool schemaKey(std::string_view raw, char* buf, size_t capacity, std::string_view& key) noexcept;
+
+        bool numericDate(const JSONValueView& value, int64_t& seconds) noexcept;
+
+        template<size_t N>
+        constexpr size_t longest(const std::array<std::string_view, N>& keys) noexcept
+        {
+            size_t n = 0;
+            for (auto k : keys)
+                n = k.size() > n ? k.size() : n;
+            return n;
+        }
+
+        // a JSON string value checked against a claim's allowed values
+        template<class Values>
+        bool allowedValue(const JSONValueView& value) noexcept
+        {
+            constexpr auto& values = Values::values;
+            if constexpr (values.empty())
+                return true;
+            else
+            {
+                static constexpr PerfectHash<values.size()> hash(values);
+
+                // an escape can spell one byte with up to six characters
+                char buf[6 * longest(values) + 1];
+                std::string_view key;
+                return schemaKey(value.rawString(), buf, sizeof buf, key) && hash.find(key) >= 0;
+            }
+        }
+    }
+
+    template<class... ClaimDefs>
+    class JWTSchema
+    {
+    public:
+        static constexpr size_t size = sizeof...(ClaimDefs);
+        static_assert(size > 0 && size <= 32, "a schema holds 1 to 32 claims");
+
+        static constexpr std::array<std::string_view, size> names { ClaimDefs::name... };
+
+        // index of a claim in the schema, resolved by the compiler
+        template<FixedString Name>
+        static constexpr size_t indexOf() noexcept
+        {
+            constexpr int i = hash_.find(Name.view());
+            static_assert(i >= 0, "claim not in schema");
+            return static_cast<size_t>(i);
+        }
+
+        // validated claims; values are views into the payload
+        struct Claims
+        {
+            std::array<JSONValueView, size> values;
+            std::array<int64_t, size> dates {};        // for numericDate claims
+            uint32_t present = 0;
+
+            template<FixedString Name>
+            bool has() const noexcept { return (present >> indexOf<Name>() & 1) != 0; }
+
+            template<FixedString Name>
+            const JSONValueView& get() const noexcept { return values[indexOf<Name>()]; }
+
+            template<FixedString Name>
+            int64_t date() const noexcept
+            {
+                static_assert(types_[indexOf<Name>()] == ClaimType::numericDate, "not a numericDate claim");
+                return dates[indexOf<Name>()];
+            }
+        };
+
+        // checks every schema claim present for its type and allowed
+        // values, and that required ones are present; other members are
+        // skipped, though the payload as a whole must be well-formed
+        static JWTStatus validate(std::string_view payload, Claims& claims) noexcept
+        {
+            claims = Claims();
+
+            JSONReader reader(payload);
+            if (!reader.enterObject())
+                return JWTStatus::badJSON;
+
+            char nameBuf[6 * detail::longest(names) + 1];
+            std::string_view name;
+            while (reader.nextMember(name))
+            {
+                std::string_view key;
+                int i = detail::schemaKey(name, nameBuf, sizeof nameBuf, key) ? hash_.find(key) : -1;
+                if (i < 0)
+                {
+                    if (!reader.skipValue())
+                        break;
+                    continue;
+                }
+
+                uint32_t bit = uint32_t(1) << i;
+                if ((claims.present & bit) != 0)
+                    return JWTStatus::badClaim;
+                claims.present |= bit;
+
+                JSONValueView& value = claims.values[static_cast<size_t>(i)];
+                if (!reader.readValue(value))
+                    break;
+
+                JWTStatus status = readers_[static_cast<size_t>(i)](value, claims.dates[static_cast<size_t>(i)]);
+                if (status != JWTStatus::ok)
+                    return status;
+            }
+
+            if (reader.failed() || !reader.atEnd())
+                return JWTStatus::badJSON;
+            if ((claims.present & requiredMask_) != requiredMask_)
+                return JWTStatus::missingClaim;
+            return JWTStatus::ok;
+        }
+
+    private:
+        using Reader = JWTStatus (*)(const JSONValueView& value, int64_t& date) noexcept;
+
+        // the check for one claim, specialized for its type and values
+        template<class C>
+        static JWTStatus readClaim(const JSONValueView& value, int64_t& date) noexcept
+        {
+            (void)date;
+            JSONType type = value.type();
+
+            if constexpr (C::type == ClaimType::string)
+            {
+                if (type != JSONType::string)
+                    return JWTStatus::badClaim;
+                return detail::allowedValue<typename C::AllowedValues>(value)
+                    ? JWTStatus::ok
+                    : JWTStatus::rejectedClaim;
+            }
+            else if constexpr (C::type == ClaimType::audience)
+                return readAudience<typename C::AllowedValues>(value);
+            else if constexpr (C::type == ClaimType::numericDate)
+                return detail::numericDate(value, date) ? JWTStatus::ok : JWTStatus::badClaim;
+            else if constexpr (C::type == ClaimType::number)
+                return type == JSONType::number ? JWTStatus::ok : JWTStatus::badClaim;
+            else if constexpr (C::type == ClaimType::boolean)
+                return type == JSONType::boolean ? JWTStatus::ok : JWTStatus::badClaim;
+            else if constexpr (C::type == ClaimType::array)
+                return type == JSONType::array ? JWTStatus::ok : JWTStatus::badClaim;
+            else if constexpr (C::type == ClaimType::object)
+                return type == JSONType::object ? JWTStatus::ok : JWTStatus::badClaim;
+            else
+                return JWTStatus::ok;
+        }
+
+        // RFC 7519 section 4.1.3: the recipient must find itself among
+        // the values; with no allowed values any strings will do
+        template<class Values>
+        static JWTStatus readAudience(const JSONValueView& value) noexcept
+        {
+            if (value.type() == JSONType::string)
+                return detail::allowedValue<Values>(value) ? JWTStatus::ok : JWTStatus::rejectedClaim;
+            if (value.type() != JSONType::array)
+                return JWTStatus::badClaim;
+
+            bool matched = Values::values.empty();
+            JSONReader elements(value.raw());
+            elements.enterArray();
+            while (elements.nextElement())
+            {
+                JSONValueView element;
+                if (!elements.readValue(element) || element.type() != JSONType::string)
+                    return JWTStatus::badClaim;
+                if (!matched)
+                    matched = detail::allowedValue<Values>(element);
+            }
+            return matched ? JWTStatus::ok : JWTStatus::rejectedClaim;
+        }
+
+        static constexpr detail::PerfectHash<size> hash_ { names };
+        static constexpr std::array<ClaimType, size> types_ { ClaimDefs::type... };
+        static constexpr std::array<Reader, size> readers_ { &readClaim<ClaimDefs>... };
+        static constexpr uint32_t requiredMask_ = []
+        {
+            uint32_t mask = 0;
+            size_t i = 0;
+            ((mask |= ClaimDefs::required ? uint32_t(1) << i : 0, ++i), ...);
+            return mask;
+        }();
+    };
+}
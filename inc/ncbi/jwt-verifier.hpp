@@ -0,0 +1,86 @@
+#pragma once
+
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-arena.hpp>
+#include <ncbi/jwt-error.hpp>
+#include <ncbi/verified-cache.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace ncbi
+{
+    class IssuerRegistry;
+    class RevocationList;
+    class VerifyProbe;
+
+    struct JWTVerifierOptions
+    {
+        // leeway granted to "exp" and "nbf" for clock differences; with an
+        // IssuerRegistry each issuer's policy sets its own
+        std::chrono::seconds clockSkew { 60 };
+
+        // optional cache of earlier results; must outlive the verifier
+        VerifiedTokenCache* cache = nullptr;
+
+        // optional list of revoked "jti" values, consulted for cached
+        // results too; must outlive the verifier
+        const RevocationList* revocations = nullptr;
+    };
+
+    // verifies signed JWTs against the keys of a JWKSCache, or of the
+    // issuer an IssuerRegistry finds for the token's "iss"
+    //
+    // checks the signature and the "exp" and "nbf" claims, and with a
+    // registry the issuer's algorithms and audiences as well; the
+    // remaining claims are left to the caller, who reads them from the
+    // result
+    // with a registry the payload is parsed before the signature is
+    // checked, since "iss" decides which keys check it; nothing read from
+    // it is trusted until they have
+    // when a cache is configured it is told about each new key generation,
+    // so results verified by a key that has since been rotated out are
+    // dropped rather than served; with a registry, each hit is checked
+    // against the configuration in force instead
+    // every verification is timed stage by stage into verifyMetrics()
+    // (ncbi/verify-metrics.hpp), unless NCBI_OAUTH_METRICS is 0
+    class JWTVerifier
+    {
+    public:
+        explicit JWTVerifier(JWKSCache& keys, JWTVerifierOptions options = {});
+
+        // trusts the issuers of "issuers", which must outlive the verifier
+        // a cached result outlives reloads of the registry and rotations of
+        // the issuer's keys: it is served only if the policy now in force
+        // would still accept it, which is checked without the signature
+        explicit JWTVerifier(const IssuerRegistry& issuers, JWTVerifierOptions options = {});
+
+        // "now" is a NumericDate; on success "result" holds the verified token
+        JWTStatus verify(std::string_view token, int64_t now,
+            std::shared_ptr<const VerifiedToken>& result) const;
+
+        JWTStatus verify(std::string_view token, std::shared_ptr<const VerifiedToken>& result) const;
+
+        // verifies into an object model allocated from the caller's memory
+        // resource, normally a RequestArena, bypassing the cache; nothing
+        // is allocated elsewhere
+        JWTStatus verify(std::string_view token, int64_t now, ArenaJWT& result) const noexcept;
+
+    private:
+        JWTStatus verify(std::string_view token, int64_t now,
+            std::shared_ptr<const VerifiedToken>& result, VerifyProbe& probe) const;
+        JWTStatus verify(std::string_view token, int64_t now, ArenaJWT& result, VerifyProbe& probe) const noexcept;
+        JWTStatus verifyIssued(std::string_view token, int64_t now,
+            std::shared_ptr<const VerifiedToken>& result, VerifyProbe& probe) const;
+        JWTStatus verifyIssued(std::string_view token, int64_t now, ArenaJWT& result,
+            VerifyProbe& probe) const noexcept;
+
+        JWKSCache* keys_ = nullptr;                 // exactly one of these is set
+        const IssuerRegistry* issuers_ = nullptr;
+        JWTVerifierOptions options_;
+        mutable std::atomic<uint64_t> lastGeneration_ { 0 };
+    };
+}
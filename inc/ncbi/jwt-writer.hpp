@@ -0,0 +1,105 @@
+#pragma once
+
+#include <ncbi/jws-signer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    // one member of a claims set to be written; it refers to its name and
+    // text, which must outlive the write
+    class JWTClaimValue
+    {
+    public:
+        enum class Type : unsigned char
+        {
+            string,     // escaped as a JSON string
+            number,
+            boolean,
+            json        // already serialized JSON, an array or object, written as it stands
+        };
+
+        JWTClaimValue() noexcept = default;
+
+        JWTClaimValue(std::string_view name, std::string_view value) noexcept
+            : name_(name), text_(value), type_(Type::string)
+        {
+        }
+
+        // string literals would otherwise convert to bool
+        JWTClaimValue(std::string_view name, const char* value) noexcept
+            : JWTClaimValue(name, std::string_view(value))
+        {
+        }
+
+        JWTClaimValue(std::string_view name, int64_t value) noexcept
+            : name_(name), number_(value), type_(Type::number)
+        {
+        }
+
+        static JWTClaimValue boolean(std::string_view name, bool value) noexcept
+        {
+            JWTClaimValue claim(name, int64_t(value));
+            claim.type_ = Type::boolean;
+            return claim;
+        }
+
+        static JWTClaimValue json(std::string_view name, std::string_view json) noexcept
+        {
+            JWTClaimValue claim(name, json);
+            claim.type_ = Type::json;
+            return claim;
+        }
+
+        std::string_view name() const noexcept { return name_; }
+        Type type() const noexcept { return type_; }
+        std::string_view text() const noexcept { return text_; }
+        int64_t number() const noexcept { return number_; }
+
+    private:
+        std::string_view name_;
+        std::string_view text_;
+        int64_t number_ = 0;
+        Type type_ = Type::number;
+    };
+
+    // serializes signed tokens into the caller's memory
+    //
+    // the header segment is encoded once, at construction; for each token
+    // size() computes the exact length of the compact serialization, and
+    // write() produces it in one pass over the caller's buffer, with the
+    // signature computed over the bytes where they lie; the claims JSON
+    // and the signature are staged on the stack, or, past a couple of
+    // kilobytes, written at the end of their own segments and encoded
+    // forward in place, so no step allocates
+    // claims are written in the order given, and names are not checked
+    // for repeats
+    class JWTWriter
+    {
+    public:
+        // "typ" goes into the header unless empty; throws JWTException
+        // without a signer
+        explicit JWTWriter(std::shared_ptr<const JWSSigner> signer, std::string_view typ = "JWT");
+
+        const JWSSigner& signer() const noexcept { return *signer_; }
+
+        // the exact length of the token for "claims"
+        size_t size(std::span<const JWTClaimValue> claims) const noexcept;
+
+        // writes the token for "claims" into "out", signing with "context",
+        // a context of signer(); returns its length, or 0 if the token
+        // needs more than "capacity" bytes or signing fails
+        size_t write(std::span<const JWTClaimValue> claims, SigningContext& context,
+            char* out, size_t capacity) const noexcept;
+
+    private:
+        std::shared_ptr<const JWSSigner> signer_;
+        std::string encodedHeader_;             // base64url JOSE header, then '.'
+        size_t signatureSize_;                  // encoded, after the '.'
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ncbi
+{
+    // upper bound on a decoded JWS signature: an RSA-4096 signature is
+    // 512 bytes, larger than any ECDSA or EdDSA signature
+    constexpr size_t maxSignatureSize = 512;
+
+    // non-owning view of a JWS compact serialization "header.payload.signature"
+    //
+    // parsing only locates the two dots; segments are base64url-decoded on
+    // request into buffers the caller supplies, so a token that is rejected
+    // early is never decoded at all and none of this class allocates
+    class JWTView
+    {
+    public:
+        // splits "token" into its segments; the token text must outlive the view
+        static JWTStatus parse(std::string_view token, JWTView& view) noexcept;
+
+        std::string_view token() const noexcept { return token_; }
+        std::string_view headerSegment() const noexcept { return token_.substr(0, dot1_); }
+        std::string_view payloadSegment() const noexcept { return token_.substr(dot1_ + 1, dot2_ - dot1_ - 1); }
+        std::string_view signatureSegment() const noexcept { return token_.substr(dot2_ + 1); }
+
+        // "header.payload", the octets covered by the signature
+        std::string_view signingInput() const noexcept { return token_.substr(0, dot2_); }
+
+        // buffer sizes sufficient for the decoded segments
+        size_t headerSize() const noexcept;
+        size_t payloadSize() const noexcept;
+        size_t signatureSize() const noexcept;
+
+        // decode a segment into "buf", returning a view of the decoded text
+        JWTStatus decodeHeader(char* buf, size_t capacity, std::string_view& json) const noexcept;
+        JWTStatus decodePayload(char* buf, size_t capacity, std::string_view& json) const noexcept;
+        JWTStatus decodeSignature(unsigned char* buf, size_t capacity, size_t& length) const noexcept;
+
+    private:
+        std::string_view token_;
+        size_t dot1_ = 0;
+        size_t dot2_ = 0;
+    };
+
+    // the JOSE header members a verifier needs, located in a single scan of
+    // the decoded header; string members are views into that text and stay
+    // escaped only in the unlikely case that the producer escaped them
+    struct JWTHeader
+    {
+        std::string_view json;
+        JWTAlg alg = JWTAlg::unknown;
+        JSONValueView kid;
+        JSONValueView typ;
+        JSONValueView cty;
+        bool hasCrit = false;
+
+        // fails with badJSON unless "json" is a well-formed object
+        static JWTStatus parse(std::string_view json, JWTHeader& header) noexcept;
+    };
+
+    // a NumericDate claim value: integral seconds, or a fraction that RFC
+    // 7519 permits and that is truncated here
+    bool parseNumericDate(const JSONValueView& value, int64_t& seconds) noexcept;
+
+    // lazy view of a decoded claims set
+    //
+    // nothing is parsed up front: each lookup scans the payload members until
+    // the requested one is found, so a verifier that only checks "exp" never
+    // looks past it
+    class JWTClaimsView
+    {
+    public:
+        JWTClaimsView() noexcept = default;
+        explicit JWTClaimsView(std::string_view json) noexcept
+            : json_(json)
+        {
+        }
+
+        std::string_view json() const noexcept { return json_; }
+
+        bool find(std::string_view name, JSONValueView& value) const noexcept;
+
+        // string claims without escapes are returned as views into the payload;
+        // escaped ones fail, callers wanting those use find() and getString()
+        bool getString(std::string_view name, std::string_view& value) const noexcept;
+
+        // NumericDate claims such as "exp", "nbf" and "iat"
+        bool getNumericDate(std::string_view name, int64_t& seconds) const noexcept;
+
+    private:
+        std::string_view json_;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ncbi
+{
+    // token endpoint grant types (RFC 6749 sections 4.1, 4.4 and 6)
+    enum class GrantType : unsigned char
+    {
+        authorizationCode,
+        clientCredentials,
+        refreshToken
+    };
+
+    // a registered client
+    struct OAuthClient
+    {
+        std::string id;
+        std::string secret;                     // empty for a public client
+        std::vector<std::string> scopes;        // the scopes it may be granted
+        std::vector<GrantType> grants;          // the grants it may use
+
+        bool confidential() const noexcept { return !secret.empty(); }
+        bool allows(GrantType grant) const noexcept;
+        bool allowsScope(std::string_view scope) const noexcept;
+    };
+
+    // an immutable set of clients, indexed by client_id
+    //
+    // secrets are kept only as SHA-256 digests and checked in constant
+    // time, so neither a memory dump nor response timing reveals them
+    class ClientRegistry
+    {
+    public:
+        ClientRegistry() = default;
+
+        // throws JWTException on a duplicate or empty client_id
+        explicit ClientRegistry(std::vector<OAuthClient> clients);
+
+        // the client registered as "id", or nullptr; a binary search
+        const OAuthClient* find(std::string_view id) const noexcept;
+
+        // true if "secret" is the secret of "client", a confidential
+        // member of this registry
+        bool authenticate(const OAuthClient& client, std::string_view secret) const noexcept;
+
+        size_t size() const noexcept { return clients_.size(); }
+
+    private:
+        using Digest = std::array<unsigned char, 32>;
+
+        std::vector<OAuthClient> clients_;      // sorted by id; secrets cleared
+        std::vector<Digest> secrets_;           // parallel to clients_
+    };
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <ncbi/epoch.hpp>
+#include <ncbi/fetch.hpp>
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwks-cache.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ncbi
+{
+    // provider metadata from OpenID Connect Discovery 1.0 section 3, or
+    // the RFC 8414 equivalent; only the members this library uses are kept
+    struct ProviderMetadata
+    {
+        std::string issuer;
+        std::string jwksURI;
+        std::string authorizationEndpoint;
+        std::string tokenEndpoint;
+        std::string userinfoEndpoint;
+        std::string introspectionEndpoint;
+        std::string revocationEndpoint;
+        std::vector<std::string> scopesSupported;
+        std::vector<std::string> responseTypesSupported;
+        std::vector<std::string> grantTypesSupported;
+        std::vector<std::string> codeChallengeMethodsSupported;
+        std::vector<JWTAlg> idTokenSigningAlgs;     // names this library does not know are dropped
+
+        // throws JWTException on malformed JSON, a member of the wrong
+        // type, or a missing "issuer" or "jwks_uri"
+        static ProviderMetadata parse(std::string_view json);
+    };
+
+    // "issuer" with "/.well-known/openid-configuration" appended, as
+    // OpenID Connect Discovery 1.0 section 4 forms it
+    std::string discoveryURI(std::string_view issuer);
+
+    struct DiscoveryOptions
+    {
+        // freshness lifetime of metadata when the response carries no max-age
+        std::chrono::seconds defaultMaxAge { 3600 };
+
+        // bounds on the lifetime honored from Cache-Control
+        std::chrono::seconds minRefreshInterval { 60 };
+        std::chrono::seconds maxRefreshInterval { 86400 };
+
+        // delay before retrying a failed discovery; a provider resolved
+        // earlier stays in service meanwhile
+        std::chrono::seconds retryInterval { 30 };
+
+        // for the key set cache of each provider
+        JWKSCacheOptions jwks;
+    };
+
+    // resolves the metadata and key sets of a known list of issuers
+    //
+    // issuers are registered up front; a background thread fetches each
+    // one's discovery document, then starts a JWKSCache on its "jwks_uri",
+    // and publishes the provider only once that cache holds keys
+    // lookups go to an immutable directory behind an RCUPointer, take no
+    // lock and never fetch: an issuer is either ready, with its keys, or
+    // not found, so a request never waits on I/O
+    // metadata is refetched as its max-age runs out; a provider whose
+    // "jwks_uri" is unchanged keeps its warm key set cache, and one whose
+    // "jwks_uri" moved stops refreshing the old cache
+    // destruction stops every provider's key set cache, copies of
+    // Provider::keys included
+    class DiscoveryCache
+    {
+    public:
+        struct Provider
+        {
+            ProviderMetadata metadata;
+            std::shared_ptr<JWKSCache> keys;        // started, holding a key set
+            uint64_t generation;                    // of this issuer's metadata
+        };
+
+        // a consistent view of the resolved providers, valid while it is held
+        class Snapshot
+        {
+        public:
+            // the provider for "issuer", compared exactly; null if it is
+            // not registered or not yet resolved
+            const Provider* find(std::string_view issuer) const noexcept;
+
+            size_t size() const noexcept;
+
+        private:
+            friend class DiscoveryCache;
+            explicit Snapshot(const DiscoveryCache& cache) noexcept;
+
+            EpochGuard guard_;
+            const std::vector<std::shared_ptr<const Provider>>* providers_ = nullptr;
+        };
+
+        // the refresher thread starts at once, idle until issuers are added
+        explicit DiscoveryCache(std::shared_ptr<Fetcher> fetcher, DiscoveryOptions options = {});
+        ~DiscoveryCache();
+
+        DiscoveryCache(const DiscoveryCache&) = delete;
+        DiscoveryCache& operator=(const DiscoveryCache&) = delete;
+
+        // registers "issuer" for discovery on the background thread and
+        // returns at once; adding an issuer twice has no effect
+        void add(std::string issuer);
+
+        Snapshot snapshot() const noexcept { return Snapshot(*this); }
+
+        // waits until every issuer added so far has been tried at least
+        // once, or until "timeout"; true if all of them are resolved
+        bool waitUntilReady(std::chrono::milliseconds timeout);
+
+        // discovers "issuer", which must have been added, on the calling
+        // thread; returns false and keeps any earlier provider on failure
+        bool refresh(std::string_view issuer);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using Directory = std::vector<std::shared_ptr<const Provider>>;     // sorted by issuer
+
+        struct Issuer
+        {
+            std::string name;
+            Clock::time_point next;
+            bool tried = false;
+        };
+
+        // fetches and publishes one issuer; returns the time of its next refresh
+        Clock::time_point discover(const std::string& issuer, bool& ok);
+        void run(std::stop_token stop);
+
+        std::shared_ptr<Fetcher> fetcher_;
+        DiscoveryOptions options_;
+
+        RCUPointer<Directory> directory_;
+        std::mutex publishMutex_;                   // serializes discovery and publication
+
+        std::mutex mutex_;                          // guards issuers_
+        std::condition_variable_any wakeup_;
+        std::condition_variable ready_;
+        std::vector<Issuer> issuers_;
+
+        std::jthread refresher_;
+    };
+}
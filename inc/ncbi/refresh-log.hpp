@@ -0,0 +1,167 @@
+#pragma once
+
+#include <ncbi/grant-store.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ncbi
+{
+    struct LogRefreshTokenStoreOptions
+    {
+        unsigned shards = 16;                           // rounded up to a power of two
+
+        // the log file grows by this much at a time, up to "maxSize",
+        // the address space reserved for it
+        size_t growBy = size_t(64) << 20;
+        size_t maxSize = size_t(64) << 30;
+
+        // issue() and rotate() return only once their record is on disk;
+        // concurrent callers share one fdatasync (group commit)
+        // without it, records reach the disk when the kernel writes them
+        bool sync = true;
+    };
+
+    // refresh tokens in an append-only log file, memory-mapped, indexed in
+    // memory by shards of hash tables
+    //
+    // tokens themselves are never written: the log holds their SHA-256
+    // digests, so a copy of it grants nothing
+    // every issue and rotation appends one record, checksummed so that a
+    // record torn by a crash is recognized and dropped on recovery
+    //
+    // rotation retires the presented token; presenting a retired token
+    // again is taken as theft (OAuth 2.0 Security BCP, section 4.14.2) and
+    // revokes the whole family of tokens descended from the same grant
+    // compact() rewrites the log with only what is still needed: live
+    // tokens, and retired ones until they would have expired, so that
+    // reuse stays detectable for as long as it matters
+    class LogRefreshTokenStore final : public RefreshTokenStore
+    {
+    public:
+        // opens or creates the log at "path" and replays it; throws
+        // JWTException if the file cannot be opened or mapped
+        explicit LogRefreshTokenStore(std::string path, LogRefreshTokenStoreOptions options = {});
+        ~LogRefreshTokenStore() override;
+
+        LogRefreshTokenStore(const LogRefreshTokenStore&) = delete;
+        LogRefreshTokenStore& operator=(const LogRefreshTokenStore&) = delete;
+
+        // both throw JWTException when the log cannot be written or
+        // synced; a rotation that fails so is undone, in the log too, and
+        // the presented token can be presented again
+        std::string issue(AuthorizationGrant grant) override;
+        RotateResult rotate(std::string_view token, std::string_view clientId, std::string_view scope,
+            int64_t now, AuthorizationGrant& grant, std::string& successor) override;
+
+        // rewrites the log without expired tokens and revoked families,
+        // replacing the file atomically; issue() and rotate() wait while
+        // it runs
+        void compact(int64_t now);
+
+        struct Stats
+        {
+            uint64_t live = 0;
+            uint64_t retired = 0;
+            uint64_t revokedFamilies = 0;
+            uint64_t reuseDetected = 0;
+            uint64_t appends = 0;
+            uint64_t syncs = 0;             // fdatasync calls; appends / syncs is the batch size
+            uint64_t logBytes = 0;
+        };
+        Stats stats() const;
+
+    private:
+        using Key = std::array<unsigned char, 32>;
+
+        struct KeyHash
+        {
+            // keys are SHA-256 digests, uniform already
+            size_t operator()(const Key& key) const noexcept
+            {
+                size_t h;
+                std::memcpy(&h, key.data(), sizeof h);
+                return h;
+            }
+        };
+
+        struct Entry
+        {
+            uint64_t offset;                // of its record in the log
+            uint64_t family;
+            int64_t expires;
+            bool retired;
+            bool rotating;                  // retired by a rotation not yet durable
+        };
+
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<Key, Entry, KeyHash> entries;
+        };
+
+        struct Log
+        {
+            int fd = -1;
+            unsigned char* base = nullptr;
+            size_t fileSize = 0;
+            size_t tail = 0;
+        };
+
+        Shard& shardFor(const Key& key) noexcept { return shards_[KeyHash()(key) >> 32 & shardMask_]; }
+
+        void openLog(Log& log, const std::string& path, bool truncate);
+        void closeLog(Log& log) noexcept;
+        void replay();
+        void reserve(Log& log, size_t bytes);
+
+        // appends under appendMutex_, which the caller holds; returns the
+        // log position to wait on for durability
+        uint64_t append(unsigned char type, const void* body, size_t size, uint64_t& offset);
+        uint64_t appendIssue(const Key& key, const Key& parent, uint64_t family,
+            const AuthorizationGrant& grant, uint64_t& offset);
+        void waitDurable(uint64_t position);
+
+        AuthorizationGrant readGrant(uint64_t offset) const;
+        bool familyRevoked(uint64_t family) const;
+        void revokeFamily(uint64_t family);
+
+        std::string path_;
+        LogRefreshTokenStoreOptions options_;
+
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
+
+        mutable std::mutex appendMutex_;    // taken before any shard mutex
+        Log log_;
+        std::atomic<uint64_t> nextFamily_ { 1 };
+
+        // group commit: positions count bytes ever appended, across
+        // compactions, so that waiters never see them go backwards
+        std::mutex syncMutex_;
+        std::condition_variable synced_;
+        uint64_t appended_ = 0;             // guarded by syncMutex_
+        uint64_t durable_ = 0;
+        uint64_t failed_ = 0;               // covered by an fdatasync that failed
+        int syncError_ = 0;
+        bool syncing_ = false;
+
+        mutable std::shared_mutex familiesMutex_;
+        std::unordered_set<uint64_t> revoked_;
+
+        std::atomic<uint64_t> reuseDetected_ { 0 };
+        std::atomic<uint64_t> appends_ { 0 };
+        std::atomic<uint64_t> syncs_ { 0 };
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace ncbi
+{
+    // one block of memory reused by a thread for request after request
+    //
+    // everything a request allocates through resource() is carved from the
+    // block in order, and release() frees it all at once by rewinding;
+    // a request that needs more spills over to the heap in chunks that
+    // release() returns, and spills() counts them, so a block sized from
+    // production traffic can be checked to hold a typical request whole
+    class RequestArena
+    {
+    public:
+        explicit RequestArena(size_t size = 16384)
+            : buffer_(std::make_unique<std::byte[]>(size))
+            , size_(size)
+            , arena_(buffer_.get(), size, &upstream_)
+        {
+        }
+
+        RequestArena(const RequestArena&) = delete;
+        RequestArena& operator=(const RequestArena&) = delete;
+
+        std::pmr::memory_resource* resource() noexcept { return &arena_; }
+
+        // everything allocated from resource() is gone afterwards
+        void release() noexcept { arena_.release(); }
+
+        size_t size() const noexcept { return size_; }
+        size_t spills() const noexcept { return upstream_.allocations; }
+
+    private:
+        // the heap, counted
+        struct Upstream final : std::pmr::memory_resource
+        {
+            size_t allocations = 0;
+
+            void* do_allocate(size_t bytes, size_t alignment) override
+            {
+                ++allocations;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override
+            {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const memory_resource& other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        std::unique_ptr<std::byte[]> buffer_;
+        size_t size_;
+        Upstream upstream_;
+        std::pmr::monotonic_buffer_resource arena_;
+    };
+}
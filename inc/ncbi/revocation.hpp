@@ -0,0 +1,148 @@
+#pragma once
+
+#include <ncbi/epoch.hpp>
+#include <ncbi/fetch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace ncbi
+{
+    struct RevocationListOptions
+    {
+        // filter bits per revoked "jti"; 16 lets about one lookup in a
+        // thousand through to the exact set, at 2 bytes per entry
+        unsigned filterBitsPerEntry = 16;
+    };
+
+    // the "jti" values of revoked tokens (RFC 7009), checked on every request
+    //
+    // almost no token presented is revoked, so the exact set sits behind a
+    // blocked Bloom filter: a lookup hashes the "jti" once and reads one
+    // cache line, and only a hit goes on to the exact set, where the whole
+    // "jti" is compared
+    // the filter and the set form an immutable snapshot behind an
+    // RCUPointer, as the key sets of JWKSCache do; readers take no lock and
+    // allocate nothing, while each change builds a new snapshot and swaps
+    // it in, so a change costs time linear in the size of the list
+    //
+    // changes arrive as revocation documents, lines of text:
+    //
+    //     revocations <serial> [after <base>]
+    //     + <jti> <exp>
+    //     - <jti>
+    //
+    // the first line numbers the document; a full document replaces the
+    // list, a delta "after <base>" applies only to the list at serial
+    // <base>; "+" revokes a "jti" until NumericDate <exp>, after which the
+    // token is expired anyway and the entry can be pruned; "-" withdraws
+    // a revocation; a "jti" holds no whitespace
+    class RevocationList
+    {
+    public:
+        explicit RevocationList(RevocationListOptions options = {});
+        ~RevocationList();
+
+        RevocationList(const RevocationList&) = delete;
+        RevocationList& operator=(const RevocationList&) = delete;
+
+        bool revoked(std::string_view jti) const noexcept;
+
+        enum class Update : unsigned char
+        {
+            applied,
+            current,        // the list has the document's serial or a later one
+            gap             // a delta after some other serial; a full document is needed
+        };
+
+        // applies a revocation document; throws JWTException if it is
+        // malformed, leaving the list unchanged
+        Update apply(std::string_view document);
+
+        // revokes one "jti" without a document; the serial is unchanged
+        void revoke(std::string_view jti, int64_t expires);
+
+        // drops entries whose tokens have expired by "now"
+        void prune(int64_t now);
+
+        uint64_t serial() const noexcept;
+        size_t size() const noexcept;
+
+    private:
+        struct Set;
+        class Builder;
+
+        RevocationListOptions options_;
+        uint64_t seed_;
+        RCUPointer<Set> set_;
+        std::mutex writeMutex_;         // serializes changes
+    };
+
+    struct RevocationFeedOptions
+    {
+        // polling interval when the response carries no max-age, and the
+        // bounds on the one honored from Cache-Control
+        std::chrono::seconds defaultMaxAge { 30 };
+        std::chrono::seconds minRefreshInterval { 5 };
+        std::chrono::seconds maxRefreshInterval { 3600 };
+
+        // delay before retrying a failed fetch
+        std::chrono::seconds retryInterval { 30 };
+
+        // fetched when a delta does not follow on from the list's serial;
+        // empty to keep polling the feed until it serves a full document
+        std::string fullURI;
+    };
+
+    // keeps a RevocationList current from a feed of revocation documents
+    //
+    // the feed URI serves the latest document, usually a delta after the
+    // one before; a local file written by an operator will do, through a
+    // FileFetcher, as will a FunctionFetcher standing in for a server
+    class RevocationFeed
+    {
+    public:
+        // the list must outlive the feed
+        RevocationFeed(RevocationList& list, std::string uri, std::shared_ptr<Fetcher> fetcher,
+            RevocationFeedOptions options = {});
+        ~RevocationFeed();
+
+        RevocationFeed(const RevocationFeed&) = delete;
+        RevocationFeed& operator=(const RevocationFeed&) = delete;
+
+        // polls once, throwing JWTException if that fails, then starts the
+        // background poller
+        void start();
+
+        // polls now, on the calling thread; returns false and leaves the
+        // list as it was if the fetch fails or the document is malformed
+        bool poll();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // fetches and applies; returns the time of the next poll
+        Clock::time_point fetchAndApply(bool& ok);
+        bool fetchDocument(const std::string& uri, RevocationList::Update& update,
+            std::chrono::seconds& maxAge);
+        void run(std::stop_token stop, Clock::time_point next);
+
+        RevocationList& list_;
+        std::string uri_;
+        std::shared_ptr<Fetcher> fetcher_;
+        RevocationFeedOptions options_;
+
+        std::mutex fetchMutex_;         // serializes polls
+        std::mutex mutex_;
+        std::condition_variable_any wakeup_;
+        std::jthread poller_;
+    };
+}
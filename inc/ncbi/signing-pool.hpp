@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ncbi/jws-signer.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace ncbi
+{
+    struct SigningPoolOptions
+    {
+        // one slot per CPU when 0
+        unsigned slots = 0;
+    };
+
+    // signing contexts for one key, one per CPU, for callers that cannot
+    // keep a context per thread: tasks on shared executors, coroutines
+    // resumed wherever, request handlers on threads they do not own
+    //
+    // a signature goes to the slot of the CPU the caller runs on, whose
+    // lock is then almost never contended; a slot found busy, because the
+    // scheduler moved a thread mid-signature, sends the caller on to the
+    // next free one, so no signature waits for another while any slot is
+    // idle
+    // the contexts are created up front, so signing allocates nothing
+    class SigningPool
+    {
+    public:
+        // throws JWTException if a context cannot be created
+        explicit SigningPool(std::shared_ptr<const JWSSigner> signer, SigningPoolOptions options = {});
+        ~SigningPool();
+
+        SigningPool(const SigningPool&) = delete;
+        SigningPool& operator=(const SigningPool&) = delete;
+
+        // as SigningContext::sign()
+        bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept;
+
+        // refills the reserves of every slot not in use, such as the
+        // presigned nonces of PrivateKeySignerOptions; for idle time, a
+        // timer or a low-priority thread; returns how much was prepared
+        size_t precompute() noexcept;
+
+        const JWSSigner& signer() const noexcept { return *signer_; }
+        size_t slots() const noexcept { return slotCount_; }
+
+    private:
+        struct alignas(64) Slot
+        {
+            std::mutex mutex;
+            std::unique_ptr<SigningContext> context;
+        };
+
+        size_t homeSlot() const noexcept;
+
+        std::shared_ptr<const JWSSigner> signer_;
+        std::unique_ptr<Slot[]> slots_;
+        size_t slotCount_;
+    };
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ncbi
+{
+    // fixed set of worker threads draining one FIFO queue
+    //
+    // meant for coarse work such as batches of signature checks, where a
+    // task runs for microseconds at least and one shared queue is no
+    // bottleneck; tasks must not throw
+    class ThreadPool
+    {
+    public:
+        // "threads" of 0 means one per hardware thread
+        explicit ThreadPool(unsigned threads = 0);
+
+        // runs the tasks still queued, then joins the workers
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        unsigned size() const noexcept { return static_cast<unsigned>(workers_.size()); }
+
+        void post(std::function<void()> task);
+
+        // calls fn(i) for every i in [0, count), on the workers and on the
+        // calling thread, and returns once all calls have finished
+        template<class F>
+        void parallelFor(size_t count, F&& fn);
+
+    private:
+        void run(std::stop_token stop);
+
+        std::mutex mutex_;
+        std::condition_variable_any wakeup_;
+        std::deque<std::function<void()>> queue_;
+        std::vector<std::jthread> workers_;
+    };
+
+    template<class F>
+    void ThreadPool::parallelFor(size_t count, F&& fn)
+    {
+        if (count == 0)
+            return;
+
+        // helpers may start after the caller has finished every index, so
+        // the counters live on the heap and "fn" is touched only by whoever
+        // claims an index, which the caller is still waiting for
+        struct State
+        {
+            std::atomic<size_t> next { 0 };
+            std::atomic<size_t> done { 0 };
+        };
+        auto state = std::make_shared<State>();
+        auto* body = &fn;
+
+        auto work = [state, body, count]
+        {
+            for (size_t i; (i = state->next.fetch_add(1, std::memory_order_relaxed)) < count; )
+            {
+                (*body)(i);
+                if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+                    state->done.notify_all();
+            }
+        };
+
+        size_t helpers = std::min<size_t>(size(), count - 1);
+        for (size_t h = 0; h < helpers; ++h)
+            post(work);
+        work();
+
+        for (size_t d; (d = state->done.load(std::memory_order_acquire)) != count; )
+            state->done.wait(d, std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <ncbi/grant-store.hpp>
+#include <ncbi/jws-signer.hpp>
+#include <ncbi/jwt-writer.hpp>
+#include <ncbi/oauth-client.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ncbi
+{
+    struct TokenEndpointOptions
+    {
+        std::string issuer;                     // "iss" of issued tokens
+        std::string audience;                   // "aud"; omitted when empty
+
+        std::chrono::seconds accessTokenTTL { 300 };
+        std::chrono::seconds refreshTokenTTL { 86400 * 30 };
+
+        // refresh tokens accompany tokens issued for authorization codes
+        // to clients allowed the refresh_token grant
+        bool issueRefreshTokens = true;
+
+        // per-worker arena for parsing a request;
+        // requests that need more spill over to the heap
+        size_t arenaSize = 8192;
+    };
+
+    // an HTTP POST to the token endpoint
+    struct TokenRequest
+    {
+        std::string_view authorization;         // the Authorization header, if any
+        std::string_view body;                  // application/x-www-form-urlencoded
+    };
+
+    // the reply to send: "body" is application/json, to be served with
+    // Cache-Control: no-store (RFC 6749 section 5.1)
+    // a 401 answers failed client authentication; when the request used
+    // Basic authentication, "challenge" asks for a WWW-Authenticate header
+    struct TokenResponse
+    {
+        int status = 500;
+        std::string_view body;                  // valid until the worker's next request
+        bool challenge = false;
+    };
+
+    // the OAuth 2.0 token endpoint (RFC 6749 section 3.2) issuing JWT
+    // access tokens (RFC 9068), for the client_credentials grant, the
+    // authorization_code grant with PKCE (RFC 7636, S256 only) and the
+    // refresh_token grant with rotation
+    //
+    // the endpoint is immutable and shared; each serving thread handles
+    // requests through its own Worker, which holds everything a request
+    // needs ready-made: a signing context for the key, an arena for the
+    // request, a response buffer and a reserve of random bytes
+    // tokens are serialized straight into the response body by the
+    // endpoint's JWTWriter, at their exact length
+    class TokenEndpoint
+    {
+    public:
+        // throws JWTException if any of the collaborators is missing
+        TokenEndpoint(std::shared_ptr<const JWSSigner> signer,
+            std::shared_ptr<const ClientRegistry> clients,
+            std::shared_ptr<AuthorizationCodeStore> codes,
+            std::shared_ptr<RefreshTokenStore> refreshTokens,
+            TokenEndpointOptions options = {});
+        ~TokenEndpoint();
+
+        TokenEndpoint(const TokenEndpoint&) = delete;
+        TokenEndpoint& operator=(const TokenEndpoint&) = delete;
+
+        class Worker
+        {
+        public:
+            explicit Worker(const TokenEndpoint& endpoint);
+            ~Worker();
+
+            Worker(const Worker&) = delete;
+            Worker& operator=(const Worker&) = delete;
+
+            // processes one request at "now" (NumericDate); failures are
+            // answered with the error responses of RFC 6749 section 5.2
+            TokenResponse handle(const TokenRequest& request, int64_t now) noexcept;
+            TokenResponse handle(const TokenRequest& request) noexcept;
+
+        private:
+            struct State;
+            std::unique_ptr<State> state_;
+        };
+
+        const TokenEndpointOptions& options() const noexcept { return options_; }
+
+    private:
+        std::shared_ptr<const JWSSigner> signer_;
+        std::shared_ptr<const ClientRegistry> clients_;
+        std::shared_ptr<AuthorizationCodeStore> codes_;
+        std::shared_ptr<RefreshTokenStore> refreshTokens_;
+        TokenEndpointOptions options_;
+
+        JWTWriter writer_;
+    };
+}
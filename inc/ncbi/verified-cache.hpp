@@ -0,0 +1,130 @@
+#pragma once
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ncbi
+{
+    struct JWK;
+    class JWKSet;
+
+    // a token whose signature has been checked, with its decoded claims
+    struct VerifiedToken
+    {
+        std::string token;              // the raw token, compared in full on every cache hit
+        std::string payload;            // decoded claims set
+        std::string kid;
+        std::string jti;                // decoded; empty without "jti"
+        JWTAlg alg = JWTAlg::unknown;
+        int64_t exp = INT64_MAX;        // NumericDate; INT64_MAX without "exp"
+        int64_t nbf = INT64_MIN;        // NumericDate; INT64_MIN without "nbf"
+        uint64_t keyFingerprint = 0;    // identifies the key that verified it
+
+        // set when an IssuerRegistry chose the key: the decoded "iss", and
+        // the registry and key set generations the token was accepted under
+        std::string issuer;
+        uint64_t registryGeneration = 0;
+        uint64_t keysGeneration = 0;
+
+        JWTClaimsView claims() const noexcept { return JWTClaimsView(payload); }
+    };
+
+    // identifies a key by its type and material, so that a key replaced
+    // under an unchanged "kid" counts as a different key
+    uint64_t jwkFingerprint(const JWK& key) noexcept;
+
+    struct VerifiedTokenCacheOptions
+    {
+        size_t capacity = 65536;        // entries across all shards
+        unsigned shards = 16;           // rounded up to a power of two
+    };
+
+    // bounded cache of verification results, so that a client reusing one
+    // access token for many requests pays for the signature only once
+    //
+    // entries are found by a seeded 64-bit hash of the raw token and then
+    // confirmed by comparing the whole token, so a hash collision can cost
+    // a verification but never admit a different token
+    // each shard evicts with the CLOCK algorithm, taking expired entries
+    // before any live one; lookups share the shard lock and mark entries
+    // referenced with a relaxed store
+    class VerifiedTokenCache
+    {
+    public:
+        explicit VerifiedTokenCache(VerifiedTokenCacheOptions options = {});
+        ~VerifiedTokenCache();
+
+        VerifiedTokenCache(const VerifiedTokenCache&) = delete;
+        VerifiedTokenCache& operator=(const VerifiedTokenCache&) = delete;
+
+        // the cached result for "token", provided "exp" is still after "now"
+        std::shared_ptr<const VerifiedToken> find(std::string_view token, int64_t now) const noexcept;
+
+        // adds a freshly verified token, unless the key that verified it has
+        // been rotated out by retainKeys() in the meantime
+        void insert(std::shared_ptr<const VerifiedToken> entry, int64_t now);
+
+        // declares the keys now trusted: entries verified by any other key
+        // are evicted and further inserts for them refused
+        void retainKeys(const JWKSet& keys);
+
+        void clear();
+        size_t size() const;
+
+        struct Stats
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t insertions = 0;
+            uint64_t evictions = 0;
+        };
+        Stats stats() const noexcept;
+
+    private:
+        struct Slot
+        {
+            uint64_t hash = 0;
+            std::shared_ptr<const VerifiedToken> entry;
+            std::atomic<bool> referenced { false };
+        };
+
+        struct alignas(64) Shard
+        {
+            mutable std::shared_mutex mutex;
+            std::unique_ptr<Slot[]> slots;
+            size_t used = 0;
+            size_t hand = 0;
+            std::unordered_map<uint64_t, uint32_t> index;
+
+            mutable std::atomic<uint64_t> hits { 0 };
+            mutable std::atomic<uint64_t> misses { 0 };
+            uint64_t insertions = 0;
+            uint64_t evictions = 0;
+        };
+
+        Shard& shardFor(uint64_t hash) const noexcept { return shards_[hash & shardMask_]; }
+        size_t claimSlot(Shard& shard, int64_t now);
+        void evict(Shard& shard, Slot& slot);
+        bool trusted(uint64_t fingerprint) const;
+
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
+        size_t slotsPerShard_;
+        uint64_t seed_;
+
+        // sorted fingerprints of the trusted keys; null until retainKeys()
+        mutable std::mutex trustedMutex_;
+        std::shared_ptr<const std::vector<uint64_t>> trusted_;
+    };
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <ncbi/fetch.hpp>
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwks-cache.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ncbi
+{
+    // one trusted issuer as a configuration document describes it
+    struct IssuerConfig
+    {
+        std::string issuer;
+        std::string jwksURI;
+        std::vector<std::string> audiences;
+        std::vector<JWTAlg> algorithms;
+        std::chrono::seconds clockSkew { 60 };
+    };
+
+    // everything a multi-tenant JWTVerifier trusts, as a JSON document:
+    //
+    //     { "issuers": [ { "issuer": "https://login.example.org",
+    //                      "jwks_uri": "https://login.example.org/keys",
+    //                      "audiences": [ "https://api.example.org" ],
+    //                      "algorithms": [ "RS256", "ES256" ],
+    //                      "clock_skew": 60 }, ... ] }
+    //
+    // only "issuer" and "jwks_uri" are required; members this library does
+    // not know are ignored
+    struct VerifierConfig
+    {
+        std::vector<IssuerConfig> issuers;
+
+        // throws JWTException on malformed JSON, a member of the wrong
+        // type, an unknown algorithm, or a missing "issuer" or "jwks_uri"
+        static VerifierConfig parse(std::string_view json);
+    };
+
+    struct VerifierConfigFeedOptions
+    {
+        // polling interval when the response carries no max-age, and the
+        // bounds on the one honored from Cache-Control
+        std::chrono::seconds defaultMaxAge { 60 };
+        std::chrono::seconds minRefreshInterval { 5 };
+        std::chrono::seconds maxRefreshInterval { 3600 };
+
+        // delay before retrying a fetch that failed or a document that
+        // could not be applied
+        std::chrono::seconds retryInterval { 30 };
+
+        // for the key set caches of the issuers the feed adds
+        JWKSCacheOptions jwks;
+    };
+
+    // keeps an IssuerRegistry in step with a configuration document, so
+    // issuers, keys and policies change without a restart
+    //
+    // a new configuration is built and validated in full before it is
+    // swapped in: its issuers whose "jwks_uri" the registry already uses
+    // keep that key set cache, warm, and the caches of new URIs are
+    // started, fetching their first key set, beforehand; if anything
+    // fails, the configuration in force stays in force
+    // verifications in flight finish on the snapshot they took, and the
+    // old configuration, with any key set cache only it used, is freed
+    // once the last of them has let go; those caches stop refreshing
+    // at the swap
+    // results in a verifier's cache outlive the swap, served as long as
+    // the new configuration would accept them
+    class VerifierConfigFeed
+    {
+    public:
+        // the registry must outlive the feed; "fetcher" serves both the
+        // document and the key sets
+        VerifierConfigFeed(IssuerRegistry& registry, std::string uri, std::shared_ptr<Fetcher> fetcher,
+            VerifierConfigFeedOptions options = {});
+        ~VerifierConfigFeed();
+
+        VerifierConfigFeed(const VerifierConfigFeed&) = delete;
+        VerifierConfigFeed& operator=(const VerifierConfigFeed&) = delete;
+
+        // polls once, throwing JWTException if that fails, then starts the
+        // background poller
+        void start();
+
+        // polls now, on the calling thread; returns false and leaves the
+        // registry as it was if the fetch fails or the document cannot be
+        // applied; an unchanged document is not applied again
+        bool poll();
+
+        // builds the policies for "config" and swaps them in; throws
+        // JWTException, leaving the registry as it was, if the
+        // configuration is invalid or a new key set cannot be fetched
+        void apply(const VerifierConfig& config);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // builds and swaps in the policies; applyMutex_ must be held
+        void install(const VerifierConfig& config);
+
+        // fetches and applies; returns the time of the next poll
+        Clock::time_point fetchAndApply(bool& ok);
+        void run(std::stop_token stop, Clock::time_point next);
+
+        IssuerRegistry& registry_;
+        std::string uri_;
+        std::shared_ptr<Fetcher> fetcher_;
+        VerifierConfigFeedOptions options_;
+
+        std::mutex applyMutex_;         // serializes polls and applications
+        std::string applied_;           // the last document applied
+        std::mutex mutex_;
+        std::condition_variable_any wakeup_;
+        std::jthread poller_;
+    };
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <ncbi/jwt-error.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// per-stage verification metrics are compiled in unless the library and
+// its users are built with NCBI_OAUTH_METRICS defined as 0, which leaves
+// VerifyProbe empty and verifyMetrics() reporting nothing
+#ifndef NCBI_OAUTH_METRICS
+#define NCBI_OAUTH_METRICS 1
+#endif
+
+namespace ncbi
+{
+    // where JWTVerifier spends its time; a stage visited more than once
+    // in one verification, as decode is for the header and the payload,
+    // is recorded once with the total
+    enum class VerifyStage : unsigned char
+    {
+        cache,              // verified-token cache lookup and insertion
+        decode,             // splitting the token and base64url-decoding segments
+        parse,              // header and claims JSON
+        keyResolve,         // "alg" and "crit" checks and the JWKS lookup
+        signature,
+        claims              // dates and revocation
+    };
+
+    constexpr size_t verifyStageCount = static_cast<size_t>(VerifyStage::claims) + 1;
+
+    // short, static name suitable for metric labels
+    const char* toString(VerifyStage stage) noexcept;
+
+    // latencies in nanoseconds, HDR-style: exact below 16, and above that
+    // 16 linear buckets for each power of two, so any value is within
+    // about 6% of its bucket; values past 2^40 ns are counted in the last
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned subBucketBits = 4;
+        static constexpr unsigned maxValueBits = 40;
+        static constexpr size_t bucketCount = ((maxValueBits - subBucketBits + 1) << subBucketBits);
+
+        static size_t bucketOf(uint64_t value) noexcept;
+
+        // the smallest value counted in a bucket, and one past the largest
+        static uint64_t bucketLow(size_t bucket) noexcept;
+        static uint64_t bucketHigh(size_t bucket) noexcept;
+
+        void add(uint64_t value, uint64_t count = 1) noexcept { counts_[bucketOf(value)] += count; }
+        void merge(const LatencyHistogram& other) noexcept;
+
+        uint64_t count() const noexcept;
+
+        // values up to and including "value", counting a bucket when its
+        // midpoint is
+        uint64_t countAtOrBelow(uint64_t value) const noexcept;
+
+        // the value below which a fraction q of the samples fall, as a
+        // bucket midpoint; 0 when empty
+        uint64_t percentile(double q) const noexcept;
+
+        uint64_t bucket(size_t index) const noexcept { return counts_[index]; }
+
+    private:
+        std::array<uint64_t, bucketCount> counts_ {};
+    };
+
+    struct StageMetrics
+    {
+        uint64_t count = 0;             // verifications that reached the stage
+        uint64_t failures = 0;          // and were rejected in it
+        uint64_t totalNanos = 0;
+        LatencyHistogram latency;
+    };
+
+    // everything recorded since the process started, by every thread,
+    // including threads that have since exited
+    struct VerifyMetrics
+    {
+        std::array<StageMetrics, verifyStageCount> stages;
+        std::array<uint64_t, jwtStatusCount> outcomes {};   // indexed by JWTStatus
+
+        const StageMetrics& operator[](VerifyStage stage) const noexcept
+        {
+            return stages[static_cast<size_t>(stage)];
+        }
+
+        uint64_t verifications() const noexcept;
+    };
+
+    // adds up the per-thread records without stopping their writers; a
+    // verification finishing meanwhile may be counted in some stages and
+    // not yet in others
+    VerifyMetrics verifyMetrics();
+
+    // the Prometheus text exposition format (version 0.0.4):
+    //
+    //     <prefix>_verify_stage_seconds           histogram by stage
+    //     <prefix>_verify_stage_failures_total    counter by stage
+    //     <prefix>_verify_total                   counter by status
+    //
+    // the histogram is given in fixed buckets from 100 ns to 100 ms
+    std::string toPrometheus(const VerifyMetrics& metrics, std::string_view prefix = "ncbi_oauth");
+
+    namespace detail
+    {
+        // a cheap clock for stage timing: the TSC, scaled to nanoseconds
+        // when a snapshot is taken, where there is one (it is expected to
+        // be invariant, as on any current x86 server); nanoseconds otherwise
+        inline uint64_t metricTicks() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        // adds one verification to the calling thread's record
+        void recordVerification(const uint64_t (&ticks)[verifyStageCount], unsigned reached,
+            VerifyStage failedIn, JWTStatus status) noexcept;
+    }
+
+#if NCBI_OAUTH_METRICS
+    // times one verification, stage by stage
+    //
+    // enter() charges the time since the last mark to the current stage
+    // and moves on to the next; finish() charges the last, writes all of
+    // it to the thread's record and hands back the status, blaming a
+    // failure on the stage it ended in
+    // the thread's record is written without atomic read-modify-writes and
+    // read without locks, so timing costs a few TSC reads and a few dozen
+    // stores per verification
+    class VerifyProbe
+    {
+    public:
+        explicit VerifyProbe(VerifyStage first) noexcept
+            : stage_(first)
+            , reached_(1u << static_cast<unsigned>(first))
+            , mark_(detail::metricTicks())
+        {
+        }
+
+        void enter(VerifyStage stage) noexcept
+        {
+            uint64_t now = detail::metricTicks();
+            ticks_[static_cast<size_t>(stage_)] += now - mark_;
+            mark_ = now;
+            stage_ = stage;
+            reached_ |= 1u << static_cast<unsigned>(stage);
+        }
+
+        JWTStatus finish(JWTStatus status) noexcept
+        {
+            ticks_[static_cast<size_t>(stage_)] += detail::metricTicks() - mark_;
+            detail::recordVerification(ticks_, reached_, stage_, status);
+            return status;
+        }
+
+    private:
+        uint64_t ticks_[verifyStageCount] = {};
+        VerifyStage stage_;
+        unsigned reached_;
+        uint64_t mark_;
+    };
+#else
+    class VerifyProbe
+    {
+    public:
+        explicit VerifyProbe(VerifyStage) noexcept {}
+        void enter(VerifyStage) noexcept {}
+        JWTStatus finish(JWTStatus status) noexcept { return status; }
+    };
+#endif
+}
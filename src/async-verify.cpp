@@ -0,0 +1,93 @@
+#include <ncbi/async-verify.hpp>
+
+namespace ncbi
+{
+    AsyncJWTVerifier::AsyncJWTVerifier(JWKSCache& keys, Executor& executor, JWTVerifierOptions options)
+        : keys_(keys)
+        , executor_(executor)
+        , verifier_(keys, options)
+    {
+    }
+
+    AsyncJWTVerifier::Verification AsyncJWTVerifier::verify(std::string_view token) const noexcept
+    {
+        return Verification(*this, token, std::nullopt);
+    }
+
+    AsyncJWTVerifier::Verification AsyncJWTVerifier::verify(std::string_view token, int64_t now) const noexcept
+    {
+        return Verification(*this, token, now);
+    }
+
+    AsyncJWTVerifier::Verification::Verification(const AsyncJWTVerifier& verifier, std::string_view token,
+            std::optional<int64_t> now) noexcept
+        : verifier_(verifier)
+        , token_(token)
+        , now_(now)
+    {
+    }
+
+    void AsyncJWTVerifier::Verification::attempt()
+    {
+        const JWTVerifier& v = verifier_.verifier_;
+        result_.status = now_ ? v.verify(token_, *now_, result_.token) : v.verify(token_, result_.token);
+    }
+
+    bool AsyncJWTVerifier::Verification::await_ready()
+    {
+        // the generation is read first: a key set published after it was
+        // read is then either used by this attempt or waited for
+        generation_ = verifier_.keys_.generation();
+        attempt();
+        return result_.status != JWTStatus::unknownKey;
+    }
+
+    bool AsyncJWTVerifier::Verification::await_suspend(std::coroutine_handle<> awaiting)
+    {
+        // once the callback is registered the coroutine may be resumed on
+        // another thread at any moment, so nothing here touches the
+        // awaiter after whenRefreshed() returns
+        retry_ = true;
+        Executor& executor = verifier_.executor_;
+        return verifier_.keys_.whenRefreshed(generation_, [&executor, awaiting]
+        {
+            try
+            {
+                executor.post([awaiting] { awaiting.resume(); });
+            }
+            catch (...)
+            {
+                // better resumed on the refresher thread than never
+                awaiting.resume();
+            }
+        });
+    }
+
+    VerificationResult AsyncJWTVerifier::Verification::await_resume()
+    {
+        if (retry_)
+            attempt();
+        return std::move(result_);
+    }
+
+    bool AsyncIntrospectionClient::Introspection::await_ready()
+    {
+        return client_.client_.cached(token_, outcome_.status, outcome_.result);
+    }
+
+    void AsyncIntrospectionClient::Introspection::await_suspend(std::coroutine_handle<> awaiting)
+    {
+        client_.executor_.post([this, awaiting]
+        {
+            try
+            {
+                outcome_.status = client_.client_.introspect(token_, outcome_.result);
+            }
+            catch (...)
+            {
+                outcome_ = IntrospectionOutcome();
+            }
+            awaiting.resume();
+        });
+    }
+}
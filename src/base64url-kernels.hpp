@@ -0,0 +1,30 @@
+#pragma once
+
+// vectorized base64url kernels, private to the codec
+//
+// a kernel handles a prefix of the input in whole blocks and reports how
+// much it consumed; the scalar code in base64url.cpp finishes the tail and
+// applies the strictness rules, which only concern the final quantum
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ncbi::detail
+{
+    // encode whole 3-byte groups from "src"; returns bytes consumed,
+    // always a multiple of 3, having written 4/3 as many characters
+    using Base64EncodeKernel = size_t (*)(const uint8_t* src, size_t bytes, char* dst) noexcept;
+
+    // decode whole 4-character quanta from "src"; returns characters consumed,
+    // always a multiple of 4, or sets "invalid" on a character outside the
+    // alphabet, in which case the output is unspecified
+    using Base64DecodeKernel = size_t (*)(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept;
+
+    size_t base64EncodeSSE41(const uint8_t* src, size_t bytes, char* dst) noexcept;
+    size_t base64EncodeAVX2(const uint8_t* src, size_t bytes, char* dst) noexcept;
+    size_t base64EncodeAVX512(const uint8_t* src, size_t bytes, char* dst) noexcept;
+
+    size_t base64DecodeSSE41(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept;
+    size_t base64DecodeAVX2(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept;
+    size_t base64DecodeAVX512(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept;
+}
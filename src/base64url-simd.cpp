@@ -0,0 +1,324 @@
+#include "base64url-kernels.hpp"
+
+#include <immintrin.h>
+
+// GCC 12 warns about the deliberately undefined vectors inside its own
+// AVX-512 intrinsics (GCC bug 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// the kernels follow Wojciech Muła and Daniel Lemire, "Faster Base64
+// Encoding and Decoding using AVX2 Instructions" and "Base64 encoding and
+// decoding at almost the speed of a memory copy", adapted to the URL-safe
+// alphabet of RFC 4648 section 5
+//
+// each function is compiled for its own instruction set and is only ever
+// called after the dispatcher in base64url.cpp has checked the CPU
+
+// alphabet position to character: add lookup[reduced] to the index,
+// where "reduced" is 13 for A-Z, 0 for a-z, 1..10 for digits,
+// 11 for '-' and 12 for '_'
+#define NCBI_B64_ENCODE_SHIFTS \
+    71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -17, 32, 65, 0, 0
+
+// the four 6-bit fields of each 3-byte group after the bytes have
+// been spread as [b1 b0 b2 b1] into a 32-bit lane
+#define NCBI_B64_ENCODE_SPREAD \
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+
+// gathers the three significant bytes of each 32-bit lane,
+// most significant first, into the low 12 bytes of a 128-bit lane
+#define NCBI_B64_DECODE_PACK \
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+// character validation by nibble: a character is outside the alphabet
+// when the class bits of its high nibble meet the invalid-for-class bits
+// of its low nibble; bit 0x20 rejects every high nibble other than 2..7
+#define NCBI_B64_DECODE_CLASS_HI \
+    0x20, 0x20, 0x01, 0x02, 0x04, 0x08, 0x04, 0x10, \
+    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20
+#define NCBI_B64_DECODE_INVALID_LO \
+    0x25, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, \
+    0x21, 0x21, 0x23, 0x3B, 0x3B, 0x3A, 0x3B, 0x33
+
+// character to alphabet position by high nibble; '_' shares its high
+// nibble with 'P'..'Z' and is patched separately
+#define NCBI_B64_DECODE_SHIFTS \
+    0, 0, 62 - '-', 52 - '0', -'A', -'A', 26 - 'a', 26 - 'a', \
+    0, 0, 0, 0, 0, 0, 0, 0
+
+namespace ncbi::detail
+{
+    // SSE4.1
+
+    __attribute__((target("sse4.1")))
+    static inline __m128i encodeTranslateSSE(__m128i indices) noexcept
+    {
+        const __m128i shifts = _mm_setr_epi8(NCBI_B64_ENCODE_SHIFTS);
+        __m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        reduced = _mm_or_si128(reduced, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        return _mm_add_epi8(indices, _mm_shuffle_epi8(shifts, reduced));
+    }
+
+    __attribute__((target("sse4.1")))
+    static inline __m128i encodeSplitSSE(__m128i in) noexcept
+    {
+        in = _mm_shuffle_epi8(in, _mm_setr_epi8(NCBI_B64_ENCODE_SPREAD));
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        return _mm_or_si128(t1, t3);
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t base64EncodeSSE41(const uint8_t* src, size_t bytes, char* dst) noexcept
+    {
+        size_t i = 0;
+
+        // each step reads 16 bytes to use 12
+        for (; bytes - i >= 16; i += 12)
+        {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i out = encodeTranslateSSE(encodeSplitSSE(in));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+            dst += 16;
+        }
+        return i;
+    }
+
+    // translates characters to 6-bit values, flagging any outside the alphabet
+    __attribute__((target("sse4.1")))
+    static inline __m128i decodeTranslateSSE(__m128i c, bool& valid) noexcept
+    {
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(c, 4), _mm_set1_epi8(0x0F));
+        __m128i lo = _mm_and_si128(c, _mm_set1_epi8(0x0F));
+
+        __m128i classes = _mm_shuffle_epi8(_mm_setr_epi8(NCBI_B64_DECODE_CLASS_HI), hi);
+        __m128i invalid = _mm_shuffle_epi8(_mm_setr_epi8(NCBI_B64_DECODE_INVALID_LO), lo);
+        valid = _mm_testz_si128(classes, invalid) != 0;
+
+        __m128i shift = _mm_shuffle_epi8(_mm_setr_epi8(NCBI_B64_DECODE_SHIFTS), hi);
+        __m128i under = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+        shift = _mm_blendv_epi8(shift, _mm_set1_epi8(63 - '_'), under);
+        return _mm_add_epi8(c, shift);
+    }
+
+    // packs sixteen 6-bit values into the low 12 bytes
+    __attribute__((target("sse4.1")))
+    static inline __m128i decodePackSSE(__m128i values) noexcept
+    {
+        __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        return _mm_shuffle_epi8(quads, _mm_setr_epi8(NCBI_B64_DECODE_PACK));
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t base64DecodeSSE41(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept
+    {
+        size_t i = 0;
+
+        // each step stores 16 bytes of which 12 are output; stopping while
+        // 24 characters remain keeps the surplus inside the output buffer
+        for (; chars - i >= 24; i += 16)
+        {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            bool valid;
+            __m128i values = decodeTranslateSSE(c, valid);
+            if (!valid)
+            {
+                invalid = true;
+                return i;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), decodePackSSE(values));
+            dst += 12;
+        }
+        return i;
+    }
+
+    // AVX2
+
+    __attribute__((target("avx2")))
+    size_t base64EncodeAVX2(const uint8_t* src, size_t bytes, char* dst) noexcept
+    {
+        const __m256i spread = _mm256_setr_epi8(NCBI_B64_ENCODE_SPREAD, NCBI_B64_ENCODE_SPREAD);
+        const __m256i shifts = _mm256_setr_epi8(NCBI_B64_ENCODE_SHIFTS, NCBI_B64_ENCODE_SHIFTS);
+
+        size_t i = 0;
+
+        // two overlapping 16-byte loads place 12 input bytes in each lane
+        for (; bytes - i >= 28; i += 24)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+            __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+            in = _mm256_shuffle_epi8(in, spread);
+            __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+            __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+            __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+            __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+            __m256i indices = _mm256_or_si256(t1, t3);
+
+            __m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+            __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+            reduced = _mm256_or_si256(reduced, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+            __m256i out = _mm256_add_epi8(indices, _mm256_shuffle_epi8(shifts, reduced));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+            dst += 32;
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    size_t base64DecodeAVX2(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept
+    {
+        const __m256i pack = _mm256_setr_epi8(NCBI_B64_DECODE_PACK, NCBI_B64_DECODE_PACK);
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        const __m256i classHi = _mm256_setr_epi8(NCBI_B64_DECODE_CLASS_HI, NCBI_B64_DECODE_CLASS_HI);
+        const __m256i invalidLo = _mm256_setr_epi8(NCBI_B64_DECODE_INVALID_LO, NCBI_B64_DECODE_INVALID_LO);
+        const __m256i shifts = _mm256_setr_epi8(NCBI_B64_DECODE_SHIFTS, NCBI_B64_DECODE_SHIFTS);
+
+        size_t i = 0;
+
+        // each step stores 32 bytes of which 24 are output; stopping while
+        // 44 characters remain keeps the surplus inside the output buffer
+        for (; chars - i >= 44; i += 32)
+        {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi32(c, 4), _mm256_set1_epi8(0x0F));
+            __m256i lo = _mm256_and_si256(c, _mm256_set1_epi8(0x0F));
+
+            __m256i classes = _mm256_shuffle_epi8(classHi, hi);
+            __m256i invalidFor = _mm256_shuffle_epi8(invalidLo, lo);
+            if (!_mm256_testz_si256(classes, invalidFor))
+            {
+                invalid = true;
+                return i;
+            }
+
+            __m256i shift = _mm256_shuffle_epi8(shifts, hi);
+            __m256i under = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+            shift = _mm256_blendv_epi8(shift, _mm256_set1_epi8(63 - '_'), under);
+            __m256i values = _mm256_add_epi8(c, shift);
+
+            __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+            __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+            __m256i out = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(quads, pack), lanes);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+            dst += 24;
+        }
+        return i;
+    }
+
+    // AVX-512 with VBMI, whose byte permutes replace the shuffles above
+    // and let the tail of each step be handled by masked loads and stores
+
+    namespace
+    {
+        struct AVX512Tables
+        {
+            alignas(64) uint8_t encodeSpread[64];
+            alignas(64) char encodeAlphabet[64];
+            alignas(64) uint8_t decodeLookup[128];
+            alignas(64) uint8_t decodePack[64];
+
+            constexpr AVX512Tables() noexcept
+                : encodeSpread {}
+                , encodeAlphabet {}
+                , decodeLookup {}
+                , decodePack {}
+            {
+                constexpr char alphabet[] =
+                    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+                constexpr uint8_t order[4] = { 1, 0, 2, 1 };
+                for (unsigned j = 0; j < 64; ++j)
+                {
+                    encodeSpread[j] = static_cast<uint8_t>(j / 4 * 3 + order[j % 4]);
+                    encodeAlphabet[j] = alphabet[j];
+                }
+
+                // 0x80 marks characters outside the alphabet
+                for (unsigned j = 0; j < 128; ++j)
+                    decodeLookup[j] = 0x80;
+                for (unsigned j = 0; j < 64; ++j)
+                    decodeLookup[static_cast<unsigned char>(alphabet[j])] = static_cast<uint8_t>(j);
+
+                for (unsigned j = 0; j < 64; ++j)
+                    decodePack[j] = j < 48 ? static_cast<uint8_t>(j / 3 * 4 + 2 - j % 3) : 0;
+            }
+        };
+
+        constexpr AVX512Tables avx512Tables;
+
+        // bit offsets of the four 6-bit fields within each spread 32-bit lane
+        constexpr long long encodeFieldOffsets = 0x3036242a1016040a;
+
+        constexpr __mmask64 mask48 = 0x0000FFFFFFFFFFFFull;
+    }
+
+    __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+    size_t base64EncodeAVX512(const uint8_t* src, size_t bytes, char* dst) noexcept
+    {
+        const __m512i spread = _mm512_load_si512(avx512Tables.encodeSpread);
+        const __m512i alphabet = _mm512_load_si512(avx512Tables.encodeAlphabet);
+        const __m512i offsets = _mm512_set1_epi64(encodeFieldOffsets);
+
+        size_t i = 0;
+        for (; bytes - i >= 48; i += 48)
+        {
+            __m512i in = _mm512_maskz_loadu_epi8(mask48, src + i);
+            in = _mm512_permutexvar_epi8(spread, in);
+            __m512i indices = _mm512_multishift_epi64_epi8(offsets, in);
+            __m512i out = _mm512_permutexvar_epi8(indices, alphabet);
+            _mm512_storeu_si512(dst, out);
+            dst += 64;
+        }
+        return i;
+    }
+
+    __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+    size_t base64DecodeAVX512(const char* src, size_t chars, uint8_t* dst, bool& invalid) noexcept
+    {
+        const __m512i lookupLo = _mm512_load_si512(avx512Tables.decodeLookup);
+        const __m512i lookupHi = _mm512_load_si512(avx512Tables.decodeLookup + 64);
+        const __m512i pack = _mm512_load_si512(avx512Tables.decodePack);
+
+        size_t i = 0;
+        for (; chars - i >= 64; i += 64)
+        {
+            __m512i c = _mm512_loadu_si512(src + i);
+
+            // the lookup sees only the low 7 bits, so a set high bit in
+            // either the character or its translation marks it invalid
+            __m512i values = _mm512_permutex2var_epi8(lookupLo, c, lookupHi);
+            if (_mm512_movepi8_mask(_mm512_or_si512(c, values)) != 0)
+            {
+                invalid = true;
+                return i;
+            }
+
+            __m512i pairs = _mm512_maddubs_epi16(values, _mm512_set1_epi32(0x01400140));
+            __m512i quads = _mm512_madd_epi16(pairs, _mm512_set1_epi32(0x00011000));
+            __m512i out = _mm512_permutexvar_epi8(pack, quads);
+
+            _mm512_mask_storeu_epi8(dst, mask48, out);
+            dst += 48;
+        }
+        return i;
+    }
+
+}
+
+#undef NCBI_B64_ENCODE_SHIFTS
+#undef NCBI_B64_ENCODE_SPREAD
+#undef NCBI_B64_DECODE_PACK
+#undef NCBI_B64_DECODE_CLASS_HI
+#undef NCBI_B64_DECODE_INVALID_LO
+#undef NCBI_B64_DECODE_SHIFTS
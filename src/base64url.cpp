@@ -0,0 +1,234 @@
+#include <ncbi/base64url.hpp>
+#include "base64url-kernels.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace ncbi
+{
+    namespace
+    {
+        constexpr char encodeTable[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+        constexpr uint8_t invalid = 0xFF;
+
+        struct DecodeTable
+        {
+            uint8_t value[256];
+
+            constexpr DecodeTable() noexcept
+                : value {}
+            {
+                for (unsigned i = 0; i < 256; ++i)
+                    value[i] = invalid;
+                for (unsigned i = 0; i < 64; ++i)
+                    value[static_cast<unsigned char>(encodeTable[i])] = static_cast<uint8_t>(i);
+            }
+        };
+
+        constexpr DecodeTable decodeTable;
+
+        struct KernelSet
+        {
+            Base64URLKernel kernel;
+            detail::Base64EncodeKernel encode;
+            detail::Base64DecodeKernel decode;
+        };
+
+        constexpr KernelSet kernelSets[] =
+        {
+            { Base64URLKernel::scalar, nullptr, nullptr },
+            { Base64URLKernel::sse41,  detail::base64EncodeSSE41,  detail::base64DecodeSSE41 },
+            { Base64URLKernel::avx2,   detail::base64EncodeAVX2,   detail::base64DecodeAVX2 },
+            { Base64URLKernel::avx512, detail::base64EncodeAVX512, detail::base64DecodeAVX512 }
+        };
+
+        // null until first use; detection is idempotent, so racing
+        // initializers merely store the same value
+        std::atomic<const KernelSet*> activeKernels { nullptr };
+
+        bool cpuSupports(Base64URLKernel kernel) noexcept
+        {
+            switch (kernel)
+            {
+            case Base64URLKernel::scalar:
+                return true;
+            case Base64URLKernel::sse41:
+                return __builtin_cpu_supports("sse4.1");
+            case Base64URLKernel::avx2:
+                return __builtin_cpu_supports("avx2");
+            case Base64URLKernel::avx512:
+                return __builtin_cpu_supports("avx512f") &&
+                    __builtin_cpu_supports("avx512bw") &&
+                    __builtin_cpu_supports("avx512vbmi");
+            }
+            return false;
+        }
+
+        const KernelSet& kernels() noexcept
+        {
+            const KernelSet* set = activeKernels.load(std::memory_order_acquire);
+            if (set == nullptr)
+            {
+                __builtin_cpu_init();
+                set = &kernelSets[0];
+                for (const KernelSet& candidate : kernelSets)
+                {
+                    if (cpuSupports(candidate.kernel))
+                        set = &candidate;
+                }
+                activeKernels.store(set, std::memory_order_release);
+            }
+            return *set;
+        }
+    }
+
+    Base64URLKernel base64urlKernel() noexcept
+    {
+        return kernels().kernel;
+    }
+
+    bool base64urlKernelSupported(Base64URLKernel kernel) noexcept
+    {
+        __builtin_cpu_init();
+        return cpuSupports(kernel);
+    }
+
+    bool base64urlSelectKernel(Base64URLKernel kernel) noexcept
+    {
+        if (!base64urlKernelSupported(kernel))
+            return false;
+        activeKernels.store(&kernelSets[static_cast<unsigned>(kernel)], std::memory_order_release);
+        return true;
+    }
+
+    size_t base64urlEncode(const void* src, size_t bytes, char* dst) noexcept
+    {
+        const auto* in = static_cast<const uint8_t*>(src);
+        char* out = dst;
+
+        size_t i = 0;
+        if (detail::Base64EncodeKernel encode = kernels().encode)
+        {
+            i = encode(in, bytes, out);
+            out += i / 3 * 4;
+        }
+
+        for (; i + 3 <= bytes; i += 3)
+        {
+            uint32_t triple = uint32_t(in[i]) << 16 | uint32_t(in[i + 1]) << 8 | in[i + 2];
+            out[0] = encodeTable[triple >> 18];
+            out[1] = encodeTable[triple >> 12 & 0x3F];
+            out[2] = encodeTable[triple >> 6 & 0x3F];
+            out[3] = encodeTable[triple & 0x3F];
+            out += 4;
+        }
+
+        switch (bytes - i)
+        {
+        case 2:
+        {
+            uint32_t pair = uint32_t(in[i]) << 8 | in[i + 1];
+            out[0] = encodeTable[pair >> 10];
+            out[1] = encodeTable[pair >> 4 & 0x3F];
+            out[2] = encodeTable[pair << 2 & 0x3F];
+            out += 3;
+            break;
+        }
+        case 1:
+            out[0] = encodeTable[in[i] >> 2];
+            out[1] = encodeTable[in[i] << 4 & 0x3F];
+            out += 2;
+            break;
+        }
+
+        return static_cast<size_t>(out - dst);
+    }
+
+    bool base64urlDecode(std::string_view src, void* dst, size_t& written, Base64URLMode mode) noexcept
+    {
+        const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+        auto* out = static_cast<uint8_t*>(dst);
+        size_t len = src.size();
+
+        bool strict = mode == Base64URLMode::strict;
+        if (!strict && len % 4 == 0 && len != 0 && in[len - 1] == '=')
+            len -= in[len - 2] == '=' ? 2 : 1;
+
+        if (len % 4 == 1)
+            return false;
+
+        size_t i = 0;
+        if (detail::Base64DecodeKernel decode = kernels().decode)
+        {
+            bool invalid = false;
+            i = decode(src.data(), len, out, invalid);
+            if (invalid)
+                return false;
+            out += i / 4 * 3;
+        }
+
+        const uint8_t* table = decodeTable.value;
+
+        // OR-ing the lookups lets a single test after the loop catch
+        // any character outside the alphabet
+        uint32_t bad = 0;
+
+        for (; i + 4 <= len; i += 4)
+        {
+            uint32_t a = table[in[i]];
+            uint32_t b = table[in[i + 1]];
+            uint32_t c = table[in[i + 2]];
+            uint32_t d = table[in[i + 3]];
+            bad |= a | b | c | d;
+
+            uint32_t quad = a << 18 | b << 12 | c << 6 | d;
+            out[0] = static_cast<uint8_t>(quad >> 16);
+            out[1] = static_cast<uint8_t>(quad >> 8);
+            out[2] = static_cast<uint8_t>(quad);
+            out += 3;
+        }
+
+        switch (len - i)
+        {
+        case 3:
+        {
+            uint32_t a = table[in[i]];
+            uint32_t b = table[in[i + 1]];
+            uint32_t c = table[in[i + 2]];
+            bad |= a | b | c;
+
+            // the last character carries two unused low bits
+            if (strict && (c & 0x03) != 0)
+                return false;
+
+            uint32_t triple = a << 12 | b << 6 | c;
+            out[0] = static_cast<uint8_t>(triple >> 10);
+            out[1] = static_cast<uint8_t>(triple >> 2);
+            out += 2;
+            break;
+        }
+        case 2:
+        {
+            uint32_t a = table[in[i]];
+            uint32_t b = table[in[i + 1]];
+            bad |= a | b;
+
+            // the last character carries four unused low bits
+            if (strict && (b & 0x0F) != 0)
+                return false;
+
+            out[0] = static_cast<uint8_t>(a << 2 | b >> 4);
+            out += 1;
+            break;
+        }
+        }
+
+        if ((bad & 0x80) != 0)
+            return false;
+
+        written = static_cast<size_t>(out - static_cast<uint8_t*>(dst));
+        return true;
+    }
+}
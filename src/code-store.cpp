@@ -0,0 +1,376 @@
+#include <ncbi/code-store.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include "random-reserve.hpp"
+
+#include <openssl/crypto.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <unordered_map>
+
+namespace ncbi
+{
+    namespace
+    {
+        constexpr size_t codeBytes = 32;
+        constexpr size_t codeWords = codeBytes / 8;
+        constexpr size_t window = 16;
+
+        // a slot's state word: its reuse count above two state bits
+        constexpr uint64_t stateEmpty = 0;
+        constexpr uint64_t stateBusy = 1;       // being filled or emptied by its claimant
+        constexpr uint64_t stateLive = 2;
+
+        constexpr uint64_t makeWord(uint64_t reuses, uint64_t state) noexcept { return reuses << 2 | state; }
+        constexpr uint64_t reusesOf(uint64_t word) noexcept { return word >> 2; }
+        constexpr uint64_t stateOf(uint64_t word) noexcept { return word & 3; }
+
+        // the wheel: 256 one-second buckets, then two levels of 64, each
+        // bucket spanning a whole turn of the level below
+        constexpr unsigned level0Bits = 8;
+        constexpr unsigned levelBits = 6;
+        constexpr size_t level0Size = size_t(1) << level0Bits;
+        constexpr size_t levelSize = size_t(1) << levelBits;
+        constexpr size_t level1Base = level0Size;
+        constexpr size_t level2Base = level0Size + levelSize;
+        constexpr size_t bucketCount = level0Size + 2 * levelSize;
+        constexpr int64_t level1Span = int64_t(1) << level0Bits;
+        constexpr int64_t level2Span = int64_t(1) << (level0Bits + levelBits);
+        constexpr int64_t wheelSpan = int64_t(1) << (level0Bits + 2 * levelBits);
+
+        void readCode(const unsigned char* bytes, uint64_t (&key)[codeWords]) noexcept
+        {
+            std::memcpy(key, bytes, codeBytes);
+        }
+    }
+
+    struct alignas(64) ShardedCodeStore::Slot
+    {
+        std::atomic<uint64_t> word { makeWord(0, stateEmpty) };
+        std::atomic<uint64_t> key[codeWords] = {};
+        std::atomic<int64_t> expires { 0 };
+        std::atomic<AuthorizationGrant*> grant { nullptr };
+
+        // from live "w" to busy; exactly one of any number of racing
+        // claimants succeeds, and none does once the slot has been reused
+        bool claim(uint64_t w) noexcept
+        {
+            return word.compare_exchange_strong(w, makeWord(reusesOf(w), stateBusy),
+                std::memory_order_acq_rel, std::memory_order_relaxed);
+        }
+
+        // after a successful claim of "w": takes the grant out and frees the slot
+        std::unique_ptr<AuthorizationGrant> release(uint64_t w) noexcept
+        {
+            std::unique_ptr<AuthorizationGrant> out(grant.load(std::memory_order_relaxed));
+            grant.store(nullptr, std::memory_order_relaxed);
+            word.store(makeWord(reusesOf(w), stateEmpty), std::memory_order_release);
+            return out;
+        }
+    };
+
+    // a wheel entry: the slot and the state word it had when the code
+    // was issued, which no longer matches once the code is consumed
+    struct ShardedCodeStore::Node
+    {
+        Node* next;
+        int64_t expires;
+        uint64_t word;
+        size_t slot;
+    };
+
+    struct ShardedCodeStore::Shard
+    {
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<Node*> buckets[bucketCount] = {};
+        std::atomic<int64_t> current { 0 };     // the last second expired
+        std::mutex expiring;
+
+        alignas(64) std::atomic<size_t> live { 0 };
+
+        std::mutex overflowMutex;
+        std::unordered_map<std::string, AuthorizationGrant> overflow;
+        std::atomic<size_t> overflowSize { 0 };
+
+        // pushes "node" onto the bucket for its expiry, as seen from second
+        // "now"; an entry pushed just as the wheel moves past its bucket
+        // waits a turn of that level, its code expired but harmless, since
+        // consume() checks the expiry itself
+        void schedule(Node* node, int64_t now) noexcept
+        {
+            int64_t e = node->expires;
+            int64_t delta = e - now;
+            size_t index;
+            if (delta <= 0)
+                index = static_cast<size_t>(now + 1) & (level0Size - 1);
+            else if (delta < level1Span)
+                index = static_cast<size_t>(e) & (level0Size - 1);
+            else if (delta < level2Span)
+                index = level1Base + (static_cast<size_t>(e >> level0Bits) & (levelSize - 1));
+            else if (delta < wheelSpan)
+                index = level2Base + (static_cast<size_t>(e >> (level0Bits + levelBits)) & (levelSize - 1));
+            else
+            {
+                // beyond the wheel: the farthest bucket, to be placed again from there
+                index = level2Base + (static_cast<size_t>((now >> (level0Bits + levelBits)) + levelSize - 1) & (levelSize - 1));
+            }
+
+            std::atomic<Node*>& bucket = buckets[index];
+            node->next = bucket.load(std::memory_order_relaxed);
+            while (!bucket.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+    };
+
+    ShardedCodeStore::ShardedCodeStore(ShardedCodeStoreOptions options)
+    {
+        static_assert(sizeof(Slot) == 64, "a slot is one cache line");
+
+        size_t shards = std::bit_ceil(std::max<size_t>(options.shards, 1));
+        size_t perShard = std::max(std::bit_ceil(std::max<size_t>(options.capacity, 1)) / shards, window);
+        int64_t start = options.start != 0 ? options.start : static_cast<int64_t>(std::time(nullptr));
+
+        shards_ = std::make_unique<Shard[]>(shards);
+        shardMask_ = shards - 1;
+        shardBits_ = static_cast<unsigned>(std::countr_zero(shards));
+        slotMask_ = perShard - 1;
+        for (size_t i = 0; i < shards; ++i)
+        {
+            shards_[i].slots = std::make_unique<Slot[]>(perShard);
+            shards_[i].current.store(start, std::memory_order_relaxed);
+        }
+    }
+
+    ShardedCodeStore::~ShardedCodeStore()
+    {
+        for (size_t i = 0; i <= shardMask_; ++i)
+        {
+            Shard& shard = shards_[i];
+            for (size_t s = 0; s <= slotMask_; ++s)
+                delete shard.slots[s].grant.load(std::memory_order_relaxed);
+            for (std::atomic<Node*>& bucket : shard.buckets)
+            {
+                for (Node* node = bucket.load(std::memory_order_relaxed); node != nullptr;)
+                {
+                    Node* next = node->next;
+                    delete node;
+                    node = next;
+                }
+            }
+        }
+    }
+
+    std::string ShardedCodeStore::issue(AuthorizationGrant grant)
+    {
+        unsigned char bytes[codeBytes];
+        if (!detail::takeRandom(bytes, sizeof bytes))
+            throw JWTException("ShardedCodeStore: no randomness available");
+        std::string code(base64urlEncodedSize(sizeof bytes), '\0');
+        base64urlEncode(bytes, sizeof bytes, code.data());
+
+        uint64_t key[codeWords];
+        readCode(bytes, key);
+        OPENSSL_cleanse(bytes, sizeof bytes);
+        Shard& shard = shards_[key[0] & shardMask_];
+        size_t home = (key[0] >> shardBits_) & slotMask_;
+
+        int64_t expires = grant.expires;
+        auto owned = std::make_unique<AuthorizationGrant>(std::move(grant));
+        auto node = std::make_unique<Node>();
+
+        for (size_t i = 0; i < window; ++i)
+        {
+            size_t index = (home + i) & slotMask_;
+            Slot& slot = shard.slots[index];
+            uint64_t w = slot.word.load(std::memory_order_relaxed);
+            if (stateOf(w) != stateEmpty ||
+                !slot.word.compare_exchange_strong(w, makeWord(reusesOf(w) + 1, stateBusy),
+                    std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                continue;
+            }
+
+            for (size_t k = 0; k < codeWords; ++k)
+                slot.key[k].store(key[k], std::memory_order_relaxed);
+            slot.expires.store(expires, std::memory_order_relaxed);
+            slot.grant.store(owned.release(), std::memory_order_relaxed);
+            uint64_t live = makeWord(reusesOf(w) + 1, stateLive);
+            slot.word.store(live, std::memory_order_release);
+            shard.live.fetch_add(1, std::memory_order_relaxed);
+
+            *node = Node { nullptr, expires, live, index };
+            shard.schedule(node.release(), shard.current.load(std::memory_order_relaxed));
+            return code;
+        }
+
+        std::lock_guard<std::mutex> lock(shard.overflowMutex);
+        shard.overflow.emplace(std::string(reinterpret_cast<const char*>(key), codeBytes), std::move(*owned));
+        shard.overflowSize.fetch_add(1, std::memory_order_relaxed);
+        shard.live.fetch_add(1, std::memory_order_relaxed);
+        return code;
+    }
+
+    bool ShardedCodeStore::consume(std::string_view code, int64_t now, AuthorizationGrant& grant)
+    {
+        unsigned char bytes[codeBytes + 2];
+        size_t written;
+        if (code.size() != base64urlEncodedSize(codeBytes) || !base64urlDecode(code, bytes, written) ||
+            written != codeBytes)
+        {
+            return false;
+        }
+
+        uint64_t key[codeWords];
+        readCode(bytes, key);
+        Shard& shard = shards_[key[0] & shardMask_];
+        size_t home = (key[0] >> shardBits_) & slotMask_;
+
+        for (size_t i = 0; i < window; ++i)
+        {
+            Slot& slot = shard.slots[(home + i) & slotMask_];
+            uint64_t w = slot.word.load(std::memory_order_acquire);
+            if (stateOf(w) != stateLive)
+                continue;
+
+            // every word is compared, so timing shows nothing of a near miss
+            uint64_t diff = 0;
+            for (size_t k = 0; k < codeWords; ++k)
+                diff |= slot.key[k].load(std::memory_order_relaxed) ^ key[k];
+            if (diff != 0)
+                continue;
+
+            // the key read above belongs to "w" only if the claim succeeds;
+            // failure means the code was consumed or expired just now
+            if (!slot.claim(w))
+                return false;
+            int64_t expires = slot.expires.load(std::memory_order_relaxed);
+            std::unique_ptr<AuthorizationGrant> owned = slot.release(w);
+            shard.live.fetch_sub(1, std::memory_order_relaxed);
+
+            // an expired code is consumed all the same
+            if (expires <= now)
+                return false;
+            grant = std::move(*owned);
+            return true;
+        }
+
+        if (shard.overflowSize.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock(shard.overflowMutex);
+        auto it = shard.overflow.find(std::string(reinterpret_cast<const char*>(bytes), codeBytes));
+        if (it == shard.overflow.end())
+            return false;
+        bool live = it->second.expires > now;
+        if (live)
+            grant = std::move(it->second);
+        shard.overflow.erase(it);
+        shard.overflowSize.fetch_sub(1, std::memory_order_relaxed);
+        shard.live.fetch_sub(1, std::memory_order_relaxed);
+        return live;
+    }
+
+    size_t ShardedCodeStore::expireBucket(Shard& shard, std::atomic<Node*>& bucket, int64_t current, int64_t now)
+    {
+        size_t expired = 0;
+        Node* node = bucket.exchange(nullptr, std::memory_order_acquire);
+        while (node != nullptr)
+        {
+            Node* next = node->next;
+            Slot& slot = shard.slots[node->slot];
+            if (node->expires > now && slot.word.load(std::memory_order_relaxed) == node->word)
+            {
+                // a higher level's bucket, cascading down
+                shard.schedule(node, current);
+            }
+            else
+            {
+                if (slot.claim(node->word))
+                {
+                    slot.release(node->word);
+                    shard.live.fetch_sub(1, std::memory_order_relaxed);
+                    ++expired;
+                }
+                delete node;
+            }
+            node = next;
+        }
+        return expired;
+    }
+
+    size_t ShardedCodeStore::expire(int64_t now)
+    {
+        size_t expired = 0;
+        for (size_t i = 0; i <= shardMask_; ++i)
+        {
+            Shard& shard = shards_[i];
+            std::unique_lock<std::mutex> lock(shard.expiring, std::try_to_lock);
+            if (!lock.owns_lock())
+                continue;
+
+            int64_t from = shard.current.load(std::memory_order_relaxed);
+            if (now <= from)
+                continue;
+
+            if (now - from >= wheelSpan)
+            {
+                // a whole wheel's time has passed: every bucket is due
+                shard.current.store(now, std::memory_order_relaxed);
+                for (std::atomic<Node*>& bucket : shard.buckets)
+                    expired += expireBucket(shard, bucket, now, now);
+            }
+            else
+            {
+                for (int64_t t = from + 1; t <= now; ++t)
+                {
+                    shard.current.store(t, std::memory_order_relaxed);
+                    if ((t & (level1Span - 1)) == 0)
+                    {
+                        // the higher levels cascade first, so that what they
+                        // hand down for second "t" expires with it
+                        if ((t & (level2Span - 1)) == 0)
+                        {
+                            size_t index = static_cast<size_t>(t >> (level0Bits + levelBits)) & (levelSize - 1);
+                            expired += expireBucket(shard, shard.buckets[level2Base + index], t, now);
+                        }
+                        size_t index = static_cast<size_t>(t >> level0Bits) & (levelSize - 1);
+                        expired += expireBucket(shard, shard.buckets[level1Base + index], t, now);
+                    }
+                    expired += expireBucket(shard, shard.buckets[static_cast<size_t>(t) & (level0Size - 1)], t, now);
+                }
+            }
+
+            if (shard.overflowSize.load(std::memory_order_relaxed) != 0)
+            {
+                std::lock_guard<std::mutex> overflowLock(shard.overflowMutex);
+                for (auto it = shard.overflow.begin(); it != shard.overflow.end();)
+                {
+                    if (it->second.expires > now)
+                    {
+                        ++it;
+                        continue;
+                    }
+                    it = shard.overflow.erase(it);
+                    shard.overflowSize.fetch_sub(1, std::memory_order_relaxed);
+                    shard.live.fetch_sub(1, std::memory_order_relaxed);
+                    ++expired;
+                }
+            }
+        }
+        return expired;
+    }
+
+    size_t ShardedCodeStore::size() const noexcept
+    {
+        size_t total = 0;
+        for (size_t i = 0; i <= shardMask_; ++i)
+            total += shards_[i].live.load(std::memory_order_relaxed);
+        return total;
+    }
+}
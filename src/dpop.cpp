@@ -0,0 +1,456 @@
+#include <ncbi/dpop.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/hash.hpp>
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+
+namespace ncbi
+{
+    namespace
+    {
+        // a proof header carries a whole public key, an RSA-4096 one
+        // taking some 700 characters; payloads hold a handful of claims
+        constexpr size_t maxHeaderSize = 2048;
+        constexpr size_t maxPayloadSize = 2048;
+
+        constexpr size_t keyShards = 16;
+
+        // the proof claims beyond the registered ones, by index into
+        // JWTClaims::custom
+        enum ProofClaim : size_t
+        {
+            htm, htu, ath, nonce
+        };
+
+        const JWTClaimsParser& proofClaimsParser()
+        {
+            static const JWTClaimsParser parser({ "htm", "htu", "ath", "nonce" });
+            return parser;
+        }
+
+        int64_t floorDiv(int64_t a, int64_t b) noexcept
+        {
+            int64_t q = a / b;
+            return q * b > a ? q - 1 : q;
+        }
+
+        // "uri" without its query and fragment, as RFC 9449 section 4.3
+        // compares "htu"
+        std::string_view withoutQuery(std::string_view uri) noexcept
+        {
+            return uri.substr(0, uri.find_first_of("?#"));
+        }
+
+        // unescapes a string value in place; "buf" is the decoded segment
+        // holding it, where unescaping can only shrink the value
+        bool decodeString(const JSONValueView& value, char* buf, std::string_view& text) noexcept
+        {
+            if (value.type() != JSONType::string)
+                return false;
+            std::string_view raw = value.rawString();
+            char* dst = buf + (raw.data() - buf);
+            size_t length;
+            if (!unescapeJSONString(raw, dst, length))
+                return false;
+            text = std::string_view(dst, length);
+            return true;
+        }
+    }
+
+    struct DPoPReplayCache::Shard
+    {
+        struct Generation
+        {
+            int64_t number = INT64_MIN;
+            size_t count = 0;
+            std::unique_ptr<uint64_t[]> hashes;     // allocated on first use; zero marks a free slot
+        };
+
+        std::mutex mutex;
+        std::unique_ptr<Generation[]> ring;
+    };
+
+    DPoPReplayCache::DPoPReplayCache(DPoPReplayCacheOptions options)
+        : options_(options)
+    {
+        if (options_.window.count() <= 0)
+            throw JWTException("DPoPReplayCache: the window must be positive");
+        if (options_.generations < 2)
+            throw JWTException("DPoPReplayCache: at least two generations are needed");
+
+        // rounded up, so the live generations always cover the window
+        int64_t covering = options_.generations - 1;
+        span_ = (options_.window.count() + covering - 1) / covering;
+
+        size_t shards = std::bit_ceil(std::max<size_t>(options_.shards, 1));
+        shards_ = std::make_unique<Shard[]>(shards);
+        shardMask_ = shards - 1;
+        tableLimit_ = std::max<size_t>(1, (options_.capacity + shards - 1) / shards);
+        tableMask_ = std::bit_ceil(2 * tableLimit_) - 1;
+        for (size_t i = 0; i < shards; ++i)
+            shards_[i].ring = std::make_unique<Shard::Generation[]>(options_.generations);
+
+        // "jti" values are chosen by clients; a secret seed keeps them from
+        // steering entries into one shard or colliding on purpose
+        std::random_device rd;
+        seed_ = uint64_t(rd()) << 32 | rd();
+    }
+
+    DPoPReplayCache::~DPoPReplayCache() = default;
+
+    DPoPReplayCache::Result DPoPReplayCache::insert(std::string_view jti, int64_t now) noexcept
+    {
+        uint64_t hash = hash64(jti, seed_);
+        if (hash == 0)
+            hash = 1;
+        Shard& shard = shards_[hash >> 40 & shardMask_];
+
+        const int64_t number = floorDiv(now, span_);
+        const int64_t generations = options_.generations;
+        Shard::Generation& current = shard.ring[static_cast<size_t>(number - floorDiv(number, generations) * generations)];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        // every generation within reach of "now" is live, including any a
+        // caller with a faster clock has already begun
+        for (int64_t i = 0; i < generations; ++i)
+        {
+            const Shard::Generation& generation = shard.ring[i];
+            if (generation.count == 0 || generation.number <= number - generations)
+                continue;
+            for (size_t slot = hash & tableMask_; generation.hashes[slot] != 0; slot = (slot + 1) & tableMask_)
+            {
+                if (generation.hashes[slot] == hash)
+                {
+                    replayed_.fetch_add(1, std::memory_order_relaxed);
+                    return Result::replayed;
+                }
+            }
+        }
+
+        if (current.number != number)
+        {
+            // a clock so far behind that its generation has been reused
+            if (current.number > number)
+            {
+                full_.fetch_add(1, std::memory_order_relaxed);
+                return Result::full;
+            }
+
+            if (current.hashes == nullptr)
+                current.hashes = std::make_unique<uint64_t[]>(tableMask_ + 1);
+            else
+            {
+                std::fill_n(current.hashes.get(), tableMask_ + 1, 0);
+                rotations_.fetch_add(1, std::memory_order_relaxed);
+            }
+            current.number = number;
+            current.count = 0;
+        }
+
+        if (current.count == tableLimit_)
+        {
+            full_.fetch_add(1, std::memory_order_relaxed);
+            return Result::full;
+        }
+
+        size_t slot = hash & tableMask_;
+        while (current.hashes[slot] != 0)
+            slot = (slot + 1) & tableMask_;
+        current.hashes[slot] = hash;
+        ++current.count;
+        fresh_.fetch_add(1, std::memory_order_relaxed);
+        return Result::fresh;
+    }
+
+    DPoPReplayCache::Stats DPoPReplayCache::stats() const noexcept
+    {
+        Stats stats;
+        stats.fresh = fresh_.load(std::memory_order_relaxed);
+        stats.replayed = replayed_.load(std::memory_order_relaxed);
+        stats.full = full_.load(std::memory_order_relaxed);
+        stats.rotations = rotations_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    struct DPoPVerifier::KeyEntry
+    {
+        uint64_t hash = 0;
+        JWTAlg alg = JWTAlg::unknown;
+        std::string jwk;                                // the header member, as sent
+        std::unique_ptr<const JWSVerifier> verifier;
+        std::array<char, jwkThumbprintSize> jkt {};
+    };
+
+    struct DPoPVerifier::KeyShard
+    {
+        std::shared_mutex mutex;
+        std::unique_ptr<std::shared_ptr<const KeyEntry>[]> slots;  // direct-mapped
+    };
+
+    DPoPVerifier::DPoPVerifier(DPoPVerifierOptions options)
+        : options_(std::move(options))
+        , replayCache_(options_.replayCache)
+    {
+        if (options_.maxAge.count() < 0 || options_.clockSkew.count() < 0)
+            throw JWTException("DPoPVerifier: negative age or skew");
+        for (JWTAlg alg : options_.algorithms)
+        {
+            JWTAlgFamily family = algFamily(alg);
+            if (family == JWTAlgFamily::none || family == JWTAlgFamily::hmac)
+                throw JWTException("DPoPVerifier: proofs need an asymmetric algorithm");
+        }
+
+        // a proof stays acceptable from the moment its "iat" is within the
+        // skew until it is "maxAge" old, and its "jti" must be remembered
+        // for as long
+        std::chrono::seconds window = std::max(options_.maxAge + options_.clockSkew, std::chrono::seconds(1));
+        if (replayCache_ == nullptr)
+        {
+            DPoPReplayCacheOptions replayOptions;
+            replayOptions.window = window;
+            ownReplayCache_ = std::make_unique<DPoPReplayCache>(replayOptions);
+            replayCache_ = ownReplayCache_.get();
+        }
+        else if (replayCache_->window() < window)
+            throw JWTException("DPoPVerifier: the replay cache window is shorter than a proof's lifetime");
+
+        keyShards_ = std::make_unique<KeyShard[]>(keyShards);
+        keyShardMask_ = keyShards - 1;
+        size_t slots = std::bit_ceil(std::max<size_t>(1, (options_.keyCacheSize + keyShards - 1) / keyShards));
+        keySlotMask_ = slots - 1;
+        for (size_t i = 0; i < keyShards; ++i)
+            keyShards_[i].slots = std::make_unique<std::shared_ptr<const KeyEntry>[]>(slots);
+
+        std::random_device rd;
+        seed_ = uint64_t(rd()) << 32 | rd();
+    }
+
+    DPoPVerifier::~DPoPVerifier() = default;
+
+    JWTStatus DPoPVerifier::resolveKey(std::string_view jwk, JWTAlg alg, std::shared_ptr<const KeyEntry>& entry) const
+    {
+        uint64_t hash = hash64(jwk, seed_ ^ static_cast<uint64_t>(alg));
+        KeyShard& shard = keyShards_[hash >> 40 & keyShardMask_];
+        size_t slot = hash & keySlotMask_;
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const std::shared_ptr<const KeyEntry>& cached = shard.slots[slot];
+            if (cached != nullptr && cached->hash == hash && cached->alg == alg && cached->jwk == jwk)
+            {
+                entry = cached;
+                return JWTStatus::ok;
+            }
+        }
+
+        // a proof key is public by definition; one with its private part
+        // is refused rather than imported
+        JSONValueView privatePart;
+        if (findJSONMember(jwk, "d", privatePart))
+            return JWTStatus::unknownKey;
+
+        JWK key;
+        try
+        {
+            key = JWK::parse(jwk);
+        }
+        catch (const JWTException&)
+        {
+            return JWTStatus::badJSON;
+        }
+        if (!key.accepts(alg))
+            return JWTStatus::algMismatch;
+
+        auto imported = std::make_shared<KeyEntry>();
+        try
+        {
+            imported->verifier = makeJWSVerifier(key, alg);
+            std::string thumbprint = jwkThumbprint(key);
+            std::copy(thumbprint.begin(), thumbprint.end(), imported->jkt.begin());
+        }
+        catch (const JWTException&)
+        {
+            return JWTStatus::unknownKey;
+        }
+        imported->hash = hash;
+        imported->alg = alg;
+        imported->jwk.assign(jwk);
+
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            shard.slots[slot] = imported;
+        }
+        entry = std::move(imported);
+        return JWTStatus::ok;
+    }
+
+    JWTStatus DPoPVerifier::verify(std::string_view proof, const DPoPRequest& request, int64_t now,
+        DPoPProof& result) const
+    {
+        return verifyProof(proof, request, now, {}, result);
+    }
+
+    JWTStatus DPoPVerifier::verify(const JWTVerifier& tokens, std::string_view accessToken, std::string_view proof,
+        const DPoPRequest& request, int64_t now, std::shared_ptr<const VerifiedToken>& result) const
+    {
+        JWTStatus status = tokens.verify(accessToken, now, result);
+        if (status != JWTStatus::ok)
+            return status;
+
+        // the key the token is bound to, RFC 9449 section 6.1
+        JSONValueView cnf, jkt;
+        if (!findJSONMember(result->payload, "cnf", cnf) || cnf.type() != JSONType::object ||
+            !findJSONMember(cnf.raw(), "jkt", jkt))
+        {
+            status = JWTStatus::missingClaim;
+        }
+        else if (jkt.type() != JSONType::string)
+            status = JWTStatus::badClaim;
+        else if (!jkt.isPlainString())
+            status = JWTStatus::rejectedClaim;      // base64url never needs escaping
+        else
+        {
+            DPoPRequest bound = request;
+            bound.accessToken = accessToken;
+            DPoPProof accepted;
+            status = verifyProof(proof, bound, now, jkt.rawString(), accepted);
+        }
+
+        if (status != JWTStatus::ok)
+            result.reset();
+        return status;
+    }
+
+    JWTStatus DPoPVerifier::verifyProof(std::string_view proof, const DPoPRequest& request, int64_t now,
+        std::string_view jkt, DPoPProof& result) const
+    {
+        JWTView view;
+        JWTStatus status = JWTView::parse(proof, view);
+        if (status != JWTStatus::ok)
+            return status;
+
+        if (view.headerSize() > maxHeaderSize)
+            return JWTStatus::bufferTooSmall;
+        char headerBuf[maxHeaderSize];
+        std::string_view headerJSON;
+        JWTHeader header;
+        if ((status = view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON)) != JWTStatus::ok ||
+            (status = JWTHeader::parse(headerJSON, header)) != JWTStatus::ok)
+        {
+            return status;
+        }
+
+        if (!header.typ.stringEquals("dpop+jwt"))
+            return JWTStatus::rejectedClaim;
+        if (header.hasCrit)
+            return JWTStatus::unsupportedCrit;
+        JWTAlgFamily family = algFamily(header.alg);
+        if (header.alg == JWTAlg::unknown || family == JWTAlgFamily::none || family == JWTAlgFamily::hmac ||
+            (!options_.algorithms.empty() &&
+                std::find(options_.algorithms.begin(), options_.algorithms.end(), header.alg) == options_.algorithms.end()))
+        {
+            return JWTStatus::unsupportedAlg;
+        }
+
+        JSONValueView jwk;
+        if (!findJSONMember(header.json, "jwk", jwk))
+            return JWTStatus::missingClaim;
+        if (jwk.type() != JSONType::object)
+            return JWTStatus::badJSON;
+        std::shared_ptr<const KeyEntry> key;
+        if ((status = resolveKey(jwk.raw(), header.alg, key)) != JWTStatus::ok)
+            return status;
+
+        unsigned char signature[maxSignatureSize];
+        size_t signatureSize;
+        if ((status = view.decodeSignature(signature, sizeof signature, signatureSize)) != JWTStatus::ok)
+            return status;
+        if (!key->verifier->verify(view.signingInput(), signature, signatureSize))
+            return JWTStatus::badSignature;
+
+        if (view.payloadSize() > maxPayloadSize)
+            return JWTStatus::bufferTooSmall;
+        char payloadBuf[maxPayloadSize];
+        std::string_view payloadJSON;
+        JWTClaims claims;
+        if ((status = view.decodePayload(payloadBuf, sizeof payloadBuf, payloadJSON)) != JWTStatus::ok ||
+            (status = proofClaimsParser().parse(payloadJSON, claims)) != JWTStatus::ok)
+        {
+            return status;
+        }
+
+        if (!claims.has(JWTClaim::jti) || !claims.has(JWTClaim::iat) || !claims.hasCustom(htm) ||
+            !claims.hasCustom(htu))
+        {
+            return JWTStatus::missingClaim;
+        }
+
+        if (claims.iat < now - options_.maxAge.count())
+            return JWTStatus::expired;
+        if (claims.iat > now + options_.clockSkew.count())
+            return JWTStatus::notYetValid;
+
+        if (claims.custom[htm].type() != JSONType::string)
+            return JWTStatus::badClaim;
+        if (!claims.custom[htm].stringEquals(request.method))
+            return JWTStatus::rejectedClaim;
+
+        std::string_view uri;
+        if (!decodeString(claims.custom[htu], payloadBuf, uri))
+            return JWTStatus::badClaim;
+        if (withoutQuery(uri) != withoutQuery(request.uri))
+            return JWTStatus::rejectedClaim;
+
+        if (!request.accessToken.empty())
+        {
+            if (!claims.hasCustom(ath))
+                return JWTStatus::missingClaim;
+            unsigned char digest[SHA256_DIGEST_LENGTH];
+            SHA256(reinterpret_cast<const unsigned char*>(request.accessToken.data()), request.accessToken.size(), digest);
+            char expected[base64urlEncodedSize(SHA256_DIGEST_LENGTH)];
+            base64urlEncode(digest, sizeof digest, expected);
+            if (claims.custom[ath].type() != JSONType::string)
+                return JWTStatus::badClaim;
+            if (!claims.custom[ath].stringEquals(std::string_view(expected, sizeof expected)))
+                return JWTStatus::rejectedClaim;
+        }
+
+        if (!request.nonce.empty())
+        {
+            if (!claims.hasCustom(nonce))
+                return JWTStatus::missingClaim;
+            if (claims.custom[nonce].type() != JSONType::string)
+                return JWTStatus::badClaim;
+            if (!claims.custom[nonce].stringEquals(request.nonce))
+                return JWTStatus::rejectedClaim;
+        }
+
+        if (!jkt.empty() && jkt != std::string_view(key->jkt.data(), key->jkt.size()))
+            return JWTStatus::rejectedClaim;
+
+        // last, so that only a proof accepted in every other respect
+        // uses up its "jti"
+        std::string_view jti;
+        if (!decodeString(claims.jti, payloadBuf, jti))
+            return JWTStatus::badClaim;
+        if (replayCache_->insert(jti, now) != DPoPReplayCache::Result::fresh)
+            return JWTStatus::replayed;
+
+        result.jkt = key->jkt;
+        result.iat = claims.iat;
+        return JWTStatus::ok;
+    }
+}
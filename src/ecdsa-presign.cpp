@@ -0,0 +1,155 @@
+// ECDSA_sign_setup() and ECDSA_do_sign_ex() have no EVP equivalent in
+// OpenSSL 3.0
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "ecdsa-presign.hpp"
+
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+
+#include <unistd.h>
+
+#include <vector>
+
+namespace ncbi::detail
+{
+    namespace
+    {
+        struct ECKeyFree { void operator()(EC_KEY* p) const noexcept { EC_KEY_free(p); } };
+        struct MDCtxFree { void operator()(EVP_MD_CTX* p) const noexcept { EVP_MD_CTX_free(p); } };
+        struct MDFree { void operator()(EVP_MD* p) const noexcept { EVP_MD_free(p); } };
+        struct ECDSASigFree { void operator()(ECDSA_SIG* p) const noexcept { ECDSA_SIG_free(p); } };
+
+        const char* digestName(JWTAlg alg) noexcept
+        {
+            switch (alg)
+            {
+            case JWTAlg::ES256: return "SHA256";
+            case JWTAlg::ES384: return "SHA384";
+            case JWTAlg::ES512: return "SHA512";
+            default:            return nullptr;
+            }
+        }
+
+        // k^-1 and r for one signature; secret, and cleared when dropped
+        struct Nonce
+        {
+            BIGNUM* kinv = nullptr;
+            BIGNUM* r = nullptr;
+        };
+
+        void clearNonce(Nonce& nonce) noexcept
+        {
+            BN_clear_free(nonce.kinv);
+            BN_clear_free(nonce.r);
+            nonce = Nonce();
+        }
+
+        class PresignedECDSAContext final : public SigningContext
+        {
+        public:
+            PresignedECDSAContext(EVP_PKEY* pkey, JWTAlg alg, size_t coordinateSize, size_t reserve)
+                : key_(EVP_PKEY_get1_EC_KEY(pkey))
+                , md_(EVP_MD_fetch(nullptr, digestName(alg), nullptr))
+                , mdCtx_(EVP_MD_CTX_new())
+                , coordinateSize_(coordinateSize)
+                , capacity_(reserve)
+            {
+                if (key_ == nullptr || md_ == nullptr || mdCtx_ == nullptr)
+                    throw JWTException("PrivateKeySigner: cannot set up ECDSA nonce reserve");
+                nonces_.reserve(capacity_);
+            }
+
+            ~PresignedECDSAContext() override
+            {
+                discard();
+            }
+
+            bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept override
+            {
+                unsigned char digest[EVP_MAX_MD_SIZE];
+                unsigned int digestSize = 0;
+                if (EVP_DigestInit_ex2(mdCtx_.get(), md_.get(), nullptr) != 1 ||
+                    EVP_DigestUpdate(mdCtx_.get(), signingInput.data(), signingInput.size()) != 1 ||
+                    EVP_DigestFinal_ex(mdCtx_.get(), digest, &digestSize) != 1)
+                {
+                    return false;
+                }
+
+                // a nonce used twice reveals the key; a forked child holds
+                // copies of its parent's, so it must not touch them
+                if (pid_ != ::getpid())
+                    discard();
+
+                // an empty reserve falls back to a fresh nonce, which is
+                // what ECDSA_do_sign_ex() draws when given none
+                Nonce nonce;
+                if (!nonces_.empty())
+                {
+                    nonce = nonces_.back();
+                    nonces_.pop_back();
+                }
+                std::unique_ptr<ECDSA_SIG, ECDSASigFree> sig(ECDSA_do_sign_ex(digest, static_cast<int>(digestSize),
+                    nonce.kinv, nonce.r, key_.get()));
+                clearNonce(nonce);
+                if (sig == nullptr)
+                    return false;
+
+                int width = static_cast<int>(coordinateSize_);
+                if (BN_bn2binpad(ECDSA_SIG_get0_r(sig.get()), signature, width) != width ||
+                    BN_bn2binpad(ECDSA_SIG_get0_s(sig.get()), signature + width, width) != width)
+                {
+                    return false;
+                }
+                size = 2 * coordinateSize_;
+                return true;
+            }
+
+            size_t precompute() noexcept override
+            {
+                if (pid_ != ::getpid())
+                    discard();
+
+                size_t added = 0;
+                while (nonces_.size() < capacity_)
+                {
+                    Nonce nonce;
+                    if (ECDSA_sign_setup(key_.get(), nullptr, &nonce.kinv, &nonce.r) != 1)
+                    {
+                        clearNonce(nonce);
+                        break;
+                    }
+                    nonces_.push_back(nonce);
+                    ++added;
+                }
+                return added;
+            }
+
+        private:
+            void discard() noexcept
+            {
+                for (Nonce& nonce : nonces_)
+                    clearNonce(nonce);
+                nonces_.clear();
+                pid_ = ::getpid();
+            }
+
+            std::unique_ptr<EC_KEY, ECKeyFree> key_;
+            std::unique_ptr<EVP_MD, MDFree> md_;
+            std::unique_ptr<EVP_MD_CTX, MDCtxFree> mdCtx_;
+            size_t coordinateSize_;
+            size_t capacity_;
+            std::vector<Nonce> nonces_;
+            pid_t pid_ = ::getpid();
+        };
+    }
+
+    std::unique_ptr<SigningContext> newPresignedECDSAContext(EVP_PKEY* pkey, JWTAlg alg,
+        size_t coordinateSize, size_t reserve)
+    {
+        return std::make_unique<PresignedECDSAContext>(pkey, alg, coordinateSize, reserve);
+    }
+}
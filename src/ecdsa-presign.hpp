@@ -0,0 +1,26 @@
+#pragma once
+
+// ECDSA signing with nonces prepared ahead of time, private to the signer
+//
+// the per-signature cost of ECDSA is dominated by the scalar
+// multiplication k·G; it needs neither the message nor the key's secret,
+// so the pair (k^-1, r) can be computed while a thread is idle and spent
+// later on exactly one signature
+// OpenSSL exposes this only through its deprecated EC_KEY interface,
+// which is confined to the one translation unit implementing it
+
+#include <ncbi/jws-signer.hpp>
+
+#include <openssl/evp.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace ncbi::detail
+{
+    // a context for "alg" (ES256, ES384 or ES512) keeping up to "reserve"
+    // nonces, which precompute() refills; throws JWTException if the key
+    // cannot be used through EC_KEY
+    std::unique_ptr<SigningContext> newPresignedECDSAContext(EVP_PKEY* pkey, JWTAlg alg,
+        size_t coordinateSize, size_t reserve);
+}
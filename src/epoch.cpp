@@ -0,0 +1,190 @@
+#include <ncbi/epoch.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ncbi
+{
+    namespace
+    {
+        // one per thread that has ever read; slots are recycled when their
+        // thread exits and are never freed, so scanning the list is safe
+        // without any synchronization beyond the atomics themselves
+        struct alignas(64) ReaderSlot
+        {
+            std::atomic<uint64_t> epoch { 0 };      // 0 while outside any guard
+            std::atomic<bool> owned { false };
+            ReaderSlot* next = nullptr;
+        };
+
+        struct Retired
+        {
+            void* object;
+            void (*deleter)(void*);
+            uint64_t epoch;
+        };
+
+        class EpochDomain
+        {
+        public:
+            static EpochDomain& instance() noexcept
+            {
+                // leaked on purpose: threads may still leave guards while
+                // static destructors run
+                static EpochDomain* domain = new EpochDomain;
+                return *domain;
+            }
+
+            ReaderSlot* acquireSlot()
+            {
+                for (ReaderSlot* slot = slots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+                {
+                    bool expected = false;
+                    if (!slot->owned.load(std::memory_order_relaxed) &&
+                        slot->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        return slot;
+                    }
+                }
+
+                auto* slot = new ReaderSlot;
+                slot->owned.store(true, std::memory_order_relaxed);
+                ReaderSlot* head = slots_.load(std::memory_order_relaxed);
+                do
+                    slot->next = head;
+                while (!slots_.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+                return slot;
+            }
+
+            void enter(ReaderSlot& slot) noexcept
+            {
+                // the seq_cst store orders the announcement before the
+                // reader's subsequent pointer loads, pairing with the
+                // writer's exchange and scan in retire()
+                slot.epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+
+            void leave(ReaderSlot& slot) noexcept
+            {
+                slot.epoch.store(0, std::memory_order_release);
+            }
+
+            void retire(void* object, void (*deleter)(void*))
+            {
+                std::vector<Retired> ready;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+
+                    // readers announced at or before this epoch may have
+                    // loaded the pointer that was just replaced; later
+                    // ones cannot
+                    uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+                    retired_.push_back(Retired { object, deleter, epoch });
+                    collect(ready);
+                }
+                destroy(ready);
+            }
+
+            void reclaim()
+            {
+                std::vector<Retired> ready;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    collect(ready);
+                }
+                destroy(ready);
+            }
+
+        private:
+            uint64_t oldestActive() const noexcept
+            {
+                uint64_t oldest = UINT64_MAX;
+                for (ReaderSlot* slot = slots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+                {
+                    uint64_t e = slot->epoch.load(std::memory_order_seq_cst);
+                    if (e != 0 && e < oldest)
+                        oldest = e;
+                }
+                return oldest;
+            }
+
+            // moves every object no active reader can reach into "ready"
+            void collect(std::vector<Retired>& ready)
+            {
+                uint64_t oldest = oldestActive();
+                auto keep = retired_.begin();
+                for (auto it = retired_.begin(); it != retired_.end(); ++it)
+                {
+                    if (it->epoch < oldest)
+                        ready.push_back(*it);
+                    else
+                        *keep++ = *it;
+                }
+                retired_.erase(keep, retired_.end());
+            }
+
+            static void destroy(const std::vector<Retired>& ready)
+            {
+                for (const Retired& r : ready)
+                    r.deleter(r.object);
+            }
+
+            std::atomic<ReaderSlot*> slots_ { nullptr };
+            std::atomic<uint64_t> epoch_ { 1 };
+
+            std::mutex mutex_;
+            std::vector<Retired> retired_;
+        };
+
+        struct ThreadReader
+        {
+            ReaderSlot* slot = nullptr;
+            unsigned nesting = 0;
+
+            ~ThreadReader()
+            {
+                if (slot != nullptr)
+                {
+                    slot->epoch.store(0, std::memory_order_release);
+                    slot->owned.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        thread_local ThreadReader threadReader;
+    }
+
+    EpochGuard::EpochGuard() noexcept
+    {
+        ThreadReader& reader = threadReader;
+        if (reader.nesting++ == 0)
+        {
+            EpochDomain& domain = EpochDomain::instance();
+            if (reader.slot == nullptr)
+            {
+                // first read on this thread; a failure to allocate a
+                // slot here is treated like any other out-of-memory abort
+                reader.slot = domain.acquireSlot();
+            }
+            domain.enter(*reader.slot);
+        }
+    }
+
+    EpochGuard::~EpochGuard()
+    {
+        ThreadReader& reader = threadReader;
+        if (--reader.nesting == 0)
+            EpochDomain::instance().leave(*reader.slot);
+    }
+
+    void retireEpochObject(void* object, void (*deleter)(void*))
+    {
+        EpochDomain::instance().retire(object, deleter);
+    }
+
+    void reclaimEpochObjects()
+    {
+        EpochDomain::instance().reclaim();
+    }
+}
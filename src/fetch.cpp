@@ -0,0 +1,88 @@
+#include <ncbi/fetch.hpp>
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+namespace ncbi
+{
+    namespace
+    {
+        // "lower" must already be lower case
+        bool equalsIgnoreCase(std::string_view text, std::string_view lower) noexcept
+        {
+            if (text.size() != lower.size())
+                return false;
+            for (size_t i = 0; i < text.size(); ++i)
+            {
+                char ch = text[i] >= 'A' && text[i] <= 'Z' ? static_cast<char>(text[i] + 32) : text[i];
+                if (ch != lower[i])
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    FetchResponse Fetcher::post(const std::string&, const FetchRequest&)
+    {
+        return FetchResponse();
+    }
+
+    FetchResponse FileFetcher::get(const std::string& uri)
+    {
+        constexpr std::string_view scheme = "file://";
+        std::string path = uri.compare(0, scheme.size(), scheme) == 0
+            ? uri.substr(scheme.size())
+            : uri;
+
+        FetchResponse response;
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            response.status = 404;
+            return response;
+        }
+
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        response.status = 200;
+        response.body = contents.str();
+        return response;
+    }
+
+    std::optional<std::chrono::seconds> parseCacheControlMaxAge(std::string_view header) noexcept
+    {
+        std::optional<std::chrono::seconds> result;
+
+        while (!header.empty())
+        {
+            size_t comma = header.find(',');
+            std::string_view directive = header.substr(0, comma);
+            header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+            while (!directive.empty() && (directive.front() == ' ' || directive.front() == '\t'))
+                directive.remove_prefix(1);
+            while (!directive.empty() && (directive.back() == ' ' || directive.back() == '\t'))
+                directive.remove_suffix(1);
+
+            if (equalsIgnoreCase(directive, "no-store") || equalsIgnoreCase(directive, "no-cache"))
+                return std::chrono::seconds(0);
+
+            size_t eq = directive.find('=');
+            if (eq == std::string_view::npos || !equalsIgnoreCase(directive.substr(0, eq), "max-age"))
+                continue;
+
+            std::string_view value = directive.substr(eq + 1);
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                value = value.substr(1, value.size() - 2);
+
+            long long seconds;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+            if (ec == std::errc() && ptr == value.data() + value.size() && seconds >= 0)
+                result = std::chrono::seconds(seconds);
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,148 @@
+#include <ncbi/grant-store.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include "random-reserve.hpp"
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstring>
+
+namespace ncbi
+{
+    namespace
+    {
+        // bumped in the child of every fork()
+        std::atomic<unsigned> forks { 0 };
+
+        struct Reserve
+        {
+            unsigned char bytes[1024];
+            size_t used = sizeof bytes;
+            unsigned forks = 0;
+
+            ~Reserve() { OPENSSL_cleanse(bytes, sizeof bytes); }
+        };
+    }
+
+    bool detail::takeRandom(unsigned char* out, size_t n) noexcept
+    {
+        static const bool registered = pthread_atfork(nullptr, nullptr,
+            [] { forks.fetch_add(1, std::memory_order_relaxed); }) == 0;
+        thread_local Reserve reserve;
+
+        unsigned seen = forks.load(std::memory_order_relaxed);
+        if (!registered || n > sizeof reserve.bytes)
+            return RAND_bytes(out, static_cast<int>(n)) == 1;
+        if (reserve.used + n > sizeof reserve.bytes || reserve.forks != seen)
+        {
+            if (RAND_bytes(reserve.bytes, sizeof reserve.bytes) != 1)
+                return false;
+            reserve.used = 0;
+            reserve.forks = seen;
+        }
+        std::memcpy(out, reserve.bytes + reserve.used, n);
+        OPENSSL_cleanse(reserve.bytes + reserve.used, n);
+        reserve.used += n;
+        return true;
+    }
+
+    std::string randomCredential()
+    {
+        unsigned char bytes[32];
+        if (!detail::takeRandom(bytes, sizeof bytes))
+            throw JWTException("randomCredential: no randomness available");
+
+        std::string out(base64urlEncodedSize(sizeof bytes), '\0');
+        base64urlEncode(bytes, sizeof bytes, out.data());
+        return out;
+    }
+
+    bool scopeWithin(std::string_view requested, std::string_view granted) noexcept
+    {
+        auto contains = [granted](std::string_view value)
+        {
+            for (std::string_view rest = granted; !rest.empty(); )
+            {
+                size_t end = rest.find(' ');
+                if (rest.substr(0, end) == value)
+                    return true;
+                if (end == std::string_view::npos)
+                    break;
+                rest.remove_prefix(end + 1);
+            }
+            return false;
+        };
+
+        while (true)
+        {
+            size_t end = requested.find(' ');
+            std::string_view value = requested.substr(0, end);
+            if (value.empty() || !contains(value))
+                return false;
+            if (end == std::string_view::npos)
+                return true;
+            requested.remove_prefix(end + 1);
+        }
+    }
+
+    std::string MemoryCodeStore::issue(AuthorizationGrant grant)
+    {
+        std::string code = randomCredential();
+        std::lock_guard<std::mutex> lock(mutex_);
+        codes_.emplace(code, std::move(grant));
+        return code;
+    }
+
+    bool MemoryCodeStore::consume(std::string_view code, int64_t now, AuthorizationGrant& grant)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = codes_.find(std::string(code));
+        if (it == codes_.end())
+            return false;
+
+        // an expired code is consumed all the same
+        bool live = it->second.expires > now;
+        if (live)
+            grant = std::move(it->second);
+        codes_.erase(it);
+        return live;
+    }
+
+    std::string MemoryRefreshTokenStore::issue(AuthorizationGrant grant)
+    {
+        std::string token = randomCredential();
+        std::lock_guard<std::mutex> lock(mutex_);
+        tokens_.emplace(token, std::move(grant));
+        return token;
+    }
+
+    RotateResult MemoryRefreshTokenStore::rotate(std::string_view token, std::string_view clientId,
+        std::string_view scope, int64_t now, AuthorizationGrant& grant, std::string& successor)
+    {
+        std::string next = randomCredential();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tokens_.find(std::string(token));
+        if (it == tokens_.end() || it->second.clientId != clientId)
+            return RotateResult::invalidGrant;
+        if (it->second.expires <= now)
+        {
+            tokens_.erase(it);
+            return RotateResult::invalidGrant;
+        }
+        if (!scope.empty() && !scopeWithin(scope, it->second.scope))
+            return RotateResult::invalidScope;
+
+        grant = it->second;
+        auto node = tokens_.extract(it);
+        node.key() = next;
+        tokens_.insert(std::move(node));
+        successor = std::move(next);
+        return RotateResult::rotated;
+    }
+}
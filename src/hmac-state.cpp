@@ -0,0 +1,119 @@
+// SHA256_CTX and SHA512_CTX are the only hash states OpenSSL 3.0 lets a
+// caller copy without allocating
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "hmac-state.hpp"
+
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/crypto.h>
+
+#include <cstring>
+
+namespace ncbi::detail
+{
+    namespace
+    {
+        constexpr size_t maxBlockSize = SHA512_CBLOCK;
+
+        size_t blockSize(JWTAlg alg) noexcept
+        {
+            return alg == JWTAlg::HS256 ? SHA256_CBLOCK : SHA512_CBLOCK;
+        }
+
+        // the state after absorbing one block
+        void absorb(JWTAlg alg, const unsigned char* block, SHA256_CTX& sha256, SHA512_CTX& sha512) noexcept
+        {
+            switch (alg)
+            {
+            case JWTAlg::HS256: SHA256_Init(&sha256); SHA256_Update(&sha256, block, SHA256_CBLOCK); break;
+            case JWTAlg::HS384: SHA384_Init(&sha512); SHA384_Update(&sha512, block, SHA512_CBLOCK); break;
+            default:            SHA512_Init(&sha512); SHA512_Update(&sha512, block, SHA512_CBLOCK); break;
+            }
+        }
+    }
+
+    HMACKey::HMACKey(JWTAlg alg, std::string_view secret)
+        : alg_(alg)
+        , size_(algDigestSize(alg))
+    {
+        if (algFamily(alg) != JWTAlgFamily::hmac)
+            throw JWTException("HMACKey: not an HMAC algorithm");
+
+        // RFC 2104: a key longer than the block is replaced by its hash,
+        // a shorter one padded with zeros
+        unsigned char key[maxBlockSize] = {};
+        const auto* data = reinterpret_cast<const unsigned char*>(secret.data());
+        if (secret.size() > blockSize(alg))
+        {
+            switch (alg)
+            {
+            case JWTAlg::HS256: SHA256(data, secret.size(), key); break;
+            case JWTAlg::HS384: SHA384(data, secret.size(), key); break;
+            default:            SHA512(data, secret.size(), key); break;
+            }
+        }
+        else
+        {
+            std::memcpy(key, data, secret.size());
+        }
+
+        unsigned char pad[maxBlockSize];
+        for (size_t i = 0; i < maxBlockSize; ++i)
+            pad[i] = key[i] ^ 0x36;
+        absorb(alg, pad, inner_.sha256, inner_.sha512);
+        for (size_t i = 0; i < maxBlockSize; ++i)
+            pad[i] = key[i] ^ 0x5c;
+        absorb(alg, pad, outer_.sha256, outer_.sha512);
+
+        OPENSSL_cleanse(key, sizeof key);
+        OPENSSL_cleanse(pad, sizeof pad);
+    }
+
+    HMACKey::~HMACKey()
+    {
+        OPENSSL_cleanse(&inner_, sizeof inner_);
+        OPENSSL_cleanse(&outer_, sizeof outer_);
+    }
+
+    void HMACKey::mac(std::string_view message, unsigned char* out) const noexcept
+    {
+        unsigned char digest[SHA512_DIGEST_LENGTH];
+        if (alg_ == JWTAlg::HS256)
+        {
+            SHA256_CTX ctx = inner_.sha256;
+            SHA256_Update(&ctx, message.data(), message.size());
+            SHA256_Final(digest, &ctx);
+            ctx = outer_.sha256;
+            SHA256_Update(&ctx, digest, SHA256_DIGEST_LENGTH);
+            SHA256_Final(out, &ctx);
+        }
+        else if (alg_ == JWTAlg::HS384)
+        {
+            SHA512_CTX ctx = inner_.sha512;
+            SHA384_Update(&ctx, message.data(), message.size());
+            SHA384_Final(digest, &ctx);
+            ctx = outer_.sha512;
+            SHA384_Update(&ctx, digest, SHA384_DIGEST_LENGTH);
+            SHA384_Final(out, &ctx);
+        }
+        else
+        {
+            SHA512_CTX ctx = inner_.sha512;
+            SHA512_Update(&ctx, message.data(), message.size());
+            SHA512_Final(digest, &ctx);
+            ctx = outer_.sha512;
+            SHA512_Update(&ctx, digest, SHA512_DIGEST_LENGTH);
+            SHA512_Final(out, &ctx);
+        }
+    }
+
+    bool HMACKey::verify(std::string_view message, const unsigned char* mac, size_t macSize) const noexcept
+    {
+        if (macSize != size_)
+            return false;
+        unsigned char expected[SHA512_DIGEST_LENGTH];
+        this->mac(message, expected);
+        return CRYPTO_memcmp(expected, mac, size_) == 0;
+    }
+}
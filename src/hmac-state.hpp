@@ -0,0 +1,54 @@
+#pragma once
+
+// HMAC with the key absorbed ahead of time, private to HMACVerifier and
+// HMACSigner
+//
+// HMAC(K, m) = H((K ^ opad) || H((K ^ ipad) || m)), and the hash states
+// after the two padded key blocks depend only on K; they are computed once
+// per key and copied onto the stack for each MAC, which then hashes only
+// the message and the inner digest, with no allocation or provider lookup
+// the copyable states are those of OpenSSL's deprecated SHA256_CTX and
+// SHA512_CTX interface, whose block functions are chosen for the CPU
+// (SHA-NI, AVX2, AVX or SSSE3 for SHA-256); its use is confined to
+// hmac-state.cpp
+
+#include <ncbi/jwa.hpp>
+
+#include <openssl/sha.h>
+
+#include <cstddef>
+#include <string_view>
+
+namespace ncbi::detail
+{
+    class HMACKey
+    {
+    public:
+        // "alg" is HS256, HS384 or HS512; throws JWTException otherwise
+        HMACKey(JWTAlg alg, std::string_view secret);
+        ~HMACKey();
+
+        HMACKey(const HMACKey&) = delete;
+        HMACKey& operator=(const HMACKey&) = delete;
+
+        size_t size() const noexcept { return size_; }
+
+        // writes size() bytes to "out"
+        void mac(std::string_view message, unsigned char* out) const noexcept;
+
+        // compares in time independent of where the MACs differ
+        bool verify(std::string_view message, const unsigned char* mac, size_t macSize) const noexcept;
+
+    private:
+        union State
+        {
+            SHA256_CTX sha256;
+            SHA512_CTX sha512;      // SHA-384 too
+        };
+
+        State inner_;
+        State outer_;
+        JWTAlg alg_;
+        size_t size_;
+    };
+}
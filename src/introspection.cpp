@@ -0,0 +1,271 @@
+#include <ncbi/introspection.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/hash.hpp>
+
+#include <algorithm>
+#include <new>
+#include <bit>
+#include <random>
+
+namespace ncbi
+{
+    namespace
+    {
+        // application/x-www-form-urlencoded (HTML, as RFC 6749 appendix B uses it)
+        void appendFormEncoded(std::string& out, std::string_view text)
+        {
+            static constexpr char hex[] = "0123456789ABCDEF";
+            for (char ch : text)
+            {
+                unsigned char c = static_cast<unsigned char>(ch);
+                if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                    c == '-' || c == '.' || c == '_' || c == '*')
+                {
+                    out += ch;
+                }
+                else if (c == ' ')
+                    out += '+';
+                else
+                {
+                    out += '%';
+                    out += hex[c >> 4];
+                    out += hex[c & 15];
+                }
+            }
+        }
+
+        // standard base64 with padding, derived from the base64url codec
+        std::string base64(std::string_view data)
+        {
+            std::string out(base64urlEncodedSize(data.size()), '\0');
+            base64urlEncode(data.data(), data.size(), out.data());
+            for (char& ch : out)
+            {
+                if (ch == '-')
+                    ch = '+';
+                else if (ch == '_')
+                    ch = '/';
+            }
+            out.append((4 - out.size() % 4) % 4, '=');
+            return out;
+        }
+
+        // RFC 6749 section 2.3.1: both halves are form-encoded first
+        std::string basicAuthorization(std::string_view clientId, std::string_view secret)
+        {
+            if (clientId.empty())
+                return std::string();
+
+            std::string credentials;
+            appendFormEncoded(credentials, clientId);
+            credentials += ':';
+            appendFormEncoded(credentials, secret);
+            return "Basic " + base64(credentials);
+        }
+
+        const JWTClaimsParser& responseParser()
+        {
+            static const JWTClaimsParser parser({ "active", "client_id", "username", "token_type" });
+            return parser;
+        }
+
+        int64_t unixNow() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    IntrospectionClient::IntrospectionClient(std::string endpoint, std::shared_ptr<Fetcher> fetcher,
+        IntrospectionOptions options)
+        : endpoint_(std::move(endpoint))
+        , fetcher_(std::move(fetcher))
+        , options_(std::move(options))
+        , authorization_(basicAuthorization(options_.clientId, options_.clientSecret))
+    {
+        if (fetcher_ == nullptr)
+            throw JWTException("IntrospectionClient: no fetcher");
+
+        size_t shards = std::bit_ceil(std::max<size_t>(options_.shards, 1));
+        shards_ = std::make_unique<Shard[]>(shards);
+        shardMask_ = shards - 1;
+        shardCapacity_ = std::max<size_t>(1, (options_.capacity + shards - 1) / shards);
+
+        std::random_device rd;
+        seed_ = uint64_t(rd()) << 32 | rd();
+    }
+
+    IntrospectionClient::~IntrospectionClient() = default;
+
+    IntrospectionClient::Outcome IntrospectionClient::request(std::string_view token)
+    {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+
+        FetchRequest request;
+        request.contentType = "application/x-www-form-urlencoded";
+        request.authorization = authorization_;
+        request.body = "token=";
+        appendFormEncoded(request.body, token);
+        if (!options_.tokenTypeHint.empty())
+        {
+            request.body += "&token_type_hint=";
+            appendFormEncoded(request.body, options_.tokenTypeHint);
+        }
+
+        FetchResponse response = fetcher_->post(endpoint_, request);
+        if (response.status != 200)
+            return { JWTStatus::serverError, nullptr };
+
+        auto result = std::make_shared<IntrospectionResult>();
+        result->body = std::move(response.body);
+
+        // "active" is the one member RFC 7662 requires
+        const JSONValueView& active = result->claims.custom[IntrospectionResult::activeClaim];
+        if (responseParser().parse(result->body, result->claims) != JWTStatus::ok ||
+            !result->claims.hasCustom(IntrospectionResult::activeClaim) ||
+            !active.getBool(result->active))
+        {
+            return { JWTStatus::serverError, nullptr };
+        }
+
+        // an active token past its "exp" is inactive whatever the server says
+        if (result->active && result->claims.exp <= unixNow())
+            result->active = false;
+
+        return { result->active ? JWTStatus::ok : JWTStatus::inactive, std::move(result) };
+    }
+
+    void IntrospectionClient::store(Shard& shard, uint64_t hash, std::string_view token, const Outcome& outcome)
+    {
+        if (outcome.result == nullptr)
+            return;
+
+        Clock::time_point now = Clock::now();
+        std::chrono::seconds ttl = outcome.result->active ? options_.activeTTL : options_.inactiveTTL;
+        if (outcome.result->active)
+        {
+            int64_t left = outcome.result->claims.exp - unixNow();
+            ttl = std::min(ttl, std::chrono::seconds(std::max<int64_t>(left, 0)));
+        }
+        if (ttl <= std::chrono::seconds(0))
+            return;
+
+        // evict in insertion order; with bounded TTLs the oldest entries
+        // are also the nearest to expiry
+        while (shard.entries.size() >= shardCapacity_ && !shard.order.empty())
+        {
+            shard.entries.erase(shard.order.front());
+            shard.order.pop_front();
+        }
+
+        auto [it, inserted] = shard.entries.insert_or_assign(hash, Entry { std::string(token), outcome.result, now + ttl });
+        (void)it;
+        if (inserted)
+            shard.order.push_back(hash);
+    }
+
+    bool IntrospectionClient::findCached(Shard& shard, uint64_t hash, std::string_view token,
+        std::shared_ptr<const IntrospectionResult>& result)
+    {
+        auto cached = shard.entries.find(hash);
+        if (cached == shard.entries.end() || cached->second.token != token ||
+            cached->second.expires <= Clock::now())
+        {
+            return false;
+        }
+
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        result = cached->second.result;
+        return true;
+    }
+
+    bool IntrospectionClient::cached(std::string_view token, JWTStatus& status,
+        std::shared_ptr<const IntrospectionResult>& result)
+    {
+        uint64_t hash = hash64(token, seed_);
+        Shard& shard = shards_[hash & shardMask_];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!findCached(shard, hash, token, result))
+            return false;
+        status = result->active ? JWTStatus::ok : JWTStatus::inactive;
+        return true;
+    }
+
+    JWTStatus IntrospectionClient::introspect(std::string_view token, std::shared_ptr<const IntrospectionResult>& result)
+    {
+        uint64_t hash = hash64(token, seed_);
+        Shard& shard = shards_[hash & shardMask_];
+
+        std::shared_ptr<Flight> flight;
+        std::promise<Outcome> promise;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            if (findCached(shard, hash, token, result))
+                return result->active ? JWTStatus::ok : JWTStatus::inactive;
+
+            // a different token in flight under the same hash is left
+            // alone; this lookup then sends its own request
+            auto pending = shard.flights.find(hash);
+            if (pending == shard.flights.end())
+            {
+                flight = std::make_shared<Flight>();
+                flight->token.assign(token);
+                flight->outcome = promise.get_future().share();
+                shard.flights.emplace(hash, flight);
+                leader = true;
+            }
+            else if (pending->second->token == token)
+                flight = pending->second;
+        }
+
+        if (flight != nullptr && !leader)
+        {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            const Outcome& outcome = flight->outcome.get();
+            result = outcome.result;
+            return outcome.status;
+        }
+
+        Outcome outcome;
+        try
+        {
+            outcome = request(token);
+        }
+        catch (...)
+        {
+            // a throwing fetcher counts as an unreachable server
+            outcome = { JWTStatus::serverError, nullptr };
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (leader)
+                shard.flights.erase(hash);
+            try
+            {
+                store(shard, hash, token, outcome);
+            }
+            catch (const std::bad_alloc&)
+            {
+                // the result is still returned, only not cached
+            }
+        }
+        if (leader)
+            promise.set_value(outcome);
+
+        result = outcome.result;
+        return outcome.status;
+    }
+
+    IntrospectionClient::Stats IntrospectionClient::stats() const noexcept
+    {
+        Stats stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+        stats.requests = requests_.load(std::memory_order_relaxed);
+        return stats;
+    }
+}
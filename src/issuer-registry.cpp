@@ -0,0 +1,233 @@
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/hash.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <unordered_set>
+
+namespace ncbi
+{
+    struct IssuerRegistry::Table
+    {
+        uint64_t generation = 0;
+        uint64_t seed = 0;
+        std::vector<uint64_t> pilots;           // per bucket, already mixed
+        std::vector<IssuerPolicy> policies;     // by slot
+    };
+
+    namespace
+    {
+        // average names per bucket; fewer buckets make a smaller table
+        // and a longer search for the last displacements
+        constexpr size_t bucketLoad = 4;
+
+        // displacements tried per bucket, and seeds tried before giving up;
+        // for the set sizes of a registry a second seed is rarely needed
+        constexpr uint64_t maxPilot = uint64_t(1) << 20;
+        constexpr unsigned maxAttempts = 16;
+
+        // maps "x" onto [0, n) by its high bits, without a division
+        size_t reduce(uint64_t x, size_t n) noexcept
+        {
+            return static_cast<size_t>((static_cast<__uint128_t>(x) * n) >> 64);
+        }
+
+        uint64_t mixPilot(uint64_t pilot) noexcept
+        {
+            return detail::mix(pilot ^ detail::hashSecret[2], detail::hashSecret[3]);
+        }
+
+        size_t slotOf(uint64_t hash, uint64_t pilot, size_t n) noexcept
+        {
+            return reduce(detail::mix(hash, pilot), n);
+        }
+    }
+
+    // builds the table for a list of policies
+    class IssuerRegistry::Compiler
+    {
+    public:
+        static std::unique_ptr<Table> compile(std::vector<IssuerPolicy> policies);
+
+    private:
+        // hash and displace: buckets are placed largest first, each with
+        // the first displacement that sends all of its names to free
+        // slots; false if some bucket has none within maxPilot
+        static bool place(Table& table, const std::vector<IssuerPolicy>& policies,
+            std::vector<size_t>& slots)
+        {
+            const size_t n = policies.size();
+            const size_t buckets = table.pilots.size();
+
+            std::vector<uint64_t> hashes(n);
+            std::vector<std::vector<size_t>> members(buckets);
+            for (size_t i = 0; i < n; ++i)
+            {
+                hashes[i] = hash64(policies[i].issuer, table.seed);
+                members[reduce(hashes[i], buckets)].push_back(i);
+            }
+
+            std::vector<size_t> order(buckets);
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::stable_sort(order.begin(), order.end(),
+                [&](size_t a, size_t b) { return members[a].size() > members[b].size(); });
+
+            std::vector<bool> taken(n);
+            std::vector<size_t> candidate;
+            for (size_t b : order)
+            {
+                const std::vector<size_t>& names = members[b];
+                if (names.empty())
+                    break;
+
+                bool placed = false;
+                for (uint64_t pilot = 0; pilot < maxPilot && !placed; ++pilot)
+                {
+                    uint64_t mixed = mixPilot(pilot);
+                    candidate.clear();
+                    placed = true;
+                    for (size_t i : names)
+                    {
+                        size_t slot = slotOf(hashes[i], mixed, n);
+                        if (taken[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end())
+                        {
+                            placed = false;
+                            break;
+                        }
+                        candidate.push_back(slot);
+                    }
+                    if (placed)
+                    {
+                        table.pilots[b] = mixed;
+                        for (size_t k = 0; k < names.size(); ++k)
+                        {
+                            taken[candidate[k]] = true;
+                            slots[names[k]] = candidate[k];
+                        }
+                    }
+                }
+                if (!placed)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    std::unique_ptr<IssuerRegistry::Table> IssuerRegistry::Compiler::compile(std::vector<IssuerPolicy> policies)
+    {
+        std::unordered_set<std::string_view> seen;
+        for (const IssuerPolicy& policy : policies)
+        {
+            if (policy.issuer.empty())
+                throw JWTException("IssuerRegistry: empty issuer");
+            if (!seen.insert(policy.issuer).second)
+                throw JWTException("IssuerRegistry: issuer listed twice: " + policy.issuer);
+            if (policy.keys == nullptr)
+                throw JWTException("IssuerRegistry: no keys for issuer " + policy.issuer);
+            if (policy.keys->snapshot().keys() == nullptr)
+                throw JWTException("IssuerRegistry: no key set fetched yet for issuer " + policy.issuer);
+            if (policy.clockSkew.count() < 0)
+                throw JWTException("IssuerRegistry: negative clock skew for issuer " + policy.issuer);
+        }
+
+        auto table = std::make_unique<Table>();
+        if (policies.empty())
+            return table;
+
+        table->pilots.resize((policies.size() + bucketLoad - 1) / bucketLoad);
+        std::vector<size_t> slots(policies.size());
+        unsigned attempt = 0;
+        for (; attempt < maxAttempts; ++attempt)
+        {
+            table->seed = detail::mix(attempt ^ detail::hashSecret[0], detail::hashSecret[1]);
+            if (place(*table, policies, slots))
+                break;
+        }
+        if (attempt == maxAttempts)
+            throw JWTException("IssuerRegistry: no perfect hash found for the issuer set");
+
+        table->policies.resize(policies.size());
+        for (size_t i = 0; i < policies.size(); ++i)
+            table->policies[slots[i]] = std::move(policies[i]);
+        return table;
+    }
+
+    bool IssuerPolicy::acceptsAlg(JWTAlg alg) const noexcept
+    {
+        return algorithms.empty() || std::find(algorithms.begin(), algorithms.end(), alg) != algorithms.end();
+    }
+
+    IssuerRegistry::Snapshot::Snapshot(const IssuerRegistry& registry) noexcept
+        : table_(registry.table_.load(guard_))
+    {
+    }
+
+    const IssuerPolicy* IssuerRegistry::Snapshot::find(std::string_view issuer) const noexcept
+    {
+        const size_t n = table_->policies.size();
+        if (n == 0)
+            return nullptr;
+        uint64_t hash = hash64(issuer, table_->seed);
+        uint64_t pilot = table_->pilots[reduce(hash, table_->pilots.size())];
+        const IssuerPolicy& policy = table_->policies[slotOf(hash, pilot, n)];
+        return policy.issuer == issuer ? &policy : nullptr;
+    }
+
+    size_t IssuerRegistry::Snapshot::size() const noexcept
+    {
+        return table_->policies.size();
+    }
+
+    std::span<const IssuerPolicy> IssuerRegistry::Snapshot::policies() const noexcept
+    {
+        return table_->policies;
+    }
+
+    uint64_t IssuerRegistry::Snapshot::generation() const noexcept
+    {
+        return table_->generation;
+    }
+
+    IssuerRegistry::IssuerRegistry()
+        : table_(std::make_unique<const Table>())
+    {
+    }
+
+    IssuerRegistry::IssuerRegistry(std::vector<IssuerPolicy> policies)
+        : table_(Compiler::compile(std::move(policies)))
+    {
+    }
+
+    IssuerRegistry::~IssuerRegistry() = default;
+
+    std::vector<std::shared_ptr<JWKSCache>> IssuerRegistry::reload(std::vector<IssuerPolicy> policies)
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        std::unique_ptr<Table> table = Compiler::compile(std::move(policies));
+        table->generation = ++generation_;
+
+        std::unordered_set<const JWKSCache*> kept;
+        for (const IssuerPolicy& policy : table->policies)
+            kept.insert(policy.keys.get());
+
+        // collected before the swap, while the old table is certainly alive
+        std::vector<std::shared_ptr<JWKSCache>> dropped;
+        {
+            EpochGuard guard;
+            for (const IssuerPolicy& policy : table_.load(guard)->policies)
+            {
+                if (!kept.contains(policy.keys.get()) &&
+                    std::find(dropped.begin(), dropped.end(), policy.keys) == dropped.end())
+                {
+                    dropped.push_back(policy.keys);
+                }
+            }
+        }
+
+        table_.publish(std::move(table));
+        return dropped;
+    }
+}
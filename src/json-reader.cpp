@@ -0,0 +1,626 @@
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include "json-scan-kernels.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+
+namespace ncbi
+{
+    namespace
+    {
+        // containers nested deeper than this are rejected; the limit lets
+        // the skipper track open containers in a single machine word
+        constexpr unsigned maxDepth = 64;
+
+        // strings shorter than this are scanned byte by byte; most member
+        // names and short claims never reach a vector kernel
+        constexpr ptrdiff_t minVectorScan = 16;
+
+        // null until first use; detection is idempotent, so racing
+        // initializers merely store the same value
+        std::atomic<detail::JSONStringScanKernel> activeScanKernel { nullptr };
+
+        int hexValue(char ch) noexcept
+        {
+            if (ch >= '0' && ch <= '9')
+                return ch - '0';
+            if (ch >= 'a' && ch <= 'f')
+                return ch - 'a' + 10;
+            if (ch >= 'A' && ch <= 'F')
+                return ch - 'A' + 10;
+            return -1;
+        }
+
+        bool readHex4(const char* p, const char* end, unsigned& value) noexcept
+        {
+            if (end - p < 4)
+                return false;
+
+            value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                int h = hexValue(p[i]);
+                if (h < 0)
+                    return false;
+                value = value << 4 | static_cast<unsigned>(h);
+            }
+            return true;
+        }
+
+        // decodes one escape sequence starting at the backslash "p" points to,
+        // advancing "p" past it; returns the number of UTF-8 bytes placed in
+        // "out" or -1 if the sequence is invalid
+        int decodeEscape(const char*& p, const char* end, char out[4]) noexcept
+        {
+            if (end - p < 2)
+                return -1;
+
+            char ch = p[1];
+            p += 2;
+
+            switch (ch)
+            {
+            case '"':  out[0] = '"';  return 1;
+            case '\\': out[0] = '\\'; return 1;
+            case '/':  out[0] = '/';  return 1;
+            case 'b':  out[0] = '\b'; return 1;
+            case 'f':  out[0] = '\f'; return 1;
+            case 'n':  out[0] = '\n'; return 1;
+            case 'r':  out[0] = '\r'; return 1;
+            case 't':  out[0] = '\t'; return 1;
+            case 'u':
+                break;
+            default:
+                return -1;
+            }
+
+            unsigned cp;
+            if (!readHex4(p, end, cp))
+                return -1;
+            p += 4;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                // a high surrogate must be followed by an escaped low surrogate
+                unsigned low;
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !readHex4(p + 2, end, low))
+                    return -1;
+                if (low < 0xDC00 || low > 0xDFFF)
+                    return -1;
+                p += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF)
+            {
+                return -1;
+            }
+
+            if (cp < 0x80)
+            {
+                out[0] = static_cast<char>(cp);
+                return 1;
+            }
+            if (cp < 0x800)
+            {
+                out[0] = static_cast<char>(0xC0 | cp >> 6);
+                out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+                return 2;
+            }
+            if (cp < 0x10000)
+            {
+                out[0] = static_cast<char>(0xE0 | cp >> 12);
+                out[1] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+                return 3;
+            }
+            out[0] = static_cast<char>(0xF0 | cp >> 18);
+            out[1] = static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 4;
+        }
+    }
+
+    detail::JSONStringScanKernel detail::jsonStringScanKernel() noexcept
+    {
+        detail::JSONStringScanKernel kernel = activeScanKernel.load(std::memory_order_acquire);
+        if (kernel == nullptr)
+        {
+            __builtin_cpu_init();
+            kernel = __builtin_cpu_supports("avx2")
+                ? detail::scanJSONStringAVX2
+                : detail::scanJSONStringSSE2;
+            activeScanKernel.store(kernel, std::memory_order_release);
+        }
+        return kernel;
+    }
+
+    bool rawJSONStringEquals(std::string_view raw, std::string_view text) noexcept
+    {
+        const char* p = raw.data();
+        const char* end = p + raw.size();
+        const char* t = text.data();
+        const char* tend = t + text.size();
+
+        while (p != end)
+        {
+            const char* bs = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+            size_t plain = static_cast<size_t>((bs != nullptr ? bs : end) - p);
+            if (static_cast<size_t>(tend - t) < plain || std::memcmp(p, t, plain) != 0)
+                return false;
+            p += plain;
+            t += plain;
+
+            if (bs == nullptr)
+                break;
+
+            char buf[4];
+            int n = decodeEscape(p, end, buf);
+            if (n < 0 || tend - t < n || std::memcmp(buf, t, static_cast<size_t>(n)) != 0)
+                return false;
+            t += n;
+        }
+        return t == tend;
+    }
+
+    std::string_view JSONValueView::rawString() const noexcept
+    {
+        if (type_ != JSONType::string || raw_.size() < 2)
+            return std::string_view();
+        return raw_.substr(1, raw_.size() - 2);
+    }
+
+    bool JSONValueView::isPlainString() const noexcept
+    {
+        return type_ == JSONType::string && rawString().find('\\') == std::string_view::npos;
+    }
+
+    bool JSONValueView::stringEquals(std::string_view text) const noexcept
+    {
+        return type_ == JSONType::string && rawJSONStringEquals(rawString(), text);
+    }
+
+    bool JSONValueView::getString(char* dst, size_t& written) const noexcept
+    {
+        return type_ == JSONType::string && unescapeJSONString(rawString(), dst, written);
+    }
+
+    std::string jsonString(const JSONValueView& value, std::string_view owner, std::string_view member)
+    {
+        if (value.type() != JSONType::string)
+            throw JWTException(std::string(owner) + ": member '" + std::string(member) + "' is not a string");
+
+        std::string out(value.rawString().size(), '\0');
+        size_t written;
+        if (!value.getString(out.data(), written))
+            throw JWTException(std::string(owner) + ": member '" + std::string(member) + "' has a bad escape");
+        out.resize(written);
+        return out;
+    }
+
+    bool JSONValueView::getBool(bool& value) const noexcept
+    {
+        if (type_ != JSONType::boolean)
+            return false;
+        value = raw_[0] == 't';
+        return true;
+    }
+
+    bool JSONValueView::getInt64(int64_t& value) const noexcept
+    {
+        if (type_ != JSONType::number)
+            return false;
+
+        const char* first = raw_.data();
+        const char* last = first + raw_.size();
+        auto [ptr, ec] = std::from_chars(first, last, value);
+        return ec == std::errc() && ptr == last;
+    }
+
+    bool JSONValueView::getDouble(double& value) const noexcept
+    {
+        if (type_ != JSONType::number)
+            return false;
+
+        const char* first = raw_.data();
+        const char* last = first + raw_.size();
+        auto [ptr, ec] = std::from_chars(first, last, value);
+        return ec == std::errc() && ptr == last;
+    }
+
+    bool unescapeJSONString(std::string_view raw, char* dst, size_t& written) noexcept
+    {
+        const char* p = raw.data();
+        const char* end = p + raw.size();
+        char* out = dst;
+
+        while (p != end)
+        {
+            const char* bs = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+            size_t plain = static_cast<size_t>((bs != nullptr ? bs : end) - p);
+            std::memmove(out, p, plain);
+            out += plain;
+            p += plain;
+
+            if (bs == nullptr)
+                break;
+
+            int n = decodeEscape(p, end, out);
+            if (n < 0)
+                return false;
+            out += n;
+        }
+
+        written = static_cast<size_t>(out - dst);
+        return true;
+    }
+
+    JSONReader::JSONReader(std::string_view text) noexcept
+        : cur_(text.data())
+        , end_(text.data() + text.size())
+        , first_(false)
+        , failed_(false)
+    {
+    }
+
+    bool JSONReader::fail() noexcept
+    {
+        failed_ = true;
+        cur_ = end_;
+        return false;
+    }
+
+    void JSONReader::skipSpace() noexcept
+    {
+        while (cur_ != end_ && (*cur_ == ' ' || *cur_ == '\n' || *cur_ == '\r' || *cur_ == '\t'))
+            ++cur_;
+    }
+
+    bool JSONReader::scanString() noexcept
+    {
+        // cur_ is on the opening quote
+        const char* p = cur_ + 1;
+        while (p != end_)
+        {
+            if (end_ - p >= minVectorScan)
+            {
+                p = detail::jsonStringScanKernel()(p, end_);
+                if (p == end_)
+                    break;
+            }
+
+            unsigned char ch = static_cast<unsigned char>(*p);
+            if (ch == '"')
+            {
+                cur_ = p + 1;
+                return true;
+            }
+            if (ch < 0x20)
+                return fail();
+            if (ch == '\\')
+            {
+                char buf[4];
+                if (decodeEscape(p, end_, buf) < 0)
+                    return fail();
+                continue;
+            }
+            ++p;
+        }
+        return fail();
+    }
+
+    bool JSONReader::scanNumber() noexcept
+    {
+        const char* p = cur_;
+        auto isDigit = [](char ch) { return ch >= '0' && ch <= '9'; };
+
+        if (p != end_ && *p == '-')
+            ++p;
+        if (p == end_)
+            return fail();
+
+        if (*p == '0')
+            ++p;
+        else if (isDigit(*p))
+        {
+            while (p != end_ && isDigit(*p))
+                ++p;
+        }
+        else
+            return fail();
+
+        if (p != end_ && *p == '.')
+        {
+            ++p;
+            if (p == end_ || !isDigit(*p))
+                return fail();
+            while (p != end_ && isDigit(*p))
+                ++p;
+        }
+
+        if (p != end_ && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            if (p != end_ && (*p == '+' || *p == '-'))
+                ++p;
+            if (p == end_ || !isDigit(*p))
+                return fail();
+            while (p != end_ && isDigit(*p))
+                ++p;
+        }
+
+        cur_ = p;
+        return true;
+    }
+
+    bool JSONReader::scanLiteral(std::string_view literal) noexcept
+    {
+        if (static_cast<size_t>(end_ - cur_) < literal.size() ||
+            std::memcmp(cur_, literal.data(), literal.size()) != 0)
+        {
+            return fail();
+        }
+        cur_ += literal.size();
+        return true;
+    }
+
+    bool JSONReader::scanScalar() noexcept
+    {
+        switch (*cur_)
+        {
+        case '"': return scanString();
+        case 't': return scanLiteral("true");
+        case 'f': return scanLiteral("false");
+        case 'n': return scanLiteral("null");
+        default:  return scanNumber();
+        }
+    }
+
+    bool JSONReader::scanContainer() noexcept
+    {
+        // bit 0 of "objects" is set while the innermost open container is
+        // an object; opening shifts left, closing shifts right
+        uint64_t objects = 0;
+        unsigned depth = 0;
+
+        // positions the cursor on the next value of the innermost container,
+        // consuming the member name first when that container is an object
+        auto beginElement = [this, &objects]() noexcept
+        {
+            if ((objects & 1) != 0)
+            {
+                skipSpace();
+                if (cur_ == end_ || *cur_ != '"' || !scanString())
+                    return fail();
+                skipSpace();
+                if (cur_ == end_ || *cur_ != ':')
+                    return fail();
+                ++cur_;
+            }
+            skipSpace();
+            return cur_ != end_ || fail();
+        };
+
+        // cur_ is on the opening '{' or '['
+        for (;;)
+        {
+            if (*cur_ == '{' || *cur_ == '[')
+            {
+                if (depth == maxDepth)
+                    return fail();
+
+                bool isObject = *cur_ == '{';
+                objects = objects << 1 | (isObject ? 1 : 0);
+                ++depth;
+                ++cur_;
+
+                skipSpace();
+                if (cur_ == end_)
+                    return fail();
+
+                if (*cur_ != (isObject ? '}' : ']'))
+                {
+                    if (!beginElement())
+                        return false;
+                    continue;
+                }
+
+                // empty container
+                ++cur_;
+                objects >>= 1;
+                if (--depth == 0)
+                    return true;
+            }
+            else if (!scanScalar())
+            {
+                return false;
+            }
+
+            // after a value: either a sibling follows, or containers
+            // close, possibly several in a row
+            for (;;)
+            {
+                skipSpace();
+                if (cur_ == end_)
+                    return fail();
+                if (*cur_ == ',')
+                {
+                    ++cur_;
+                    break;
+                }
+                if (*cur_ != ((objects & 1) != 0 ? '}' : ']'))
+                    return fail();
+                ++cur_;
+                objects >>= 1;
+                if (--depth == 0)
+                    return true;
+            }
+
+            if (!beginElement())
+                return false;
+        }
+    }
+
+    bool JSONReader::enterObject() noexcept
+    {
+        skipSpace();
+        if (cur_ == end_ || *cur_ != '{')
+            return fail();
+        ++cur_;
+        first_ = true;
+        return true;
+    }
+
+    bool JSONReader::nextMember(std::string_view& rawName) noexcept
+    {
+        if (failed_)
+            return false;
+
+        skipSpace();
+        if (cur_ == end_)
+            return fail();
+
+        if (*cur_ == '}')
+        {
+            // a closing brace right after a comma is a trailing comma,
+            // which the name check below rejects
+            ++cur_;
+            first_ = false;
+            return false;
+        }
+
+        if (!first_)
+        {
+            if (*cur_ != ',')
+                return fail();
+            ++cur_;
+            skipSpace();
+        }
+        first_ = false;
+
+        if (cur_ == end_ || *cur_ != '"')
+            return fail();
+
+        const char* start = cur_ + 1;
+        if (!scanString())
+            return false;
+        rawName = std::string_view(start, static_cast<size_t>(cur_ - 1 - start));
+
+        skipSpace();
+        if (cur_ == end_ || *cur_ != ':')
+            return fail();
+        ++cur_;
+        return true;
+    }
+
+    bool JSONReader::enterArray() noexcept
+    {
+        skipSpace();
+        if (cur_ == end_ || *cur_ != '[')
+            return fail();
+        ++cur_;
+        first_ = true;
+        return true;
+    }
+
+    bool JSONReader::nextElement() noexcept
+    {
+        if (failed_)
+            return false;
+
+        skipSpace();
+        if (cur_ == end_)
+            return fail();
+
+        if (*cur_ == ']')
+        {
+            ++cur_;
+            first_ = false;
+            return false;
+        }
+
+        if (!first_)
+        {
+            if (*cur_ != ',')
+                return fail();
+            ++cur_;
+        }
+        first_ = false;
+        return true;
+    }
+
+    bool JSONReader::peekType(JSONType& type) noexcept
+    {
+        if (failed_)
+            return false;
+
+        skipSpace();
+        if (cur_ == end_)
+            return fail();
+
+        switch (*cur_)
+        {
+        case '{': type = JSONType::object; break;
+        case '[': type = JSONType::array; break;
+        case '"': type = JSONType::string; break;
+        case 't':
+        case 'f': type = JSONType::boolean; break;
+        case 'n': type = JSONType::null; break;
+        default:
+            if (*cur_ != '-' && (*cur_ < '0' || *cur_ > '9'))
+                return fail();
+            type = JSONType::number;
+            break;
+        }
+        return true;
+    }
+
+    bool JSONReader::readValue(JSONValueView& value) noexcept
+    {
+        JSONType type;
+        if (!peekType(type))
+            return false;
+
+        const char* start = cur_;
+        bool scanned = type == JSONType::object || type == JSONType::array
+            ? scanContainer()
+            : scanScalar();
+        if (!scanned)
+            return false;
+
+        value = JSONValueView(type, std::string_view(start, static_cast<size_t>(cur_ - start)));
+        return true;
+    }
+
+    bool JSONReader::skipValue() noexcept
+    {
+        JSONValueView ignored;
+        return readValue(ignored);
+    }
+
+    bool JSONReader::atEnd() noexcept
+    {
+        skipSpace();
+        return cur_ == end_ && !failed_;
+    }
+
+    bool findJSONMember(std::string_view object, std::string_view name, JSONValueView& value) noexcept
+    {
+        JSONReader reader(object);
+        if (!reader.enterObject())
+            return false;
+
+        std::string_view rawName;
+        while (reader.nextMember(rawName))
+        {
+            if (rawJSONStringEquals(rawName, name))
+                return reader.readValue(value);
+            if (!reader.skipValue())
+                return false;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// vectorized scanning of JSON string bodies, private to the reader and
+// the writer
+//
+// a kernel skips the run of ordinary characters at "p" and returns the
+// first byte that needs the scalar code's attention: '"', '\\' or a
+// control character; it examines whole blocks only and returns the start
+// of the unexamined tail, which may be "end", when no block holds one
+
+namespace ncbi::detail
+{
+    using JSONStringScanKernel = const char* (*)(const char* p, const char* end) noexcept;
+
+    const char* scanJSONStringSSE2(const char* p, const char* end) noexcept;
+    const char* scanJSONStringAVX2(const char* p, const char* end) noexcept;
+
+    // the widest kernel the CPU supports, chosen on first use
+    JSONStringScanKernel jsonStringScanKernel() noexcept;
+}
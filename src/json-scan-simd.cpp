@@ -0,0 +1,54 @@
+#include "json-scan-kernels.hpp"
+
+#include <immintrin.h>
+
+// each kernel compares a block against '"' and '\\' and finds control
+// characters as the bytes whose unsigned maximum with 0x1F is 0x1F
+// the AVX2 kernel is only called after the dispatcher in json-reader.cpp
+// has checked the CPU; SSE2 is part of the x86-64 baseline
+
+namespace ncbi::detail
+{
+    const char* scanJSONStringSSE2(const char* p, const char* end) noexcept
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        while (end - p >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+            if (mask != 0)
+                return p + __builtin_ctz(mask);
+            p += 16;
+        }
+        return p;
+    }
+
+    __attribute__((target("avx2")))
+    const char* scanJSONStringAVX2(const char* p, const char* end) noexcept
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1F);
+
+        while (end - p >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+            if (mask != 0)
+                return p + __builtin_ctz(mask);
+            p += 32;
+        }
+        return scanJSONStringSSE2(p, end);
+    }
+}
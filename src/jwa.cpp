@@ -0,0 +1,75 @@
+#include <ncbi/jwa.hpp>
+
+namespace ncbi
+{
+    namespace
+    {
+        struct AlgEntry
+        {
+            std::string_view name;
+            JWTAlg alg;
+            JWTAlgFamily family;
+            unsigned digestSize;
+        };
+
+        constexpr AlgEntry algTable[] =
+        {
+            { "none",  JWTAlg::none,  JWTAlgFamily::none,   0 },
+            { "HS256", JWTAlg::HS256, JWTAlgFamily::hmac,   32 },
+            { "HS384", JWTAlg::HS384, JWTAlgFamily::hmac,   48 },
+            { "HS512", JWTAlg::HS512, JWTAlgFamily::hmac,   64 },
+            { "RS256", JWTAlg::RS256, JWTAlgFamily::rsa,    32 },
+            { "RS384", JWTAlg::RS384, JWTAlgFamily::rsa,    48 },
+            { "RS512", JWTAlg::RS512, JWTAlgFamily::rsa,    64 },
+            { "PS256", JWTAlg::PS256, JWTAlgFamily::rsaPSS, 32 },
+            { "PS384", JWTAlg::PS384, JWTAlgFamily::rsaPSS, 48 },
+            { "PS512", JWTAlg::PS512, JWTAlgFamily::rsaPSS, 64 },
+            { "ES256", JWTAlg::ES256, JWTAlgFamily::ecdsa,  32 },
+            { "ES384", JWTAlg::ES384, JWTAlgFamily::ecdsa,  48 },
+            { "ES512", JWTAlg::ES512, JWTAlgFamily::ecdsa,  64 },
+            { "EdDSA", JWTAlg::EdDSA, JWTAlgFamily::eddsa,  0 }
+        };
+
+        const AlgEntry* findEntry(JWTAlg alg) noexcept
+        {
+            for (const AlgEntry& e : algTable)
+            {
+                if (e.alg == alg)
+                    return &e;
+            }
+            return nullptr;
+        }
+    }
+
+    JWTAlg parseAlg(std::string_view name) noexcept
+    {
+        // every registered name is five characters except "none"
+        if (name.size() != 5 && name.size() != 4)
+            return JWTAlg::unknown;
+
+        for (const AlgEntry& e : algTable)
+        {
+            if (e.name == name)
+                return e.alg;
+        }
+        return JWTAlg::unknown;
+    }
+
+    std::string_view algName(JWTAlg alg) noexcept
+    {
+        const AlgEntry* e = findEntry(alg);
+        return e != nullptr ? e->name : std::string_view();
+    }
+
+    JWTAlgFamily algFamily(JWTAlg alg) noexcept
+    {
+        const AlgEntry* e = findEntry(alg);
+        return e != nullptr ? e->family : JWTAlgFamily::none;
+    }
+
+    unsigned algDigestSize(JWTAlg alg) noexcept
+    {
+        const AlgEntry* e = findEntry(alg);
+        return e != nullptr ? e->digestSize : 0;
+    }
+}
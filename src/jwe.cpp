@@ -0,0 +1,697 @@
+#include <ncbi/jwe.hpp>
+#include <ncbi/base64url.hpp>
+
+#include "jwk-import.hpp"
+
+#include <openssl/bio.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace ncbi
+{
+    namespace
+    {
+        struct CipherFree { void operator()(EVP_CIPHER* p) const noexcept { EVP_CIPHER_free(p); } };
+        struct CipherCtxFree { void operator()(EVP_CIPHER_CTX* p) const noexcept { EVP_CIPHER_CTX_free(p); } };
+        struct PKeyCtxFree { void operator()(EVP_PKEY_CTX* p) const noexcept { EVP_PKEY_CTX_free(p); } };
+        struct MDCtxFree { void operator()(EVP_MD_CTX* p) const noexcept { EVP_MD_CTX_free(p); } };
+        struct MDFree { void operator()(EVP_MD* p) const noexcept { EVP_MD_free(p); } };
+        struct BIOFree { void operator()(BIO* p) const noexcept { BIO_free(p); } };
+
+        using detail::PKey;
+
+        // an ECDH-ES header, with its ephemeral key, runs to a few hundred bytes
+        constexpr size_t maxHeaderSize = 4096;
+
+        constexpr size_t ivSize = 12;
+        constexpr size_t tagSize = 16;
+        constexpr size_t maxKeySize = 32;
+        constexpr size_t maxEncryptedKeySize = 512;     // RSA-4096
+        constexpr size_t maxCoordinateSize = 66;        // P-521
+        constexpr size_t maxPartyInfoSize = 256;
+
+        // RFC 7518 section 4.2
+        constexpr size_t minRSAModulusBits = 2048;
+
+        struct AlgName
+        {
+            std::string_view name;
+            JWEAlg alg;
+        };
+
+        constexpr AlgName algNames[] =
+        {
+            { "dir",            JWEAlg::dir },
+            { "A128KW",         JWEAlg::A128KW },
+            { "A256KW",         JWEAlg::A256KW },
+            { "RSA-OAEP",       JWEAlg::RSA_OAEP },
+            { "RSA-OAEP-256",   JWEAlg::RSA_OAEP_256 },
+            { "ECDH-ES",        JWEAlg::ECDH_ES },
+            { "ECDH-ES+A128KW", JWEAlg::ECDH_ES_A128KW },
+            { "ECDH-ES+A256KW", JWEAlg::ECDH_ES_A256KW },
+        };
+
+        enum CipherIndex { gcm128, gcm256, ecb128, ecb256, cipherCount };
+
+        constexpr const char* cipherNames[cipherCount] = { "AES-128-GCM", "AES-256-GCM", "AES-128-ECB", "AES-256-ECB" };
+
+        // the ciphers, fetched from the provider once for the process
+        struct Ciphers
+        {
+            std::unique_ptr<EVP_CIPHER, CipherFree> cipher[cipherCount];
+
+            Ciphers()
+            {
+                for (size_t i = 0; i < cipherCount; ++i)
+                    cipher[i].reset(EVP_CIPHER_fetch(nullptr, cipherNames[i], nullptr));
+            }
+        };
+
+        // a context per thread and cipher, bound to the cipher once and
+        // given only a key and IV for each token: creating and freeing the
+        // provider's context costs more than decrypting a small token
+        // the context keeps the last key schedule until the next token
+        // replaces it, as HMACVerifier keeps its key state
+        EVP_CIPHER_CTX* threadContext(CipherIndex index) noexcept
+        {
+            static const Ciphers ciphers;
+            thread_local std::unique_ptr<EVP_CIPHER_CTX, CipherCtxFree> contexts[cipherCount];
+
+            std::unique_ptr<EVP_CIPHER_CTX, CipherCtxFree>& ctx = contexts[index];
+            if (ctx == nullptr && ciphers.cipher[index] != nullptr)
+            {
+                ctx.reset(EVP_CIPHER_CTX_new());
+                if (ctx == nullptr || EVP_DecryptInit_ex2(ctx.get(), ciphers.cipher[index].get(), nullptr, nullptr, nullptr) != 1)
+                {
+                    ctx.reset();
+                    return nullptr;
+                }
+                EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+            }
+            return ctx.get();
+        }
+
+        // the key encryption key size of the AES key wrap algorithms, else 0
+        size_t wrapKeySize(JWEAlg alg) noexcept
+        {
+            switch (alg)
+            {
+            case JWEAlg::A128KW:
+            case JWEAlg::ECDH_ES_A128KW: return 16;
+            case JWEAlg::A256KW:
+            case JWEAlg::ECDH_ES_A256KW: return 32;
+            default:                     return 0;
+            }
+        }
+
+        // decodes a segment that must fit "capacity"
+        bool decodeInto(std::string_view segment, unsigned char* buf, size_t capacity, size_t& length) noexcept
+        {
+            return base64urlDecodedSize(segment.size()) <= capacity && base64urlDecode(segment, buf, length);
+        }
+
+        // RFC 3394 key unwrap, section 2.2.2 in its index-based form, over
+        // single AES block decryptions: OpenSSL's AES-WRAP cipher is several
+        // times slower than the twelve or twenty-four blocks of a content
+        // key; "out" receives inSize - 8 bytes
+        bool aesUnwrap(const unsigned char* kek, size_t kekSize, const unsigned char* in, size_t inSize,
+            unsigned char* out, size_t outSize) noexcept
+        {
+            if ((kekSize != 16 && kekSize != 32) || inSize != outSize + 8 || outSize % 8 != 0 || outSize < 16)
+                return false;
+            EVP_CIPHER_CTX* ctx = threadContext(kekSize == 16 ? ecb128 : ecb256);
+            if (ctx == nullptr || EVP_DecryptInit_ex2(ctx, nullptr, kek, nullptr, nullptr) != 1)
+                return false;
+
+            static constexpr unsigned char iv[8] = { 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6 };
+            size_t n = outSize / 8;
+            unsigned char block[16];
+            std::memcpy(block, in, 8);
+            std::memcpy(out, in + 8, outSize);
+
+            bool ok = true;
+            for (size_t j = 6; ok && j-- > 0;)
+            {
+                for (size_t i = n; ok && i > 0; --i)
+                {
+                    // A ^ t, then R[i]; B = AES-1(K, that), A = MSB(B), R[i] = LSB(B)
+                    uint64_t t = n * j + i;
+                    for (size_t k = 0; k < 8; ++k)
+                        block[7 - k] ^= static_cast<unsigned char>(t >> (8 * k));
+                    std::memcpy(block + 8, out + 8 * (i - 1), 8);
+                    int written = 0;
+                    ok = EVP_DecryptUpdate(ctx, block, &written, block, sizeof block) == 1 && written == sizeof block;
+                    std::memcpy(out + 8 * (i - 1), block + 8, 8);
+                }
+            }
+
+            ok = ok && CRYPTO_memcmp(block, iv, sizeof iv) == 0;
+            OPENSSL_cleanse(block, sizeof block);
+            if (!ok)
+                OPENSSL_cleanse(out, outSize);
+            return ok;
+        }
+
+        // AES-GCM over "data" in place, authenticating "aad" and checking "tag"
+        bool gcmDecrypt(JWEEnc enc, const unsigned char* cek, const unsigned char* iv, std::string_view aad,
+            unsigned char* data, size_t size, unsigned char* tag) noexcept
+        {
+            EVP_CIPHER_CTX* ctx = threadContext(enc == JWEEnc::A128GCM ? gcm128 : gcm256);
+            if (ctx == nullptr)
+                return false;
+
+            int written = 0;
+            bool ok = EVP_DecryptInit_ex2(ctx, nullptr, cek, iv, nullptr) == 1 &&
+                EVP_DecryptUpdate(ctx, nullptr, &written,
+                    reinterpret_cast<const unsigned char*>(aad.data()), static_cast<int>(aad.size())) == 1;
+
+            // in place, in chunks an int can count
+            constexpr size_t chunk = size_t(1) << 30;
+            for (size_t done = 0; ok && done < size; done += chunk)
+            {
+                int n = static_cast<int>(size - done < chunk ? size - done : chunk);
+                ok = EVP_DecryptUpdate(ctx, data + done, &written, data + done, n) == 1;
+            }
+
+            int final = 0;
+            return ok && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(tagSize), tag) == 1 &&
+                EVP_DecryptFinal_ex(ctx, data + size, &final) == 1;
+        }
+
+        // a member of the "epk" object, which must be a plain string
+        bool epkMember(std::string_view epk, std::string_view name, std::string_view& value) noexcept
+        {
+            JSONValueView v;
+            if (!findJSONMember(epk, name, v) || !v.isPlainString())
+                return false;
+            value = v.rawString();
+            return true;
+        }
+
+        const char* groupName(std::string_view crv) noexcept
+        {
+            if (crv == "P-256")
+                return "prime256v1";
+            if (crv == "P-384")
+                return "secp384r1";
+            if (crv == "P-521")
+                return "secp521r1";
+            return nullptr;
+        }
+
+        // the ephemeral public key, on the recipient's curve "crv"; OpenSSL
+        // checks that an EC point lies on the curve as it imports it
+        PKey importEphemeralKey(std::string_view epk, std::string_view crv) noexcept
+        {
+            std::string_view kty, epkCrv, x64, y64;
+            if (!epkMember(epk, "kty", kty) || !epkMember(epk, "crv", epkCrv) || epkCrv != crv ||
+                !epkMember(epk, "x", x64))
+            {
+                return nullptr;
+            }
+
+            unsigned char x[maxCoordinateSize];
+            size_t xSize;
+            if (!decodeInto(x64, x, sizeof x, xSize))
+                return nullptr;
+
+            if (kty == "OKP" && crv == "X25519")
+                return PKey(EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, x, xSize));
+            if (kty != "EC" || !epkMember(epk, "y", y64))
+                return nullptr;
+
+            // uncompressed SEC1 point
+            unsigned char point[1 + 2 * maxCoordinateSize];
+            size_t ySize;
+            if (!decodeInto(y64, point + 1 + xSize, maxCoordinateSize, ySize) || ySize != xSize)
+                return nullptr;
+            point[0] = 0x04;
+            std::memcpy(point + 1, x, xSize);
+
+            OSSL_PARAM params[] =
+            {
+                OSSL_PARAM_construct_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, const_cast<char*>(groupName(crv)), 0),
+                OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY, point, 1 + 2 * xSize),
+                OSSL_PARAM_construct_end()
+            };
+            std::unique_ptr<EVP_PKEY_CTX, PKeyCtxFree> ctx(EVP_PKEY_CTX_new_from_name(nullptr, "EC", nullptr));
+            EVP_PKEY* pkey = nullptr;
+            if (ctx == nullptr || EVP_PKEY_fromdata_init(ctx.get()) <= 0 ||
+                EVP_PKEY_fromdata(ctx.get(), &pkey, EVP_PKEY_PUBLIC_KEY, params) <= 0)
+            {
+                return nullptr;
+            }
+            return PKey(pkey);
+        }
+
+        // appends a 32-bit big-endian length, or the value itself
+        unsigned char* putLength(unsigned char* p, size_t value) noexcept
+        {
+            *p++ = static_cast<unsigned char>(value >> 24);
+            *p++ = static_cast<unsigned char>(value >> 16);
+            *p++ = static_cast<unsigned char>(value >> 8);
+            *p++ = static_cast<unsigned char>(value);
+            return p;
+        }
+
+        // base64url party information into "out", empty when absent
+        bool partyInfo(const JSONValueView& value, unsigned char* out, size_t& size) noexcept
+        {
+            size = 0;
+            if (value.raw().empty())
+                return true;
+            return value.isPlainString() && decodeInto(value.rawString(), out, maxPartyInfoSize, size);
+        }
+    }
+
+    JWEAlg parseJWEAlg(std::string_view name) noexcept
+    {
+        for (const AlgName& entry : algNames)
+        {
+            if (entry.name == name)
+                return entry.alg;
+        }
+        return JWEAlg::unknown;
+    }
+
+    std::string_view jweAlgName(JWEAlg alg) noexcept
+    {
+        for (const AlgName& entry : algNames)
+        {
+            if (entry.alg == alg)
+                return entry.name;
+        }
+        return {};
+    }
+
+    JWEEnc parseJWEEnc(std::string_view name) noexcept
+    {
+        if (name == "A128GCM")
+            return JWEEnc::A128GCM;
+        if (name == "A256GCM")
+            return JWEEnc::A256GCM;
+        return JWEEnc::unknown;
+    }
+
+    std::string_view jweEncName(JWEEnc enc) noexcept
+    {
+        switch (enc)
+        {
+        case JWEEnc::A128GCM: return "A128GCM";
+        case JWEEnc::A256GCM: return "A256GCM";
+        default:              return {};
+        }
+    }
+
+    size_t jweKeySize(JWEEnc enc) noexcept
+    {
+        switch (enc)
+        {
+        case JWEEnc::A128GCM: return 16;
+        case JWEEnc::A256GCM: return 32;
+        default:              return 0;
+        }
+    }
+
+    JWTStatus JWEView::parse(std::string_view token, JWEView& view) noexcept
+    {
+        size_t dots[4];
+        size_t from = 0;
+        for (size_t& dot : dots)
+        {
+            const void* d = std::memchr(token.data() + from, '.', token.size() - from);
+            if (d == nullptr)
+                return JWTStatus::malformed;
+            dot = static_cast<size_t>(static_cast<const char*>(d) - token.data());
+            from = dot + 1;
+        }
+
+        // a fifth dot is garbage; the header, IV and tag cannot be empty
+        if (std::memchr(token.data() + from, '.', token.size() - from) != nullptr ||
+            dots[0] == 0 || dots[2] == dots[1] + 1 || from == token.size())
+        {
+            return JWTStatus::malformed;
+        }
+
+        view.token_ = token;
+        std::memcpy(view.dots_, dots, sizeof dots);
+        return JWTStatus::ok;
+    }
+
+    std::string_view JWEView::segment(size_t index) const noexcept
+    {
+        size_t begin = index == 0 ? 0 : dots_[index - 1] + 1;
+        size_t end = index == 4 ? token_.size() : dots_[index];
+        return token_.substr(begin, end - begin);
+    }
+
+    size_t JWEView::headerSize() const noexcept
+    {
+        return base64urlDecodedSize(headerSegment().size());
+    }
+
+    size_t JWEView::plaintextSize() const noexcept
+    {
+        return base64urlDecodedSize(ciphertextSegment().size());
+    }
+
+    JWTStatus JWEView::decodeHeader(char* buf, size_t capacity, std::string_view& json) const noexcept
+    {
+        if (headerSize() > capacity)
+            return JWTStatus::bufferTooSmall;
+        size_t length;
+        if (!base64urlDecode(headerSegment(), buf, length))
+            return JWTStatus::badEncoding;
+        json = std::string_view(buf, length);
+        return JWTStatus::ok;
+    }
+
+    JWTStatus JWEHeader::parse(std::string_view json, JWEHeader& header) noexcept
+    {
+        header = JWEHeader();
+        header.json = json;
+
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            return JWTStatus::badJSON;
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            if (rawJSONStringEquals(name, "alg"))
+                header.alg = value.isPlainString() ? parseJWEAlg(value.rawString()) : JWEAlg::unknown;
+            else if (rawJSONStringEquals(name, "enc"))
+                header.enc = value.isPlainString() ? parseJWEEnc(value.rawString()) : JWEEnc::unknown;
+            else if (rawJSONStringEquals(name, "kid"))
+                header.kid = value;
+            else if (rawJSONStringEquals(name, "typ"))
+                header.typ = value;
+            else if (rawJSONStringEquals(name, "cty"))
+                header.cty = value;
+            else if (rawJSONStringEquals(name, "epk"))
+                header.epk = value;
+            else if (rawJSONStringEquals(name, "apu"))
+                header.apu = value;
+            else if (rawJSONStringEquals(name, "apv"))
+                header.apv = value;
+            else if (rawJSONStringEquals(name, "zip"))
+                header.hasZip = true;
+            else if (rawJSONStringEquals(name, "crit"))
+                header.hasCrit = true;
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            return JWTStatus::badJSON;
+        return JWTStatus::ok;
+    }
+
+    JWTStatus JWEDecrypter::decrypt(std::string_view token, char* buf, size_t capacity,
+        std::string_view& plaintext) const noexcept
+    {
+        plaintext = {};
+
+        JWEView view;
+        JWTStatus status = JWEView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+        if (view.headerSize() > maxHeaderSize)
+            return JWTStatus::bufferTooSmall;
+
+        char headerBuf[maxHeaderSize];
+        std::string_view json;
+        JWEHeader header;
+        if ((status = view.decodeHeader(headerBuf, sizeof headerBuf, json)) != JWTStatus::ok ||
+            (status = JWEHeader::parse(json, header)) != JWTStatus::ok)
+        {
+            return status;
+        }
+        return decrypt(view, header, buf, capacity, plaintext);
+    }
+
+    JWTStatus JWEDecrypter::decrypt(const JWEView& view, const JWEHeader& header, char* buf, size_t capacity,
+        std::string_view& plaintext) const noexcept
+    {
+        plaintext = {};
+
+        if (header.alg == JWEAlg::unknown || header.enc == JWEEnc::unknown || header.hasZip)
+            return JWTStatus::unsupportedAlg;
+        if (header.hasCrit)
+            return JWTStatus::unsupportedCrit;
+        if (header.alg != alg())
+            return JWTStatus::algMismatch;
+        if (view.plaintextSize() > capacity)
+            return JWTStatus::bufferTooSmall;
+
+        unsigned char encryptedKey[maxEncryptedKeySize];
+        unsigned char iv[ivSize + 2];
+        unsigned char tag[tagSize + 2];
+        size_t encryptedKeySize, length;
+        if (!decodeInto(view.encryptedKeySegment(), encryptedKey, sizeof encryptedKey, encryptedKeySize) ||
+            !decodeInto(view.ivSegment(), iv, sizeof iv, length) || length != ivSize ||
+            !decodeInto(view.tagSegment(), tag, sizeof tag, length) || length != tagSize)
+        {
+            return JWTStatus::decryptionFailed;
+        }
+
+        unsigned char* data = reinterpret_cast<unsigned char*>(buf);
+        size_t size;
+        if (!base64urlDecode(view.ciphertextSegment(), data, size))
+            return JWTStatus::badEncoding;
+
+        size_t cekSize = jweKeySize(header.enc);
+        unsigned char cek[maxKeySize];
+        bool ok = unwrapKey(header, encryptedKey, encryptedKeySize, cek, cekSize) &&
+            gcmDecrypt(header.enc, cek, iv, view.headerSegment(), data, size, tag);
+        OPENSSL_cleanse(cek, sizeof cek);
+        if (!ok)
+        {
+            OPENSSL_cleanse(data, size);
+            return JWTStatus::decryptionFailed;
+        }
+
+        plaintext = std::string_view(buf, size);
+        return JWTStatus::ok;
+    }
+
+    SymmetricJWEDecrypter::SymmetricJWEDecrypter(JWEAlg alg, std::string_view key, std::string kid)
+        : JWEDecrypter(std::move(kid))
+        , key_(key)
+        , alg_(alg)
+    {
+        if (alg == JWEAlg::dir)
+        {
+            if (key.size() != 16 && key.size() != 32)
+                throw JWTException("SymmetricJWEDecrypter: a direct key is 16 or 32 bytes");
+        }
+        else if (alg == JWEAlg::A128KW || alg == JWEAlg::A256KW)
+        {
+            if (key.size() != wrapKeySize(alg))
+                throw JWTException("SymmetricJWEDecrypter: key size does not match " + std::string(jweAlgName(alg)));
+        }
+        else
+        {
+            throw JWTException("SymmetricJWEDecrypter: not a symmetric key management algorithm");
+        }
+    }
+
+    SymmetricJWEDecrypter::~SymmetricJWEDecrypter()
+    {
+        OPENSSL_cleanse(key_.data(), key_.size());
+    }
+
+    bool SymmetricJWEDecrypter::unwrapKey(const JWEHeader&, const unsigned char* encryptedKey,
+        size_t encryptedKeySize, unsigned char* cek, size_t cekSize) const noexcept
+    {
+        const auto* key = reinterpret_cast<const unsigned char*>(key_.data());
+        if (alg_ != JWEAlg::dir)
+            return aesUnwrap(key, key_.size(), encryptedKey, encryptedKeySize, cek, cekSize);
+
+        // RFC 7516 section 5.2: the encrypted key is empty for "dir"
+        if (encryptedKeySize != 0 || key_.size() != cekSize)
+            return false;
+        std::memcpy(cek, key, cekSize);
+        return true;
+    }
+
+    struct PrivateKeyJWEDecrypter::Key
+    {
+        PKey pkey;
+        std::unique_ptr<EVP_MD, MDFree> oaepDigest;     // RSA-OAEP
+        std::unique_ptr<EVP_MD, MDFree> kdfDigest;      // ECDH-ES: SHA-256
+        std::string crv;
+    };
+
+    PrivateKeyJWEDecrypter::PrivateKeyJWEDecrypter(JWEAlg alg, std::string_view pem, std::string kid)
+        : JWEDecrypter(std::move(kid))
+        , key_(std::make_unique<Key>())
+        , alg_(alg)
+    {
+        std::unique_ptr<BIO, BIOFree> bio(BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size())));
+        if (bio != nullptr)
+            key_->pkey.reset(PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr));
+        if (key_->pkey == nullptr)
+            throw JWTException("PrivateKeyJWEDecrypter: cannot read private key");
+        EVP_PKEY* pkey = key_->pkey.get();
+
+        switch (alg)
+        {
+        case JWEAlg::RSA_OAEP:
+        case JWEAlg::RSA_OAEP_256:
+            if (!EVP_PKEY_is_a(pkey, "RSA"))
+                throw JWTException("PrivateKeyJWEDecrypter: RSA-OAEP needs an RSA key");
+            if (EVP_PKEY_get_bits(pkey) < static_cast<int>(minRSAModulusBits))
+                throw JWTException("PrivateKeyJWEDecrypter: RSA key shorter than 2048 bits");
+            key_->oaepDigest.reset(EVP_MD_fetch(nullptr, alg == JWEAlg::RSA_OAEP ? "SHA1" : "SHA256", nullptr));
+            if (key_->oaepDigest == nullptr)
+                throw JWTException("PrivateKeyJWEDecrypter: digest unavailable");
+            break;
+
+        case JWEAlg::ECDH_ES:
+        case JWEAlg::ECDH_ES_A128KW:
+        case JWEAlg::ECDH_ES_A256KW:
+            if (EVP_PKEY_is_a(pkey, "X25519"))
+                key_->crv = "X25519";
+            else if (EVP_PKEY_is_a(pkey, "EC"))
+            {
+                char group[64];
+                if (EVP_PKEY_get_utf8_string_param(pkey, OSSL_PKEY_PARAM_GROUP_NAME, group, sizeof group, nullptr))
+                {
+                    std::string_view name(group);
+                    key_->crv = name == "prime256v1" ? "P-256"
+                        : name == "secp384r1" ? "P-384"
+                        : name == "secp521r1" ? "P-521"
+                        : "";
+                }
+            }
+            if (key_->crv.empty())
+                throw JWTException("PrivateKeyJWEDecrypter: ECDH-ES needs a P-256, P-384, P-521 or X25519 key");
+            key_->kdfDigest.reset(EVP_MD_fetch(nullptr, "SHA256", nullptr));
+            if (key_->kdfDigest == nullptr)
+                throw JWTException("PrivateKeyJWEDecrypter: digest unavailable");
+            break;
+
+        default:
+            throw JWTException("PrivateKeyJWEDecrypter: not a private-key management algorithm");
+        }
+    }
+
+    PrivateKeyJWEDecrypter::~PrivateKeyJWEDecrypter() = default;
+
+    bool PrivateKeyJWEDecrypter::unwrapKey(const JWEHeader& header, const unsigned char* encryptedKey,
+        size_t encryptedKeySize, unsigned char* cek, size_t cekSize) const noexcept
+    {
+        if (alg_ == JWEAlg::RSA_OAEP || alg_ == JWEAlg::RSA_OAEP_256)
+            return rsaUnwrap(encryptedKey, encryptedKeySize, cek, cekSize);
+
+        // RFC 7518 section 4.6: ECDH-ES agrees on the content encryption
+        // key itself, the key wrap variants on a key that wraps it
+        if (alg_ == JWEAlg::ECDH_ES)
+            return encryptedKeySize == 0 && ecdhAgree(header, cek, cekSize);
+
+        unsigned char kek[maxKeySize];
+        size_t kekSize = wrapKeySize(alg_);
+        bool ok = ecdhAgree(header, kek, kekSize) &&
+            aesUnwrap(kek, kekSize, encryptedKey, encryptedKeySize, cek, cekSize);
+        OPENSSL_cleanse(kek, sizeof kek);
+        return ok;
+    }
+
+    bool PrivateKeyJWEDecrypter::rsaUnwrap(const unsigned char* encryptedKey, size_t encryptedKeySize,
+        unsigned char* cek, size_t cekSize) const noexcept
+    {
+        // a random key stands in for one that does not decrypt, so the
+        // failure shows only at the tag, like any other
+        if (RAND_bytes(cek, static_cast<int>(cekSize)) != 1)
+            return false;
+
+        unsigned char out[maxEncryptedKeySize];
+        size_t outSize = sizeof out;
+        std::unique_ptr<EVP_PKEY_CTX, PKeyCtxFree> ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, key_->pkey.get(), nullptr));
+        if (ctx != nullptr &&
+            EVP_PKEY_decrypt_init(ctx.get()) > 0 &&
+            EVP_PKEY_CTX_set_rsa_padding(ctx.get(), RSA_PKCS1_OAEP_PADDING) > 0 &&
+            EVP_PKEY_CTX_set_rsa_oaep_md(ctx.get(), key_->oaepDigest.get()) > 0 &&
+            EVP_PKEY_CTX_set_rsa_mgf1_md(ctx.get(), key_->oaepDigest.get()) > 0 &&
+            EVP_PKEY_decrypt(ctx.get(), out, &outSize, encryptedKey, encryptedKeySize) > 0 &&
+            outSize == cekSize)
+        {
+            std::memcpy(cek, out, cekSize);
+        }
+        OPENSSL_cleanse(out, sizeof out);
+        return true;
+    }
+
+    bool PrivateKeyJWEDecrypter::ecdhAgree(const JWEHeader& header, unsigned char* derived,
+        size_t derivedSize) const noexcept
+    {
+        if (header.epk.type() != JSONType::object)
+            return false;
+        PKey peer = importEphemeralKey(header.epk.raw(), key_->crv);
+        if (peer == nullptr)
+            return false;
+
+        unsigned char z[maxCoordinateSize];
+        size_t zSize = sizeof z;
+        std::unique_ptr<EVP_PKEY_CTX, PKeyCtxFree> ctx(EVP_PKEY_CTX_new_from_pkey(nullptr, key_->pkey.get(), nullptr));
+        if (ctx == nullptr || EVP_PKEY_derive_init(ctx.get()) <= 0 ||
+            EVP_PKEY_derive_set_peer(ctx.get(), peer.get()) <= 0 ||
+            EVP_PKEY_derive(ctx.get(), z, &zSize) <= 0)
+        {
+            return false;
+        }
+
+        // Concat KDF (NIST SP 800-56A section 5.8.1) with SHA-256, over
+        // AlgorithmID, PartyUInfo, PartyVInfo and SuppPubInfo as RFC 7518
+        // section 4.6.2 lays them out
+        std::string_view algorithm = alg_ == JWEAlg::ECDH_ES ? jweEncName(header.enc) : jweAlgName(alg_);
+        unsigned char apu[maxPartyInfoSize], apv[maxPartyInfoSize];
+        size_t apuSize, apvSize;
+        if (!partyInfo(header.apu, apu, apuSize) || !partyInfo(header.apv, apv, apvSize))
+        {
+            OPENSSL_cleanse(z, sizeof z);
+            return false;
+        }
+
+        unsigned char info[4 + 16 + 4 + maxPartyInfoSize + 4 + maxPartyInfoSize + 4];
+        unsigned char* p = putLength(info, algorithm.size());
+        std::memcpy(p, algorithm.data(), algorithm.size());
+        p = putLength(p + algorithm.size(), apuSize);
+        std::memcpy(p, apu, apuSize);
+        p = putLength(p + apuSize, apvSize);
+        std::memcpy(p, apv, apvSize);
+        p = putLength(p + apvSize, derivedSize * 8);
+
+        bool ok = true;
+        std::unique_ptr<EVP_MD_CTX, MDCtxFree> md(EVP_MD_CTX_new());
+        unsigned char round[32];
+        for (uint32_t counter = 1, done = 0; ok && done < derivedSize; ++counter, done += sizeof round)
+        {
+            unsigned char count[4];
+            putLength(count, counter);
+            ok = md != nullptr &&
+                EVP_DigestInit_ex2(md.get(), key_->kdfDigest.get(), nullptr) == 1 &&
+                EVP_DigestUpdate(md.get(), count, sizeof count) == 1 &&
+                EVP_DigestUpdate(md.get(), z, zSize) == 1 &&
+                EVP_DigestUpdate(md.get(), info, static_cast<size_t>(p - info)) == 1 &&
+                EVP_DigestFinal_ex(md.get(), round, nullptr) == 1;
+            if (ok)
+                std::memcpy(derived + done, round, std::min(sizeof round, derivedSize - done));
+        }
+        OPENSSL_cleanse(round, sizeof round);
+        OPENSSL_cleanse(z, sizeof z);
+        return ok;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// key import shared by the one-shot and batch verification paths
+
+#include <ncbi/jwa.hpp>
+#include <ncbi/jwk.hpp>
+
+#include <openssl/evp.h>
+
+#include <memory>
+#include <string_view>
+
+namespace ncbi::detail
+{
+    struct PKeyFree { void operator()(EVP_PKEY* p) const noexcept { EVP_PKEY_free(p); } };
+    using PKey = std::unique_ptr<EVP_PKEY, PKeyFree>;
+
+    // imports the public key of an RSA, EC or OKP JWK for use with "alg";
+    // null for "oct" keys, unsupported curves and RSA keys under 2048 bits
+    PKey importJWK(const JWK& key, JWTAlg alg) noexcept;
+
+    // verifies an asymmetric JWS signature in its JOSE encoding; "md" is
+    // the digest of "alg", or null for EdDSA
+    bool verifyWithPKey(EVP_PKEY* pkey, const EVP_MD* md, JWTAlg alg, std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) noexcept;
+
+    // verifies an HMAC signature with a raw secret in constant time
+    bool verifyWithSecret(std::string_view secret, JWTAlg alg, std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) noexcept;
+}
@@ -0,0 +1,346 @@
+#include <ncbi/jws.hpp>
+#include <ncbi/jwk.hpp>
+
+#include "jwk-import.hpp"
+
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/param_build.h>
+#include <openssl/rsa.h>
+
+#include <memory>
+#include <string>
+
+namespace ncbi
+{
+    namespace
+    {
+        struct PKeyCtxFree { void operator()(EVP_PKEY_CTX* p) const noexcept { EVP_PKEY_CTX_free(p); } };
+        struct MDCtxFree { void operator()(EVP_MD_CTX* p) const noexcept { EVP_MD_CTX_free(p); } };
+        struct MDFree { void operator()(EVP_MD* p) const noexcept { EVP_MD_free(p); } };
+        struct BNFree { void operator()(BIGNUM* p) const noexcept { BN_free(p); } };
+        struct ParamBldFree { void operator()(OSSL_PARAM_BLD* p) const noexcept { OSSL_PARAM_BLD_free(p); } };
+        struct ParamFree { void operator()(OSSL_PARAM* p) const noexcept { OSSL_PARAM_free(p); } };
+        struct ECDSASigFree { void operator()(ECDSA_SIG* p) const noexcept { ECDSA_SIG_free(p); } };
+
+        using detail::PKey;
+
+        // RFC 7518 section 3.3
+        constexpr size_t minRSAModulusBytes = 2048 / 8;
+
+        const EVP_MD* digestFor(JWTAlg alg) noexcept
+        {
+            switch (algDigestSize(alg))
+            {
+            case 32: return EVP_sha256();
+            case 48: return EVP_sha384();
+            case 64: return EVP_sha512();
+            default: return nullptr;
+            }
+        }
+
+        size_t ecCoordinateSize(JWTAlg alg) noexcept
+        {
+            switch (alg)
+            {
+            case JWTAlg::ES256: return 32;
+            case JWTAlg::ES384: return 48;
+            case JWTAlg::ES512: return 66;
+            default:            return 0;
+            }
+        }
+
+        const char* ecGroupName(std::string_view crv) noexcept
+        {
+            if (crv == "P-256")
+                return "prime256v1";
+            if (crv == "P-384")
+                return "secp384r1";
+            if (crv == "P-521")
+                return "secp521r1";
+            return nullptr;
+        }
+
+        PKey fromData(const char* type, OSSL_PARAM_BLD* bld)
+        {
+            std::unique_ptr<OSSL_PARAM, ParamFree> params(OSSL_PARAM_BLD_to_param(bld));
+            std::unique_ptr<EVP_PKEY_CTX, PKeyCtxFree> ctx(EVP_PKEY_CTX_new_from_name(nullptr, type, nullptr));
+            if (params == nullptr || ctx == nullptr || EVP_PKEY_fromdata_init(ctx.get()) <= 0)
+                return nullptr;
+
+            EVP_PKEY* pkey = nullptr;
+            if (EVP_PKEY_fromdata(ctx.get(), &pkey, EVP_PKEY_PUBLIC_KEY, params.get()) <= 0)
+                return nullptr;
+            return PKey(pkey);
+        }
+
+        PKey importRSA(const JWK& key)
+        {
+            // the modulus may carry leading zero octets; count significant ones
+            size_t first = key.n.find_first_not_of('\0');
+            if (first == std::string::npos || key.n.size() - first < minRSAModulusBytes)
+                return nullptr;
+
+            auto bytes = [](const std::string& s) { return reinterpret_cast<const unsigned char*>(s.data()); };
+            std::unique_ptr<BIGNUM, BNFree> n(BN_bin2bn(bytes(key.n), static_cast<int>(key.n.size()), nullptr));
+            std::unique_ptr<BIGNUM, BNFree> e(BN_bin2bn(bytes(key.e), static_cast<int>(key.e.size()), nullptr));
+            std::unique_ptr<OSSL_PARAM_BLD, ParamBldFree> bld(OSSL_PARAM_BLD_new());
+            if (n == nullptr || e == nullptr || bld == nullptr ||
+                !OSSL_PARAM_BLD_push_BN(bld.get(), OSSL_PKEY_PARAM_RSA_N, n.get()) ||
+                !OSSL_PARAM_BLD_push_BN(bld.get(), OSSL_PKEY_PARAM_RSA_E, e.get()))
+            {
+                return nullptr;
+            }
+            return fromData("RSA", bld.get());
+        }
+
+        PKey importEC(const JWK& key, size_t coordinateSize)
+        {
+            const char* group = ecGroupName(key.crv);
+            if (group == nullptr || key.x.size() != coordinateSize || key.y.size() != coordinateSize)
+                return nullptr;
+
+            // uncompressed SEC1 point
+            std::string point;
+            point.reserve(1 + 2 * coordinateSize);
+            point += '\x04';
+            point += key.x;
+            point += key.y;
+
+            std::unique_ptr<OSSL_PARAM_BLD, ParamBldFree> bld(OSSL_PARAM_BLD_new());
+            if (bld == nullptr ||
+                !OSSL_PARAM_BLD_push_utf8_string(bld.get(), OSSL_PKEY_PARAM_GROUP_NAME, group, 0) ||
+                !OSSL_PARAM_BLD_push_octet_string(bld.get(), OSSL_PKEY_PARAM_PUB_KEY, point.data(), point.size()))
+            {
+                return nullptr;
+            }
+            return fromData("EC", bld.get());
+        }
+
+        PKey importOKP(const JWK& key)
+        {
+            int type = key.crv == "Ed25519" ? EVP_PKEY_ED25519
+                : key.crv == "Ed448" ? EVP_PKEY_ED448
+                : EVP_PKEY_NONE;
+            if (type == EVP_PKEY_NONE)
+                return nullptr;
+
+            return PKey(EVP_PKEY_new_raw_public_key(type, nullptr,
+                reinterpret_cast<const unsigned char*>(key.x.data()), key.x.size()));
+        }
+
+        // JWS carries ECDSA signatures as fixed-width R || S (RFC 7518
+        // section 3.4); OpenSSL wants DER
+        bool ecdsaToDER(const unsigned char* signature, size_t size, size_t coordinateSize,
+            unsigned char* der, size_t& derSize) noexcept
+        {
+            if (size != 2 * coordinateSize)
+                return false;
+
+            std::unique_ptr<ECDSA_SIG, ECDSASigFree> sig(ECDSA_SIG_new());
+            BIGNUM* r = BN_bin2bn(signature, static_cast<int>(coordinateSize), nullptr);
+            BIGNUM* s = BN_bin2bn(signature + coordinateSize, static_cast<int>(coordinateSize), nullptr);
+            if (sig == nullptr || r == nullptr || s == nullptr || !ECDSA_SIG_set0(sig.get(), r, s))
+            {
+                BN_free(r);
+                BN_free(s);
+                return false;
+            }
+
+            unsigned char* out = der;
+            int len = i2d_ECDSA_SIG(sig.get(), &out);
+            if (len <= 0)
+                return false;
+            derSize = static_cast<size_t>(len);
+            return true;
+        }
+
+        // readies "ctx" to verify with "pkey" under "alg"
+        bool initVerify(EVP_MD_CTX* ctx, EVP_PKEY* pkey, const EVP_MD* md, JWTAlg alg) noexcept
+        {
+            EVP_PKEY_CTX* pctx = nullptr;
+            if (EVP_DigestVerifyInit(ctx, &pctx, md, nullptr, pkey) <= 0)
+                return false;
+
+            if (algFamily(alg) == JWTAlgFamily::rsaPSS)
+            {
+                // RFC 7518 section 3.5: MGF1 with the same hash, salt as long as the hash
+                if (EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) <= 0 ||
+                    EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, RSA_PSS_SALTLEN_DIGEST) <= 0 ||
+                    EVP_PKEY_CTX_set_rsa_mgf1_md(pctx, md) <= 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // verifies a signature in its JOSE encoding with a readied "ctx"
+        bool digestVerify(EVP_MD_CTX* ctx, JWTAlg alg, std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) noexcept
+        {
+            auto input = reinterpret_cast<const unsigned char*>(signingInput.data());
+            if (algFamily(alg) != JWTAlgFamily::ecdsa)
+                return EVP_DigestVerify(ctx, signature, signatureSize, input, signingInput.size()) == 1;
+
+            unsigned char der[2 * 66 + 16];
+            size_t derSize;
+            return ecdsaToDER(signature, signatureSize, ecCoordinateSize(alg), der, derSize) &&
+                EVP_DigestVerify(ctx, der, derSize, input, signingInput.size()) == 1;
+        }
+    }
+
+    namespace detail
+    {
+        PKey importJWK(const JWK& key, JWTAlg alg) noexcept
+        {
+            try
+            {
+                switch (algFamily(alg))
+                {
+                case JWTAlgFamily::rsa:
+                case JWTAlgFamily::rsaPSS:
+                    return key.kty == "RSA" ? importRSA(key) : nullptr;
+                case JWTAlgFamily::ecdsa:
+                    return key.kty == "EC" ? importEC(key, ecCoordinateSize(alg)) : nullptr;
+                case JWTAlgFamily::eddsa:
+                    return key.kty == "OKP" ? importOKP(key) : nullptr;
+                case JWTAlgFamily::hmac:
+                case JWTAlgFamily::none:
+                    break;
+                }
+            }
+            catch (...)
+            {
+                // allocation failure while importing the key
+            }
+            return nullptr;
+        }
+
+        bool verifyWithPKey(EVP_PKEY* pkey, const EVP_MD* md, JWTAlg alg, std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) noexcept
+        {
+            std::unique_ptr<EVP_MD_CTX, MDCtxFree> ctx(EVP_MD_CTX_new());
+            return ctx != nullptr && initVerify(ctx.get(), pkey, md, alg) &&
+                digestVerify(ctx.get(), alg, signingInput, signature, signatureSize);
+        }
+
+        bool verifyWithSecret(std::string_view secret, JWTAlg alg, std::string_view signingInput,
+            const unsigned char* signature, size_t signatureSize) noexcept
+        {
+            if (secret.size() < algDigestSize(alg) || signatureSize != algDigestSize(alg))
+                return false;
+
+            unsigned char mac[EVP_MAX_MD_SIZE];
+            unsigned int macSize = 0;
+            if (HMAC(digestFor(alg), secret.data(), static_cast<int>(secret.size()),
+                    reinterpret_cast<const unsigned char*>(signingInput.data()), signingInput.size(),
+                    mac, &macSize) == nullptr)
+            {
+                return false;
+            }
+            return macSize == signatureSize && CRYPTO_memcmp(mac, signature, macSize) == 0;
+        }
+    }
+
+    bool verifyWithJWK(const JWK& key, JWTAlg alg, std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) noexcept
+    {
+        if (!key.accepts(alg))
+            return false;
+
+        if (algFamily(alg) == JWTAlgFamily::hmac)
+            return detail::verifyWithSecret(key.k, alg, signingInput, signature, signatureSize);
+
+        PKey pkey = detail::importJWK(key, alg);
+        return pkey != nullptr &&
+            detail::verifyWithPKey(pkey.get(), digestFor(alg), alg, signingInput, signature, signatureSize);
+    }
+
+    struct PublicKeyVerifier::Context
+    {
+        PKey pkey;
+        std::unique_ptr<EVP_MD, MDFree> md;     // null for EdDSA
+
+        // initialized for pkey once; each verify() works on a copy
+        std::unique_ptr<EVP_MD_CTX, MDCtxFree> prototype;
+    };
+
+    PublicKeyVerifier::PublicKeyVerifier(const JWK& key, JWTAlg alg)
+        : context_(std::make_unique<Context>())
+        , alg_(alg)
+    {
+        JWTAlgFamily family = algFamily(alg);
+        if (family == JWTAlgFamily::none || family == JWTAlgFamily::hmac)
+            throw JWTException("PublicKeyVerifier: not a public-key algorithm");
+        if (!key.accepts(alg))
+            throw JWTException("PublicKeyVerifier: key does not accept the algorithm");
+
+        context_->pkey = detail::importJWK(key, alg);
+        if (context_->pkey == nullptr)
+            throw JWTException("PublicKeyVerifier: cannot import key");
+
+        // an explicit fetch spares every EVP_DigestVerifyInit() the
+        // provider lookup that EVP_sha256() and friends imply
+        if (family != JWTAlgFamily::eddsa)
+        {
+            context_->md.reset(EVP_MD_fetch(nullptr, EVP_MD_get0_name(digestFor(alg)), nullptr));
+            if (context_->md == nullptr)
+                throw JWTException("PublicKeyVerifier: digest unavailable");
+        }
+
+        // EVP_DigestVerifyInit() looks up the signature implementation and
+        // sets the key and the PSS parameters up; copying its result is
+        // cheaper than repeating it per token
+        context_->prototype.reset(EVP_MD_CTX_new());
+        if (context_->prototype == nullptr ||
+            !initVerify(context_->prototype.get(), context_->pkey.get(), context_->md.get(), alg))
+        {
+            throw JWTException("PublicKeyVerifier: cannot initialize verification");
+        }
+
+        // OpenSSL builds the Montgomery context of an RSA modulus on the
+        // first public-key operation and keeps it with the key; a dummy
+        // all-zero signature runs that operation now rather than on the
+        // first real token
+        if (family == JWTAlgFamily::rsa || family == JWTAlgFamily::rsaPSS)
+        {
+            std::string zero(static_cast<size_t>(EVP_PKEY_get_size(context_->pkey.get())), '\0');
+            verify({}, reinterpret_cast<const unsigned char*>(zero.data()), zero.size());
+        }
+    }
+
+    PublicKeyVerifier::~PublicKeyVerifier() = default;
+
+    bool PublicKeyVerifier::verify(std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) const noexcept
+    {
+        // the copy still duplicates the key context, an allocation per
+        // call, but as a throwaway it may be finalized in place instead of
+        // being duplicated once more; it is reset afterwards so that an
+        // idle thread does not keep a rotated-out key alive
+        thread_local std::unique_ptr<EVP_MD_CTX, MDCtxFree> scratch(EVP_MD_CTX_new());
+        if (scratch == nullptr || EVP_MD_CTX_copy_ex(scratch.get(), context_->prototype.get()) != 1)
+            return false;
+        EVP_MD_CTX_set_flags(scratch.get(), EVP_MD_CTX_FLAG_FINALISE);
+
+        bool verified = digestVerify(scratch.get(), alg_, signingInput, signature, signatureSize);
+        EVP_MD_CTX_reset(scratch.get());
+        return verified;
+    }
+
+    std::unique_ptr<const JWSVerifier> makeJWSVerifier(const JWK& key, JWTAlg alg)
+    {
+        if (algFamily(alg) == JWTAlgFamily::hmac)
+        {
+            if (!key.accepts(alg))
+                throw JWTException("makeJWSVerifier: key does not accept the algorithm");
+            return std::make_unique<HMACVerifier>(alg, key.k);
+        }
+        return std::make_unique<PublicKeyVerifier>(key, alg);
+    }
+}
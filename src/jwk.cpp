@@ -0,0 +1,305 @@
+#include <ncbi/jwk.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+
+namespace ncbi
+{
+    namespace
+    {
+        std::string base64urlMember(const JSONValueView& value, std::string_view member)
+        {
+            std::string text = jsonString(value, "JWK", member);
+            std::string out(base64urlDecodedSize(text.size()), '\0');
+            size_t written;
+            if (!base64urlDecode(text, out.data(), written))
+                throw JWTException("JWK: member '" + std::string(member) + "' is not base64url");
+            out.resize(written);
+            return out;
+        }
+
+        bool supportedKeyType(std::string_view kty) noexcept
+        {
+            return kty == "RSA" || kty == "EC" || kty == "OKP" || kty == "oct";
+        }
+
+        void requireMembers(const JWK& key)
+        {
+            bool complete = true;
+            if (key.kty == "RSA")
+                complete = !key.n.empty() && !key.e.empty();
+            else if (key.kty == "EC")
+                complete = !key.crv.empty() && !key.x.empty() && !key.y.empty();
+            else if (key.kty == "OKP")
+                complete = !key.crv.empty() && !key.x.empty();
+            else if (key.kty == "oct")
+                complete = !key.k.empty();
+
+            if (!complete)
+                throw JWTException("JWK: '" + key.kty + "' key '" + key.kid + "' lacks required members");
+        }
+    }
+
+    namespace
+    {
+        // appends "name":"value" for the thumbprint input, escaping what
+        // JSON requires; the members are base64url or short ASCII names,
+        // so in practice nothing is
+        void appendMember(std::string& json, std::string_view name, std::string_view value)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+
+            json += json.empty() ? "{\"" : ",\"";
+            json += name;
+            json += "\":\"";
+            for (char c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    json += '\\';
+                    json += c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    json += "\\u00";
+                    json += hex[static_cast<unsigned char>(c) >> 4];
+                    json += hex[c & 15];
+                }
+                else
+                    json += c;
+            }
+            json += '"';
+        }
+
+        void appendBase64urlMember(std::string& json, std::string_view name, std::string_view octets)
+        {
+            std::string encoded(base64urlEncodedSize(octets.size()), '\0');
+            base64urlEncode(octets.data(), octets.size(), encoded.data());
+            appendMember(json, name, encoded);
+        }
+    }
+
+    std::string jwkThumbprint(const JWK& key)
+    {
+        // the required members in lexicographic order, RFC 7638 section 3.2
+        std::string json;
+        if (key.kty == "RSA")
+        {
+            appendBase64urlMember(json, "e", key.e);
+            appendMember(json, "kty", key.kty);
+            appendBase64urlMember(json, "n", key.n);
+        }
+        else if (key.kty == "EC")
+        {
+            appendMember(json, "crv", key.crv);
+            appendMember(json, "kty", key.kty);
+            appendBase64urlMember(json, "x", key.x);
+            appendBase64urlMember(json, "y", key.y);
+        }
+        else if (key.kty == "OKP")
+        {
+            appendMember(json, "crv", key.crv);
+            appendMember(json, "kty", key.kty);
+            appendBase64urlMember(json, "x", key.x);
+        }
+        else
+            throw JWTException("JWK: no thumbprint for a '" + key.kty + "' key");
+        json += '}';
+
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(json.data()), json.size(), digest);
+        static_assert(base64urlEncodedSize(SHA256_DIGEST_LENGTH) == jwkThumbprintSize);
+        std::string thumbprint(jwkThumbprintSize, '\0');
+        base64urlEncode(digest, sizeof digest, thumbprint.data());
+        return thumbprint;
+    }
+
+    bool JWK::accepts(JWTAlg a) const noexcept
+    {
+        if (alg != JWTAlg::unknown && alg != a)
+            return false;
+
+        switch (algFamily(a))
+        {
+        case JWTAlgFamily::hmac:
+            return kty == "oct";
+        case JWTAlgFamily::rsa:
+        case JWTAlgFamily::rsaPSS:
+            return kty == "RSA";
+        case JWTAlgFamily::ecdsa:
+            if (kty != "EC")
+                return false;
+            switch (a)
+            {
+            case JWTAlg::ES256: return crv == "P-256";
+            case JWTAlg::ES384: return crv == "P-384";
+            case JWTAlg::ES512: return crv == "P-521";
+            default:            return false;
+            }
+        case JWTAlgFamily::eddsa:
+            return kty == "OKP" && (crv == "Ed25519" || crv == "Ed448");
+        case JWTAlgFamily::none:
+            break;
+        }
+        return false;
+    }
+
+    JWK JWK::parse(std::string_view json)
+    {
+        JWK key;
+
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            throw JWTException("JWK: not a JSON object");
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            if (rawJSONStringEquals(name, "kty"))
+                key.kty = jsonString(value, "JWK", "kty");
+            else if (rawJSONStringEquals(name, "kid"))
+                key.kid = jsonString(value, "JWK", "kid");
+            else if (rawJSONStringEquals(name, "use"))
+                key.use = jsonString(value, "JWK", "use");
+            else if (rawJSONStringEquals(name, "crv"))
+                key.crv = jsonString(value, "JWK", "crv");
+            else if (rawJSONStringEquals(name, "alg"))
+            {
+                // an unrecognized "alg" makes the key unusable rather than
+                // unrestricted
+                key.alg = parseAlg(jsonString(value, "JWK", "alg"));
+                if (key.alg == JWTAlg::unknown)
+                    key.alg = JWTAlg::none;
+            }
+            else if (rawJSONStringEquals(name, "n"))
+                key.n = base64urlMember(value, "n");
+            else if (rawJSONStringEquals(name, "e"))
+                key.e = base64urlMember(value, "e");
+            else if (rawJSONStringEquals(name, "x"))
+                key.x = base64urlMember(value, "x");
+            else if (rawJSONStringEquals(name, "y"))
+                key.y = base64urlMember(value, "y");
+            else if (rawJSONStringEquals(name, "k"))
+                key.k = base64urlMember(value, "k");
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            throw JWTException("JWK: malformed JSON");
+        if (key.kty.empty())
+            throw JWTException("JWK: missing 'kty'");
+
+        if (supportedKeyType(key.kty))
+            requireMembers(key);
+        return key;
+    }
+
+    JWKSet::JWKSet() = default;
+
+    JWKSet::JWKSet(std::vector<JWK> keys)
+        : keys_(std::move(keys))
+    {
+        std::stable_sort(keys_.begin(), keys_.end(),
+            [](const JWK& a, const JWK& b) { return a.kid < b.kid; });
+
+        verifiers_.resize(keys_.size());
+        for (size_t i = 0; i < keys_.size(); ++i)
+        {
+            for (int a = static_cast<int>(JWTAlg::HS256); a <= static_cast<int>(JWTAlg::EdDSA); ++a)
+            {
+                JWTAlg alg = static_cast<JWTAlg>(a);
+                if (!keys_[i].accepts(alg))
+                    continue;
+
+                // a key that will not import stays in the set, so tokens
+                // naming it fail with badSignature rather than unknownKey
+                try
+                {
+                    verifiers_[i].push_back(makeJWSVerifier(keys_[i], alg));
+                }
+                catch (const JWTException&)
+                {
+                }
+            }
+        }
+    }
+
+    JWKSet::~JWKSet() = default;
+
+    const JWSVerifier* JWKSet::verifier(const JWK& key, JWTAlg alg) const noexcept
+    {
+        size_t i = static_cast<size_t>(&key - keys_.data());
+        if (i >= keys_.size())
+            return nullptr;
+
+        for (const auto& v : verifiers_[i])
+        {
+            if (v->alg() == alg)
+                return v.get();
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<const JWKSet> JWKSet::parse(std::string_view json)
+    {
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            throw JWTException("JWKS: not a JSON object");
+
+        std::vector<JWK> keys;
+        bool sawKeys = false;
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            if (!rawJSONStringEquals(name, "keys"))
+            {
+                reader.skipValue();
+                continue;
+            }
+
+            sawKeys = true;
+            if (!reader.enterArray())
+                break;
+
+            while (reader.nextElement())
+            {
+                JSONValueView element;
+                if (!reader.readValue(element))
+                    break;
+                if (element.type() != JSONType::object)
+                    throw JWTException("JWKS: 'keys' element is not an object");
+
+                JWK key = JWK::parse(element.raw());
+                if (supportedKeyType(key.kty) && key.use != "enc")
+                    keys.push_back(std::move(key));
+            }
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            throw JWTException("JWKS: malformed JSON");
+        if (!sawKeys)
+            throw JWTException("JWKS: missing 'keys'");
+
+        return std::make_unique<const JWKSet>(std::move(keys));
+    }
+
+    const JWK* JWKSet::find(std::string_view kid, JWTAlg alg) const noexcept
+    {
+        auto it = std::lower_bound(keys_.begin(), keys_.end(), kid,
+            [](const JWK& key, std::string_view k) { return key.kid < k; });
+
+        for (; it != keys_.end() && it->kid == kid; ++it)
+        {
+            if (it->accepts(alg))
+                return &*it;
+        }
+        return nullptr;
+    }
+}
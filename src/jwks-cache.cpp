@@ -0,0 +1,222 @@
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+
+namespace ncbi
+{
+    JWKSCache::Snapshot::Snapshot(const JWKSCache& cache) noexcept
+        : cache_(cache)
+    {
+        if (const Published* p = cache.published_.load(guard_))
+        {
+            keys_ = p->keys.get();
+            generation_ = p->generation;
+        }
+    }
+
+    const JWK* JWKSCache::Snapshot::find(std::string_view kid, JWTAlg alg) const noexcept
+    {
+        const JWK* key = keys_ != nullptr ? keys_->find(kid, alg) : nullptr;
+        if (key == nullptr)
+            cache_.requestRefresh();
+        return key;
+    }
+
+    JWKSCache::JWKSCache(std::string uri, std::shared_ptr<Fetcher> fetcher, JWKSCacheOptions options)
+        : uri_(std::move(uri))
+        , fetcher_(std::move(fetcher))
+        , options_(options)
+    {
+    }
+
+    JWKSCache::~JWKSCache()
+    {
+        stop();
+    }
+
+    void JWKSCache::start()
+    {
+        bool ok;
+        Clock::time_point next = fetchAndPublish(ok);
+        if (!ok)
+            throw JWTException("JWKSCache: initial fetch of '" + uri_ + "' failed");
+
+        std::lock_guard<std::mutex> lock(waitersMutex_);
+        refresher_ = std::jthread([this, next](std::stop_token stop) { run(stop, next); });
+        running_ = true;
+    }
+
+    void JWKSCache::stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(waitersMutex_);
+            if (!running_)
+                return;
+            running_ = false;
+        }
+        refresher_.request_stop();
+        refresher_.join();
+
+        // no fetch will notify the callbacks accepted before the flag fell
+        notifyWaiters();
+    }
+
+    bool JWKSCache::refresh()
+    {
+        bool ok;
+        fetchAndPublish(ok);
+        notifyWaiters();
+        return ok;
+    }
+
+    bool JWKSCache::whenRefreshed(uint64_t seen, std::function<void()> callback)
+    {
+        std::lock_guard<std::mutex> lock(waitersMutex_);
+
+        // publication precedes the notification, which takes this mutex,
+        // so a waiter either sees the new generation here or is notified
+        if (generation() != seen || !running_)
+            return false;
+
+        // a fetch in progress will notify; otherwise one must be allowed
+        if (!fetching_.load(std::memory_order_acquire) &&
+            Clock::now() < lastFetch_.load(std::memory_order_relaxed) + options_.minRefreshInterval)
+        {
+            return false;
+        }
+
+        waiters_.push_back(std::move(callback));
+        requestRefresh();
+        return true;
+    }
+
+    void JWKSCache::notifyWaiters() noexcept
+    {
+        std::vector<std::function<void()>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(waitersMutex_);
+            waiters.swap(waiters_);
+        }
+        for (auto& waiter : waiters)
+            waiter();
+    }
+
+    void JWKSCache::requestRefresh() const noexcept
+    {
+        // only the request that raises the flag touches the mutex, so a
+        // burst of misses on unknown keys costs one notification; taking
+        // the mutex closes the window in which the refresher has tested
+        // the flag but not yet begun waiting
+        if (refreshRequested_.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wakeup_.notify_one();
+        }
+        catch (...)
+        {
+            // the scheduled refresh still happens
+        }
+    }
+
+    JWKSCache::Clock::time_point JWKSCache::fetchAndPublish(bool& ok)
+    {
+        std::lock_guard<std::mutex> lock(fetchMutex_);
+
+        // requests raised while this fetch runs ask for a newer one
+        refreshRequested_.store(false, std::memory_order_release);
+        Clock::time_point now = Clock::now();
+        lastFetch_.store(now, std::memory_order_relaxed);
+        ok = false;
+
+        fetching_.store(true, std::memory_order_release);
+        struct Done
+        {
+            std::atomic<bool>& fetching;
+            ~Done() { fetching.store(false, std::memory_order_release); }
+        } done { fetching_ };
+
+        auto failed = [this, now]
+        {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            return now + options_.retryInterval;
+        };
+
+        FetchResponse response;
+        try
+        {
+            response = fetcher_->get(uri_);
+        }
+        catch (...)
+        {
+            return failed();
+        }
+
+        if (response.status != 200)
+            return failed();
+
+        // anything thrown while the set is built, a bad key as much as an
+        // allocation failing in OpenSSL, leaves the current set in service
+        try
+        {
+            std::unique_ptr<const JWKSet> keys = JWKSet::parse(response.body);
+            published_.publish(std::make_unique<const Published>(Published { std::move(keys), ++generation_ }));
+        }
+        catch (...)
+        {
+            return failed();
+        }
+        ok = true;
+
+        std::chrono::seconds maxAge = parseCacheControlMaxAge(response.cacheControl).value_or(options_.defaultMaxAge);
+        maxAge = std::clamp(maxAge, options_.minRefreshInterval, options_.maxRefreshInterval);
+        return now + maxAge;
+    }
+
+    void JWKSCache::run(std::stop_token stop, Clock::time_point next)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto requested = [this] { return refreshRequested_.load(std::memory_order_acquire); };
+
+        while (!stop.stop_requested())
+        {
+            if (wakeup_.wait_until(lock, stop, next, requested))
+            {
+                // an early refresh still honors the minimum interval
+                Clock::time_point earliest = lastFetch_.load(std::memory_order_relaxed) + options_.minRefreshInterval;
+                if (Clock::now() < earliest)
+                {
+                    next = std::min(next, earliest);
+                    wakeup_.wait_until(lock, stop, next, [] { return false; });
+                }
+            }
+            else if (Clock::now() < next)
+            {
+                continue;
+            }
+
+            if (stop.stop_requested())
+                break;
+
+            lock.unlock();
+            try
+            {
+                bool ok;
+                next = fetchAndPublish(ok);
+            }
+            catch (...)
+            {
+                // nothing may escape the thread, which would terminate
+                // the process; the refresh is retried as after any failure
+                failures_.fetch_add(1, std::memory_order_relaxed);
+                next = Clock::now() + options_.retryInterval;
+            }
+            notifyWaiters();
+            lock.lock();
+        }
+    }
+}
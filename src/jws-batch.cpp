@@ -0,0 +1,153 @@
+#include <ncbi/jws-batch.hpp>
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <algorithm>
+
+namespace ncbi
+{
+    namespace
+    {
+        constexpr size_t maxHeaderSize = 2048;
+
+        struct Resolved
+        {
+            const JWK* key = nullptr;
+            JWTAlg alg = JWTAlg::unknown;
+        };
+
+        // a run of tokens sharing one key and algorithm: order[begin, end)
+        struct Group
+        {
+            size_t begin;
+            size_t end;
+        };
+
+        JWTStatus resolve(std::string_view token, const JWKSet& keys, Resolved& resolved) noexcept
+        {
+            JWTView view;
+            JWTStatus status = JWTView::parse(token, view);
+            if (status != JWTStatus::ok)
+                return status;
+
+            if (view.headerSize() > maxHeaderSize)
+                return JWTStatus::bufferTooSmall;
+            char headerBuf[maxHeaderSize];
+            std::string_view headerJSON;
+            JWTHeader header;
+            if ((status = view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON)) != JWTStatus::ok ||
+                (status = JWTHeader::parse(headerJSON, header)) != JWTStatus::ok)
+            {
+                return status;
+            }
+
+            if (header.alg == JWTAlg::unknown || header.alg == JWTAlg::none)
+                return JWTStatus::unsupportedAlg;
+            if (header.hasCrit)
+                return JWTStatus::unsupportedCrit;
+
+            std::string_view kid;
+            if (!header.kid.raw().empty())
+            {
+                if (header.kid.type() != JSONType::string)
+                    return JWTStatus::badJSON;
+                std::string_view raw = header.kid.rawString();
+                char* dst = headerBuf + (raw.data() - headerBuf);
+                size_t length;
+                if (!unescapeJSONString(raw, dst, length))
+                    return JWTStatus::badJSON;
+                kid = std::string_view(dst, length);
+            }
+
+            resolved.key = keys.find(kid, header.alg);
+            resolved.alg = header.alg;
+            return resolved.key != nullptr ? JWTStatus::ok : JWTStatus::unknownKey;
+        }
+
+        JWTStatus checkSignature(std::string_view token, const JWSVerifier& verifier) noexcept
+        {
+            JWTView view;
+            JWTStatus status = JWTView::parse(token, view);
+            if (status != JWTStatus::ok)
+                return status;
+
+            unsigned char signature[maxSignatureSize];
+            size_t signatureSize;
+            if ((status = view.decodeSignature(signature, sizeof signature, signatureSize)) != JWTStatus::ok)
+                return status;
+
+            return verifier.verify(view.signingInput(), signature, signatureSize)
+                ? JWTStatus::ok
+                : JWTStatus::badSignature;
+        }
+
+        template<class F>
+        void forEachChunk(ThreadPool* pool, size_t chunks, F&& fn)
+        {
+            if (pool != nullptr && chunks > 1)
+                pool->parallelFor(chunks, fn);
+            else
+            {
+                for (size_t i = 0; i < chunks; ++i)
+                    fn(i);
+            }
+        }
+    }
+
+    std::vector<JWTStatus> verifyJWSBatch(std::span<const std::string_view> tokens,
+        const JWKSet& keys, const JWSBatchOptions& options)
+    {
+        const size_t grain = std::max<size_t>(options.grainSize, 1);
+        std::vector<JWTStatus> status(tokens.size(), JWTStatus::ok);
+        std::vector<Resolved> resolved(tokens.size());
+
+        // headers and keys, in parallel over contiguous chunks
+        forEachChunk(options.pool, (tokens.size() + grain - 1) / grain, [&](size_t chunk)
+        {
+            size_t end = std::min(tokens.size(), (chunk + 1) * grain);
+            for (size_t i = chunk * grain; i < end; ++i)
+                status[i] = resolve(tokens[i], keys, resolved[i]);
+        });
+
+        // group resolved tokens by key and algorithm
+        std::vector<size_t> order;
+        order.reserve(tokens.size());
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (status[i] == JWTStatus::ok)
+                order.push_back(i);
+        }
+        auto groupKey = [&](size_t i) { return std::pair(resolved[i].key, resolved[i].alg); };
+        std::stable_sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return groupKey(a) < groupKey(b); });
+
+        // groups larger than the grain are split so the pool stays busy
+        std::vector<Group> groups;
+        for (size_t begin = 0; begin < order.size(); )
+        {
+            size_t end = begin + 1;
+            while (end < order.size() && end - begin < grain && groupKey(order[end]) == groupKey(order[begin]))
+                ++end;
+            groups.push_back({ begin, end });
+            begin = end;
+        }
+
+        // signatures, each group sharing one prebuilt verifier
+        forEachChunk(options.pool, groups.size(), [&](size_t g)
+        {
+            const Group& group = groups[g];
+            const Resolved& first = resolved[order[group.begin]];
+            const JWSVerifier* verifier = keys.verifier(*first.key, first.alg);
+
+            for (size_t k = group.begin; k < group.end; ++k)
+            {
+                size_t i = order[k];
+                status[i] = verifier != nullptr
+                    ? checkSignature(tokens[i], *verifier)
+                    : JWTStatus::badSignature;
+            }
+        });
+
+        return status;
+    }
+}
@@ -0,0 +1,391 @@
+#include <ncbi/jws-signer.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include "ecdsa-presign.hpp"
+#include "hmac-state.hpp"
+
+#include <cstring>
+
+namespace ncbi
+{
+    namespace
+    {
+        struct PKeyFree { void operator()(EVP_PKEY* p) const noexcept { EVP_PKEY_free(p); } };
+        struct PKeyCtxFree { void operator()(EVP_PKEY_CTX* p) const noexcept { EVP_PKEY_CTX_free(p); } };
+        struct MDCtxFree { void operator()(EVP_MD_CTX* p) const noexcept { EVP_MD_CTX_free(p); } };
+        struct MDFree { void operator()(EVP_MD* p) const noexcept { EVP_MD_free(p); } };
+        struct BIOFree { void operator()(BIO* p) const noexcept { BIO_free(p); } };
+
+        // RFC 7518 section 3.3
+        constexpr int minRSAModulusBits = 2048;
+
+        // OSSL_SIGNATURE_PARAM_NONCE_TYPE, from OpenSSL 3.2 on; 1 selects RFC 6979
+        constexpr const char* nonceTypeParam = "nonce-type";
+
+        const char* digestName(JWTAlg alg) noexcept
+        {
+            switch (algDigestSize(alg))
+            {
+            case 32: return "SHA256";
+            case 48: return "SHA384";
+            case 64: return "SHA512";
+            default: return nullptr;
+            }
+        }
+
+        size_t ecCoordinateSize(JWTAlg alg) noexcept
+        {
+            switch (alg)
+            {
+            case JWTAlg::ES256: return 32;
+            case JWTAlg::ES384: return 48;
+            case JWTAlg::ES512: return 66;
+            default:            return 0;
+            }
+        }
+
+        // reads one DER INTEGER at "p" into a fixed-width big-endian field
+        bool derInteger(const unsigned char*& p, const unsigned char* end, unsigned char* out, size_t width) noexcept
+        {
+            if (end - p < 2 || p[0] != 0x02)
+                return false;
+            size_t len = p[1];
+            p += 2;
+            if (len == 0 || len > static_cast<size_t>(end - p))
+                return false;
+
+            // drop the sign octet and any other leading zeros
+            const unsigned char* digits = p;
+            p += len;
+            while (len > 0 && *digits == 0)
+            {
+                ++digits;
+                --len;
+            }
+            if (len > width)
+                return false;
+
+            std::memset(out, 0, width - len);
+            std::memcpy(out + width - len, digits, len);
+            return true;
+        }
+
+        // OpenSSL emits ECDSA signatures as DER SEQUENCE { r, s }; JWS wants
+        // fixed-width R || S (RFC 7518 section 3.4)
+        bool derToJOSE(const unsigned char* der, size_t size, size_t width, unsigned char* out) noexcept
+        {
+            const unsigned char* p = der;
+            const unsigned char* end = der + size;
+            if (size < 2 || p[0] != 0x30)
+                return false;
+
+            // P-521 signatures exceed 127 octets and take the long form
+            size_t len = p[1];
+            p += 2;
+            if (len == 0x81)
+            {
+                if (p == end)
+                    return false;
+                len = *p++;
+            }
+            if (len != static_cast<size_t>(end - p))
+                return false;
+
+            return derInteger(p, end, out, width) && derInteger(p, end, out + width, width) && p == end;
+        }
+
+        // the padded key is hashed once per context; signing hashes only
+        // the signing input and the inner digest
+        class HMACContext final : public SigningContext
+        {
+        public:
+            HMACContext(JWTAlg alg, const std::string& secret)
+                : key_(alg, secret)
+            {
+            }
+
+            bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept override
+            {
+                key_.mac(signingInput, signature);
+                size = key_.size();
+                return true;
+            }
+
+        private:
+            detail::HMACKey key_;
+        };
+
+        // RSA, RSA-PSS and ECDSA: the digest is taken separately and signed
+        // with a key context set up once, with its padding, for the thread
+        class DigestSignContext final : public SigningContext
+        {
+        public:
+            DigestSignContext(EVP_PKEY* pkey, JWTAlg alg, size_t coordinateSize, bool deterministic)
+                : coordinateSize_(coordinateSize)
+            {
+                md_.reset(EVP_MD_fetch(nullptr, digestName(alg), nullptr));
+                mdCtx_.reset(EVP_MD_CTX_new());
+                keyCtx_.reset(EVP_PKEY_CTX_new_from_pkey(nullptr, pkey, nullptr));
+                if (md_ == nullptr || mdCtx_ == nullptr || keyCtx_ == nullptr ||
+                    EVP_PKEY_sign_init(keyCtx_.get()) <= 0 ||
+                    EVP_PKEY_CTX_set_signature_md(keyCtx_.get(), md_.get()) <= 0)
+                {
+                    throw JWTException("PrivateKeySigner: cannot set up signing context");
+                }
+
+                if (algFamily(alg) == JWTAlgFamily::rsa &&
+                    EVP_PKEY_CTX_set_rsa_padding(keyCtx_.get(), RSA_PKCS1_PADDING) <= 0)
+                {
+                    throw JWTException("PrivateKeySigner: cannot set RSA padding");
+                }
+
+                // RFC 7518 section 3.5: MGF1 with the same hash, salt as long as the hash
+                if (algFamily(alg) == JWTAlgFamily::rsaPSS &&
+                    (EVP_PKEY_CTX_set_rsa_padding(keyCtx_.get(), RSA_PKCS1_PSS_PADDING) <= 0 ||
+                     EVP_PKEY_CTX_set_rsa_pss_saltlen(keyCtx_.get(), RSA_PSS_SALTLEN_DIGEST) <= 0 ||
+                     EVP_PKEY_CTX_set_rsa_mgf1_md(keyCtx_.get(), md_.get()) <= 0))
+                {
+                    throw JWTException("PrivateKeySigner: cannot set PSS parameters");
+                }
+
+                // providers ignore parameters they do not know, so support
+                // is established by asking, not by setting
+                if (deterministic)
+                {
+                    unsigned int rfc6979 = 1;
+                    OSSL_PARAM params[] =
+                    {
+                        OSSL_PARAM_construct_uint(nonceTypeParam, &rfc6979),
+                        OSSL_PARAM_construct_end()
+                    };
+                    if (OSSL_PARAM_locate_const(EVP_PKEY_CTX_settable_params(keyCtx_.get()), nonceTypeParam) == nullptr ||
+                        EVP_PKEY_CTX_set_params(keyCtx_.get(), params) <= 0)
+                    {
+                        throw JWTException("PrivateKeySigner: deterministic ECDSA needs OpenSSL 3.2 or later");
+                    }
+                }
+
+                derSize_ = static_cast<size_t>(EVP_PKEY_get_size(pkey));
+            }
+
+            bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept override
+            {
+                unsigned char digest[EVP_MAX_MD_SIZE];
+                unsigned int digestSize = 0;
+                if (EVP_DigestInit_ex2(mdCtx_.get(), md_.get(), nullptr) != 1 ||
+                    EVP_DigestUpdate(mdCtx_.get(), signingInput.data(), signingInput.size()) != 1 ||
+                    EVP_DigestFinal_ex(mdCtx_.get(), digest, &digestSize) != 1)
+                {
+                    return false;
+                }
+
+                if (coordinateSize_ == 0)
+                {
+                    size = derSize_;
+                    return EVP_PKEY_sign(keyCtx_.get(), signature, &size, digest, digestSize) == 1;
+                }
+
+                // EVP_PKEY_get_size() bounds the DER form of an ECDSA signature
+                unsigned char der[2 * 66 + 16];
+                size_t derSize = sizeof der;
+                if (derSize_ > sizeof der ||
+                    EVP_PKEY_sign(keyCtx_.get(), der, &derSize, digest, digestSize) != 1 ||
+                    !derToJOSE(der, derSize, coordinateSize_, signature))
+                {
+                    return false;
+                }
+                size = 2 * coordinateSize_;
+                return true;
+            }
+
+        private:
+            std::unique_ptr<EVP_MD, MDFree> md_;
+            std::unique_ptr<EVP_MD_CTX, MDCtxFree> mdCtx_;
+            std::unique_ptr<EVP_PKEY_CTX, PKeyCtxFree> keyCtx_;
+            size_t coordinateSize_;     // 0 unless ECDSA
+            size_t derSize_;
+        };
+
+        // EdDSA hashes internally and has only the one-shot interface
+        class EdDSAContext final : public SigningContext
+        {
+        public:
+            explicit EdDSAContext(EVP_PKEY* pkey)
+                : pkey_(pkey)
+                , mdCtx_(EVP_MD_CTX_new())
+            {
+                if (mdCtx_ == nullptr)
+                    throw JWTException("PrivateKeySigner: cannot set up signing context");
+                size_ = static_cast<size_t>(EVP_PKEY_get_size(pkey));
+            }
+
+            bool sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept override
+            {
+                size = size_;
+                return EVP_MD_CTX_reset(mdCtx_.get()) == 1 &&
+                    EVP_DigestSignInit_ex(mdCtx_.get(), nullptr, nullptr, nullptr, nullptr, pkey_, nullptr) == 1 &&
+                    EVP_DigestSign(mdCtx_.get(), signature, &size,
+                        reinterpret_cast<const unsigned char*>(signingInput.data()), signingInput.size()) == 1;
+            }
+
+        private:
+            EVP_PKEY* pkey_;
+            std::unique_ptr<EVP_MD_CTX, MDCtxFree> mdCtx_;
+            size_t size_;
+        };
+
+        std::string bignumMember(EVP_PKEY* pkey, const char* name, size_t width = 0)
+        {
+            BIGNUM* bn = nullptr;
+            if (EVP_PKEY_get_bn_param(pkey, name, &bn) != 1)
+                throw JWTException("PrivateKeySigner: missing key parameter");
+
+            size_t size = width != 0 ? width : static_cast<size_t>(BN_num_bytes(bn));
+            std::string bytes(size, '\0');
+            int ok = BN_bn2binpad(bn, reinterpret_cast<unsigned char*>(bytes.data()), static_cast<int>(size));
+            BN_free(bn);
+            if (ok < 0)
+                throw JWTException("PrivateKeySigner: key parameter too large");
+
+            std::string out(base64urlEncodedSize(size), '\0');
+            base64urlEncode(bytes.data(), bytes.size(), out.data());
+            return out;
+        }
+    }
+
+    HMACSigner::HMACSigner(JWTAlg alg, std::string_view secret, std::string kid)
+        : JWSSigner(std::move(kid))
+        , secret_(secret)
+        , alg_(alg)
+    {
+        if (algFamily(alg) != JWTAlgFamily::hmac)
+            throw JWTException("HMACSigner: not an HMAC algorithm");
+        if (secret.size() < algDigestSize(alg))
+            throw JWTException("HMACSigner: secret shorter than the hash output");
+    }
+
+    std::unique_ptr<SigningContext> HMACSigner::newContext() const
+    {
+        return std::make_unique<HMACContext>(alg_, secret_);
+    }
+
+    struct PrivateKeySigner::Key
+    {
+        std::unique_ptr<EVP_PKEY, PKeyFree> pkey;
+    };
+
+    PrivateKeySigner::PrivateKeySigner(JWTAlg alg, std::string_view pem, std::string kid,
+            PrivateKeySignerOptions options)
+        : JWSSigner(std::move(kid))
+        , key_(std::make_unique<Key>())
+        , alg_(alg)
+        , signatureSize_(0)
+        , options_(options)
+    {
+        std::unique_ptr<BIO, BIOFree> bio(BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size())));
+        if (bio == nullptr)
+            throw JWTException("PrivateKeySigner: out of memory");
+        key_->pkey.reset(PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr));
+        if (key_->pkey == nullptr)
+            throw JWTException("PrivateKeySigner: cannot read private key");
+
+        EVP_PKEY* pkey = key_->pkey.get();
+        bool suits = false;
+        switch (algFamily(alg))
+        {
+        case JWTAlgFamily::rsa:
+        case JWTAlgFamily::rsaPSS:
+            suits = EVP_PKEY_is_a(pkey, "RSA") && EVP_PKEY_get_bits(pkey) >= minRSAModulusBits;
+            signatureSize_ = static_cast<size_t>(EVP_PKEY_get_size(pkey));
+            break;
+        case JWTAlgFamily::ecdsa:
+            suits = EVP_PKEY_is_a(pkey, "EC") &&
+                static_cast<size_t>(EVP_PKEY_get_bits(pkey) + 7) / 8 == ecCoordinateSize(alg);
+            signatureSize_ = 2 * ecCoordinateSize(alg);
+            break;
+        case JWTAlgFamily::eddsa:
+            suits = EVP_PKEY_is_a(pkey, "ED25519") || EVP_PKEY_is_a(pkey, "ED448");
+            signatureSize_ = static_cast<size_t>(EVP_PKEY_get_size(pkey));
+            break;
+        case JWTAlgFamily::hmac:
+        case JWTAlgFamily::none:
+            break;
+        }
+        if (!suits)
+            throw JWTException("PrivateKeySigner: key does not suit " + std::string(algName(alg)));
+
+        // a prepared nonce is random by construction
+        if (options_.deterministicNonces && options_.presignedNonces != 0)
+            throw JWTException("PrivateKeySigner: deterministic nonces cannot be prepared ahead");
+
+        // fail now, not in the first thread to sign
+        newContext();
+    }
+
+    PrivateKeySigner::~PrivateKeySigner() = default;
+
+    std::unique_ptr<SigningContext> PrivateKeySigner::newContext() const
+    {
+        EVP_PKEY* pkey = key_->pkey.get();
+        switch (algFamily(alg_))
+        {
+        case JWTAlgFamily::eddsa:
+            return std::make_unique<EdDSAContext>(pkey);
+        case JWTAlgFamily::ecdsa:
+            if (options_.presignedNonces != 0)
+                return detail::newPresignedECDSAContext(pkey, alg_, ecCoordinateSize(alg_), options_.presignedNonces);
+            return std::make_unique<DigestSignContext>(pkey, alg_, ecCoordinateSize(alg_), options_.deterministicNonces);
+        default:
+            return std::make_unique<DigestSignContext>(pkey, alg_, 0, false);
+        }
+    }
+
+    std::string PrivateKeySigner::publicJWK() const
+    {
+        EVP_PKEY* pkey = key_->pkey.get();
+        std::string json = R"({"kid":")" + kid() + R"(","use":"sig","alg":")" + std::string(algName(alg_)) + '"';
+
+        switch (algFamily(alg_))
+        {
+        case JWTAlgFamily::rsa:
+        case JWTAlgFamily::rsaPSS:
+            json += R"(,"kty":"RSA","n":")" + bignumMember(pkey, OSSL_PKEY_PARAM_RSA_N) +
+                R"(","e":")" + bignumMember(pkey, OSSL_PKEY_PARAM_RSA_E) + '"';
+            break;
+        case JWTAlgFamily::ecdsa:
+        {
+            size_t width = ecCoordinateSize(alg_);
+            const char* crv = alg_ == JWTAlg::ES256 ? "P-256" : alg_ == JWTAlg::ES384 ? "P-384" : "P-521";
+            json += R"(,"kty":"EC","crv":")" + std::string(crv) +
+                R"(","x":")" + bignumMember(pkey, OSSL_PKEY_PARAM_EC_PUB_X, width) +
+                R"(","y":")" + bignumMember(pkey, OSSL_PKEY_PARAM_EC_PUB_Y, width) + '"';
+            break;
+        }
+        case JWTAlgFamily::eddsa:
+        {
+            unsigned char raw[57];
+            size_t size = sizeof raw;
+            if (EVP_PKEY_get_raw_public_key(pkey, raw, &size) != 1)
+                throw JWTException("PrivateKeySigner: cannot export public key");
+            std::string x(base64urlEncodedSize(size), '\0');
+            base64urlEncode(raw, size, x.data());
+            json += R"(,"kty":"OKP","crv":")" + std::string(EVP_PKEY_is_a(pkey, "ED448") ? "Ed448" : "Ed25519") +
+                R"(","x":")" + x + '"';
+            break;
+        }
+        case JWTAlgFamily::hmac:
+        case JWTAlgFamily::none:
+            break;
+        }
+        return json + '}';
+    }
+}
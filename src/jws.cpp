@@ -0,0 +1,47 @@
+#include <ncbi/jws.hpp>
+
+#include "hmac-state.hpp"
+
+namespace ncbi
+{
+    struct HMACVerifier::Context : detail::HMACKey
+    {
+        using HMACKey::HMACKey;
+    };
+
+    HMACVerifier::HMACVerifier(JWTAlg alg, std::string_view secret)
+        : alg_(alg)
+    {
+        if (algFamily(alg) != JWTAlgFamily::hmac)
+            throw JWTException("HMACVerifier: not an HMAC algorithm");
+        if (secret.size() < algDigestSize(alg))
+            throw JWTException("HMACVerifier: secret shorter than the hash output");
+        context_ = std::make_unique<Context>(alg, secret);
+    }
+
+    HMACVerifier::~HMACVerifier() = default;
+
+    bool HMACVerifier::verify(std::string_view signingInput,
+        const unsigned char* signature, size_t signatureSize) const noexcept
+    {
+        return context_->verify(signingInput, signature, signatureSize);
+    }
+
+    JWTStatus verifyJWS(const JWTView& token, const JWTHeader& header, const JWSVerifier& verifier) noexcept
+    {
+        if (header.alg == JWTAlg::unknown || header.alg == JWTAlg::none)
+            return JWTStatus::unsupportedAlg;
+        if (header.alg != verifier.alg())
+            return JWTStatus::algMismatch;
+
+        unsigned char signature[maxSignatureSize];
+        size_t signatureSize;
+        JWTStatus status = token.decodeSignature(signature, sizeof signature, signatureSize);
+        if (status != JWTStatus::ok)
+            return status == JWTStatus::bufferTooSmall ? JWTStatus::badSignature : status;
+
+        if (!verifier.verify(token.signingInput(), signature, signatureSize))
+            return JWTStatus::badSignature;
+        return JWTStatus::ok;
+    }
+}
@@ -0,0 +1,212 @@
+#include <ncbi/jwt-arena.hpp>
+#include <ncbi/json-reader.hpp>
+
+#include "jwt-arena.hpp"
+
+#include <new>
+
+namespace ncbi
+{
+    namespace
+    {
+        // decodes a JSON string value into "out", which keeps its allocator
+        bool decodeString(const JSONValueView& value, std::pmr::string& out)
+        {
+            out.resize(value.rawString().size());
+            size_t length;
+            if (!value.getString(out.data(), length))
+                return false;
+            out.resize(length);
+            return true;
+        }
+
+        // decodes a segment into "out", sized for it beforehand
+        template<class Decode>
+        JWTStatus decodeSegment(size_t size, std::pmr::string& out, Decode&& decode)
+        {
+            out.resize(size);
+            std::string_view json;
+            JWTStatus status = decode(out.data(), out.size(), json);
+            if (status != JWTStatus::ok)
+                return status;
+            out.resize(json.size());
+            return JWTStatus::ok;
+        }
+
+        JWTStatus decodeHeader(const JWTView& view, ArenaJWT& result)
+        {
+            result.header = JWTHeader();
+            result.kid.clear();
+
+            JWTStatus status = decodeSegment(view.headerSize(), result.headerJSON,
+                [&](char* buf, size_t capacity, std::string_view& json) { return view.decodeHeader(buf, capacity, json); });
+            if (status != JWTStatus::ok || (status = JWTHeader::parse(result.headerJSON, result.header)) != JWTStatus::ok)
+                return status;
+
+            if (!result.header.kid.raw().empty() &&
+                (result.header.kid.type() != JSONType::string || !decodeString(result.header.kid, result.kid)))
+            {
+                return JWTStatus::badJSON;
+            }
+            return JWTStatus::ok;
+        }
+
+        JWTStatus decodePayload(const JWTView& view, ArenaJWT& result)
+        {
+            result.claims = JWTClaims();
+            for (std::pmr::string* s : { &result.iss, &result.sub, &result.jti, &result.scope })
+                s->clear();
+            result.audiences.clear();
+            result.scopes.clear();
+            result.members.clear();
+
+            JWTStatus status = decodeSegment(view.payloadSize(), result.payload,
+                [&](char* buf, size_t capacity, std::string_view& json) { return view.decodePayload(buf, capacity, json); });
+            if (status != JWTStatus::ok || (status = JWTClaimsParser().parse(result.payload, result.claims)) != JWTStatus::ok)
+                return status;
+
+            const JWTClaims& claims = result.claims;
+            result.exp = claims.exp;
+            result.nbf = claims.nbf;
+            result.iat = claims.iat;
+
+            // the parser has typed these already; only decoding can fail
+            if ((claims.has(JWTClaim::iss) && !decodeString(claims.iss, result.iss)) ||
+                (claims.has(JWTClaim::sub) && !decodeString(claims.sub, result.sub)) ||
+                (claims.has(JWTClaim::jti) && !decodeString(claims.jti, result.jti)) ||
+                (claims.has(JWTClaim::scope) && !decodeString(claims.scope, result.scope)))
+            {
+                return JWTStatus::badClaim;
+            }
+
+            if (claims.has(JWTClaim::aud))
+            {
+                auto addAudience = [&](const JSONValueView& value)
+                {
+                    return decodeString(value, result.audiences.emplace_back());
+                };
+                if (claims.audJSON.type() == JSONType::string)
+                {
+                    if (!addAudience(claims.audJSON))
+                        return JWTStatus::badClaim;
+                }
+                else
+                {
+                    JSONReader elements(claims.audJSON.raw());
+                    elements.enterArray();
+                    JSONValueView value;
+                    while (elements.nextElement())
+                    {
+                        if (!elements.readValue(value) || !addAudience(value))
+                            return JWTStatus::badClaim;
+                    }
+                }
+            }
+
+            // RFC 6749 section 3.3
+            std::string_view scope = result.scope;
+            while (!scope.empty())
+            {
+                size_t space = scope.find(' ');
+                if (space != 0)
+                    result.scopes.push_back(scope.substr(0, space));
+                if (space == std::string_view::npos)
+                    break;
+                scope.remove_prefix(space + 1);
+            }
+
+            // the parser has validated the object; this walk cannot fail
+            // except on names that need decoding and cannot be
+            JSONReader reader(result.payload);
+            reader.enterObject();
+            result.members.reserve(16);
+            std::string_view rawName;
+            while (reader.nextMember(rawName))
+            {
+                JWTMember member;
+                if (!reader.readValue(member.value))
+                    return JWTStatus::badJSON;
+                member.name = rawName;
+                if (rawName.find('\\') != std::string_view::npos)
+                {
+                    char* name = static_cast<char*>(result.get_allocator().resource()->allocate(rawName.size(), 1));
+                    size_t length;
+                    if (!unescapeJSONString(rawName, name, length))
+                        return JWTStatus::badJSON;
+                    member.name = std::string_view(name, length);
+                }
+                result.members.push_back(member);
+            }
+            return JWTStatus::ok;
+        }
+    }
+
+    namespace detail
+    {
+        JWTStatus decodeArenaHeader(const JWTView& view, ArenaJWT& result) noexcept
+        {
+            try
+            {
+                return decodeHeader(view, result);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return JWTStatus::bufferTooSmall;
+            }
+        }
+
+        JWTStatus decodeArenaPayload(const JWTView& view, ArenaJWT& result) noexcept
+        {
+            try
+            {
+                return decodePayload(view, result);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return JWTStatus::bufferTooSmall;
+            }
+        }
+    }
+
+    JWTStatus decodeJWT(std::string_view token, ArenaJWT& result) noexcept
+    {
+        result.verified = false;
+        result.keyFingerprint = 0;
+
+        JWTView view;
+        JWTStatus status = JWTView::parse(token, view);
+        if (status != JWTStatus::ok || (status = detail::decodeArenaHeader(view, result)) != JWTStatus::ok)
+            return status;
+        return detail::decodeArenaPayload(view, result);
+    }
+
+    const JSONValueView* ArenaJWT::find(std::string_view name) const noexcept
+    {
+        for (const JWTMember& member : members)
+        {
+            if (member.name == name)
+                return &member.value;
+        }
+        return nullptr;
+    }
+
+    bool ArenaJWT::hasAudience(std::string_view audience) const noexcept
+    {
+        for (const std::pmr::string& a : audiences)
+        {
+            if (a == audience)
+                return true;
+        }
+        return false;
+    }
+
+    bool ArenaJWT::hasScope(std::string_view name) const noexcept
+    {
+        for (std::string_view s : scopes)
+        {
+            if (s == name)
+                return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// the two halves of decodeJWT(), which the verifier runs with the
+// signature check between them
+
+#include <ncbi/jwt-arena.hpp>
+
+namespace ncbi::detail
+{
+    // decodes and parses the header and decodes "kid"
+    JWTStatus decodeArenaHeader(const JWTView& view, ArenaJWT& result) noexcept;
+
+    // decodes the payload and extracts the claims, members and dates
+    JWTStatus decodeArenaPayload(const JWTView& view, ArenaJWT& result) noexcept;
+}
@@ -0,0 +1,244 @@
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jwt.hpp>
+
+namespace ncbi
+{
+    namespace
+    {
+        constexpr std::string_view claimNames[] =
+        {
+            "iss", "sub", "aud", "exp", "nbf", "iat", "jti", "scope"
+        };
+
+        constexpr int notRegistered = -1;
+
+        // the JWTClaim named by an escaped member name, or notRegistered;
+        // unescaped names, which is all of them in practice, are told apart
+        // by length and first character alone
+        int registeredClaim(std::string_view raw) noexcept
+        {
+            if (raw.find('\\') != std::string_view::npos)
+            {
+                for (size_t i = 0; i < std::size(claimNames); ++i)
+                {
+                    if (rawJSONStringEquals(raw, claimNames[i]))
+                        return static_cast<int>(i);
+                }
+                return notRegistered;
+            }
+
+            JWTClaim claim;
+            if (raw.size() == 3)
+            {
+                switch (raw[0])
+                {
+                case 'i': claim = raw[2] == 's' ? JWTClaim::iss : JWTClaim::iat; break;
+                case 's': claim = JWTClaim::sub; break;
+                case 'a': claim = JWTClaim::aud; break;
+                case 'e': claim = JWTClaim::exp; break;
+                case 'n': claim = JWTClaim::nbf; break;
+                case 'j': claim = JWTClaim::jti; break;
+                default:  return notRegistered;
+                }
+            }
+            else if (raw.size() == 5 && raw[0] == 's')
+                claim = JWTClaim::scope;
+            else
+                return notRegistered;
+
+            int index = static_cast<int>(claim);
+            return raw == claimNames[index] ? index : notRegistered;
+        }
+
+        uint32_t bit(JWTClaim claim) noexcept
+        {
+            return 1u << static_cast<unsigned>(claim);
+        }
+
+        // "aud", a string or an array of strings, positioned at its value
+        bool readAudience(JSONReader& reader, JWTClaims& claims) noexcept
+        {
+            JSONType type;
+            if (!reader.peekType(type))
+                return false;
+
+            if (type == JSONType::string)
+            {
+                if (!reader.readValue(claims.audJSON))
+                    return false;
+                claims.aud[0] = claims.audJSON;
+                claims.audCount = 1;
+                return true;
+            }
+            if (type != JSONType::array)
+                return false;
+
+            // read once to validate and keep the first few, with the raw
+            // text of the whole array for audience()
+            if (!reader.readValue(claims.audJSON))
+                return false;
+
+            JSONReader elements(claims.audJSON.raw());
+            elements.enterArray();
+            while (elements.nextElement())
+            {
+                JSONValueView value;
+                if (!elements.readValue(value) || value.type() != JSONType::string)
+                    return false;
+                if (claims.audCount < JWTClaims::maxAudiences)
+                    claims.aud[claims.audCount++] = value;
+            }
+            return !elements.failed();
+        }
+    }
+
+    bool JWTClaims::audience(std::string_view audience) const noexcept
+    {
+        for (uint32_t i = 0; i < audCount; ++i)
+        {
+            if (aud[i].stringEquals(audience))
+                return true;
+        }
+        if (audCount < maxAudiences)
+            return false;
+
+        // more values than were kept: look through the rest
+        JSONReader elements(audJSON.raw());
+        if (!elements.enterArray())
+            return false;
+        for (size_t i = 0; elements.nextElement(); ++i)
+        {
+            JSONValueView value;
+            if (!elements.readValue(value))
+                return false;
+            if (i >= maxAudiences && value.stringEquals(audience))
+                return true;
+        }
+        return false;
+    }
+
+    bool JWTClaims::hasScope(std::string_view name) const noexcept
+    {
+        if (!has(JWTClaim::scope) || name.empty())
+            return false;
+
+        std::string_view text = scope.rawString();
+        char decoded[1024];
+        if (!scope.isPlainString())
+        {
+            size_t written;
+            if (text.size() > sizeof decoded || !scope.getString(decoded, written))
+                return false;
+            text = std::string_view(decoded, written);
+        }
+
+        // RFC 6749 section 3.3: space-delimited, case-sensitive
+        while (!text.empty())
+        {
+            size_t space = text.find(' ');
+            if (text.substr(0, space) == name)
+                return true;
+            if (space == std::string_view::npos)
+                break;
+            text.remove_prefix(space + 1);
+        }
+        return false;
+    }
+
+    JWTClaimsParser::JWTClaimsParser(std::initializer_list<std::string_view> customClaims)
+    {
+        if (customClaims.size() > JWTClaims::maxCustomClaims)
+            throw JWTException("JWTClaimsParser: too many custom claims");
+
+        for (std::string_view name : customClaims)
+        {
+            for (std::string_view registered : claimNames)
+            {
+                if (name == registered)
+                    throw JWTException("JWTClaimsParser: '" + std::string(name) + "' is a registered claim");
+            }
+            custom_[customCount_++] = std::string(name);
+        }
+    }
+
+    JWTStatus JWTClaimsParser::parse(std::string_view payload, JWTClaims& claims) const noexcept
+    {
+        claims = JWTClaims();
+
+        JSONReader reader(payload);
+        if (!reader.enterObject())
+            return JWTStatus::badJSON;
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            int index = registeredClaim(name);
+            if (index == notRegistered)
+            {
+                size_t c = 0;
+                while (c < customCount_ && !rawJSONStringEquals(name, custom_[c]))
+                    ++c;
+
+                if (c == customCount_)
+                {
+                    if (!reader.skipValue())
+                        break;
+                    continue;
+                }
+
+                uint32_t customBit = 1u << (8 + c);
+                if ((claims.present & customBit) != 0)
+                    return JWTStatus::badClaim;
+                if (!reader.readValue(claims.custom[c]))
+                    break;
+                claims.present |= customBit;
+                continue;
+            }
+
+            JWTClaim claim = static_cast<JWTClaim>(index);
+            if (claims.has(claim))
+                return JWTStatus::badClaim;
+            claims.present |= bit(claim);
+
+            if (claim == JWTClaim::aud)
+            {
+                if (!readAudience(reader, claims))
+                    return reader.failed() ? JWTStatus::badJSON : JWTStatus::badClaim;
+                continue;
+            }
+
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            switch (claim)
+            {
+            case JWTClaim::iss:   claims.iss = value; break;
+            case JWTClaim::sub:   claims.sub = value; break;
+            case JWTClaim::jti:   claims.jti = value; break;
+            case JWTClaim::scope: claims.scope = value; break;
+            case JWTClaim::exp:
+                if (!parseNumericDate(value, claims.exp))
+                    return JWTStatus::badClaim;
+                continue;
+            case JWTClaim::nbf:
+                if (!parseNumericDate(value, claims.nbf))
+                    return JWTStatus::badClaim;
+                continue;
+            case JWTClaim::iat:
+                if (!parseNumericDate(value, claims.iat))
+                    return JWTStatus::badClaim;
+                continue;
+            case JWTClaim::aud:
+                break;
+            }
+
+            if (value.type() != JSONType::string)
+                return JWTStatus::badClaim;
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            return JWTStatus::badJSON;
+        return JWTStatus::ok;
+    }
+}
@@ -0,0 +1,33 @@
+#include <ncbi/jwt-error.hpp>
+
+namespace ncbi
+{
+    const char* toString(JWTStatus status) noexcept
+    {
+        switch (status)
+        {
+        case JWTStatus::ok:              return "ok";
+        case JWTStatus::malformed:       return "malformed token";
+        case JWTStatus::badEncoding:     return "invalid base64url segment";
+        case JWTStatus::badJSON:         return "invalid JSON object";
+        case JWTStatus::bufferTooSmall:  return "buffer too small for decoded segment";
+        case JWTStatus::unsupportedAlg:  return "unsupported algorithm";
+        case JWTStatus::unsupportedCrit: return "unsupported critical header parameter";
+        case JWTStatus::algMismatch:     return "algorithm does not match key";
+        case JWTStatus::unknownKey:      return "unknown signing key";
+        case JWTStatus::unknownIssuer:   return "untrusted issuer";
+        case JWTStatus::badSignature:    return "signature verification failed";
+        case JWTStatus::decryptionFailed: return "decryption failed";
+        case JWTStatus::badClaim:        return "invalid claim";
+        case JWTStatus::missingClaim:    return "required claim missing";
+        case JWTStatus::rejectedClaim:   return "claim value not accepted";
+        case JWTStatus::expired:         return "token expired";
+        case JWTStatus::notYetValid:     return "token not yet valid";
+        case JWTStatus::inactive:        return "token not active";
+        case JWTStatus::revoked:         return "token revoked";
+        case JWTStatus::replayed:        return "proof replayed";
+        case JWTStatus::serverError:     return "authorization server unavailable";
+        }
+        return "unknown status";
+    }
+}
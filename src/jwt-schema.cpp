@@ -0,0 +1,27 @@
+#include <ncbi/jwt-schema.hpp>
+#include <ncbi/jwt.hpp>
+
+namespace ncbi::detail
+{
+    bool schemaKey(std::string_view raw, char* buf, size_t capacity, std::string_view& key) noexcept
+    {
+        if (raw.find('\\') == std::string_view::npos)
+        {
+            key = raw;
+            return true;
+        }
+
+        // decoding shrinks text at most six-fold, so anything longer than
+        // the buffer decodes to more than the longest key
+        size_t written;
+        if (raw.size() > capacity || !unescapeJSONString(raw, buf, written))
+            return false;
+        key = std::string_view(buf, written);
+        return true;
+    }
+
+    bool numericDate(const JSONValueView& value, int64_t& seconds) noexcept
+    {
+        return parseNumericDate(value, seconds);
+    }
+}
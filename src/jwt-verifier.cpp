@@ -0,0 +1,489 @@
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwt-claims.hpp>
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt.hpp>
+#include <ncbi/revocation.hpp>
+#include <ncbi/verify-metrics.hpp>
+
+#include "jwt-arena.hpp"
+
+#include <string>
+
+namespace ncbi
+{
+    namespace
+    {
+        // headers are small; anything larger is not worth decoding
+        constexpr size_t maxHeaderSize = 2048;
+
+        // the checks between the header and the payload, common to both
+        // result types: algorithm, key and signature
+        JWTStatus checkSignature(const JWKSCache::Snapshot& keys, const JWTView& view, const JWTHeader& header,
+            std::string_view kid, const JWK*& key, VerifyProbe& probe) noexcept
+        {
+            probe.enter(VerifyStage::keyResolve);
+            if (header.alg == JWTAlg::unknown || header.alg == JWTAlg::none)
+                return JWTStatus::unsupportedAlg;
+            if (header.hasCrit)
+                return JWTStatus::unsupportedCrit;
+
+            key = keys.find(kid, header.alg);
+            if (key == nullptr)
+                return JWTStatus::unknownKey;
+
+            probe.enter(VerifyStage::signature);
+            unsigned char signature[maxSignatureSize];
+            size_t signatureSize;
+            JWTStatus status = view.decodeSignature(signature, sizeof signature, signatureSize);
+            if (status != JWTStatus::ok)
+                return status;
+            const JWSVerifier* verifier = keys.keys()->verifier(*key, header.alg);
+            if (verifier == nullptr || !verifier->verify(view.signingInput(), signature, signatureSize))
+                return JWTStatus::badSignature;
+            return JWTStatus::ok;
+        }
+
+        // decodes and parses the header into "buf"; an escaped "kid" is
+        // unescaped in place, where it can only shrink
+        JWTStatus decodeHeader(const JWTView& view, char (&buf)[maxHeaderSize], JWTHeader& header,
+            std::string_view& kid, VerifyProbe& probe) noexcept
+        {
+            if (view.headerSize() > maxHeaderSize)
+                return JWTStatus::bufferTooSmall;
+            std::string_view headerJSON;
+            JWTStatus status = view.decodeHeader(buf, sizeof buf, headerJSON);
+            if (status != JWTStatus::ok)
+                return status;
+            probe.enter(VerifyStage::parse);
+            if ((status = JWTHeader::parse(headerJSON, header)) != JWTStatus::ok)
+                return status;
+
+            if (!header.kid.raw().empty())
+            {
+                if (header.kid.type() != JSONType::string)
+                    return JWTStatus::badJSON;
+                std::string_view raw = header.kid.rawString();
+                char* dst = buf + (raw.data() - buf);
+                size_t length;
+                if (!unescapeJSONString(raw, dst, length))
+                    return JWTStatus::badJSON;
+                kid = std::string_view(dst, length);
+            }
+            return JWTStatus::ok;
+        }
+
+        // decodes the payload into "verified" and parses it in one pass,
+        // which validates it and extracts the dates
+        JWTStatus decodeClaims(const JWTView& view, VerifiedToken& verified, JWTClaims& claims, VerifyProbe& probe)
+        {
+            probe.enter(VerifyStage::decode);
+            verified.payload.resize(view.payloadSize());
+            std::string_view payloadJSON;
+            JWTStatus status = view.decodePayload(verified.payload.data(), verified.payload.size(), payloadJSON);
+            if (status != JWTStatus::ok)
+                return status;
+            verified.payload.resize(payloadJSON.size());
+
+            probe.enter(VerifyStage::parse);
+            if ((status = JWTClaimsParser().parse(verified.payload, claims)) != JWTStatus::ok)
+                return status;
+            verified.exp = claims.exp;
+            verified.nbf = claims.nbf;
+            return JWTStatus::ok;
+        }
+
+        JWTStatus checkDates(int64_t exp, int64_t nbf, int64_t now, int64_t skew) noexcept
+        {
+            if (exp <= now - skew)
+                return JWTStatus::expired;
+            if (nbf > now + skew)
+                return JWTStatus::notYetValid;
+            return JWTStatus::ok;
+        }
+
+        // fills in the rest of a token whose signature and dates check out,
+        // unless its "jti" is revoked
+        JWTStatus completeVerified(VerifiedToken& verified, const JWTClaims& claims, std::string_view token,
+            std::string_view kid, JWTAlg alg, const JWK& key, const RevocationList* revocations)
+        {
+            if (claims.jti.type() == JSONType::string)
+            {
+                verified.jti.resize(claims.jti.rawString().size());
+                size_t length;
+                if (!claims.jti.getString(verified.jti.data(), length))
+                    return JWTStatus::badClaim;
+                verified.jti.resize(length);
+                if (revocations != nullptr && revocations->revoked(verified.jti))
+                    return JWTStatus::revoked;
+            }
+
+            verified.token.assign(token);
+            verified.kid.assign(kid);
+            verified.alg = alg;
+            verified.keyFingerprint = jwkFingerprint(key);
+            return JWTStatus::ok;
+        }
+
+        // an issuer without audiences accepts tokens for any, or none
+        template<class HasAudience>
+        JWTStatus checkAudience(const IssuerPolicy& policy, bool present, HasAudience hasAudience) noexcept
+        {
+            if (policy.audiences.empty())
+                return JWTStatus::ok;
+            if (!present)
+                return JWTStatus::missingClaim;
+            for (const std::string& audience : policy.audiences)
+            {
+                if (hasAudience(audience))
+                    return JWTStatus::ok;
+            }
+            return JWTStatus::rejectedClaim;
+        }
+
+        enum class Reuse : unsigned char
+        {
+            no,
+            yes,
+            revalidated         // under a newer registry or key set; worth caching again
+        };
+
+        // whether a cached result may be served under the configuration in
+        // force: its issuer still trusted, its dates good by that issuer's
+        // skew, and, if the registry or the key set has moved on since,
+        // its algorithm, key and audience still accepted; "keysGeneration"
+        // is that of the key set checked against, and "skew" the issuer's
+        Reuse reusable(const IssuerRegistry::Snapshot& issuers, const VerifiedToken& entry, int64_t now,
+            uint64_t& keysGeneration, int64_t& skew) noexcept
+        {
+            const IssuerPolicy* policy = issuers.find(entry.issuer);
+            if (policy == nullptr ||
+                checkDates(entry.exp, entry.nbf, now, policy->clockSkew.count()) != JWTStatus::ok)
+            {
+                return Reuse::no;
+            }
+            skew = policy->clockSkew.count();
+
+            JWKSCache::Snapshot keys = policy->keys->snapshot();
+            keysGeneration = keys.generation();
+            if (entry.registryGeneration == issuers.generation() && entry.keysGeneration == keys.generation())
+                return Reuse::yes;
+
+            if (!policy->acceptsAlg(entry.alg))
+                return Reuse::no;
+            const JWK* key = keys.find(entry.kid, entry.alg);
+            if (key == nullptr || jwkFingerprint(*key) != entry.keyFingerprint)
+                return Reuse::no;
+            if (!policy->audiences.empty())
+            {
+                JWTClaims claims;
+                if (JWTClaimsParser().parse(entry.payload, claims) != JWTStatus::ok ||
+                    checkAudience(*policy, claims.has(JWTClaim::aud),
+                        [&](std::string_view audience) { return claims.audience(audience); }) != JWTStatus::ok)
+                {
+                    return Reuse::no;
+                }
+            }
+            return Reuse::revalidated;
+        }
+    }
+
+    JWTVerifier::JWTVerifier(JWKSCache& keys, JWTVerifierOptions options)
+        : keys_(&keys)
+        , options_(options)
+    {
+    }
+
+    JWTVerifier::JWTVerifier(const IssuerRegistry& issuers, JWTVerifierOptions options)
+        : issuers_(&issuers)
+        , options_(options)
+    {
+    }
+
+    JWTStatus JWTVerifier::verify(std::string_view token, std::shared_ptr<const VerifiedToken>& result) const
+    {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return verify(token, now, result);
+    }
+
+    JWTStatus JWTVerifier::verify(std::string_view token, int64_t now,
+        std::shared_ptr<const VerifiedToken>& result) const
+    {
+        VerifyProbe probe(options_.cache != nullptr ? VerifyStage::cache : VerifyStage::decode);
+        if (issuers_ != nullptr)
+            return probe.finish(verifyIssued(token, now, result, probe));
+        return probe.finish(verify(token, now, result, probe));
+    }
+
+    JWTStatus JWTVerifier::verify(std::string_view token, int64_t now, ArenaJWT& result) const noexcept
+    {
+        VerifyProbe probe(VerifyStage::decode);
+        if (issuers_ != nullptr)
+            return probe.finish(verifyIssued(token, now, result, probe));
+        return probe.finish(verify(token, now, result, probe));
+    }
+
+    JWTStatus JWTVerifier::verify(std::string_view token, int64_t now,
+        std::shared_ptr<const VerifiedToken>& result, VerifyProbe& probe) const
+    {
+        const int64_t skew = options_.clockSkew.count();
+        VerifiedTokenCache* cache = options_.cache;
+
+        result.reset();
+
+        // a new key generation is pushed to the cache before the cache is
+        // consulted, so a rotated-out key cannot vouch for a token
+        JWKSCache::Snapshot keys = keys_->snapshot();
+        if (cache != nullptr)
+        {
+            uint64_t seen = lastGeneration_.load(std::memory_order_acquire);
+            if (keys.keys() != nullptr && seen != keys.generation() &&
+                lastGeneration_.compare_exchange_strong(seen, keys.generation(), std::memory_order_acq_rel))
+            {
+                cache->retainKeys(*keys.keys());
+            }
+
+            // an entry stays usable for "skew" seconds past its "exp"
+            result = cache->find(token, now - skew);
+            if (result != nullptr && result->nbf <= now + skew)
+            {
+                if (options_.revocations == nullptr || result->jti.empty() ||
+                    !options_.revocations->revoked(result->jti))
+                {
+                    return JWTStatus::ok;
+                }
+                result.reset();
+                return JWTStatus::revoked;
+            }
+            result.reset();
+            probe.enter(VerifyStage::decode);
+        }
+
+        JWTView view;
+        JWTStatus status = JWTView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+
+        char headerBuf[maxHeaderSize];
+        JWTHeader header;
+        std::string_view kid;
+        if ((status = decodeHeader(view, headerBuf, header, kid, probe)) != JWTStatus::ok)
+            return status;
+
+        const JWK* key;
+        if ((status = checkSignature(keys, view, header, kid, key, probe)) != JWTStatus::ok)
+            return status;
+
+        auto verified = std::make_shared<VerifiedToken>();
+        JWTClaims claims;
+        if ((status = decodeClaims(view, *verified, claims, probe)) != JWTStatus::ok)
+            return status;
+
+        probe.enter(VerifyStage::claims);
+        if ((status = checkDates(verified->exp, verified->nbf, now, skew)) != JWTStatus::ok ||
+            (status = completeVerified(*verified, claims, token, kid, header.alg, *key,
+                options_.revocations)) != JWTStatus::ok)
+        {
+            return status;
+        }
+
+        if (cache != nullptr)
+        {
+            probe.enter(VerifyStage::cache);
+            cache->insert(verified, now - skew);
+        }
+        result = std::move(verified);
+        return JWTStatus::ok;
+    }
+
+    JWTStatus JWTVerifier::verify(std::string_view token, int64_t now, ArenaJWT& result,
+        VerifyProbe& probe) const noexcept
+    {
+        const int64_t skew = options_.clockSkew.count();
+        result.verified = false;
+        result.keyFingerprint = 0;
+
+        JWTView view;
+        JWTStatus status = JWTView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+        if (view.headerSize() > maxHeaderSize)
+            return JWTStatus::bufferTooSmall;
+        // the arena decoders decode and parse in one go; that is charged
+        // to parsing
+        probe.enter(VerifyStage::parse);
+        if ((status = detail::decodeArenaHeader(view, result)) != JWTStatus::ok)
+            return status;
+
+        JWKSCache::Snapshot keys = keys_->snapshot();
+        const JWK* key;
+        if ((status = checkSignature(keys, view, result.header, result.kid, key, probe)) != JWTStatus::ok)
+            return status;
+        probe.enter(VerifyStage::parse);
+        if ((status = detail::decodeArenaPayload(view, result)) != JWTStatus::ok)
+            return status;
+
+        probe.enter(VerifyStage::claims);
+        if ((status = checkDates(result.exp, result.nbf, now, skew)) != JWTStatus::ok)
+            return status;
+        if (options_.revocations != nullptr && !result.jti.empty() && options_.revocations->revoked(result.jti))
+            return JWTStatus::revoked;
+
+        result.verified = true;
+        result.keyFingerprint = jwkFingerprint(*key);
+        return JWTStatus::ok;
+    }
+
+    JWTStatus JWTVerifier::verifyIssued(std::string_view token, int64_t now,
+        std::shared_ptr<const VerifiedToken>& result, VerifyProbe& probe) const
+    {
+        VerifiedTokenCache* cache = options_.cache;
+
+        result.reset();
+
+        // one snapshot serves the cache check and the verification, so
+        // both answer to the same configuration
+        IssuerRegistry::Snapshot issuers = issuers_->snapshot();
+        if (cache != nullptr)
+        {
+            // the skew is the issuer's, so dates are left to reusable()
+            result = cache->find(token, INT64_MIN);
+            uint64_t keysGeneration = 0;
+            int64_t skew = 0;
+            Reuse reuse = result != nullptr ? reusable(issuers, *result, now, keysGeneration, skew) : Reuse::no;
+            if (reuse != Reuse::no)
+            {
+                if (options_.revocations != nullptr && !result->jti.empty() &&
+                    options_.revocations->revoked(result->jti))
+                {
+                    result.reset();
+                    return JWTStatus::revoked;
+                }
+                // a copy stamped with the current generations skips the
+                // revalidation next time
+                if (reuse == Reuse::revalidated)
+                {
+                    auto refreshed = std::make_shared<VerifiedToken>(*result);
+                    refreshed->registryGeneration = issuers.generation();
+                    refreshed->keysGeneration = keysGeneration;
+                    cache->insert(refreshed, now - skew);
+                }
+                return JWTStatus::ok;
+            }
+            result.reset();
+            probe.enter(VerifyStage::decode);
+        }
+
+        JWTView view;
+        JWTStatus status = JWTView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+
+        char headerBuf[maxHeaderSize];
+        JWTHeader header;
+        std::string_view kid;
+        if ((status = decodeHeader(view, headerBuf, header, kid, probe)) != JWTStatus::ok)
+            return status;
+
+        auto verified = std::make_shared<VerifiedToken>();
+        JWTClaims claims;
+        if ((status = decodeClaims(view, *verified, claims, probe)) != JWTStatus::ok)
+            return status;
+
+        probe.enter(VerifyStage::keyResolve);
+        if (!claims.has(JWTClaim::iss))
+            return JWTStatus::unknownIssuer;
+        std::string_view iss = claims.iss.rawString();
+        std::string decoded;
+        if (!claims.iss.isPlainString())
+        {
+            decoded.resize(iss.size());
+            size_t length;
+            if (!claims.iss.getString(decoded.data(), length))
+                return JWTStatus::badClaim;
+            decoded.resize(length);
+            iss = decoded;
+        }
+
+        // the policy and its keys stay valid while the snapshots are held
+        const IssuerPolicy* policy = issuers.find(iss);
+        if (policy == nullptr)
+            return JWTStatus::unknownIssuer;
+        if (!policy->acceptsAlg(header.alg))
+            return JWTStatus::unsupportedAlg;
+
+        JWKSCache::Snapshot keys = policy->keys->snapshot();
+        const JWK* key;
+        if ((status = checkSignature(keys, view, header, kid, key, probe)) != JWTStatus::ok)
+            return status;
+
+        probe.enter(VerifyStage::claims);
+        if ((status = checkDates(verified->exp, verified->nbf, now, policy->clockSkew.count())) != JWTStatus::ok ||
+            (status = checkAudience(*policy, claims.has(JWTClaim::aud),
+                [&](std::string_view audience) { return claims.audience(audience); })) != JWTStatus::ok ||
+            (status = completeVerified(*verified, claims, token, kid, header.alg, *key,
+                options_.revocations)) != JWTStatus::ok)
+        {
+            return status;
+        }
+        verified->issuer.assign(iss);
+        verified->registryGeneration = issuers.generation();
+        verified->keysGeneration = keys.generation();
+
+        if (cache != nullptr)
+        {
+            probe.enter(VerifyStage::cache);
+            cache->insert(verified, now - policy->clockSkew.count());
+        }
+        result = std::move(verified);
+        return JWTStatus::ok;
+    }
+
+    JWTStatus JWTVerifier::verifyIssued(std::string_view token, int64_t now, ArenaJWT& result,
+        VerifyProbe& probe) const noexcept
+    {
+        result.verified = false;
+        result.keyFingerprint = 0;
+
+        JWTView view;
+        JWTStatus status = JWTView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+        if (view.headerSize() > maxHeaderSize)
+            return JWTStatus::bufferTooSmall;
+        probe.enter(VerifyStage::parse);
+        if ((status = detail::decodeArenaHeader(view, result)) != JWTStatus::ok ||
+            (status = detail::decodeArenaPayload(view, result)) != JWTStatus::ok)
+        {
+            return status;
+        }
+
+        probe.enter(VerifyStage::keyResolve);
+        IssuerRegistry::Snapshot issuers = issuers_->snapshot();
+        const IssuerPolicy* policy = result.iss.empty() ? nullptr : issuers.find(result.iss);
+        if (policy == nullptr)
+            return JWTStatus::unknownIssuer;
+        if (!policy->acceptsAlg(result.header.alg))
+            return JWTStatus::unsupportedAlg;
+
+        JWKSCache::Snapshot keys = policy->keys->snapshot();
+        const JWK* key;
+        if ((status = checkSignature(keys, view, result.header, result.kid, key, probe)) != JWTStatus::ok)
+            return status;
+
+        probe.enter(VerifyStage::claims);
+        if ((status = checkDates(result.exp, result.nbf, now, policy->clockSkew.count())) != JWTStatus::ok ||
+            (status = checkAudience(*policy, result.claims.has(JWTClaim::aud),
+                [&](std::string_view audience) { return result.hasAudience(audience); })) != JWTStatus::ok)
+        {
+            return status;
+        }
+        if (options_.revocations != nullptr && !result.jti.empty() && options_.revocations->revoked(result.jti))
+            return JWTStatus::revoked;
+
+        result.verified = true;
+        result.keyFingerprint = jwkFingerprint(*key);
+        return JWTStatus::ok;
+    }
+}
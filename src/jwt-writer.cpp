@@ -0,0 +1,237 @@
+#include <ncbi/jwt-writer.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include "json-scan-kernels.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+
+namespace ncbi
+{
+    namespace
+    {
+        using namespace std::string_view_literals;
+
+        constexpr char hexDigits[] = "0123456789abcdef";
+
+        // values shorter than this are scanned byte by byte
+        constexpr ptrdiff_t minVectorScan = 16;
+
+        // the first '"', '\\' or control character, or "end"
+        const char* findSpecial(const char* p, const char* end) noexcept
+        {
+            if (end - p >= minVectorScan)
+                p = detail::jsonStringScanKernel()(p, end);
+            while (p != end)
+            {
+                unsigned char c = static_cast<unsigned char>(*p);
+                if (c == '"' || c == '\\' || c < 0x20)
+                    break;
+                ++p;
+            }
+            return p;
+        }
+
+        size_t escapedSize(std::string_view text) noexcept
+        {
+            size_t size = text.size() + 2;
+            const char* end = text.data() + text.size();
+            for (const char* p = findSpecial(text.data(), end); p != end; p = findSpecial(p + 1, end))
+                size += static_cast<unsigned char>(*p) < 0x20 ? 5 : 1;
+            return size;
+        }
+
+        // runs that need no escaping are copied whole
+        char* writeEscaped(char* p, std::string_view text) noexcept
+        {
+            *p++ = '"';
+            const char* from = text.data();
+            const char* end = from + text.size();
+            while (true)
+            {
+                const char* special = findSpecial(from, end);
+                std::memcpy(p, from, static_cast<size_t>(special - from));
+                p += special - from;
+                if (special == end)
+                    break;
+
+                unsigned char c = static_cast<unsigned char>(*special);
+                if (c < 0x20)
+                {
+                    std::memcpy(p, "\\u00", 4);
+                    p[4] = hexDigits[c >> 4];
+                    p[5] = hexDigits[c & 15];
+                    p += 6;
+                }
+                else
+                {
+                    *p++ = '\\';
+                    *p++ = static_cast<char>(c);
+                }
+                from = special + 1;
+            }
+            *p++ = '"';
+            return p;
+        }
+
+        size_t valueSize(const JWTClaimValue& claim) noexcept
+        {
+            switch (claim.type())
+            {
+            case JWTClaimValue::Type::string:
+                return escapedSize(claim.text());
+            case JWTClaimValue::Type::number:
+            {
+                char digits[24];
+                return static_cast<size_t>(std::to_chars(digits, digits + sizeof digits, claim.number()).ptr - digits);
+            }
+            case JWTClaimValue::Type::boolean:
+                return claim.number() != 0 ? 4 : 5;
+            case JWTClaimValue::Type::json:
+                return claim.text().size();
+            }
+            return 0;
+        }
+
+        char* writeValue(char* p, const JWTClaimValue& claim) noexcept
+        {
+            switch (claim.type())
+            {
+            case JWTClaimValue::Type::string:
+                return writeEscaped(p, claim.text());
+            case JWTClaimValue::Type::number:
+                return std::to_chars(p, p + 24, claim.number()).ptr;
+            case JWTClaimValue::Type::boolean:
+            {
+                std::string_view text = claim.number() != 0 ? "true"sv : "false"sv;
+                std::memcpy(p, text.data(), text.size());
+                return p + text.size();
+            }
+            case JWTClaimValue::Type::json:
+                std::memcpy(p, claim.text().data(), claim.text().size());
+                return p + claim.text().size();
+            }
+            return p;
+        }
+
+        size_t claimsSize(std::span<const JWTClaimValue> claims) noexcept
+        {
+            size_t size = 2 + (claims.empty() ? 0 : claims.size() - 1);
+            for (const JWTClaimValue& claim : claims)
+                size += escapedSize(claim.name()) + 1 + valueSize(claim);
+            return size;
+        }
+
+        void writeClaims(char* p, std::span<const JWTClaimValue> claims) noexcept
+        {
+            *p++ = '{';
+            for (size_t i = 0; i < claims.size(); ++i)
+            {
+                if (i != 0)
+                    *p++ = ',';
+                p = writeEscaped(p, claims[i].name());
+                *p++ = ':';
+                p = writeValue(p, claims[i]);
+            }
+            *p = '}';
+        }
+
+        // claims and signatures up to this size are produced on the stack
+        // and encoded into the token from there; encoding in place, from
+        // octets inside the very cache lines being written, runs at a
+        // third of the speed, so it is kept for what does not fit
+        constexpr size_t stageBytes = 2040;     // a multiple of 3
+
+        using Stage = unsigned char[stageBytes];
+
+        // encodes the "bytes" octets that lie at the end of the
+        // base64urlEncodedSize(bytes) characters at "dst", forward, in
+        // place: each chunk is copied out to "stage" before its characters
+        // are written, and the characters of one chunk end before the next
+        // chunk begins, as the octets start a third of their length in
+        void encodeInPlace(char* dst, size_t bytes, Stage& stage) noexcept
+        {
+            const char* src = dst + (base64urlEncodedSize(bytes) - bytes);
+            for (size_t done = 0; done < bytes; done += stageBytes)
+            {
+                size_t n = std::min(stageBytes, bytes - done);
+                std::memcpy(stage, src + done, n);
+                base64urlEncode(stage, n, dst + done / 3 * 4);
+            }
+        }
+    }
+
+    JWTWriter::JWTWriter(std::shared_ptr<const JWSSigner> signer, std::string_view typ)
+        : signer_(std::move(signer))
+    {
+        if (signer_ == nullptr)
+            throw JWTException("JWTWriter: a signer is required");
+
+        JWTClaimValue members[3];
+        size_t count = 0;
+        members[count++] = JWTClaimValue("alg", algName(signer_->alg()));
+        if (!typ.empty())
+            members[count++] = JWTClaimValue("typ", typ);
+        if (!signer_->kid().empty())
+            members[count++] = JWTClaimValue("kid", signer_->kid());
+
+        std::span<const JWTClaimValue> header(members, count);
+        std::string json(claimsSize(header), '\0');
+        writeClaims(json.data(), header);
+        encodedHeader_.resize(base64urlEncodedSize(json.size()));
+        base64urlEncode(json.data(), json.size(), encodedHeader_.data());
+        encodedHeader_ += '.';
+
+        signatureSize_ = base64urlEncodedSize(signer_->signatureSize());
+    }
+
+    size_t JWTWriter::size(std::span<const JWTClaimValue> claims) const noexcept
+    {
+        return encodedHeader_.size() + base64urlEncodedSize(claimsSize(claims)) + 1 + signatureSize_;
+    }
+
+    size_t JWTWriter::write(std::span<const JWTClaimValue> claims, SigningContext& context,
+        char* out, size_t capacity) const noexcept
+    {
+        size_t json = claimsSize(claims);
+        size_t payload = base64urlEncodedSize(json);
+        size_t total = encodedHeader_.size() + payload + 1 + signatureSize_;
+        if (total > capacity)
+            return 0;
+
+        Stage stage;
+        char* p = out;
+        std::memcpy(p, encodedHeader_.data(), encodedHeader_.size());
+        p += encodedHeader_.size();
+        if (json <= stageBytes)
+        {
+            writeClaims(reinterpret_cast<char*>(stage), claims);
+            base64urlEncode(stage, json, p);
+        }
+        else
+        {
+            writeClaims(p + (payload - json), claims);
+            encodeInPlace(p, json, stage);
+        }
+        p += payload;
+
+        // every signer here produces exactly signatureSize() octets, which
+        // is what makes the length exact
+        std::string_view signingInput(out, static_cast<size_t>(p - out));
+        *p++ = '.';
+        size_t expected = signer_->signatureSize();
+        bool staged = expected <= stageBytes;
+        unsigned char* signature = staged ? stage : reinterpret_cast<unsigned char*>(p + (signatureSize_ - expected));
+        size_t written = 0;
+        if (!context.sign(signingInput, signature, written) || written != expected)
+            return 0;
+        if (staged)
+            base64urlEncode(stage, expected, p);
+        else
+            encodeInPlace(p, expected, stage);
+        return total;
+    }
+}
@@ -0,0 +1,154 @@
+#include <ncbi/jwt.hpp>
+#include <ncbi/base64url.hpp>
+
+#include <cmath>
+#include <cstring>
+
+namespace ncbi
+{
+    JWTStatus JWTView::parse(std::string_view token, JWTView& view) noexcept
+    {
+        const char* data = token.data();
+        size_t size = token.size();
+
+        const void* d1 = std::memchr(data, '.', size);
+        if (d1 == nullptr)
+            return JWTStatus::malformed;
+        size_t dot1 = static_cast<size_t>(static_cast<const char*>(d1) - data);
+
+        const void* d2 = std::memchr(data + dot1 + 1, '.', size - dot1 - 1);
+        if (d2 == nullptr)
+            return JWTStatus::malformed;
+        size_t dot2 = static_cast<size_t>(static_cast<const char*>(d2) - data);
+
+        // a third dot means JWE or garbage; an empty header can never be valid
+        if (std::memchr(data + dot2 + 1, '.', size - dot2 - 1) != nullptr || dot1 == 0)
+            return JWTStatus::malformed;
+
+        view.token_ = token;
+        view.dot1_ = dot1;
+        view.dot2_ = dot2;
+        return JWTStatus::ok;
+    }
+
+    size_t JWTView::headerSize() const noexcept
+    {
+        return base64urlDecodedSize(dot1_);
+    }
+
+    size_t JWTView::payloadSize() const noexcept
+    {
+        return base64urlDecodedSize(dot2_ - dot1_ - 1);
+    }
+
+    size_t JWTView::signatureSize() const noexcept
+    {
+        return base64urlDecodedSize(token_.size() - dot2_ - 1);
+    }
+
+    namespace
+    {
+        JWTStatus decodeSegment(std::string_view segment, void* buf, size_t capacity, size_t& length) noexcept
+        {
+            if (base64urlDecodedSize(segment.size()) > capacity)
+                return JWTStatus::bufferTooSmall;
+            if (!base64urlDecode(segment, buf, length))
+                return JWTStatus::badEncoding;
+            return JWTStatus::ok;
+        }
+    }
+
+    JWTStatus JWTView::decodeHeader(char* buf, size_t capacity, std::string_view& json) const noexcept
+    {
+        size_t length;
+        JWTStatus status = decodeSegment(headerSegment(), buf, capacity, length);
+        if (status == JWTStatus::ok)
+            json = std::string_view(buf, length);
+        return status;
+    }
+
+    JWTStatus JWTView::decodePayload(char* buf, size_t capacity, std::string_view& json) const noexcept
+    {
+        size_t length;
+        JWTStatus status = decodeSegment(payloadSegment(), buf, capacity, length);
+        if (status == JWTStatus::ok)
+            json = std::string_view(buf, length);
+        return status;
+    }
+
+    JWTStatus JWTView::decodeSignature(unsigned char* buf, size_t capacity, size_t& length) const noexcept
+    {
+        return decodeSegment(signatureSegment(), buf, capacity, length);
+    }
+
+    JWTStatus JWTHeader::parse(std::string_view json, JWTHeader& header) noexcept
+    {
+        header = JWTHeader();
+        header.json = json;
+
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            return JWTStatus::badJSON;
+
+        // the header is small and every member matters to the verifier,
+        // so unlike the claims it is read in full
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            if (rawJSONStringEquals(name, "alg"))
+            {
+                header.alg = value.isPlainString()
+                    ? parseAlg(value.rawString())
+                    : JWTAlg::unknown;
+            }
+            else if (rawJSONStringEquals(name, "kid"))
+                header.kid = value;
+            else if (rawJSONStringEquals(name, "typ"))
+                header.typ = value;
+            else if (rawJSONStringEquals(name, "cty"))
+                header.cty = value;
+            else if (rawJSONStringEquals(name, "crit"))
+                header.hasCrit = true;
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            return JWTStatus::badJSON;
+        return JWTStatus::ok;
+    }
+
+    bool JWTClaimsView::find(std::string_view name, JSONValueView& value) const noexcept
+    {
+        return findJSONMember(json_, name, value);
+    }
+
+    bool JWTClaimsView::getString(std::string_view name, std::string_view& value) const noexcept
+    {
+        JSONValueView v;
+        if (!find(name, v) || !v.isPlainString())
+            return false;
+        value = v.rawString();
+        return true;
+    }
+
+    bool parseNumericDate(const JSONValueView& value, int64_t& seconds) noexcept
+    {
+        if (value.getInt64(seconds))
+            return true;
+
+        double d;
+        if (!value.getDouble(d) || !std::isfinite(d) || std::fabs(d) > 9.2e18)
+            return false;
+        seconds = static_cast<int64_t>(d);
+        return true;
+    }
+
+    bool JWTClaimsView::getNumericDate(std::string_view name, int64_t& seconds) const noexcept
+    {
+        JSONValueView v;
+        return find(name, v) && parseNumericDate(v, seconds);
+    }
+}
@@ -0,0 +1,67 @@
+#include <ncbi/oauth-client.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+
+namespace ncbi
+{
+    bool OAuthClient::allows(GrantType grant) const noexcept
+    {
+        return std::find(grants.begin(), grants.end(), grant) != grants.end();
+    }
+
+    bool OAuthClient::allowsScope(std::string_view scope) const noexcept
+    {
+        return std::find(scopes.begin(), scopes.end(), scope) != scopes.end();
+    }
+
+    ClientRegistry::ClientRegistry(std::vector<OAuthClient> clients)
+        : clients_(std::move(clients))
+    {
+        std::sort(clients_.begin(), clients_.end(),
+            [](const OAuthClient& a, const OAuthClient& b) { return a.id < b.id; });
+
+        secrets_.resize(clients_.size());
+        for (size_t i = 0; i < clients_.size(); ++i)
+        {
+            OAuthClient& client = clients_[i];
+            if (client.id.empty())
+                throw JWTException("ClientRegistry: empty client_id");
+            if (i > 0 && clients_[i - 1].id == client.id)
+                throw JWTException("ClientRegistry: duplicate client_id '" + client.id + "'");
+
+            if (!client.secret.empty())
+            {
+                SHA256(reinterpret_cast<const unsigned char*>(client.secret.data()), client.secret.size(),
+                    secrets_[i].data());
+
+                // keep the digest, and the fact that there is a secret
+                OPENSSL_cleanse(client.secret.data(), client.secret.size());
+                client.secret.assign(1, '*');
+            }
+        }
+    }
+
+    const OAuthClient* ClientRegistry::find(std::string_view id) const noexcept
+    {
+        auto it = std::lower_bound(clients_.begin(), clients_.end(), id,
+            [](const OAuthClient& client, std::string_view k) { return client.id < k; });
+        return it != clients_.end() && it->id == id ? &*it : nullptr;
+    }
+
+    bool ClientRegistry::authenticate(const OAuthClient& client, std::string_view secret) const noexcept
+    {
+        size_t i = static_cast<size_t>(&client - clients_.data());
+        if (i >= clients_.size() || !client.confidential())
+            return false;
+
+        // comparing digests keeps the time independent of where, and
+        // whether, the presented secret differs
+        Digest digest;
+        SHA256(reinterpret_cast<const unsigned char*>(secret.data()), secret.size(), digest.data());
+        return CRYPTO_memcmp(digest.data(), secrets_[i].data(), digest.size()) == 0;
+    }
+}
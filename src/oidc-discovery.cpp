@@ -0,0 +1,334 @@
+#include <ncbi/oidc-discovery.hpp>
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+
+namespace ncbi
+{
+    namespace
+    {
+        std::vector<std::string> jsonStrings(const JSONValueView& value, std::string_view member)
+        {
+            if (value.type() != JSONType::array)
+                throw JWTException("ProviderMetadata: member '" + std::string(member) + "' is not an array");
+
+            std::vector<std::string> out;
+            JSONReader reader(value.raw());
+            if (reader.enterArray())
+            {
+                while (reader.nextElement())
+                {
+                    JSONValueView element;
+                    if (!reader.readValue(element))
+                        break;
+                    out.push_back(jsonString(element, "ProviderMetadata", member));
+                }
+            }
+            if (reader.failed())
+                throw JWTException("ProviderMetadata: member '" + std::string(member) + "' is malformed");
+            return out;
+        }
+
+        bool issuerLess(const std::shared_ptr<const DiscoveryCache::Provider>& provider, std::string_view issuer) noexcept
+        {
+            return provider->metadata.issuer < issuer;
+        }
+    }
+
+    ProviderMetadata ProviderMetadata::parse(std::string_view json)
+    {
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            throw JWTException("ProviderMetadata: not a JSON object");
+
+        ProviderMetadata metadata;
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            if (rawJSONStringEquals(name, "issuer"))
+                metadata.issuer = jsonString(value, "ProviderMetadata", "issuer");
+            else if (rawJSONStringEquals(name, "jwks_uri"))
+                metadata.jwksURI = jsonString(value, "ProviderMetadata", "jwks_uri");
+            else if (rawJSONStringEquals(name, "authorization_endpoint"))
+                metadata.authorizationEndpoint = jsonString(value, "ProviderMetadata", "authorization_endpoint");
+            else if (rawJSONStringEquals(name, "token_endpoint"))
+                metadata.tokenEndpoint = jsonString(value, "ProviderMetadata", "token_endpoint");
+            else if (rawJSONStringEquals(name, "userinfo_endpoint"))
+                metadata.userinfoEndpoint = jsonString(value, "ProviderMetadata", "userinfo_endpoint");
+            else if (rawJSONStringEquals(name, "introspection_endpoint"))
+                metadata.introspectionEndpoint = jsonString(value, "ProviderMetadata", "introspection_endpoint");
+            else if (rawJSONStringEquals(name, "revocation_endpoint"))
+                metadata.revocationEndpoint = jsonString(value, "ProviderMetadata", "revocation_endpoint");
+            else if (rawJSONStringEquals(name, "scopes_supported"))
+                metadata.scopesSupported = jsonStrings(value, "scopes_supported");
+            else if (rawJSONStringEquals(name, "response_types_supported"))
+                metadata.responseTypesSupported = jsonStrings(value, "response_types_supported");
+            else if (rawJSONStringEquals(name, "grant_types_supported"))
+                metadata.grantTypesSupported = jsonStrings(value, "grant_types_supported");
+            else if (rawJSONStringEquals(name, "code_challenge_methods_supported"))
+                metadata.codeChallengeMethodsSupported = jsonStrings(value, "code_challenge_methods_supported");
+            else if (rawJSONStringEquals(name, "id_token_signing_alg_values_supported"))
+            {
+                for (const std::string& alg : jsonStrings(value, "id_token_signing_alg_values_supported"))
+                {
+                    JWTAlg a = parseAlg(alg);
+                    if (a != JWTAlg::unknown)
+                        metadata.idTokenSigningAlgs.push_back(a);
+                }
+            }
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            throw JWTException("ProviderMetadata: malformed JSON");
+        if (metadata.issuer.empty())
+            throw JWTException("ProviderMetadata: missing 'issuer'");
+        if (metadata.jwksURI.empty())
+            throw JWTException("ProviderMetadata: missing 'jwks_uri'");
+        return metadata;
+    }
+
+    std::string discoveryURI(std::string_view issuer)
+    {
+        if (!issuer.empty() && issuer.back() == '/')
+            issuer.remove_suffix(1);
+        return std::string(issuer) + "/.well-known/openid-configuration";
+    }
+
+    DiscoveryCache::Snapshot::Snapshot(const DiscoveryCache& cache) noexcept
+        : providers_(cache.directory_.load(guard_))
+    {
+    }
+
+    const DiscoveryCache::Provider* DiscoveryCache::Snapshot::find(std::string_view issuer) const noexcept
+    {
+        if (providers_ == nullptr)
+            return nullptr;
+        auto it = std::lower_bound(providers_->begin(), providers_->end(), issuer, issuerLess);
+        return it != providers_->end() && (*it)->metadata.issuer == issuer ? it->get() : nullptr;
+    }
+
+    size_t DiscoveryCache::Snapshot::size() const noexcept
+    {
+        return providers_ != nullptr ? providers_->size() : 0;
+    }
+
+    DiscoveryCache::DiscoveryCache(std::shared_ptr<Fetcher> fetcher, DiscoveryOptions options)
+        : fetcher_(std::move(fetcher))
+        , options_(options)
+        , refresher_([this](std::stop_token stop) { run(stop); })
+    {
+    }
+
+    DiscoveryCache::~DiscoveryCache()
+    {
+        refresher_.request_stop();
+        refresher_.join();
+
+        // directories retired earlier share these providers, and may free
+        // them later on any thread that publishes, a key set refresher
+        // among them, which cannot join itself
+        EpochGuard guard;
+        if (const Directory* current = directory_.load(guard))
+        {
+            for (const std::shared_ptr<const Provider>& provider : *current)
+                provider->keys->stop();
+        }
+    }
+
+    void DiscoveryCache::add(std::string issuer)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const Issuer& known : issuers_)
+        {
+            if (known.name == issuer)
+                return;
+        }
+        issuers_.push_back(Issuer { std::move(issuer), Clock::time_point::min() });
+        wakeup_.notify_one();
+    }
+
+    bool DiscoveryCache::waitUntilReady(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool tried = ready_.wait_for(lock, timeout, [this]
+        {
+            return std::all_of(issuers_.begin(), issuers_.end(), [](const Issuer& i) { return i.tried; });
+        });
+        if (!tried)
+            return false;
+
+        Snapshot resolved = snapshot();
+        return std::all_of(issuers_.begin(), issuers_.end(),
+            [&](const Issuer& i) { return resolved.find(i.name) != nullptr; });
+    }
+
+    bool DiscoveryCache::refresh(std::string_view issuer)
+    {
+        std::string name(issuer);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (std::none_of(issuers_.begin(), issuers_.end(), [&](const Issuer& i) { return i.name == name; }))
+                return false;
+        }
+
+        bool ok;
+        Clock::time_point next = discover(name, ok);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Issuer& i : issuers_)
+        {
+            if (i.name == name)
+            {
+                i.next = next;
+                i.tried = true;
+            }
+        }
+        ready_.notify_all();
+        return ok;
+    }
+
+    DiscoveryCache::Clock::time_point DiscoveryCache::discover(const std::string& issuer, bool& ok)
+    {
+        std::lock_guard<std::mutex> lock(publishMutex_);
+
+        Clock::time_point now = Clock::now();
+        ok = false;
+
+        FetchResponse response;
+        try
+        {
+            response = fetcher_->get(discoveryURI(issuer));
+        }
+        catch (...)
+        {
+            return now + options_.retryInterval;
+        }
+        if (response.status != 200)
+            return now + options_.retryInterval;
+
+        auto provider = std::make_shared<Provider>();
+        try
+        {
+            provider->metadata = ProviderMetadata::parse(response.body);
+        }
+        catch (const JWTException&)
+        {
+            return now + options_.retryInterval;
+        }
+
+        // OpenID Connect Discovery 1.0 section 4.3: a document naming
+        // another issuer must not be used, or one provider could pass off
+        // its keys as another's
+        if (provider->metadata.issuer != issuer)
+            return now + options_.retryInterval;
+
+        // the directory only changes under publishMutex_, which is held, so
+        // what is read here stays reachable after the guard is released;
+        // no guard may be held across the key set fetch below
+        const Directory* current;
+        {
+            EpochGuard guard;
+            current = directory_.load(guard);
+        }
+        const Provider* previous = nullptr;
+        if (current != nullptr)
+        {
+            auto it = std::lower_bound(current->begin(), current->end(), issuer, issuerLess);
+            if (it != current->end() && (*it)->metadata.issuer == issuer)
+                previous = it->get();
+        }
+
+        // a cache the provider no longer uses is stopped once it is
+        // unpublished, while this thread still holds it: the old directory
+        // may release it on any thread that publishes, its own refresher
+        // included, which cannot join itself
+        std::shared_ptr<JWKSCache> replaced;
+        if (previous != nullptr && previous->metadata.jwksURI == provider->metadata.jwksURI)
+            provider->keys = previous->keys;
+        else
+        {
+            if (previous != nullptr)
+                replaced = previous->keys;
+            // the key set is fetched before the provider is published, so
+            // no lookup ever finds a provider without keys
+            provider->keys = std::make_shared<JWKSCache>(provider->metadata.jwksURI, fetcher_, options_.jwks);
+            try
+            {
+                provider->keys->start();
+            }
+            catch (const JWTException&)
+            {
+                return now + options_.retryInterval;
+            }
+        }
+        provider->generation = previous != nullptr ? previous->generation + 1 : 1;
+
+        auto next = std::make_unique<Directory>(current != nullptr ? *current : Directory());
+        auto it = std::lower_bound(next->begin(), next->end(), issuer, issuerLess);
+        if (it != next->end() && (*it)->metadata.issuer == issuer)
+            *it = std::move(provider);
+        else
+            next->insert(it, std::move(provider));
+        directory_.publish(std::move(next));
+        if (replaced != nullptr)
+            replaced->stop();
+        ok = true;
+
+        std::chrono::seconds maxAge = parseCacheControlMaxAge(response.cacheControl).value_or(options_.defaultMaxAge);
+        maxAge = std::clamp(maxAge, options_.minRefreshInterval, options_.maxRefreshInterval);
+        return now + maxAge;
+    }
+
+    void DiscoveryCache::run(std::stop_token stop)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!stop.stop_requested())
+        {
+            // the issuer due soonest; new issuers are due at once
+            Issuer* due = nullptr;
+            for (Issuer& i : issuers_)
+            {
+                if (due == nullptr || i.next < due->next)
+                    due = &i;
+            }
+
+            if (due == nullptr)
+            {
+                wakeup_.wait(lock, stop, [this] { return !issuers_.empty(); });
+                continue;
+            }
+            if (Clock::now() < due->next)
+            {
+                // an add() or refresh() changes the schedule, so wake for it too
+                Clock::time_point until = due->next;
+                size_t count = issuers_.size();
+                wakeup_.wait_until(lock, stop, until, [&] { return issuers_.size() != count; });
+                continue;
+            }
+
+            // issuers_ may grow while unlocked, so the name is copied
+            std::string issuer = due->name;
+            lock.unlock();
+            bool ok;
+            Clock::time_point next = discover(issuer, ok);
+            lock.lock();
+
+            for (Issuer& i : issuers_)
+            {
+                if (i.name == issuer)
+                {
+                    i.next = next;
+                    i.tried = true;
+                }
+            }
+            ready_.notify_all();
+        }
+    }
+}
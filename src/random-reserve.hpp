@@ -0,0 +1,18 @@
+#pragma once
+
+// random bytes from a per-thread reserve, refilled from RAND_bytes a
+// kilobyte at a time, as TokenEndpoint's workers do for "jti" values:
+// RAND_bytes costs over a microsecond a call, which would otherwise
+// bound credential minting well below a million a second
+//
+// bytes are wiped from the reserve as they are handed out, and a reserve
+// filled before a fork() is discarded in the child, so that parent and
+// child never mint the same credential
+
+#include <cstddef>
+
+namespace ncbi::detail
+{
+    // "n" is at most a kilobyte; false if OpenSSL has no randomness to give
+    bool takeRandom(unsigned char* out, size_t n) noexcept;
+}
@@ -0,0 +1,711 @@
+#include <ncbi/refresh-log.hpp>
+#include <ncbi/hash.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <openssl/sha.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace ncbi
+{
+    namespace
+    {
+        // record layout, little-endian and 8-byte aligned:
+        //
+        //     u32 size        whole record, header included
+        //     u8  type
+        //     u8  pad[3]
+        //     u64 checksum    hash64 of the body, seeded with size and type
+        //     ... body
+        enum RecordType : unsigned char
+        {
+            issueRecord = 1,        // key, parent, family, expires, grant strings
+            retiredRecord = 2,      // key, family, expires; written by compaction
+            revokeRecord = 3,       // family
+            cancelRecord = 4        // key, parent: a rotation undone
+        };
+
+        constexpr size_t headerSize = 16;
+        constexpr uint64_t checksumSeed = 0x6e6362692d6f6175ull;
+
+        struct IssueBody
+        {
+            unsigned char key[32];
+            unsigned char parent[32];       // zero for a first issue
+            uint64_t family;
+            int64_t expires;
+            uint16_t clientIdSize;
+            uint16_t subjectSize;
+            uint16_t scopeSize;
+            uint16_t pad;
+            // client_id, subject and scope follow
+        };
+
+        struct RetiredBody
+        {
+            unsigned char key[32];
+            uint64_t family;
+            int64_t expires;
+        };
+
+        struct CancelBody
+        {
+            unsigned char key[32];          // the successor, forgotten
+            unsigned char parent[32];       // the presented token, usable again
+        };
+
+        constexpr size_t align8(size_t n) noexcept
+        {
+            return (n + 7) & ~size_t(7);
+        }
+
+        uint64_t checksum(const unsigned char* body, size_t bodySize, uint32_t size, unsigned char type) noexcept
+        {
+            return hash64(std::string_view(reinterpret_cast<const char*>(body), bodySize),
+                checksumSeed ^ (uint64_t(size) << 8 | type));
+        }
+
+        [[noreturn]] void fail(const std::string& what, int error = errno)
+        {
+            throw JWTException("LogRefreshTokenStore: " + what + ": " + std::strerror(error));
+        }
+
+        void syncDirectory(const std::string& path)
+        {
+            size_t slash = path.rfind('/');
+            std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+            int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd >= 0)
+            {
+                ::fsync(fd);
+                ::close(fd);
+            }
+        }
+    }
+
+    LogRefreshTokenStore::LogRefreshTokenStore(std::string path, LogRefreshTokenStoreOptions options)
+        : path_(std::move(path))
+        , options_(options)
+    {
+        size_t shards = std::bit_ceil(std::max<size_t>(options_.shards, 1));
+        shards_ = std::make_unique<Shard[]>(shards);
+        shardMask_ = shards - 1;
+        options_.growBy = align8(std::max<size_t>(options_.growBy, 4096));
+
+        openLog(log_, path_, false);
+        try
+        {
+            replay();
+        }
+        catch (...)
+        {
+            closeLog(log_);
+            throw;
+        }
+    }
+
+    LogRefreshTokenStore::~LogRefreshTokenStore()
+    {
+        if (options_.sync && log_.fd >= 0)
+            ::fdatasync(log_.fd);
+        closeLog(log_);
+    }
+
+    void LogRefreshTokenStore::openLog(Log& log, const std::string& path, bool truncate)
+    {
+        log.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0600);
+        if (log.fd < 0)
+            fail("cannot open '" + path + "'");
+
+        struct stat st;
+        if (::fstat(log.fd, &st) != 0)
+        {
+            closeLog(log);
+            fail("cannot stat '" + path + "'");
+        }
+        log.fileSize = static_cast<size_t>(st.st_size);
+
+        // the whole reservation is mapped once; the file grows beneath it,
+        // so records never move and readers need no lock against growth
+        size_t reservation = std::max(options_.maxSize, log.fileSize);
+        void* base = ::mmap(nullptr, reservation, PROT_READ | PROT_WRITE, MAP_SHARED, log.fd, 0);
+        if (base == MAP_FAILED)
+        {
+            closeLog(log);
+            fail("cannot map '" + path + "'");
+        }
+        log.base = static_cast<unsigned char*>(base);
+        log.tail = 0;
+
+        if (log.fileSize == 0)
+            reserve(log, options_.growBy);
+        if (truncate)
+            syncDirectory(path);
+    }
+
+    void LogRefreshTokenStore::closeLog(Log& log) noexcept
+    {
+        if (log.base != nullptr)
+            ::munmap(log.base, std::max(options_.maxSize, log.fileSize));
+        if (log.fd >= 0)
+            ::close(log.fd);
+        log = Log();
+    }
+
+    void LogRefreshTokenStore::reserve(Log& log, size_t bytes)
+    {
+        if (log.tail + bytes <= log.fileSize)
+            return;
+
+        size_t size = log.fileSize + std::max(options_.growBy, align8(bytes));
+        if (size > std::max(options_.maxSize, log.fileSize))
+            throw JWTException("LogRefreshTokenStore: log full; compact it or raise maxSize");
+        if (::ftruncate(log.fd, static_cast<off_t>(size)) != 0)
+            fail("cannot extend log");
+        log.fileSize = size;
+    }
+
+    void LogRefreshTokenStore::replay()
+    {
+        uint64_t maxFamily = 0;
+        size_t at = 0;
+        while (at + headerSize <= log_.fileSize)
+        {
+            const unsigned char* record = log_.base + at;
+            uint32_t size;
+            std::memcpy(&size, record, sizeof size);
+            unsigned char type = record[4];
+            uint64_t sum;
+            std::memcpy(&sum, record + 8, sizeof sum);
+
+            // the first record that is absent, torn or corrupt ends the log
+            if (size < headerSize || size % 8 != 0 || size > log_.fileSize - at ||
+                sum != checksum(record + headerSize, size - headerSize, size, type))
+            {
+                break;
+            }
+            const unsigned char* body = record + headerSize;
+            size_t bodySize = size - headerSize;
+
+            if (type == issueRecord && bodySize >= sizeof(IssueBody))
+            {
+                IssueBody issue;
+                std::memcpy(&issue, body, sizeof issue);
+
+                Key key;
+                std::memcpy(key.data(), issue.key, key.size());
+                shardFor(key).entries.insert_or_assign(key, Entry { at, issue.family, issue.expires, false, false });
+
+                Key parent;
+                std::memcpy(parent.data(), issue.parent, parent.size());
+                if (parent != Key())
+                {
+                    auto& entries = shardFor(parent).entries;
+                    auto it = entries.find(parent);
+                    if (it != entries.end())
+                        it->second.retired = true;
+                }
+                maxFamily = std::max(maxFamily, issue.family);
+            }
+            else if (type == retiredRecord && bodySize >= sizeof(RetiredBody))
+            {
+                RetiredBody retired;
+                std::memcpy(&retired, body, sizeof retired);
+
+                Key key;
+                std::memcpy(key.data(), retired.key, key.size());
+                shardFor(key).entries.insert_or_assign(key, Entry { at, retired.family, retired.expires, true, false });
+                maxFamily = std::max(maxFamily, retired.family);
+            }
+            else if (type == revokeRecord && bodySize >= sizeof(uint64_t))
+            {
+                uint64_t family;
+                std::memcpy(&family, body, sizeof family);
+                revoked_.insert(family);
+            }
+            else if (type == cancelRecord && bodySize >= sizeof(CancelBody))
+            {
+                CancelBody cancel;
+                std::memcpy(&cancel, body, sizeof cancel);
+
+                Key key;
+                std::memcpy(key.data(), cancel.key, key.size());
+                shardFor(key).entries.erase(key);
+
+                Key parent;
+                std::memcpy(parent.data(), cancel.parent, parent.size());
+                auto& entries = shardFor(parent).entries;
+                auto it = entries.find(parent);
+                if (it != entries.end())
+                    it->second.retired = false;
+            }
+            at += size;
+        }
+
+        // whatever follows may be the remains of a torn record; clear it
+        // so that records appended over it cannot be misread later
+        std::memset(log_.base + at, 0, log_.fileSize - at);
+        log_.tail = at;
+        nextFamily_.store(maxFamily + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t LogRefreshTokenStore::append(unsigned char type, const void* body, size_t bodySize, uint64_t& offset)
+    {
+        size_t size = align8(headerSize + bodySize);
+        reserve(log_, size);
+
+        unsigned char* record = log_.base + log_.tail;
+        std::memset(record, 0, size);
+        std::memcpy(record + headerSize, body, bodySize);
+
+        uint32_t size32 = static_cast<uint32_t>(size);
+        uint64_t sum = checksum(record + headerSize, size - headerSize, size32, type);
+        std::memcpy(record, &size32, sizeof size32);
+        record[4] = type;
+        std::memcpy(record + 8, &sum, sizeof sum);
+
+        offset = log_.tail;
+        log_.tail += size;
+        appends_.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(syncMutex_);
+        appended_ += size;
+        return appended_;
+    }
+
+    uint64_t LogRefreshTokenStore::appendIssue(const Key& key, const Key& parent, uint64_t family,
+        const AuthorizationGrant& grant, uint64_t& offset)
+    {
+        for (const std::string* s : { &grant.clientId, &grant.subject, &grant.scope })
+        {
+            if (s->size() > UINT16_MAX)
+                throw JWTException("LogRefreshTokenStore: grant member too long");
+        }
+
+        IssueBody issue {};
+        std::memcpy(issue.key, key.data(), key.size());
+        std::memcpy(issue.parent, parent.data(), parent.size());
+        issue.family = family;
+        issue.expires = grant.expires;
+        issue.clientIdSize = static_cast<uint16_t>(grant.clientId.size());
+        issue.subjectSize = static_cast<uint16_t>(grant.subject.size());
+        issue.scopeSize = static_cast<uint16_t>(grant.scope.size());
+
+        std::string body(reinterpret_cast<const char*>(&issue), sizeof issue);
+        body += grant.clientId;
+        body += grant.subject;
+        body += grant.scope;
+        return append(issueRecord, body.data(), body.size(), offset);
+    }
+
+    void LogRefreshTokenStore::waitDurable(uint64_t position)
+    {
+        if (!options_.sync)
+            return;
+
+        std::unique_lock<std::mutex> lock(syncMutex_);
+        while (durable_ < position)
+        {
+            // a failed fdatasync may have lost the record for good, and
+            // one that succeeds now would not say otherwise; whoever it
+            // covered fails with it
+            if (position <= failed_)
+                fail("fdatasync failed", syncError_);
+            if (syncing_)
+            {
+                synced_.wait(lock);
+                continue;
+            }
+
+            // this caller leads: one fdatasync covers every record
+            // appended so far, its own and those of whoever is waiting
+            syncing_ = true;
+            uint64_t target = appended_;
+            int fd = log_.fd;
+            lock.unlock();
+            int rc = ::fdatasync(fd);
+            int error = errno;
+            syncs_.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+            syncing_ = false;
+            if (rc == 0)
+                durable_ = std::max(durable_, target);
+            else
+            {
+                failed_ = std::max(failed_, target);
+                syncError_ = error;
+            }
+            synced_.notify_all();
+        }
+    }
+
+    std::string LogRefreshTokenStore::issue(AuthorizationGrant grant)
+    {
+        std::string token = randomCredential();
+        Key key;
+        SHA256(reinterpret_cast<const unsigned char*>(token.data()), token.size(), key.data());
+        uint64_t family = nextFamily_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t position;
+        {
+            std::lock_guard<std::mutex> lock(appendMutex_);
+            uint64_t offset;
+            position = appendIssue(key, Key(), family, grant, offset);
+
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> shardLock(shard.mutex);
+            shard.entries.insert_or_assign(key, Entry { offset, family, grant.expires, false, false });
+        }
+        waitDurable(position);
+        return token;
+    }
+
+    bool LogRefreshTokenStore::familyRevoked(uint64_t family) const
+    {
+        std::shared_lock<std::shared_mutex> lock(familiesMutex_);
+        return revoked_.count(family) != 0;
+    }
+
+    void LogRefreshTokenStore::revokeFamily(uint64_t family)
+    {
+        {
+            std::unique_lock<std::shared_mutex> lock(familiesMutex_);
+            if (!revoked_.insert(family).second)
+                return;
+        }
+
+        uint64_t position;
+        {
+            std::lock_guard<std::mutex> lock(appendMutex_);
+            uint64_t offset;
+            position = append(revokeRecord, &family, sizeof family, offset);
+        }
+        waitDurable(position);
+    }
+
+    AuthorizationGrant LogRefreshTokenStore::readGrant(uint64_t offset) const
+    {
+        IssueBody issue;
+        const unsigned char* body = log_.base + offset + headerSize;
+        std::memcpy(&issue, body, sizeof issue);
+        const char* strings = reinterpret_cast<const char*>(body + sizeof issue);
+
+        AuthorizationGrant grant;
+        grant.clientId.assign(strings, issue.clientIdSize);
+        grant.subject.assign(strings + issue.clientIdSize, issue.subjectSize);
+        grant.scope.assign(strings + issue.clientIdSize + issue.subjectSize, issue.scopeSize);
+        grant.expires = issue.expires;
+        return grant;
+    }
+
+    RotateResult LogRefreshTokenStore::rotate(std::string_view token, std::string_view clientId,
+        std::string_view scope, int64_t now, AuthorizationGrant& grant, std::string& successor)
+    {
+        Key key;
+        SHA256(reinterpret_cast<const unsigned char*>(token.data()), token.size(), key.data());
+
+        uint64_t family;
+        bool reused = false;
+        AuthorizationGrant stored;
+        {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.entries.find(key);
+            if (it == shard.entries.end())
+                return RotateResult::invalidGrant;
+
+            Entry& entry = it->second;
+            family = entry.family;
+            if (familyRevoked(family))
+                return RotateResult::invalidGrant;
+
+            if (entry.retired)
+                reused = true;
+            else
+            {
+                if (entry.expires <= now)
+                    return RotateResult::invalidGrant;
+
+                // the shard lock keeps compaction from moving the record
+                stored = readGrant(entry.offset);
+                if (stored.clientId != clientId)
+                    return RotateResult::invalidGrant;
+                if (!scope.empty() && !scopeWithin(scope, stored.scope))
+                    return RotateResult::invalidScope;
+
+                // retired here, so that of two racing rotations only one
+                // proceeds; the record saying so is the successor's
+                entry.retired = true;
+                entry.rotating = true;
+            }
+        }
+
+        // a retired token presented again: whoever holds the family's
+        // current token, the client or an attacker, loses it
+        if (reused)
+        {
+            reuseDetected_.fetch_add(1, std::memory_order_relaxed);
+            revokeFamily(family);
+            return RotateResult::invalidGrant;
+        }
+
+        std::string next = randomCredential();
+        Key nextKey;
+        SHA256(reinterpret_cast<const unsigned char*>(next.data()), next.size(), nextKey.data());
+
+        // ends the rotation, in the index alone once it is durable
+        auto settle = [&](bool retired)
+        {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.entries.find(key);
+            if (it != shard.entries.end())
+            {
+                it->second.retired = retired;
+                it->second.rotating = false;
+            }
+        };
+
+        // undoes the rotation: the presented token is usable again and the
+        // successor, which the client never received, is forgotten, so a
+        // retry is a rotation like any other and not reuse; once the
+        // successor is logged, a cancel record does the same on replay
+        // it is synced if the log can be synced at all, and if it is not,
+        // a retry after a restart is taken for reuse
+        auto rollBack = [&](bool logged)
+        {
+            uint64_t position = 0;
+            if (logged)
+            {
+                CancelBody cancel;
+                std::memcpy(cancel.key, nextKey.data(), nextKey.size());
+                std::memcpy(cancel.parent, key.data(), key.size());
+
+                std::lock_guard<std::mutex> lock(appendMutex_);
+                try
+                {
+                    uint64_t offset;
+                    position = append(cancelRecord, &cancel, sizeof cancel, offset);
+                }
+                catch (const JWTException&)
+                {
+                }
+
+                Shard& shard = shardFor(nextKey);
+                std::lock_guard<std::mutex> shardLock(shard.mutex);
+                shard.entries.erase(nextKey);
+            }
+            settle(false);
+
+            if (position != 0)
+            {
+                try
+                {
+                    waitDurable(position);
+                }
+                catch (const JWTException&)
+                {
+                }
+            }
+        };
+
+        uint64_t position;
+        try
+        {
+            std::lock_guard<std::mutex> lock(appendMutex_);
+            uint64_t offset;
+            position = appendIssue(nextKey, key, family, stored, offset);
+
+            Shard& shard = shardFor(nextKey);
+            std::lock_guard<std::mutex> shardLock(shard.mutex);
+            shard.entries.insert_or_assign(nextKey, Entry { offset, family, stored.expires, false, false });
+        }
+        catch (...)
+        {
+            // nothing was logged
+            rollBack(false);
+            throw;
+        }
+
+        // the record is in the log but may not be on disk; until it is,
+        // the rotation has not happened as far as the client can tell
+        try
+        {
+            waitDurable(position);
+        }
+        catch (...)
+        {
+            rollBack(true);
+            throw;
+        }
+        settle(true);
+        grant = std::move(stored);
+        successor = std::move(next);
+        return RotateResult::rotated;
+    }
+
+    void LogRefreshTokenStore::compact(int64_t now)
+    {
+        std::lock_guard<std::mutex> appendLock(appendMutex_);
+
+        std::vector<std::unique_lock<std::mutex>> shardLocks;
+        for (size_t s = 0; s <= shardMask_; ++s)
+            shardLocks.emplace_back(shards_[s].mutex);
+
+        // no fdatasync may be running on the old file when it goes
+        std::unique_lock<std::mutex> syncLock(syncMutex_);
+        synced_.wait(syncLock, [this] { return !syncing_; });
+
+        std::unique_lock<std::shared_mutex> familiesLock(familiesMutex_);
+
+        std::string temporary = path_ + ".compact";
+        Log fresh;
+        openLog(fresh, temporary, true);
+
+        // tokens retired by a rotation still in flight go first, whole:
+        // the rotation may yet be undone, and if it is not, the record of
+        // its successor, later in the file, retires them again on replay
+        auto copy = [&](bool rotating)
+        {
+            for (size_t s = 0; s <= shardMask_; ++s)
+            {
+                auto& entries = shards_[s].entries;
+                for (auto it = entries.begin(); it != entries.end(); )
+                {
+                    Entry& entry = it->second;
+                    if (entry.rotating != rotating)
+                    {
+                        ++it;
+                        continue;
+                    }
+                    if (entry.expires <= now || revoked_.count(entry.family) != 0)
+                    {
+                        it = entries.erase(it);
+                        continue;
+                    }
+
+                    const unsigned char* record = log_.base + entry.offset;
+                    size_t size;
+                    if (entry.retired && !entry.rotating)
+                    {
+                        // retired tokens keep only what reuse detection needs
+                        RetiredBody retired {};
+                        std::memcpy(retired.key, it->first.data(), it->first.size());
+                        retired.family = entry.family;
+                        retired.expires = entry.expires;
+
+                        size = align8(headerSize + sizeof retired);
+                        reserve(fresh, size);
+                        unsigned char* out = fresh.base + fresh.tail;
+                        std::memset(out, 0, size);
+                        std::memcpy(out + headerSize, &retired, sizeof retired);
+                        uint32_t size32 = static_cast<uint32_t>(size);
+                        uint64_t sum = checksum(out + headerSize, size - headerSize, size32, retiredRecord);
+                        std::memcpy(out, &size32, sizeof size32);
+                        out[4] = retiredRecord;
+                        std::memcpy(out + 8, &sum, sizeof sum);
+                    }
+                    else
+                    {
+                        // a live record is copied as it stands
+                        uint32_t size32;
+                        std::memcpy(&size32, record, sizeof size32);
+                        size = size32;
+                        reserve(fresh, size);
+                        std::memcpy(fresh.base + fresh.tail, record, size);
+                    }
+
+                    entry.offset = fresh.tail;
+                    fresh.tail += size;
+                    ++it;
+                }
+            }
+        };
+
+        try
+        {
+            copy(true);
+            copy(false);
+
+            if (::fdatasync(fresh.fd) != 0)
+                fail("fdatasync failed");
+            if (::rename(temporary.c_str(), path_.c_str()) != 0)
+                fail("cannot replace '" + path_ + "'");
+            syncDirectory(path_);
+        }
+        catch (...)
+        {
+            // the index may point into the new file by now; rebuild it
+            // from the old one, which is still in place, and retire again
+            // what rotations in flight retired
+            closeLog(fresh);
+            ::unlink(temporary.c_str());
+            std::vector<Key> rotating;
+            for (size_t s = 0; s <= shardMask_; ++s)
+            {
+                for (const auto& [key, entry] : shards_[s].entries)
+                {
+                    if (entry.rotating)
+                        rotating.push_back(key);
+                }
+                shards_[s].entries.clear();
+            }
+            revoked_.clear();
+            replay();
+            for (const Key& key : rotating)
+            {
+                auto& entries = shardFor(key).entries;
+                auto it = entries.find(key);
+                if (it != entries.end())
+                {
+                    it->second.retired = true;
+                    it->second.rotating = true;
+                }
+            }
+            throw;
+        }
+
+        closeLog(log_);
+        log_ = fresh;
+
+        // revoked families have no entries left to refuse
+        revoked_.clear();
+
+        // everything in the new file is on disk
+        durable_ = appended_;
+        synced_.notify_all();
+    }
+
+    LogRefreshTokenStore::Stats LogRefreshTokenStore::stats() const
+    {
+        Stats stats;
+        for (size_t s = 0; s <= shardMask_; ++s)
+        {
+            Shard& shard = shards_[s];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& [key, entry] : shard.entries)
+                ++(entry.retired ? stats.retired : stats.live);
+        }
+        {
+            std::shared_lock<std::shared_mutex> lock(familiesMutex_);
+            stats.revokedFamilies = revoked_.size();
+        }
+        stats.reuseDetected = reuseDetected_.load(std::memory_order_relaxed);
+        stats.appends = appends_.load(std::memory_order_relaxed);
+        stats.syncs = syncs_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(appendMutex_);
+            stats.logBytes = log_.tail;
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,429 @@
+#include <ncbi/revocation.hpp>
+#include <ncbi/hash.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace ncbi
+{
+    namespace
+    {
+        // a filter block is one cache line; a "jti" sets one bit in each of
+        // its eight words (the split block Bloom filter of Apache Parquet)
+        struct alignas(64) FilterBlock
+        {
+            uint64_t words[8];
+        };
+
+        constexpr uint32_t filterSalt[8] =
+        {
+            0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+            0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+        };
+
+        struct Entry
+        {
+            uint64_t hash;
+            int64_t expires;
+            uint32_t offset;                // of the "jti" in the pool
+            uint32_t size;
+        };
+
+        bool isSpace(char c) noexcept
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        // splits off the next whitespace-delimited field of "line"
+        std::string_view nextField(std::string_view& line) noexcept
+        {
+            size_t begin = 0;
+            while (begin < line.size() && isSpace(line[begin]))
+                ++begin;
+            size_t end = begin;
+            while (end < line.size() && !isSpace(line[end]))
+                ++end;
+            std::string_view field = line.substr(begin, end - begin);
+            line.remove_prefix(end);
+            return field;
+        }
+
+        template<class T>
+        bool parseNumber(std::string_view text, T& value) noexcept
+        {
+            auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return ec == std::errc() && end == text.data() + text.size();
+        }
+
+        [[noreturn]] void malformed(size_t line, const char* what)
+        {
+            throw JWTException("RevocationList: line " + std::to_string(line) + ": " + what);
+        }
+
+        struct Change
+        {
+            bool revoke;
+            std::string_view jti;
+            int64_t expires;
+        };
+
+        struct Document
+        {
+            uint64_t serial = 0;
+            bool delta = false;
+            uint64_t base = 0;
+            std::vector<Change> changes;
+        };
+
+        Document parseDocument(std::string_view text)
+        {
+            Document document;
+            bool numbered = false;
+            size_t number = 0;
+            while (!text.empty())
+            {
+                size_t eol = text.find('\n');
+                std::string_view line = text.substr(0, eol);
+                text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+                ++number;
+
+                std::string_view op = nextField(line);
+                if (op.empty())
+                    continue;
+
+                if (!numbered)
+                {
+                    if (op != "revocations" || !parseNumber(nextField(line), document.serial))
+                        malformed(number, "expected \"revocations <serial>\"");
+                    std::string_view after = nextField(line);
+                    if (!after.empty())
+                    {
+                        if (after != "after" || !parseNumber(nextField(line), document.base))
+                            malformed(number, "expected \"after <base>\"");
+                        document.delta = true;
+                    }
+                    numbered = true;
+                }
+                else if (op == "+")
+                {
+                    Change change { true, nextField(line), 0 };
+                    if (change.jti.empty() || !parseNumber(nextField(line), change.expires))
+                        malformed(number, "expected \"+ <jti> <exp>\"");
+                    document.changes.push_back(change);
+                }
+                else if (op == "-")
+                {
+                    Change change { false, nextField(line), 0 };
+                    if (change.jti.empty())
+                        malformed(number, "expected \"- <jti>\"");
+                    document.changes.push_back(change);
+                }
+                else
+                {
+                    malformed(number, "unknown operation");
+                }
+
+                if (!nextField(line).empty())
+                    malformed(number, "trailing text");
+            }
+            if (!numbered)
+                throw JWTException("RevocationList: empty document");
+            return document;
+        }
+    }
+
+    struct RevocationList::Set
+    {
+        uint64_t serial = 0;
+
+        std::vector<FilterBlock> filter;    // empty when the list is empty
+        std::vector<Entry> entries;
+        std::vector<uint32_t> slots;        // entry index + 1, 0 when free
+        size_t slotMask = 0;
+        std::string jtis;
+
+        std::string_view jti(const Entry& entry) const noexcept
+        {
+            return std::string_view(jtis).substr(entry.offset, entry.size);
+        }
+
+        bool mayContain(uint64_t hash) const noexcept
+        {
+            // the high half picks the block, the low half the bits in it
+            uint64_t block = (hash >> 32) * filter.size() >> 32;
+            const FilterBlock& b = filter[block];
+            uint32_t low = static_cast<uint32_t>(hash);
+            uint64_t missing = 0;
+            for (int i = 0; i < 8; ++i)
+                missing |= ~b.words[i] & uint64_t(1) << ((low * filterSalt[i]) >> 26);
+            return missing == 0;
+        }
+
+        const Entry* find(std::string_view jti, uint64_t hash) const noexcept
+        {
+            if (slots.empty())
+                return nullptr;
+            for (size_t slot = hash & slotMask; slots[slot] != 0; slot = (slot + 1) & slotMask)
+            {
+                const Entry& entry = entries[slots[slot] - 1];
+                if (entry.hash == hash && this->jti(entry) == jti)
+                    return &entry;
+            }
+            return nullptr;
+        }
+    };
+
+    // the next snapshot, built from the current one and a batch of changes
+    class RevocationList::Builder
+    {
+    public:
+        Builder(const Set* from, uint64_t seed)
+            : seed_(seed)
+        {
+            if (from == nullptr)
+                return;
+            entries_.reserve(from->entries.size());
+            for (const Entry& entry : from->entries)
+                entries_.emplace(from->jti(entry), entry.expires);
+        }
+
+        // views must stay valid until build() returns
+        void revoke(std::string_view jti, int64_t expires)
+        {
+            auto [it, added] = entries_.emplace(jti, expires);
+            if (!added)
+                it->second = std::max(it->second, expires);
+        }
+
+        void withdraw(std::string_view jti) { entries_.erase(jti); }
+
+        void prune(int64_t now)
+        {
+            std::erase_if(entries_, [now](const auto& entry) { return entry.second <= now; });
+        }
+
+        std::unique_ptr<const Set> build(uint64_t serial, unsigned bitsPerEntry) const
+        {
+            auto set = std::make_unique<Set>();
+            set->serial = serial;
+            size_t n = entries_.size();
+            if (n == 0)
+                return set;
+            if (n > UINT32_MAX - 1)
+                throw JWTException("RevocationList: too many entries");
+
+            set->entries.reserve(n);
+            size_t poolSize = 0;
+            for (const auto& [jti, expires] : entries_)
+                poolSize += jti.size();
+            if (poolSize > UINT32_MAX)
+                throw JWTException("RevocationList: too many entries");
+            set->jtis.reserve(poolSize);
+            for (const auto& [jti, expires] : entries_)
+            {
+                set->entries.push_back({ hash64(jti, seed_), expires,
+                    static_cast<uint32_t>(set->jtis.size()), static_cast<uint32_t>(jti.size()) });
+                set->jtis += jti;
+            }
+
+            size_t blocks = std::max<size_t>(1, (n * std::max(bitsPerEntry, 1u) + 511) / 512);
+            set->filter.assign(std::min<size_t>(blocks, UINT32_MAX), FilterBlock {});
+            set->slots.assign(std::bit_ceil(n * 2), 0);
+            set->slotMask = set->slots.size() - 1;
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                uint64_t hash = set->entries[i].hash;
+
+                FilterBlock& b = set->filter[(hash >> 32) * set->filter.size() >> 32];
+                uint32_t low = static_cast<uint32_t>(hash);
+                for (int w = 0; w < 8; ++w)
+                    b.words[w] |= uint64_t(1) << ((low * filterSalt[w]) >> 26);
+
+                size_t slot = hash & set->slotMask;
+                while (set->slots[slot] != 0)
+                    slot = (slot + 1) & set->slotMask;
+                set->slots[slot] = static_cast<uint32_t>(i + 1);
+            }
+            return set;
+        }
+
+    private:
+        uint64_t seed_;
+        std::unordered_map<std::string_view, int64_t> entries_;
+    };
+
+    RevocationList::RevocationList(RevocationListOptions options)
+        : options_(options)
+        , set_(std::make_unique<const Set>())
+    {
+        // "jti" values are chosen by token issuers, who need not be the
+        // only ones choosing them; a secret seed keeps lookups from being
+        // steered into the filter's false positives
+        std::random_device rd;
+        seed_ = uint64_t(rd()) << 32 | rd();
+    }
+
+    RevocationList::~RevocationList() = default;
+
+    bool RevocationList::revoked(std::string_view jti) const noexcept
+    {
+        EpochGuard guard;
+        const Set* set = set_.load(guard);
+        if (set->filter.empty())
+            return false;
+        uint64_t hash = hash64(jti, seed_);
+        return set->mayContain(hash) && set->find(jti, hash) != nullptr;
+    }
+
+    RevocationList::Update RevocationList::apply(std::string_view text)
+    {
+        Document document = parseDocument(text);
+
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        EpochGuard guard;
+        const Set* current = set_.load(guard);
+        if (document.serial <= current->serial)
+            return Update::current;
+        if (document.delta && document.base != current->serial)
+            return Update::gap;
+
+        Builder builder(document.delta ? current : nullptr, seed_);
+        for (const Change& change : document.changes)
+        {
+            if (change.revoke)
+                builder.revoke(change.jti, change.expires);
+            else
+                builder.withdraw(change.jti);
+        }
+        set_.publish(builder.build(document.serial, options_.filterBitsPerEntry));
+        return Update::applied;
+    }
+
+    void RevocationList::revoke(std::string_view jti, int64_t expires)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        EpochGuard guard;
+        const Set* current = set_.load(guard);
+
+        Builder builder(current, seed_);
+        builder.revoke(jti, expires);
+        set_.publish(builder.build(current->serial, options_.filterBitsPerEntry));
+    }
+
+    void RevocationList::prune(int64_t now)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        EpochGuard guard;
+        const Set* current = set_.load(guard);
+
+        Builder builder(current, seed_);
+        builder.prune(now);
+        set_.publish(builder.build(current->serial, options_.filterBitsPerEntry));
+    }
+
+    uint64_t RevocationList::serial() const noexcept
+    {
+        EpochGuard guard;
+        return set_.load(guard)->serial;
+    }
+
+    size_t RevocationList::size() const noexcept
+    {
+        EpochGuard guard;
+        return set_.load(guard)->entries.size();
+    }
+
+    RevocationFeed::RevocationFeed(RevocationList& list, std::string uri, std::shared_ptr<Fetcher> fetcher,
+            RevocationFeedOptions options)
+        : list_(list)
+        , uri_(std::move(uri))
+        , fetcher_(std::move(fetcher))
+        , options_(std::move(options))
+    {
+    }
+
+    RevocationFeed::~RevocationFeed()
+    {
+        if (poller_.joinable())
+        {
+            poller_.request_stop();
+            poller_.join();
+        }
+    }
+
+    void RevocationFeed::start()
+    {
+        bool ok;
+        Clock::time_point next = fetchAndApply(ok);
+        if (!ok)
+            throw JWTException("RevocationFeed: initial fetch of '" + uri_ + "' failed");
+
+        poller_ = std::jthread([this, next](std::stop_token stop) { run(stop, next); });
+    }
+
+    bool RevocationFeed::poll()
+    {
+        bool ok;
+        fetchAndApply(ok);
+        return ok;
+    }
+
+    bool RevocationFeed::fetchDocument(const std::string& uri, RevocationList::Update& update,
+        std::chrono::seconds& maxAge)
+    {
+        FetchResponse response;
+        try
+        {
+            response = fetcher_->get(uri);
+            if (response.status != 200)
+                return false;
+            update = list_.apply(response.body);
+        }
+        catch (...)
+        {
+            return false;
+        }
+        maxAge = parseCacheControlMaxAge(response.cacheControl).value_or(options_.defaultMaxAge);
+        return true;
+    }
+
+    RevocationFeed::Clock::time_point RevocationFeed::fetchAndApply(bool& ok)
+    {
+        std::lock_guard<std::mutex> lock(fetchMutex_);
+
+        Clock::time_point now = Clock::now();
+        RevocationList::Update update;
+        std::chrono::seconds maxAge;
+        ok = fetchDocument(uri_, update, maxAge);
+
+        // a delta that skips ahead means a poll was missed; the full list
+        // brings the serial up to date, after which deltas apply again
+        if (ok && update == RevocationList::Update::gap && !options_.fullURI.empty())
+            ok = fetchDocument(options_.fullURI, update, maxAge);
+        if (!ok)
+            return now + options_.retryInterval;
+
+        return now + std::clamp(maxAge, options_.minRefreshInterval, options_.maxRefreshInterval);
+    }
+
+    void RevocationFeed::run(std::stop_token stop, Clock::time_point next)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop.stop_requested())
+        {
+            if (wakeup_.wait_until(lock, stop, next, [] { return false; }) || Clock::now() < next)
+                continue;
+
+            lock.unlock();
+            bool ok;
+            next = fetchAndApply(ok);
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include <ncbi/signing-pool.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <sched.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace ncbi
+{
+    SigningPool::SigningPool(std::shared_ptr<const JWSSigner> signer, SigningPoolOptions options)
+        : signer_(std::move(signer))
+    {
+        if (signer_ == nullptr)
+            throw JWTException("SigningPool: no signer");
+
+        slotCount_ = options.slots != 0 ? options.slots : std::max(1u, std::thread::hardware_concurrency());
+        slots_ = std::make_unique<Slot[]>(slotCount_);
+        for (size_t i = 0; i < slotCount_; ++i)
+            slots_[i].context = signer_->newContext();
+    }
+
+    SigningPool::~SigningPool() = default;
+
+    size_t SigningPool::homeSlot() const noexcept
+    {
+        // sched_getcpu() reads the vDSO; a thread's CPU may change at any
+        // moment, which costs at most a probe
+        int cpu = ::sched_getcpu();
+        return cpu >= 0 ? static_cast<size_t>(cpu) % slotCount_ : 0;
+    }
+
+    bool SigningPool::sign(std::string_view signingInput, unsigned char* signature, size_t& size) noexcept
+    {
+        size_t home = homeSlot();
+        for (size_t i = 0; i < slotCount_; ++i)
+        {
+            Slot& slot = slots_[(home + i) % slotCount_];
+            std::unique_lock<std::mutex> lock(slot.mutex, std::try_to_lock);
+            if (lock.owns_lock())
+                return slot.context->sign(signingInput, signature, size);
+        }
+
+        // more signers than slots: queue on the home slot
+        Slot& slot = slots_[home];
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        return slot.context->sign(signingInput, signature, size);
+    }
+
+    size_t SigningPool::precompute() noexcept
+    {
+        size_t prepared = 0;
+        for (size_t i = 0; i < slotCount_; ++i)
+        {
+            Slot& slot = slots_[i];
+            std::unique_lock<std::mutex> lock(slot.mutex, std::try_to_lock);
+            if (lock.owns_lock())
+                prepared += slot.context->precompute();
+        }
+        return prepared;
+    }
+}
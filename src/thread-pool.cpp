@@ -0,0 +1,50 @@
+#include <ncbi/thread-pool.hpp>
+
+namespace ncbi
+{
+    ThreadPool::ThreadPool(unsigned threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        workers_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i)
+            workers_.emplace_back([this](std::stop_token stop) { run(stop); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        for (auto& worker : workers_)
+            worker.request_stop();
+        wakeup_.notify_all();
+        workers_.clear();
+    }
+
+    void ThreadPool::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(task));
+        }
+        wakeup_.notify_one();
+    }
+
+    void ThreadPool::run(std::stop_token stop)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            // the queue is drained before a stop is honored
+            wakeup_.wait(lock, stop, [this] { return !queue_.empty(); });
+            if (queue_.empty())
+                return;
+
+            std::function<void()> task = std::move(queue_.front());
+            queue_.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,567 @@
+#include <ncbi/token-endpoint.hpp>
+#include <ncbi/base64url.hpp>
+#include <ncbi/jwt-error.hpp>
+#include <ncbi/request-arena.hpp>
+
+#include "random-reserve.hpp"
+
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+
+#include <charconv>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+
+namespace ncbi
+{
+    namespace
+    {
+        using namespace std::string_view_literals;
+
+        // error responses (RFC 6749 section 5.2) are fixed texts, so that
+        // failing needs neither the arena nor the response buffer
+        constexpr std::string_view malformedBody =
+            R"({"error":"invalid_request","error_description":"malformed or repeated parameter"})";
+        constexpr std::string_view missingGrantType =
+            R"({"error":"invalid_request","error_description":"missing grant_type"})";
+        constexpr std::string_view missingCode =
+            R"({"error":"invalid_request","error_description":"missing code"})";
+        constexpr std::string_view missingRefreshToken =
+            R"({"error":"invalid_request","error_description":"missing refresh_token"})";
+        constexpr std::string_view twoAuthentications =
+            R"({"error":"invalid_request","error_description":"more than one client authentication method"})";
+        constexpr std::string_view invalidClient =
+            R"({"error":"invalid_client","error_description":"client authentication failed"})";
+        constexpr std::string_view unsupportedGrant =
+            R"({"error":"unsupported_grant_type"})";
+        constexpr std::string_view unauthorizedClient =
+            R"({"error":"unauthorized_client","error_description":"grant type not allowed for this client"})";
+        constexpr std::string_view invalidGrant =
+            R"({"error":"invalid_grant","error_description":"invalid, expired or revoked grant"})";
+        constexpr std::string_view redirectMismatch =
+            R"({"error":"invalid_grant","error_description":"redirect_uri does not match"})";
+        constexpr std::string_view pkceFailed =
+            R"({"error":"invalid_grant","error_description":"PKCE verification failed"})";
+        constexpr std::string_view invalidScope =
+            R"({"error":"invalid_scope"})";
+        constexpr std::string_view serverError =
+            R"({"error":"server_error"})";
+
+        constexpr std::string_view responsePrefix = R"({"access_token":")";
+        constexpr std::string_view tokenTypeMember = R"(","token_type":"Bearer","expires_in":)";
+
+        TokenResponse failure(int status, std::string_view body, bool challenge = false) noexcept
+        {
+            TokenResponse response;
+            response.status = status;
+            response.body = body;
+            response.challenge = challenge;
+            return response;
+        }
+
+        template<class String>
+        void appendJSONString(String& out, std::string_view text)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+            out += '"';
+            for (char ch : text)
+            {
+                unsigned char c = static_cast<unsigned char>(ch);
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                    out += ch;
+                }
+                else if (c < 0x20)
+                {
+                    out += "\\u00"sv;
+                    out += hex[c >> 4];
+                    out += hex[c & 15];
+                }
+                else
+                    out += ch;
+            }
+            out += '"';
+        }
+
+        template<class String>
+        void appendNumber(String& out, int64_t value)
+        {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof digits, value);
+            out.append(digits, static_cast<size_t>(result.ptr - digits));
+        }
+
+        int hexValue(char ch) noexcept
+        {
+            if (ch >= '0' && ch <= '9')
+                return ch - '0';
+            if (ch >= 'a' && ch <= 'f')
+                return ch - 'a' + 10;
+            if (ch >= 'A' && ch <= 'F')
+                return ch - 'A' + 10;
+            return -1;
+        }
+
+        // application/x-www-form-urlencoded value; decoded text is placed
+        // in the arena, undecorated text is returned as it stands
+        bool formDecode(std::string_view raw, std::pmr::memory_resource& arena, std::string_view& value)
+        {
+            if (raw.find_first_of("%+"sv) == std::string_view::npos)
+            {
+                value = raw;
+                return true;
+            }
+
+            char* out = static_cast<char*>(arena.allocate(raw.size(), 1));
+            size_t n = 0;
+            for (size_t i = 0; i < raw.size(); ++i)
+            {
+                char ch = raw[i];
+                if (ch == '+')
+                    ch = ' ';
+                else if (ch == '%')
+                {
+                    int hi = i + 2 < raw.size() ? hexValue(raw[i + 1]) : -1;
+                    int lo = hi >= 0 ? hexValue(raw[i + 2]) : -1;
+                    if (lo < 0)
+                        return false;
+                    ch = static_cast<char>(hi << 4 | lo);
+                    i += 2;
+                }
+                out[n++] = ch;
+            }
+            value = std::string_view(out, n);
+            return true;
+        }
+
+        // the parameters of a token request (RFC 6749 sections 4.1.3,
+        // 4.4.2 and 6, RFC 7636 section 4.5); empty means absent
+        struct TokenParams
+        {
+            std::string_view grantType;
+            std::string_view scope;
+            std::string_view code;
+            std::string_view redirectURI;
+            std::string_view codeVerifier;
+            std::string_view refreshToken;
+            std::string_view clientId;
+            std::string_view clientSecret;
+        };
+
+        std::string_view TokenParams::* paramMember(std::string_view name) noexcept
+        {
+            if (name == "grant_type"sv)     return &TokenParams::grantType;
+            if (name == "scope"sv)          return &TokenParams::scope;
+            if (name == "code"sv)           return &TokenParams::code;
+            if (name == "redirect_uri"sv)   return &TokenParams::redirectURI;
+            if (name == "code_verifier"sv)  return &TokenParams::codeVerifier;
+            if (name == "refresh_token"sv)  return &TokenParams::refreshToken;
+            if (name == "client_id"sv)      return &TokenParams::clientId;
+            if (name == "client_secret"sv)  return &TokenParams::clientSecret;
+            return nullptr;
+        }
+
+        // RFC 6749 section 3.2: unknown parameters are ignored, empty ones
+        // count as omitted, and none may be sent twice
+        bool parseForm(std::string_view body, std::pmr::memory_resource& arena, TokenParams& params)
+        {
+            while (!body.empty())
+            {
+                size_t end = body.find('&');
+                std::string_view pair = body.substr(0, end);
+                body = end == std::string_view::npos ? std::string_view() : body.substr(end + 1);
+
+                size_t eq = pair.find('=');
+                std::string_view name = pair.substr(0, eq);
+                std::string_view raw = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+
+                auto member = paramMember(name);
+                if (member == nullptr || raw.empty())
+                    continue;
+                if (!(params.*member).empty())
+                    return false;
+                if (!formDecode(raw, arena, params.*member) || (params.*member).empty())
+                    return false;
+            }
+            return true;
+        }
+
+        // RFC 6749 section 2.3.1: Basic credentials whose halves are
+        // themselves form-encoded
+        bool parseBasic(std::string_view authorization, std::pmr::memory_resource& arena,
+            std::string_view& clientId, std::string_view& secret)
+        {
+            if (authorization.size() < 6 || (authorization.substr(0, 6) != "Basic "sv &&
+                    authorization.substr(0, 6) != "basic "sv))
+            {
+                return false;
+            }
+            std::string_view encoded = authorization.substr(6);
+            while (!encoded.empty() && encoded.front() == ' ')
+                encoded.remove_prefix(1);
+
+            // standard base64 through the base64url decoder
+            char* alphabet = static_cast<char*>(arena.allocate(encoded.size() + 1, 1));
+            for (size_t i = 0; i < encoded.size(); ++i)
+            {
+                char ch = encoded[i];
+                alphabet[i] = ch == '+' ? '-' : ch == '/' ? '_' : ch == '-' || ch == '_' ? '!' : ch;
+            }
+            char* decoded = static_cast<char*>(arena.allocate(base64urlDecodedSize(encoded.size()) + 1, 1));
+            size_t size;
+            if (!base64urlDecode(std::string_view(alphabet, encoded.size()), decoded, size, Base64URLMode::lenient))
+                return false;
+
+            std::string_view credentials(decoded, size);
+            size_t colon = credentials.find(':');
+            return colon != std::string_view::npos &&
+                formDecode(credentials.substr(0, colon), arena, clientId) &&
+                formDecode(credentials.substr(colon + 1), arena, secret) &&
+                !clientId.empty();
+        }
+
+        // RFC 6749 section 3.3: scope-tokens of %x21 / %x23-5B / %x5D-7E
+        // separated by single spaces
+        template<class Allowed>
+        bool scopeAllowed(std::string_view scope, Allowed allowed)
+        {
+            while (true)
+            {
+                size_t end = scope.find(' ');
+                std::string_view token = scope.substr(0, end);
+                if (token.empty())
+                    return false;
+                for (char ch : token)
+                {
+                    unsigned char c = static_cast<unsigned char>(ch);
+                    if (c < 0x21 || c > 0x7E || c == '"' || c == '\\')
+                        return false;
+                }
+                if (!allowed(token))
+                    return false;
+                if (end == std::string_view::npos)
+                    return true;
+                scope.remove_prefix(end + 1);
+            }
+        }
+
+        // RFC 7636 section 4.6 with the S256 method:
+        // BASE64URL(SHA256(code_verifier)) == code_challenge
+        bool verifyPKCE(std::string_view verifier, std::string_view challenge) noexcept
+        {
+            // section 4.1: 43 to 128 unreserved characters
+            if (verifier.size() < 43 || verifier.size() > 128)
+                return false;
+            for (char ch : verifier)
+            {
+                bool unreserved = (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
+                    (ch >= '0' && ch <= '9') || ch == '-' || ch == '.' || ch == '_' || ch == '~';
+                if (!unreserved)
+                    return false;
+            }
+
+            unsigned char digest[SHA256_DIGEST_LENGTH];
+            SHA256(reinterpret_cast<const unsigned char*>(verifier.data()), verifier.size(), digest);
+
+            char expected[base64urlEncodedSize(SHA256_DIGEST_LENGTH)];
+            base64urlEncode(digest, sizeof digest, expected);
+            return challenge.size() == sizeof expected &&
+                CRYPTO_memcmp(expected, challenge.data(), sizeof expected) == 0;
+        }
+
+        constexpr size_t jtiBytes = 16;
+    }
+
+    TokenEndpoint::TokenEndpoint(std::shared_ptr<const JWSSigner> signer,
+            std::shared_ptr<const ClientRegistry> clients,
+            std::shared_ptr<AuthorizationCodeStore> codes,
+            std::shared_ptr<RefreshTokenStore> refreshTokens,
+            TokenEndpointOptions options)
+        : signer_(std::move(signer))
+        , clients_(std::move(clients))
+        , codes_(std::move(codes))
+        , refreshTokens_(std::move(refreshTokens))
+        , options_(std::move(options))
+        // RFC 9068 section 2.1: access tokens are typed "at+jwt"
+        , writer_(signer_, "at+jwt")
+    {
+        if (signer_ == nullptr || clients_ == nullptr || codes_ == nullptr || refreshTokens_ == nullptr)
+            throw JWTException("TokenEndpoint: signer, clients and stores are required");
+        if (options_.issuer.empty())
+            throw JWTException("TokenEndpoint: an issuer is required");
+
+    }
+
+    TokenEndpoint::~TokenEndpoint() = default;
+
+    struct TokenEndpoint::Worker::State
+    {
+        const TokenEndpoint& endpoint;
+        std::unique_ptr<SigningContext> signing;
+        RequestArena requestArena;
+        std::string response;
+
+        explicit State(const TokenEndpoint& e)
+            : endpoint(e)
+            , signing(e.signer_->newContext())
+            , requestArena(e.options_.arenaSize)
+        {
+            response.reserve(2048);
+        }
+
+        TokenResponse handle(const TokenRequest& request, int64_t now);
+
+        TokenResponse clientCredentials(const OAuthClient& client, const TokenParams& params,
+            std::pmr::memory_resource& arena, int64_t now);
+        TokenResponse authorizationCode(const OAuthClient& client, const TokenParams& params, int64_t now);
+        TokenResponse refreshToken(const OAuthClient& client, const TokenParams& params, int64_t now);
+
+        TokenResponse issue(std::string_view subject, std::string_view clientId, std::string_view scope,
+            std::string_view refreshToken, int64_t now);
+    };
+
+    TokenResponse TokenEndpoint::Worker::State::handle(const TokenRequest& request, int64_t now)
+    {
+        // the previous request's allocations go all at once
+        requestArena.release();
+        std::pmr::memory_resource& arena = *requestArena.resource();
+
+        TokenParams params;
+        if (!parseForm(request.body, arena, params))
+            return failure(400, malformedBody);
+        if (params.grantType.empty())
+            return failure(400, missingGrantType);
+
+        GrantType grant;
+        if (params.grantType == "client_credentials"sv)
+            grant = GrantType::clientCredentials;
+        else if (params.grantType == "authorization_code"sv)
+            grant = GrantType::authorizationCode;
+        else if (params.grantType == "refresh_token"sv)
+            grant = GrantType::refreshToken;
+        else
+            return failure(400, unsupportedGrant);
+
+        // client authentication: Basic, or client_id (and client_secret)
+        // in the body, never both (RFC 6749 section 2.3)
+        std::string_view clientId = params.clientId;
+        std::string_view secret = params.clientSecret;
+        bool basic = !request.authorization.empty();
+        if (basic)
+        {
+            std::string_view basicId;
+            std::string_view basicSecret;
+            if (!params.clientSecret.empty())
+                return failure(400, twoAuthentications);
+            if (!parseBasic(request.authorization, arena, basicId, basicSecret))
+                return failure(401, invalidClient, true);
+            if (!params.clientId.empty() && params.clientId != basicId)
+                return failure(400, twoAuthentications);
+            clientId = basicId;
+            secret = basicSecret;
+        }
+
+        const OAuthClient* client = clientId.empty() ? nullptr : endpoint.clients_->find(clientId);
+        if (client == nullptr)
+            return failure(401, invalidClient, basic);
+        if (client->confidential() ? !endpoint.clients_->authenticate(*client, secret) : !secret.empty())
+            return failure(401, invalidClient, basic);
+        if (!client->allows(grant))
+            return failure(400, unauthorizedClient);
+
+        switch (grant)
+        {
+        case GrantType::clientCredentials:
+            return clientCredentials(*client, params, arena, now);
+        case GrantType::authorizationCode:
+            return authorizationCode(*client, params, now);
+        case GrantType::refreshToken:
+            return refreshToken(*client, params, now);
+        }
+        return failure(500, serverError);
+    }
+
+    TokenResponse TokenEndpoint::Worker::State::clientCredentials(const OAuthClient& client,
+        const TokenParams& params, std::pmr::memory_resource& arena, int64_t now)
+    {
+        // RFC 6749 section 4.4: confidential clients only
+        if (!client.confidential())
+            return failure(400, unauthorizedClient);
+
+        std::string_view scope = params.scope;
+        if (!scope.empty())
+        {
+            if (!scopeAllowed(scope, [&](std::string_view s) { return client.allowsScope(s); }))
+                return failure(400, invalidScope);
+        }
+        else
+        {
+            // section 3.3: without a request, the client's registered scopes
+            size_t size = 0;
+            for (const std::string& s : client.scopes)
+                size += s.size() + 1;
+
+            char* all = static_cast<char*>(arena.allocate(size + 1, 1));
+            size_t n = 0;
+            for (const std::string& s : client.scopes)
+            {
+                if (n != 0)
+                    all[n++] = ' ';
+                std::memcpy(all + n, s.data(), s.size());
+                n += s.size();
+            }
+            scope = std::string_view(all, n);
+        }
+
+        return issue(client.id, client.id, scope, {}, now);
+    }
+
+    TokenResponse TokenEndpoint::Worker::State::authorizationCode(const OAuthClient& client,
+        const TokenParams& params, int64_t now)
+    {
+        if (params.code.empty())
+            return failure(400, missingCode);
+
+        // the code is spent by any attempt, successful or not
+        AuthorizationGrant grant;
+        if (!endpoint.codes_->consume(params.code, now, grant) || grant.clientId != client.id)
+            return failure(400, invalidGrant);
+        if (!grant.redirectURI.empty() && params.redirectURI != grant.redirectURI)
+            return failure(400, redirectMismatch);
+
+        // public clients must use PKCE; a verifier for a code issued
+        // without a challenge is refused, so PKCE cannot be stripped off
+        // the authorization request (OAuth 2.0 Security BCP, section 2.1.1)
+        if (grant.codeChallenge.empty()
+                ? !client.confidential() || !params.codeVerifier.empty()
+                : !verifyPKCE(params.codeVerifier, grant.codeChallenge))
+        {
+            return failure(400, pkceFailed);
+        }
+
+        std::string refresh;
+        if (endpoint.options_.issueRefreshTokens && client.allows(GrantType::refreshToken))
+        {
+            AuthorizationGrant refreshGrant;
+            refreshGrant.clientId = grant.clientId;
+            refreshGrant.subject = grant.subject;
+            refreshGrant.scope = grant.scope;
+            refreshGrant.expires = now + endpoint.options_.refreshTokenTTL.count();
+            refresh = endpoint.refreshTokens_->issue(std::move(refreshGrant));
+        }
+
+        return issue(grant.subject, client.id, grant.scope, refresh, now);
+    }
+
+    TokenResponse TokenEndpoint::Worker::State::refreshToken(const OAuthClient& client,
+        const TokenParams& params, int64_t now)
+    {
+        if (params.refreshToken.empty())
+            return failure(400, missingRefreshToken);
+
+        // RFC 6749 section 6: the scope may narrow, never widen; the
+        // store checks it before retiring the token, so a refused request
+        // leaves the token usable
+        AuthorizationGrant grant;
+        std::string successor;
+        switch (endpoint.refreshTokens_->rotate(params.refreshToken, client.id, params.scope, now, grant, successor))
+        {
+        case RotateResult::rotated:
+            break;
+        case RotateResult::invalidScope:
+            return failure(400, invalidScope);
+        default:
+            return failure(400, invalidGrant);
+        }
+
+        std::string_view scope = params.scope.empty() ? std::string_view(grant.scope) : params.scope;
+        return issue(grant.subject, client.id, scope, successor, now);
+    }
+
+    TokenResponse TokenEndpoint::Worker::State::issue(std::string_view subject, std::string_view clientId,
+        std::string_view scope, std::string_view refreshToken, int64_t now)
+    {
+        const TokenEndpointOptions& options = endpoint.options_;
+        int64_t ttl = options.accessTokenTTL.count();
+
+        unsigned char jti[jtiBytes];
+        if (!detail::takeRandom(jti, sizeof jti))
+            return failure(500, serverError);
+        char jtiText[base64urlEncodedSize(jtiBytes)];
+        base64urlEncode(jti, sizeof jti, jtiText);
+
+        // the claims set (RFC 9068 section 2.2)
+        JWTClaimValue claims[8];
+        size_t count = 0;
+        claims[count++] = JWTClaimValue("iss", options.issuer);
+        if (!options.audience.empty())
+            claims[count++] = JWTClaimValue("aud", options.audience);
+        claims[count++] = JWTClaimValue("sub", subject);
+        claims[count++] = JWTClaimValue("client_id", clientId);
+        claims[count++] = JWTClaimValue("iat", now);
+        claims[count++] = JWTClaimValue("exp", now + ttl);
+        claims[count++] = JWTClaimValue("jti", std::string_view(jtiText, sizeof jtiText));
+        if (!scope.empty())
+            claims[count++] = JWTClaimValue("scope", scope);
+        std::span<const JWTClaimValue> set(claims, count);
+
+        // the token is written where it will be sent, at its exact length
+        const JWTWriter& writer = endpoint.writer_;
+        size_t tokenSize = writer.size(set);
+        response.clear();
+        response.reserve(responsePrefix.size() + tokenSize + 2 * (scope.size() + refreshToken.size()) + 128);
+
+        response += responsePrefix;
+        size_t at = response.size();
+        response.resize(at + tokenSize);
+        if (writer.write(set, *signing, response.data() + at, tokenSize) != tokenSize)
+            return failure(500, serverError);
+
+        response += tokenTypeMember;
+        appendNumber(response, ttl);
+        if (!refreshToken.empty())
+        {
+            response += R"(,"refresh_token":)";
+            appendJSONString(response, refreshToken);
+        }
+        if (!scope.empty())
+        {
+            response += R"(,"scope":)";
+            appendJSONString(response, scope);
+        }
+        response += '}';
+
+        TokenResponse result;
+        result.status = 200;
+        result.body = response;
+        return result;
+    }
+
+    TokenEndpoint::Worker::Worker(const TokenEndpoint& endpoint)
+        : state_(std::make_unique<State>(endpoint))
+    {
+    }
+
+    TokenEndpoint::Worker::~Worker() = default;
+
+    TokenResponse TokenEndpoint::Worker::handle(const TokenRequest& request, int64_t now) noexcept
+    {
+        try
+        {
+            return state_->handle(request, now);
+        }
+        catch (...)
+        {
+            // allocation failure, or a store that could not be reached
+            return failure(500, serverError);
+        }
+    }
+
+    TokenResponse TokenEndpoint::Worker::handle(const TokenRequest& request) noexcept
+    {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return handle(request, std::chrono::duration_cast<std::chrono::seconds>(now).count());
+    }
+}
@@ -0,0 +1,215 @@
+#include <ncbi/verified-cache.hpp>
+#include <ncbi/hash.hpp>
+#include <ncbi/jwk.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <random>
+
+namespace ncbi
+{
+    uint64_t jwkFingerprint(const JWK& key) noexcept
+    {
+        uint64_t h = hash64(key.kty);
+        for (const std::string* member : { &key.crv, &key.n, &key.e, &key.x, &key.y, &key.k })
+            h = hash64(*member, h);
+        return h;
+    }
+
+    VerifiedTokenCache::VerifiedTokenCache(VerifiedTokenCacheOptions options)
+    {
+        size_t shards = std::bit_ceil(std::max<size_t>(options.shards, 1));
+        shards_ = std::make_unique<Shard[]>(shards);
+        shardMask_ = shards - 1;
+        slotsPerShard_ = std::max<size_t>(1, (options.capacity + shards - 1) / shards);
+
+        for (size_t i = 0; i < shards; ++i)
+        {
+            shards_[i].slots = std::make_unique<Slot[]>(slotsPerShard_);
+            shards_[i].index.reserve(slotsPerShard_);
+        }
+
+        // tokens are chosen by clients; a secret seed keeps them from
+        // steering entries into one shard or bucket
+        std::random_device rd;
+        seed_ = uint64_t(rd()) << 32 | rd();
+    }
+
+    VerifiedTokenCache::~VerifiedTokenCache() = default;
+
+    std::shared_ptr<const VerifiedToken> VerifiedTokenCache::find(std::string_view token, int64_t now) const noexcept
+    {
+        uint64_t hash = hash64(token, seed_);
+        Shard& shard = shardFor(hash);
+
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(hash);
+        if (it != shard.index.end())
+        {
+            Slot& slot = shard.slots[it->second];
+            const VerifiedToken& entry = *slot.entry;
+            if (entry.exp > now && entry.token == token)
+            {
+                if (!slot.referenced.load(std::memory_order_relaxed))
+                    slot.referenced.store(true, std::memory_order_relaxed);
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                return slot.entry;
+            }
+        }
+
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void VerifiedTokenCache::evict(Shard& shard, Slot& slot)
+    {
+        shard.index.erase(slot.hash);
+        slot.entry.reset();
+        slot.referenced.store(false, std::memory_order_relaxed);
+        ++shard.evictions;
+    }
+
+    size_t VerifiedTokenCache::claimSlot(Shard& shard, int64_t now)
+    {
+        if (shard.used < slotsPerShard_)
+            return shard.used++;
+
+        // two sweeps suffice: the first clears every reference bit
+        for (size_t step = 0; step < 2 * slotsPerShard_; ++step)
+        {
+            size_t i = shard.hand;
+            shard.hand = (shard.hand + 1) % slotsPerShard_;
+
+            Slot& slot = shard.slots[i];
+            if (slot.entry == nullptr)
+                return i;
+            if (slot.entry->exp <= now)
+            {
+                evict(shard, slot);
+                return i;
+            }
+            if (slot.referenced.exchange(false, std::memory_order_relaxed))
+                continue;
+
+            evict(shard, slot);
+            return i;
+        }
+
+        // unreachable, but keep the bound honest
+        Slot& slot = shard.slots[shard.hand];
+        evict(shard, slot);
+        return shard.hand;
+    }
+
+    bool VerifiedTokenCache::trusted(uint64_t fingerprint) const
+    {
+        std::lock_guard<std::mutex> lock(trustedMutex_);
+        return trusted_ == nullptr || std::binary_search(trusted_->begin(), trusted_->end(), fingerprint);
+    }
+
+    void VerifiedTokenCache::insert(std::shared_ptr<const VerifiedToken> entry, int64_t now)
+    {
+        if (entry == nullptr || entry->exp <= now)
+            return;
+
+        uint64_t hash = hash64(entry->token, seed_);
+        Shard& shard = shardFor(hash);
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        // checked under the shard lock: retainKeys() publishes the new key
+        // list before it sweeps the shards, so an entry either sees the
+        // new list here or is swept afterwards
+        if (!trusted(entry->keyFingerprint))
+            return;
+
+        auto it = shard.index.find(hash);
+        if (it != shard.index.end())
+        {
+            shard.slots[it->second].entry = std::move(entry);
+            return;
+        }
+
+        size_t i = claimSlot(shard, now);
+        Slot& slot = shard.slots[i];
+        slot.hash = hash;
+        slot.entry = std::move(entry);
+        slot.referenced.store(false, std::memory_order_relaxed);
+        shard.index.emplace(hash, static_cast<uint32_t>(i));
+        ++shard.insertions;
+    }
+
+    void VerifiedTokenCache::retainKeys(const JWKSet& keys)
+    {
+        auto fingerprints = std::make_shared<std::vector<uint64_t>>();
+        fingerprints->reserve(keys.size());
+        for (const JWK& key : keys)
+            fingerprints->push_back(jwkFingerprint(key));
+        std::sort(fingerprints->begin(), fingerprints->end());
+
+        {
+            std::lock_guard<std::mutex> lock(trustedMutex_);
+            trusted_ = fingerprints;
+        }
+
+        for (size_t s = 0; s <= shardMask_; ++s)
+        {
+            Shard& shard = shards_[s];
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            for (size_t i = 0; i < shard.used; ++i)
+            {
+                Slot& slot = shard.slots[i];
+                if (slot.entry != nullptr &&
+                    !std::binary_search(fingerprints->begin(), fingerprints->end(), slot.entry->keyFingerprint))
+                {
+                    evict(shard, slot);
+                }
+            }
+        }
+    }
+
+    void VerifiedTokenCache::clear()
+    {
+        for (size_t s = 0; s <= shardMask_; ++s)
+        {
+            Shard& shard = shards_[s];
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            for (size_t i = 0; i < shard.used; ++i)
+            {
+                shard.slots[i].entry.reset();
+                shard.slots[i].referenced.store(false, std::memory_order_relaxed);
+            }
+            shard.index.clear();
+            shard.used = 0;
+            shard.hand = 0;
+        }
+    }
+
+    size_t VerifiedTokenCache::size() const
+    {
+        size_t total = 0;
+        for (size_t s = 0; s <= shardMask_; ++s)
+        {
+            std::shared_lock<std::shared_mutex> lock(shards_[s].mutex);
+            total += shards_[s].index.size();
+        }
+        return total;
+    }
+
+    VerifiedTokenCache::Stats VerifiedTokenCache::stats() const noexcept
+    {
+        Stats stats;
+        for (size_t s = 0; s <= shardMask_; ++s)
+        {
+            const Shard& shard = shards_[s];
+            stats.hits += shard.hits.load(std::memory_order_relaxed);
+            stats.misses += shard.misses.load(std::memory_order_relaxed);
+
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            stats.insertions += shard.insertions;
+            stats.evictions += shard.evictions;
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,245 @@
+#include <ncbi/verifier-config.hpp>
+#include <ncbi/json-reader.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace ncbi
+{
+    namespace
+    {
+        // calls "each" with every element of the array "value"
+        template<class Each>
+        void forEachElement(const JSONValueView& value, std::string_view member, Each each)
+        {
+            if (value.type() != JSONType::array)
+                throw JWTException("VerifierConfig: member '" + std::string(member) + "' is not an array");
+
+            JSONReader reader(value.raw());
+            if (reader.enterArray())
+            {
+                while (reader.nextElement())
+                {
+                    JSONValueView element;
+                    if (!reader.readValue(element))
+                        break;
+                    each(element);
+                }
+            }
+            if (reader.failed())
+                throw JWTException("VerifierConfig: member '" + std::string(member) + "' is malformed");
+        }
+
+        IssuerConfig parseIssuer(const JSONValueView& value)
+        {
+            JSONReader reader(value.raw());
+            if (value.type() != JSONType::object || !reader.enterObject())
+                throw JWTException("VerifierConfig: an issuer is not a JSON object");
+
+            IssuerConfig issuer;
+
+            std::string_view name;
+            while (reader.nextMember(name))
+            {
+                JSONValueView member;
+                if (!reader.readValue(member))
+                    break;
+
+                if (rawJSONStringEquals(name, "issuer"))
+                    issuer.issuer = jsonString(member, "VerifierConfig", "issuer");
+                else if (rawJSONStringEquals(name, "jwks_uri"))
+                    issuer.jwksURI = jsonString(member, "VerifierConfig", "jwks_uri");
+                else if (rawJSONStringEquals(name, "audiences"))
+                {
+                    forEachElement(member, "audiences", [&](const JSONValueView& element)
+                    {
+                        issuer.audiences.push_back(jsonString(element, "VerifierConfig", "audiences"));
+                    });
+                }
+                else if (rawJSONStringEquals(name, "algorithms"))
+                {
+                    forEachElement(member, "algorithms", [&](const JSONValueView& element)
+                    {
+                        std::string alg = jsonString(element, "VerifierConfig", "algorithms");
+                        JWTAlg a = parseAlg(alg);
+                        if (a == JWTAlg::unknown || a == JWTAlg::none)
+                            throw JWTException("VerifierConfig: unsupported algorithm '" + alg + "'");
+                        issuer.algorithms.push_back(a);
+                    });
+                }
+                else if (rawJSONStringEquals(name, "clock_skew"))
+                {
+                    int64_t seconds;
+                    if (member.type() != JSONType::number || !member.getInt64(seconds) || seconds < 0)
+                        throw JWTException("VerifierConfig: member 'clock_skew' is not a count of seconds");
+                    issuer.clockSkew = std::chrono::seconds(seconds);
+                }
+            }
+
+            if (reader.failed())
+                throw JWTException("VerifierConfig: malformed JSON");
+            if (issuer.issuer.empty())
+                throw JWTException("VerifierConfig: missing 'issuer'");
+            if (issuer.jwksURI.empty())
+                throw JWTException("VerifierConfig: missing 'jwks_uri' for issuer " + issuer.issuer);
+            return issuer;
+        }
+    }
+
+    VerifierConfig VerifierConfig::parse(std::string_view json)
+    {
+        JSONReader reader(json);
+        if (!reader.enterObject())
+            throw JWTException("VerifierConfig: not a JSON object");
+
+        VerifierConfig config;
+
+        std::string_view name;
+        while (reader.nextMember(name))
+        {
+            JSONValueView value;
+            if (!reader.readValue(value))
+                break;
+
+            if (rawJSONStringEquals(name, "issuers"))
+            {
+                forEachElement(value, "issuers",
+                    [&](const JSONValueView& element) { config.issuers.push_back(parseIssuer(element)); });
+            }
+        }
+
+        if (reader.failed() || !reader.atEnd())
+            throw JWTException("VerifierConfig: malformed JSON");
+        return config;
+    }
+
+    VerifierConfigFeed::VerifierConfigFeed(IssuerRegistry& registry, std::string uri,
+            std::shared_ptr<Fetcher> fetcher, VerifierConfigFeedOptions options)
+        : registry_(registry)
+        , uri_(std::move(uri))
+        , fetcher_(std::move(fetcher))
+        , options_(options)
+    {
+    }
+
+    VerifierConfigFeed::~VerifierConfigFeed()
+    {
+        if (poller_.joinable())
+        {
+            poller_.request_stop();
+            poller_.join();
+        }
+    }
+
+    void VerifierConfigFeed::start()
+    {
+        bool ok;
+        Clock::time_point next = fetchAndApply(ok);
+        if (!ok)
+            throw JWTException("VerifierConfigFeed: initial load of '" + uri_ + "' failed");
+
+        poller_ = std::jthread([this, next](std::stop_token stop) { run(stop, next); });
+    }
+
+    bool VerifierConfigFeed::poll()
+    {
+        bool ok;
+        fetchAndApply(ok);
+        return ok;
+    }
+
+    void VerifierConfigFeed::apply(const VerifierConfig& config)
+    {
+        std::lock_guard<std::mutex> lock(applyMutex_);
+        install(config);
+
+        // the document no longer describes what is in force, so the next
+        // poll applies it even if it is unchanged
+        applied_.clear();
+    }
+
+    void VerifierConfigFeed::install(const VerifierConfig& config)
+    {
+        // the key set caches in service, by URI; the copies keep them alive
+        // should a concurrent reload drop them
+        std::unordered_map<std::string, std::shared_ptr<JWKSCache>> caches;
+        {
+            IssuerRegistry::Snapshot current = registry_.snapshot();
+            for (const IssuerPolicy& policy : current.policies())
+                caches.emplace(policy.keys->uri(), policy.keys);
+        }
+
+        std::vector<IssuerPolicy> policies;
+        policies.reserve(config.issuers.size());
+        for (const IssuerConfig& issuer : config.issuers)
+        {
+            // issuers sharing a key set share its cache, new or carried over
+            std::shared_ptr<JWKSCache>& keys = caches[issuer.jwksURI];
+            if (keys == nullptr)
+            {
+                auto started = std::make_shared<JWKSCache>(issuer.jwksURI, fetcher_, options_.jwks);
+                started->start();
+                keys = std::move(started);
+            }
+
+            IssuerPolicy& policy = policies.emplace_back();
+            policy.issuer = issuer.issuer;
+            policy.keys = keys;
+            policy.audiences = issuer.audiences;
+            policy.algorithms = issuer.algorithms;
+            policy.clockSkew = issuer.clockSkew;
+        }
+
+        // the caches only the old configuration used are stopped here,
+        // while this thread still holds them: the retired table may hand
+        // out the last reference on any thread that publishes, their own
+        // refreshers included, which cannot join themselves
+        for (const std::shared_ptr<JWKSCache>& dropped : registry_.reload(std::move(policies)))
+            dropped->stop();
+    }
+
+    VerifierConfigFeed::Clock::time_point VerifierConfigFeed::fetchAndApply(bool& ok)
+    {
+        std::lock_guard<std::mutex> lock(applyMutex_);
+
+        Clock::time_point now = Clock::now();
+        ok = false;
+
+        FetchResponse response;
+        try
+        {
+            response = fetcher_->get(uri_);
+            if (response.status != 200)
+                return now + options_.retryInterval;
+            if (response.body != applied_)
+            {
+                install(VerifierConfig::parse(response.body));
+                applied_ = response.body;
+            }
+        }
+        catch (...)
+        {
+            return now + options_.retryInterval;
+        }
+
+        ok = true;
+        std::chrono::seconds maxAge = parseCacheControlMaxAge(response.cacheControl).value_or(options_.defaultMaxAge);
+        return now + std::clamp(maxAge, options_.minRefreshInterval, options_.maxRefreshInterval);
+    }
+
+    void VerifierConfigFeed::run(std::stop_token stop, Clock::time_point next)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop.stop_requested())
+        {
+            if (wakeup_.wait_until(lock, stop, next, [] { return false; }) || Clock::now() < next)
+                continue;
+
+            lock.unlock();
+            bool ok;
+            next = fetchAndApply(ok);
+            lock.lock();
+        }
+    }
+}
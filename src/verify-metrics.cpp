@@ -0,0 +1,362 @@
+#include <ncbi/verify-metrics.hpp>
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ncbi
+{
+    namespace
+    {
+        constexpr uint64_t subBuckets = uint64_t(1) << LatencyHistogram::subBucketBits;
+
+        uint64_t bucketMidpoint(size_t bucket) noexcept
+        {
+            return (LatencyHistogram::bucketLow(bucket) + LatencyHistogram::bucketHigh(bucket) - 1) / 2;
+        }
+
+        // label values for each JWTStatus, in order
+        constexpr const char* statusNames[] =
+        {
+            "ok", "malformed", "bad_encoding", "bad_json", "buffer_too_small", "unsupported_alg",
+            "unsupported_crit", "alg_mismatch", "unknown_key", "unknown_issuer", "bad_signature",
+            "decryption_failed", "bad_claim", "missing_claim", "rejected_claim", "expired",
+            "not_yet_valid", "inactive", "revoked", "replayed", "server_error"
+        };
+        static_assert(std::size(statusNames) == jwtStatusCount);
+
+        // Prometheus bucket bounds, in nanoseconds
+        constexpr uint64_t exportBounds[] =
+        {
+            100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+            1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000
+        };
+
+#if NCBI_OAUTH_METRICS
+        // one writer, the owning thread, which adds with plain loads and
+        // stores; readers may see a count without its bucket, never a torn
+        // value
+        void bump(std::atomic<uint64_t>& cell, uint64_t n) noexcept
+        {
+            cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        // a thread's record, in clock ticks
+        struct ThreadRecord
+        {
+            struct Stage
+            {
+                std::atomic<uint64_t> count { 0 };
+                std::atomic<uint64_t> failures { 0 };
+                std::atomic<uint64_t> ticks { 0 };
+                std::array<std::atomic<uint64_t>, LatencyHistogram::bucketCount> buckets {};
+            };
+
+            std::array<Stage, verifyStageCount> stages;
+            std::array<std::atomic<uint64_t>, jwtStatusCount> outcomes {};
+
+            void addTo(ThreadRecord& total) const noexcept
+            {
+                for (size_t s = 0; s < verifyStageCount; ++s)
+                {
+                    const Stage& from = stages[s];
+                    Stage& to = total.stages[s];
+                    bump(to.count, from.count.load(std::memory_order_relaxed));
+                    bump(to.failures, from.failures.load(std::memory_order_relaxed));
+                    bump(to.ticks, from.ticks.load(std::memory_order_relaxed));
+                    for (size_t b = 0; b < LatencyHistogram::bucketCount; ++b)
+                        bump(to.buckets[b], from.buckets[b].load(std::memory_order_relaxed));
+                }
+                for (size_t i = 0; i < jwtStatusCount; ++i)
+                    bump(total.outcomes[i], outcomes[i].load(std::memory_order_relaxed));
+            }
+        };
+
+        // the records of live threads, and the sum of those that exited;
+        // the lock is taken when a thread first records, when it exits and
+        // for snapshots, never while recording
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<ThreadRecord*> live;
+            ThreadRecord retired;
+
+            // the clock's origin, for converting ticks to nanoseconds
+            const uint64_t startTicks = detail::metricTicks();
+            const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        };
+
+        // never destroyed, as threads may exit after static destructors ran
+        Registry& registry()
+        {
+            static Registry* registry = new Registry;
+            return *registry;
+        }
+
+        struct ThreadSlot
+        {
+            std::unique_ptr<ThreadRecord> record;
+
+            ~ThreadSlot()
+            {
+                if (record == nullptr)
+                    return;
+                Registry& r = registry();
+                std::lock_guard lock(r.mutex);
+                record->addTo(r.retired);
+                std::erase(r.live, record.get());
+            }
+        };
+
+        ThreadRecord* threadRecord() noexcept
+        {
+            thread_local ThreadSlot slot;
+            if (slot.record == nullptr)
+            {
+                try
+                {
+                    auto record = std::make_unique<ThreadRecord>();
+                    Registry& r = registry();
+                    std::lock_guard lock(r.mutex);
+                    r.live.push_back(record.get());
+                    slot.record = std::move(record);
+                }
+                catch (...)
+                {
+                    // unrecorded, rather than failing the verification
+                    return nullptr;
+                }
+            }
+            return slot.record.get();
+        }
+
+        double nanosPerTick(const Registry& r)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            // calibrated over the life of the process; the first snapshot
+            // waits until there are a few milliseconds to go by
+            auto minimum = r.startTime + std::chrono::milliseconds(20);
+            if (std::chrono::steady_clock::now() < minimum)
+                std::this_thread::sleep_until(minimum);
+            uint64_t ticks = detail::metricTicks() - r.startTicks;
+            auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - r.startTime).count();
+            return ticks == 0 ? 1.0 : static_cast<double>(nanos) / static_cast<double>(ticks);
+#else
+            (void) r;
+            return 1.0;
+#endif
+        }
+#endif
+    }
+
+    const char* toString(VerifyStage stage) noexcept
+    {
+        switch (stage)
+        {
+        case VerifyStage::cache:      return "cache";
+        case VerifyStage::decode:     return "decode";
+        case VerifyStage::parse:      return "parse";
+        case VerifyStage::keyResolve: return "key_resolve";
+        case VerifyStage::signature:  return "signature";
+        case VerifyStage::claims:     return "claims";
+        }
+        return "unknown";
+    }
+
+    size_t LatencyHistogram::bucketOf(uint64_t value) noexcept
+    {
+        if (value < subBuckets)
+            return static_cast<size_t>(value);
+        if (value >> maxValueBits != 0)
+            return bucketCount - 1;
+        unsigned shift = static_cast<unsigned>(std::bit_width(value)) - subBucketBits - 1;
+        return static_cast<size_t>(((shift + 1) << subBucketBits) + (value >> shift) - subBuckets);
+    }
+
+    uint64_t LatencyHistogram::bucketLow(size_t bucket) noexcept
+    {
+        if (bucket < subBuckets)
+            return bucket;
+        unsigned shift = static_cast<unsigned>(bucket >> subBucketBits) - 1;
+        return ((bucket & (subBuckets - 1)) + subBuckets) << shift;
+    }
+
+    uint64_t LatencyHistogram::bucketHigh(size_t bucket) noexcept
+    {
+        if (bucket < subBuckets)
+            return bucket + 1;
+        unsigned shift = static_cast<unsigned>(bucket >> subBucketBits) - 1;
+        return bucketLow(bucket) + (uint64_t(1) << shift);
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram& other) noexcept
+    {
+        for (size_t i = 0; i < bucketCount; ++i)
+            counts_[i] += other.counts_[i];
+    }
+
+    uint64_t LatencyHistogram::count() const noexcept
+    {
+        uint64_t total = 0;
+        for (uint64_t n : counts_)
+            total += n;
+        return total;
+    }
+
+    uint64_t LatencyHistogram::countAtOrBelow(uint64_t value) const noexcept
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < bucketCount && bucketMidpoint(i) <= value; ++i)
+            total += counts_[i];
+        return total;
+    }
+
+    uint64_t LatencyHistogram::percentile(double q) const noexcept
+    {
+        uint64_t total = count();
+        if (total == 0)
+            return 0;
+        double wanted = std::ceil(q * static_cast<double>(total));
+        uint64_t rank = wanted < 1 ? 1 : wanted > static_cast<double>(total) ? total : static_cast<uint64_t>(wanted);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return bucketMidpoint(i);
+        }
+        return bucketMidpoint(bucketCount - 1);
+    }
+
+    uint64_t VerifyMetrics::verifications() const noexcept
+    {
+        uint64_t total = 0;
+        for (uint64_t n : outcomes)
+            total += n;
+        return total;
+    }
+
+    namespace detail
+    {
+        void recordVerification(const uint64_t (&ticks)[verifyStageCount], unsigned reached,
+            VerifyStage failedIn, JWTStatus status) noexcept
+        {
+#if NCBI_OAUTH_METRICS
+            ThreadRecord* record = threadRecord();
+            if (record == nullptr)
+                return;
+            for (size_t s = 0; s < verifyStageCount; ++s)
+            {
+                if ((reached & (1u << s)) == 0)
+                    continue;
+                ThreadRecord::Stage& stage = record->stages[s];
+                bump(stage.count, 1);
+                bump(stage.ticks, ticks[s]);
+                bump(stage.buckets[LatencyHistogram::bucketOf(ticks[s])], 1);
+            }
+            if (status != JWTStatus::ok)
+                bump(record->stages[static_cast<size_t>(failedIn)].failures, 1);
+            bump(record->outcomes[static_cast<size_t>(status)], 1);
+#else
+            (void) ticks;
+            (void) reached;
+            (void) failedIn;
+            (void) status;
+#endif
+        }
+    }
+
+    VerifyMetrics verifyMetrics()
+    {
+        VerifyMetrics metrics;
+#if NCBI_OAUTH_METRICS
+        Registry& r = registry();
+        double scale = nanosPerTick(r);
+
+        auto total = std::make_unique<ThreadRecord>();
+        {
+            std::lock_guard lock(r.mutex);
+            r.retired.addTo(*total);
+            for (const ThreadRecord* record : r.live)
+                record->addTo(*total);
+        }
+
+        for (size_t s = 0; s < verifyStageCount; ++s)
+        {
+            const ThreadRecord::Stage& from = total->stages[s];
+            StageMetrics& to = metrics.stages[s];
+            to.count = from.count.load(std::memory_order_relaxed);
+            to.failures = from.failures.load(std::memory_order_relaxed);
+            to.totalNanos = static_cast<uint64_t>(static_cast<double>(from.ticks.load(std::memory_order_relaxed)) * scale);
+            // each bucket of ticks lands whole in the bucket of its
+            // midpoint in nanoseconds
+            for (size_t b = 0; b < LatencyHistogram::bucketCount; ++b)
+            {
+                uint64_t n = from.buckets[b].load(std::memory_order_relaxed);
+                if (n != 0)
+                    to.latency.add(static_cast<uint64_t>(static_cast<double>(bucketMidpoint(b)) * scale), n);
+            }
+        }
+        for (size_t i = 0; i < jwtStatusCount; ++i)
+            metrics.outcomes[i] = total->outcomes[i].load(std::memory_order_relaxed);
+#endif
+        return metrics;
+    }
+
+    std::string toPrometheus(const VerifyMetrics& metrics, std::string_view prefix)
+    {
+        std::string text;
+        std::string name(prefix);
+        char line[256];
+
+        text += "# HELP " + name + "_verify_stage_seconds Time spent in each stage of token verification.\n";
+        text += "# TYPE " + name + "_verify_stage_seconds histogram\n";
+        for (size_t s = 0; s < verifyStageCount; ++s)
+        {
+            const StageMetrics& stage = metrics.stages[s];
+            const char* label = toString(static_cast<VerifyStage>(s));
+            for (uint64_t bound : exportBounds)
+            {
+                std::snprintf(line, sizeof line, "_verify_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n",
+                    label, static_cast<double>(bound) * 1e-9,
+                    static_cast<unsigned long long>(stage.latency.countAtOrBelow(bound)));
+                text += name + line;
+            }
+            std::snprintf(line, sizeof line, "_verify_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+                label, static_cast<unsigned long long>(stage.count));
+            text += name + line;
+            std::snprintf(line, sizeof line, "_verify_stage_seconds_sum{stage=\"%s\"} %.9f\n",
+                label, static_cast<double>(stage.totalNanos) * 1e-9);
+            text += name + line;
+            std::snprintf(line, sizeof line, "_verify_stage_seconds_count{stage=\"%s\"} %llu\n",
+                label, static_cast<unsigned long long>(stage.count));
+            text += name + line;
+        }
+
+        text += "# HELP " + name + "_verify_stage_failures_total Verifications rejected in each stage.\n";
+        text += "# TYPE " + name + "_verify_stage_failures_total counter\n";
+        for (size_t s = 0; s < verifyStageCount; ++s)
+        {
+            std::snprintf(line, sizeof line, "_verify_stage_failures_total{stage=\"%s\"} %llu\n",
+                toString(static_cast<VerifyStage>(s)), static_cast<unsigned long long>(metrics.stages[s].failures));
+            text += name + line;
+        }
+
+        text += "# HELP " + name + "_verify_total Token verifications by outcome.\n";
+        text += "# TYPE " + name + "_verify_total counter\n";
+        for (size_t i = 0; i < jwtStatusCount; ++i)
+        {
+            std::snprintf(line, sizeof line, "_verify_total{status=\"%s\"} %llu\n",
+                statusNames[i], static_cast<unsigned long long>(metrics.outcomes[i]));
+            text += name + line;
+        }
+        return text;
+    }
+}
@@ -0,0 +1,155 @@
+// AsyncJWTVerifier and AsyncIntrospectionClient, driven by syncWait()
+// through a ThreadPoolExecutor: what can be answered at once is, without
+// suspending, and a token naming a key not yet fetched waits for the
+// refresh it triggers
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/async-verify.hpp>
+#include <ncbi/thread-pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    // serves "key-1", and "key-2" as well once "rotated" is set
+    struct KeyServer
+    {
+        PKey key1 = generateKey(JWTAlg::ES256);
+        PKey key2 = generateKey(JWTAlg::ES256);
+        std::atomic<bool> rotated { false };
+
+        std::shared_ptr<FunctionFetcher> fetcher()
+        {
+            return std::make_shared<FunctionFetcher>([this](const std::string&)
+            {
+                FetchResponse response;
+                response.status = 200;
+                response.body = R"({"keys":[)" + publicJWK(JWTAlg::ES256, key1.get(), "key-1") +
+                    (rotated ? "," + publicJWK(JWTAlg::ES256, key2.get(), "key-2") : std::string()) + "]}";
+                return response;
+            });
+        }
+    };
+
+    // the status, and whether the coroutine went on after co_await on
+    // another thread than the one that started it
+    struct Outcome
+    {
+        JWTStatus status;
+        bool resumedElsewhere;
+    };
+
+    Task<Outcome> verifyTask(const AsyncJWTVerifier& verifier, std::string_view token)
+    {
+        std::thread::id before = std::this_thread::get_id();
+        VerificationResult result = co_await verifier.verify(token, testNow);
+        co_return Outcome { result.status, std::this_thread::get_id() != before };
+    }
+
+    Task<Outcome> introspectTask(const AsyncIntrospectionClient& client, std::string_view token)
+    {
+        std::thread::id before = std::this_thread::get_id();
+        IntrospectionOutcome outcome = co_await client.introspect(token);
+        co_return Outcome { outcome.status, std::this_thread::get_id() != before };
+    }
+
+    TEST_CASE(knownKeyCompletesInline)
+    {
+        KeyServer server;
+        JWKSCache keys("stand-in:jwks", server.fetcher());
+        keys.start();
+        ThreadPool pool(2);
+        ThreadPoolExecutor executor(pool);
+        AsyncJWTVerifier verifier(keys, executor);
+
+        std::string token = makeToken(JWTAlg::ES256, server.key1.get(), "key-1", benchPayload);
+        AsyncJWTVerifier::Verification verification = verifier.verify(token, testNow);
+        CHECK(verification.await_ready());
+        CHECK(verification.await_resume().status == JWTStatus::ok);
+
+        Outcome outcome = syncWait(verifyTask(verifier, token));
+        CHECK(outcome.status == JWTStatus::ok);
+        CHECK(!outcome.resumedElsewhere);
+    }
+
+    // the key appears with the refresh the miss asks for, and the
+    // coroutine is resumed on the pool to find it
+    TEST_CASE(unknownKeyWaitsForRefresh)
+    {
+        KeyServer server;
+        JWKSCacheOptions options;
+        options.minRefreshInterval = std::chrono::seconds(0);
+        JWKSCache keys("stand-in:jwks", server.fetcher(), options);
+        keys.start();
+        ThreadPool pool(2);
+        ThreadPoolExecutor executor(pool);
+        AsyncJWTVerifier verifier(keys, executor);
+
+        uint64_t generation = keys.generation();
+        server.rotated = true;
+        std::string token = makeToken(JWTAlg::ES256, server.key2.get(), "key-2", benchPayload);
+        Outcome outcome = syncWait(verifyTask(verifier, token));
+        CHECK(outcome.status == JWTStatus::ok);
+        CHECK(outcome.resumedElsewhere);
+        CHECK(keys.generation() > generation);
+    }
+
+    // a refresh was just made, so none can start soon: the answer is
+    // unknownKey at once, on the calling thread
+    TEST_CASE(rateLimitedMissFailsAtOnce)
+    {
+        KeyServer server;
+        JWKSCacheOptions options;
+        options.minRefreshInterval = std::chrono::seconds(3600);
+        JWKSCache keys("stand-in:jwks", server.fetcher(), options);
+        keys.start();
+        ThreadPool pool(2);
+        ThreadPoolExecutor executor(pool);
+        AsyncJWTVerifier verifier(keys, executor);
+
+        server.rotated = true;
+        std::string token = makeToken(JWTAlg::ES256, server.key2.get(), "key-2", benchPayload);
+        auto start = std::chrono::steady_clock::now();
+        Outcome outcome = syncWait(verifyTask(verifier, token));
+        CHECK(outcome.status == JWTStatus::unknownKey);
+        CHECK(!outcome.resumedElsewhere);
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
+
+    TEST_CASE(cachedIntrospectionIsInline)
+    {
+        std::atomic<uint64_t> requests { 0 };
+        auto fetcher = std::make_shared<FunctionFetcher>(nullptr, [&](const std::string&, const FetchRequest&)
+        {
+            requests.fetch_add(1, std::memory_order_relaxed);
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"active":true,"client_id":"spa","exp":4102444800})";
+            return response;
+        });
+        IntrospectionClient client("https://login.example.org/introspect", fetcher);
+        ThreadPool pool(2);
+        ThreadPoolExecutor executor(pool);
+        AsyncIntrospectionClient async(client, executor);
+
+        Outcome first = syncWait(introspectTask(async, "opaque-1"));
+        CHECK(first.status == JWTStatus::ok);
+        CHECK(first.resumedElsewhere);
+
+        Outcome second = syncWait(introspectTask(async, "opaque-1"));
+        CHECK(second.status == JWTStatus::ok);
+        CHECK(!second.resumedElsewhere);
+        CHECK(requests == 1);
+    }
+}
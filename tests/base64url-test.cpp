@@ -0,0 +1,58 @@
+// the base64url kernels, each checked against the scalar decoder
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/base64url.hpp>
+
+#include <string>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr Base64URLKernel kernels[] = { Base64URLKernel::scalar, Base64URLKernel::sse41,
+        Base64URLKernel::avx2, Base64URLKernel::avx512 };
+
+    // every kernel the CPU supports decodes as the scalar one does
+    TEST_CASE(kernelsAgree)
+    {
+        std::string input;
+        for (int i = 0; i < 1000; ++i)
+            input += static_cast<char>(i * 37 + i / 7);
+
+        Base64URLKernel initial = base64urlKernel();
+        for (Base64URLKernel kernel : kernels)
+        {
+            if (!base64urlSelectKernel(kernel))
+                continue;
+            for (size_t size : { 0u, 1u, 15u, 64u, 333u, 1000u })
+            {
+                std::string src = bench::base64url(std::string_view(input.data(), size));
+                std::string out(base64urlDecodedSize(src.size()), '\0');
+                size_t written = 0;
+                CHECK(base64urlDecode(src, out.data(), written));
+                CHECK(std::string_view(out.data(), written) == std::string_view(input.data(), size));
+            }
+        }
+        base64urlSelectKernel(initial);
+    }
+
+    TEST_CASE(strictRejectsNonCanonical)
+    {
+        Base64URLKernel initial = base64urlKernel();
+        for (Base64URLKernel kernel : kernels)
+        {
+            if (!base64urlSelectKernel(kernel))
+                continue;
+            unsigned char out[64];
+            size_t written = 0;
+            CHECK(base64urlDecode("QQ", out, written));
+            CHECK(!base64urlDecode("QR", out, written));        // nonzero trailing bits
+            CHECK(!base64urlDecode("QQ==", out, written));
+            CHECK(base64urlDecode("QQ==", out, written, Base64URLMode::lenient));
+            CHECK(!base64urlDecode(std::string(40, 'A') + "+A", out, written));
+        }
+        base64urlSelectKernel(initial);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// a minimal test harness, so the tests need nothing beyond the library
+//
+// a test program defines cases with TEST_CASE and checks conditions with
+// CHECK, which records a failure and carries on, or REQUIRE, which also
+// leaves the case; the program runs every case, or those named on its
+// command line, and exits nonzero if any check failed or any case threw
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ncbi::test
+{
+    struct Case
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<Case>& cases()
+    {
+        static std::vector<Case> all;
+        return all;
+    }
+
+    inline unsigned failures = 0;
+
+    struct Register
+    {
+        Register(const char* name, void (*run)()) { cases().push_back(Case { name, run }); }
+    };
+
+    inline void fail(const char* file, int line, const std::string& what)
+    {
+        ++failures;
+        std::fprintf(stderr, "%s:%d: failed: %s\n", file, line, what.c_str());
+    }
+}
+
+#define TEST_CASE(name) \
+    void name(); \
+    const ncbi::test::Register name##Registered(#name, name); \
+    void name()
+
+#define CHECK(condition) \
+    ((condition) ? (void)0 : ncbi::test::fail(__FILE__, __LINE__, #condition))
+
+#define REQUIRE(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            ncbi::test::fail(__FILE__, __LINE__, #condition); \
+            return; \
+        } \
+    } while (false)
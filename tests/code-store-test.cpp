@@ -0,0 +1,140 @@
+// ShardedCodeStore: one winner among racing redemptions, expiry through
+// every level of the timing wheel, and the overflow map of a full window
+
+#include "check.hpp"
+
+#include <ncbi/code-store.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr int64_t testStart = 1800000000;
+
+    AuthorizationGrant grant(int64_t expires)
+    {
+        return AuthorizationGrant { "spa", "user-1", "openid", "", "", expires };
+    }
+
+    ShardedCodeStoreOptions oneShard(size_t capacity = 1024)
+    {
+        ShardedCodeStoreOptions options;
+        options.capacity = capacity;
+        options.shards = 1;
+        options.start = testStart;
+        return options;
+    }
+
+    TEST_CASE(oneOfRacingConsumesWins)
+    {
+        ShardedCodeStoreOptions options;
+        options.capacity = 1024;
+        options.start = testStart;
+        ShardedCodeStore store(options);
+
+        for (int round = 0; round < 100; ++round)
+        {
+            std::string code = store.issue(grant(testStart + 600));
+            std::atomic<bool> go { false };
+            std::atomic<unsigned> winners { 0 };
+            std::vector<std::jthread> threads;
+            for (int i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([&]
+                {
+                    while (!go.load(std::memory_order_acquire))
+                    {
+                    }
+                    AuthorizationGrant granted;
+                    if (store.consume(code, testStart, granted) && granted.subject == "user-1")
+                        winners.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            go.store(true, std::memory_order_release);
+            threads.clear();
+            CHECK(winners == 1);
+        }
+        CHECK(store.size() == 0);
+    }
+
+    TEST_CASE(expiredCodeIsRefused)
+    {
+        ShardedCodeStore store(oneShard());
+        std::string code = store.issue(grant(testStart + 10));
+        AuthorizationGrant granted;
+        CHECK(!store.consume(code, testStart + 10, granted));
+
+        code = store.issue(grant(testStart + 10));
+        CHECK(store.expire(testStart + 9) == 0);
+        CHECK(store.expire(testStart + 10) == 1);
+        CHECK(store.size() == 0);
+        CHECK(!store.consume(code, testStart + 5, granted));
+    }
+
+    // codes past 256 seconds wait on the second level, those past 16384
+    // on the third, and cascade down to expire on their very second
+    TEST_CASE(cascadesThroughLevels)
+    {
+        ShardedCodeStore store(oneShard());
+        const int64_t expiries[] = { 300, 301, 20000, 20001 };
+        std::vector<std::string> codes;
+        for (int64_t e : expiries)
+            codes.push_back(store.issue(grant(testStart + e)));
+
+        CHECK(store.expire(testStart + 299) == 0);
+        CHECK(store.size() == 4);
+        CHECK(store.expire(testStart + 300) == 1);
+        AuthorizationGrant granted;
+        CHECK(store.consume(codes[1], testStart + 300, granted));
+
+        CHECK(store.expire(testStart + 19999) == 0);
+        CHECK(store.size() == 2);
+        CHECK(store.expire(testStart + 20000) == 1);
+        CHECK(store.consume(codes[3], testStart + 20000, granted));
+        CHECK(store.size() == 0);
+        CHECK(!store.consume(codes[2], testStart + 19000, granted));
+    }
+
+    // a window of 16 slots in a table of 16 is full after 16 codes; the
+    // rest go to the overflow map, and redeem and expire the same
+    TEST_CASE(fullWindowOverflows)
+    {
+        ShardedCodeStore store(oneShard(16));
+        std::vector<std::string> codes;
+        for (int i = 0; i < 40; ++i)
+            codes.push_back(store.issue(grant(testStart + (i % 2 == 0 ? 10 : 20))));
+        CHECK(store.size() == 40);
+
+        AuthorizationGrant granted;
+        for (size_t i = 0; i < codes.size(); i += 4)
+            CHECK(store.consume(codes[i], testStart, granted));
+        CHECK(store.size() == 30);
+        CHECK(store.expire(testStart + 10) == 10);
+        CHECK(store.expire(testStart + 20) == 20);
+        CHECK(store.size() == 0);
+        CHECK(!store.consume(codes[1], testStart, granted));
+    }
+
+    // an expire() after more than a whole wheel's time empties every
+    // bucket at once, and the wheel goes on from there
+    TEST_CASE(expireJumpsWholeWheel)
+    {
+        ShardedCodeStore store(oneShard());
+        for (int64_t e : { int64_t(5), int64_t(500), int64_t(50000), int64_t(1) << 21 })
+            store.issue(grant(testStart + e));
+        CHECK(store.expire(testStart + (int64_t(1) << 20) + 5) == 3);
+        CHECK(store.size() == 1);
+        CHECK(store.expire(testStart + (int64_t(1) << 22)) == 1);
+        CHECK(store.size() == 0);
+
+        int64_t now = testStart + (int64_t(1) << 22);
+        std::string code = store.issue(grant(now + 300));
+        CHECK(store.expire(now + 299) == 0);
+        CHECK(store.expire(now + 300) == 1);
+    }
+}
@@ -0,0 +1,246 @@
+// hot reload of the verifier configuration through VerifierConfigFeed:
+// verifications never see a mixture of two configurations, and an issuer
+// can be dropped while its key set cache is refreshing
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/request-arena.hpp>
+#include <ncbi/verifier-config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+    constexpr std::string_view secretA = "secret-of-configuration-A-32byte";
+    constexpr std::string_view secretB = "secret-of-configuration-B-32byte";
+    constexpr std::string_view header = R"({"alg":"HS256","typ":"JWT","kid":"k"})";
+
+    // serves a key set for any URI: that of secret A for URIs ending in
+    // 'a', of secret B for the others; counts the fetches of "counted"
+    struct KeyServer
+    {
+        std::string counted;
+        std::atomic<uint64_t> fetches { 0 };
+
+        std::shared_ptr<FunctionFetcher> fetcher()
+        {
+            return std::make_shared<FunctionFetcher>([this](const std::string& uri)
+            {
+                if (uri == counted)
+                    fetches.fetch_add(1, std::memory_order_relaxed);
+                FetchResponse response;
+                response.status = 200;
+                response.body = R"({"keys":[)" +
+                    publicJWK(JWTAlg::HS256, nullptr, "k", uri.back() == 'a' ? secretA : secretB) + "]}";
+                return response;
+            });
+        }
+    };
+
+    std::string token(std::string_view secret, std::string_view iss, std::string_view aud, int64_t exp)
+    {
+        return makeHS256Token(header, R"({"iss":")" + std::string(iss) + R"(","aud":")" + std::string(aud) +
+            R"(","sub":"user-1","exp":)" + std::to_string(exp) + R"(,"jti":"j-1"})", secret);
+    }
+
+    // configuration A or B; each gives the issuer "https://tenant.example.org"
+    // a different key set, audience and clock skew, and the decoy issuer
+    // keeps both key set caches in service, so every swap carries them over
+    VerifierConfig config(bool a)
+    {
+        VerifierConfig config;
+        IssuerConfig& tenant = config.issuers.emplace_back();
+        tenant.issuer = "https://tenant.example.org";
+        tenant.jwksURI = a ? "stand-in:keys-a" : "stand-in:keys-b";
+        tenant.audiences = { a ? "api-a" : "api-b" };
+        tenant.algorithms = { JWTAlg::HS256 };
+        tenant.clockSkew = std::chrono::seconds(a ? 0 : 300);
+
+        IssuerConfig& decoy = config.issuers.emplace_back();
+        decoy.issuer = "https://decoy.example.org";
+        decoy.jwksURI = a ? "stand-in:keys-b" : "stand-in:keys-a";
+        return config;
+    }
+
+    // readers verify tokens while the configuration is swapped as fast as
+    // possible; some tokens pass only a mixture of the two configurations,
+    // keys of one with the audience or skew of the other, and must never
+    // be accepted, with or without a result cache; a token valid under one
+    // configuration must get its answer when no swap overlapped the
+    // verification, and both configurations must be seen in force
+    TEST_CASE(swapsAreNeverTorn)
+    {
+        KeyServer server;
+        IssuerRegistry registry;
+        VerifierConfigFeed feed(registry, "stand-in:config", server.fetcher());
+        feed.apply(config(true));
+
+        VerifiedTokenCache cache;
+        JWTVerifierOptions cached;
+        cached.cache = &cache;
+        JWTVerifier verifiers[] = { JWTVerifier(registry), JWTVerifier(registry, cached) };
+
+        const std::string iss = "https://tenant.example.org";
+        const std::string onlyA = token(secretA, iss, "api-a", testNow + 600);
+        const std::string onlyB = token(secretB, iss, "api-b", testNow + 600);
+        const std::string torn[] =
+        {
+            token(secretA, iss, "api-b", testNow + 600),    // keys of A, audience of B
+            token(secretB, iss, "api-a", testNow + 600),    // keys of B, audience of A
+            token(secretA, iss, "api-a", testNow - 100)     // A, but needing the skew of B
+        };
+
+        // generations count applications from 1, so A is in force at odd ones
+        std::atomic<bool> stop { false };
+        std::atomic<uint64_t> acceptedA { 0 }, acceptedB { 0 }, wrong { 0 };
+        auto reader = [&](size_t index)
+        {
+            const JWTVerifier& verifier = verifiers[index % 2];
+            RequestArena arena;
+            std::shared_ptr<const VerifiedToken> result;
+            uint64_t n = 0;
+
+            // true if "t" was accepted; "validUnderA" and "validUnderB" say where it should be
+            auto check = [&](const std::string& t, bool validUnderA, bool validUnderB, bool arenaResult)
+            {
+                uint64_t before = registry.snapshot().generation();
+                bool ok;
+                if (arenaResult)
+                {
+                    ArenaJWT jwt(arena.resource());
+                    ok = verifier.verify(t, testNow, jwt) == JWTStatus::ok;
+                }
+                else
+                    ok = verifier.verify(t, testNow, result) == JWTStatus::ok;
+                arena.release();
+                uint64_t after = registry.snapshot().generation();
+                ++n;
+
+                if (ok && !validUnderA && !validUnderB)
+                    wrong.fetch_add(1, std::memory_order_relaxed);
+                else if (before == after && ok != (before % 2 == 1 ? validUnderA : validUnderB))
+                    wrong.fetch_add(1, std::memory_order_relaxed);
+                return ok;
+            };
+
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                bool arenaResult = n % 2 == 1 && index % 2 == 0;
+                if (check(onlyA, true, false, arenaResult))
+                    acceptedA.fetch_add(1, std::memory_order_relaxed);
+                if (check(onlyB, false, true, arenaResult))
+                    acceptedB.fetch_add(1, std::memory_order_relaxed);
+                for (const std::string& t : torn)
+                    check(t, false, false, arenaResult);
+            }
+        };
+
+        std::vector<std::jthread> readers;
+        for (size_t i = 0; i < 4; ++i)
+            readers.emplace_back(reader, i);
+
+        uint64_t swaps = 0;
+        auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (std::chrono::steady_clock::now() < end)
+            feed.apply(config(++swaps % 2 == 0));
+        stop = true;
+        readers.clear();
+
+        CHECK(wrong == 0);
+        CHECK(acceptedA != 0);
+        CHECK(acceptedB != 0);
+    }
+
+    // the dropped issuer's cache refreshes without pause, so once the
+    // snapshot below lets go its own refresher is often the next thread
+    // to publish, and the one that reclaims the retired configuration;
+    // dropping it must neither abort the process nor leave it fetching
+    TEST_CASE(dropsIssuerWhileRefreshing)
+    {
+        KeyServer server;
+        server.counted = "stand-in:keys-dropped";
+        VerifierConfigFeedOptions options;
+        options.jwks.defaultMaxAge = std::chrono::seconds(0);
+        options.jwks.minRefreshInterval = std::chrono::seconds(0);
+
+        IssuerRegistry registry;
+        VerifierConfigFeed feed(registry, "stand-in:config", server.fetcher(), options);
+
+        VerifierConfig kept;
+        IssuerConfig& tenant = kept.issuers.emplace_back();
+        tenant.issuer = "https://tenant.example.org";
+        tenant.jwksURI = "stand-in:keys-a";
+        VerifierConfig withDropped = kept;
+        IssuerConfig& dropped = withDropped.issuers.emplace_back();
+        dropped.issuer = "https://dropped.example.org";
+        dropped.jwksURI = server.counted;
+
+        for (int round = 0; round < 20; ++round)
+        {
+            feed.apply(withDropped);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            {
+                // a verification in flight holds the old configuration
+                // across the swap, so the swap itself cannot free it
+                IssuerRegistry::Snapshot inFlight = registry.snapshot();
+                feed.apply(kept);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        uint64_t fetches = server.fetches.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(server.fetches.load() == fetches);
+        CHECK(registry.snapshot().find("https://dropped.example.org") == nullptr);
+        CHECK(registry.snapshot().find("https://tenant.example.org") != nullptr);
+    }
+
+    // a cached result revalidated under a new configuration is cached
+    // again, stamped with its generation, even when only the issuer's
+    // skew still admits it
+    TEST_CASE(revalidatedResultWithinSkewIsCachedAgain)
+    {
+        KeyServer server;
+        IssuerRegistry registry;
+        VerifierConfigFeed feed(registry, "stand-in:config", server.fetcher());
+
+        auto configuration = [](std::string audience)
+        {
+            VerifierConfig config;
+            IssuerConfig& tenant = config.issuers.emplace_back();
+            tenant.issuer = "https://tenant.example.org";
+            tenant.jwksURI = "stand-in:keys-a";
+            tenant.audiences = { "api-a", std::move(audience) };
+            tenant.clockSkew = std::chrono::seconds(300);
+            return config;
+        };
+        feed.apply(configuration("api-1"));
+
+        VerifiedTokenCache cache;
+        JWTVerifierOptions options;
+        options.cache = &cache;
+        JWTVerifier verifier(registry, options);
+        const std::string expired = token(secretA, "https://tenant.example.org", "api-a", testNow - 100);
+
+        std::shared_ptr<const VerifiedToken> result;
+        REQUIRE(verifier.verify(expired, testNow, result) == JWTStatus::ok);
+        feed.apply(configuration("api-2"));
+        REQUIRE(verifier.verify(expired, testNow, result) == JWTStatus::ok);
+
+        std::shared_ptr<const VerifiedToken> cached = cache.find(expired, INT64_MIN);
+        REQUIRE(cached != nullptr);
+        CHECK(cached->registryGeneration == registry.snapshot().generation());
+    }
+}
@@ -0,0 +1,123 @@
+// OpenID Connect discovery: providers resolve with their keys, and a key
+// set cache a provider gives up, or the whole discovery cache, can go
+// while that key set is refreshing
+
+#include "check.hpp"
+
+#include <ncbi/oidc-discovery.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr std::string_view issuer = "https://login.example.org";
+    constexpr std::string_view keySet =
+        R"({"keys":[{"kty":"oct","alg":"HS256","kid":"key-1","k":"MDEyMzQ1Njc4OWFiY2RlZjAxMjM0NTY3ODlhYmNkZWY"}]})";
+
+    // serves the discovery document of "issuer", naming "/jwks-<keys>" as
+    // its key set, and the key set at any other URI; counts the fetches
+    // of each key set URI by its last character
+    struct Server
+    {
+        std::atomic<unsigned> keys { 1 };
+        std::atomic<uint64_t> fetches[10] {};
+
+        std::shared_ptr<FunctionFetcher> fetcher()
+        {
+            return std::make_shared<FunctionFetcher>([this](const std::string& uri)
+            {
+                FetchResponse response;
+                response.status = 200;
+                if (uri == discoveryURI(issuer))
+                {
+                    response.cacheControl = "max-age=3600";
+                    response.body = R"({"issuer":")" + std::string(issuer) + R"(","jwks_uri":")" +
+                        std::string(issuer) + "/jwks-" + std::to_string(keys.load()) + R"("})";
+                }
+                else
+                {
+                    fetches[(uri.back() - '0') % 10].fetch_add(1, std::memory_order_relaxed);
+                    response.body = keySet;
+                }
+                return response;
+            });
+        }
+    };
+
+    // key sets refetched without pause, so their refreshers publish all
+    // the time and reclaim whatever was retired
+    DiscoveryOptions eager()
+    {
+        DiscoveryOptions options;
+        options.jwks.defaultMaxAge = std::chrono::seconds(0);
+        options.jwks.minRefreshInterval = std::chrono::seconds(0);
+        return options;
+    }
+
+    TEST_CASE(resolvesProvider)
+    {
+        Server server;
+        DiscoveryCache cache(server.fetcher());
+        cache.add(std::string(issuer));
+        REQUIRE(cache.waitUntilReady(std::chrono::seconds(10)));
+
+        DiscoveryCache::Snapshot snapshot = cache.snapshot();
+        const DiscoveryCache::Provider* provider = snapshot.find(issuer);
+        REQUIRE(provider != nullptr);
+        CHECK(provider->metadata.jwksURI == std::string(issuer) + "/jwks-1");
+        CHECK(provider->keys->snapshot().find("key-1", JWTAlg::HS256) != nullptr);
+        CHECK(snapshot.find("https://other.example.org") == nullptr);
+    }
+
+    // each refresh moves the provider to a new key set; a snapshot held
+    // across it keeps the old directory, and with it the old cache, from
+    // being freed by the refresh itself
+    TEST_CASE(movedKeySetStopsRefreshing)
+    {
+        Server server;
+        DiscoveryCache cache(server.fetcher(), eager());
+        cache.add(std::string(issuer));
+        REQUIRE(cache.waitUntilReady(std::chrono::seconds(10)));
+
+        for (unsigned keys = 2; keys < 10; ++keys)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            server.keys = keys;
+            DiscoveryCache::Snapshot inFlight = cache.snapshot();
+            REQUIRE(cache.refresh(issuer));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        uint64_t fetches = server.fetches[8].load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(server.fetches[8].load() == fetches);
+        CHECK(server.fetches[9].load() > 0);
+        CHECK(cache.snapshot().find(issuer)->metadata.jwksURI == std::string(issuer) + "/jwks-9");
+    }
+
+    // an earlier directory, pinned while the cache goes, shares the
+    // provider and is the last to let go of its key set cache
+    TEST_CASE(destroyedWhileRefreshing)
+    {
+        Server server;
+        for (int round = 0; round < 10; ++round)
+        {
+            auto cache = std::make_unique<DiscoveryCache>(server.fetcher(), eager());
+            cache->add(std::string(issuer));
+            REQUIRE(cache->waitUntilReady(std::chrono::seconds(10)));
+            {
+                DiscoveryCache::Snapshot inFlight = cache->snapshot();
+                REQUIRE(cache->refresh(issuer));
+                cache.reset();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        CHECK(server.fetches[1].load() > 0);
+    }
+}
@@ -0,0 +1,119 @@
+// DPoP (RFC 9449): a bound access token is accepted only with a fresh
+// proof for the request, signed by the key it is bound to, and a refused
+// proof does not use up its "jti"
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/dpop.hpp>
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-verifier.hpp>
+
+#include <openssl/sha.h>
+
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    const DPoPRequest request { "POST", "https://api.example.org/orders?page=2", {}, {} };
+
+    std::string proof(JWTAlg alg, EVP_PKEY* pkey, std::string_view jwk, std::string_view jti, std::string_view ath)
+    {
+        std::string header = R"({"typ":"dpop+jwt","alg":")" + std::string(algName(alg)) + R"(","jwk":)" +
+            std::string(jwk) + '}';
+        std::string payload = R"({"jti":")" + std::string(jti) + R"(","htm":"POST",)"
+            R"("htu":"https://api.example.org/orders","iat":)" + std::to_string(testNow) +
+            R"(,"ath":")" + std::string(ath) + R"("})";
+        std::string signingInput = base64url(header) + '.' + base64url(payload);
+        return signingInput + '.' + base64url(signJWS(alg, pkey, signingInput));
+    }
+
+    std::string tokenHash(std::string_view token)
+    {
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(token.data()), token.size(), digest);
+        return base64url(std::string_view(reinterpret_cast<const char*>(digest), sizeof digest));
+    }
+
+    // a client with its proof key and an access token bound to that key
+    struct Client
+    {
+        JWTAlg alg = JWTAlg::ES256;
+        PKey key = generateKey(alg);
+        std::string jwk = publicJWK(alg, key.get(), "client");
+        std::string token = makeHS256Token(benchHeader, R"({"iss":"https://login.example.org","sub":"user-1234567",)"
+            R"("aud":"https://api.example.org","exp":4102444800,"iat":1700000000,)"
+            R"("scope":"orders:read orders:write","cnf":{"jkt":")" + jwkThumbprint(JWK::parse(jwk)) + R"("}})",
+            benchSecret);
+
+        std::string makeProof(std::string_view jti) const
+        {
+            return proof(alg, key.get(), jwk, jti, tokenHash(token));
+        }
+    };
+
+    // verifies the access tokens, whose key set it serves itself
+    struct TokenVerifier
+    {
+        JWKSCache keys { "stand-in:jwks", std::make_shared<FunctionFetcher>([](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            return response;
+        }) };
+        JWTVerifier verifier { keys };
+
+        TokenVerifier() { keys.start(); }
+    };
+
+    // a proof refused for its request can still be presented for the
+    // right one, and only once
+    TEST_CASE(refusesOtherRequestAndReplay)
+    {
+        TokenVerifier tokens;
+        DPoPVerifier dpop;
+        Client client;
+        std::shared_ptr<const VerifiedToken> result;
+
+        std::string first = client.makeProof("test-1");
+        DPoPRequest elsewhere = request;
+        elsewhere.uri = "https://api.example.org/payments";
+        CHECK(dpop.verify(tokens.verifier, client.token, first, elsewhere, testNow, result) ==
+            JWTStatus::rejectedClaim);
+        CHECK(result == nullptr);
+        CHECK(dpop.verify(tokens.verifier, client.token, first, request, testNow, result) == JWTStatus::ok);
+        CHECK(result != nullptr);
+        CHECK(dpop.verify(tokens.verifier, client.token, first, request, testNow, result) == JWTStatus::replayed);
+    }
+
+    // a proof of its own from another client, presented with this
+    // client's token: correct "ath", wrong key
+    TEST_CASE(refusesProofByAnotherKey)
+    {
+        TokenVerifier tokens;
+        DPoPVerifier dpop;
+        Client client, other;
+        std::shared_ptr<const VerifiedToken> result;
+
+        std::string stolen = proof(other.alg, other.key.get(), other.jwk, "test-2", tokenHash(client.token));
+        CHECK(dpop.verify(tokens.verifier, client.token, stolen, request, testNow, result) ==
+            JWTStatus::rejectedClaim);
+        CHECK(result == nullptr);
+    }
+
+    TEST_CASE(replayCacheRemembersWindow)
+    {
+        DPoPReplayCache cache;
+        CHECK(cache.insert("jti-1", testNow) == DPoPReplayCache::Result::fresh);
+        CHECK(cache.insert("jti-1", testNow + 1) == DPoPReplayCache::Result::replayed);
+        CHECK(cache.insert("jti-2", testNow + 1) == DPoPReplayCache::Result::fresh);
+        CHECK(cache.stats().replayed == 1);
+    }
+}
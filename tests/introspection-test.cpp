@@ -0,0 +1,103 @@
+// IntrospectionClient: concurrent lookups of one token share one request,
+// whose result is then served from the cache until its time is up
+
+#include "check.hpp"
+
+#include <ncbi/introspection.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr int lookups = 8;
+
+    // an introspection endpoint that counts its requests and answers the
+    // first only once every other lookup is waiting on it
+    struct Server
+    {
+        std::atomic<uint64_t> requests { 0 };
+        const IntrospectionClient* client = nullptr;
+
+        std::shared_ptr<FunctionFetcher> fetcher()
+        {
+            return std::make_shared<FunctionFetcher>(nullptr, [this](const std::string&, const FetchRequest& request)
+            {
+                if (requests.fetch_add(1, std::memory_order_relaxed) == 0)
+                {
+                    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                    while (client->stats().coalesced < lookups - 1 && std::chrono::steady_clock::now() < end)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                FetchResponse response;
+                response.status = 200;
+                response.body = request.body.find("token=opaque-1") != std::string::npos ?
+                    R"({"active":true,"client_id":"spa","username":"user-1","exp":4102444800})" :
+                    R"({"active":false})";
+                return response;
+            });
+        }
+    };
+
+    TEST_CASE(coalescesThenCachesThenExpires)
+    {
+        Server server;
+        IntrospectionOptions options;
+        options.activeTTL = std::chrono::seconds(1);
+        IntrospectionClient client("https://login.example.org/introspect", server.fetcher(), options);
+        server.client = &client;
+
+        std::atomic<int> active { 0 };
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < lookups; ++i)
+        {
+            threads.emplace_back([&]
+            {
+                std::shared_ptr<const IntrospectionResult> result;
+                if (client.introspect("opaque-1", result) == JWTStatus::ok && result->active)
+                    active.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        threads.clear();
+        CHECK(active == lookups);
+        CHECK(server.requests == 1);
+        CHECK(client.stats().coalesced == lookups - 1);
+
+        // a hit, from the cache alone
+        std::shared_ptr<const IntrospectionResult> result;
+        JWTStatus status;
+        REQUIRE(client.cached("opaque-1", status, result));
+        CHECK(status == JWTStatus::ok);
+        CHECK(client.introspect("opaque-1", result) == JWTStatus::ok);
+        CHECK(server.requests == 1);
+        CHECK(client.stats().hits == 2);
+
+        // past the TTL the server is asked again
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        CHECK(!client.cached("opaque-1", status, result));
+        CHECK(client.introspect("opaque-1", result) == JWTStatus::ok);
+        CHECK(server.requests == 2);
+    }
+
+    TEST_CASE(inactiveResultIsCached)
+    {
+        Server server;
+        IntrospectionClient client("https://login.example.org/introspect", server.fetcher());
+        server.client = &client;
+        server.requests = 1;
+
+        std::shared_ptr<const IntrospectionResult> result;
+        CHECK(client.introspect("opaque-2", result) == JWTStatus::inactive);
+        REQUIRE(result != nullptr);
+        CHECK(!result->active);
+        CHECK(client.introspect("opaque-2", result) == JWTStatus::inactive);
+        CHECK(server.requests == 2);
+    }
+}
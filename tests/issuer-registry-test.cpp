@@ -0,0 +1,120 @@
+// IssuerRegistry: every issuer of registries of many sizes resolves
+// through the perfect hash, names close to them do not, and a reload
+// hands back the key set caches it drops
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/issuer-registry.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    std::shared_ptr<JWKSCache> startedCache(std::string uri)
+    {
+        auto keys = std::make_shared<JWKSCache>(std::move(uri), std::make_shared<FunctionFetcher>([](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            return response;
+        }));
+        keys->start();
+        return keys;
+    }
+
+    std::string tenant(size_t i)
+    {
+        return "https://login.example.org/tenant-" + std::to_string(i) + "/v2.0";
+    }
+
+    TEST_CASE(resolvesEveryIssuer)
+    {
+        std::shared_ptr<JWKSCache> keys = startedCache("stand-in:jwks");
+        for (size_t count : { 1, 2, 3, 7, 16, 100, 1000, 4096 })
+        {
+            std::vector<IssuerPolicy> policies(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                policies[i].issuer = tenant(i);
+                policies[i].keys = keys;
+            }
+            IssuerRegistry registry(std::move(policies));
+            IssuerRegistry::Snapshot snapshot = registry.snapshot();
+            CHECK(snapshot.size() == count);
+
+            size_t found = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const IssuerPolicy* policy = snapshot.find(tenant(i));
+                if (policy != nullptr && policy->issuer == tenant(i))
+                    ++found;
+            }
+            CHECK(found == count);
+
+            // near misses and strangers
+            std::string first = tenant(0);
+            std::string altered = first;
+            altered.back() = '1';
+            for (const std::string& miss : { first + '/', first.substr(0, first.size() - 1), altered,
+                std::string("HTTPS://login.example.org/tenant-0/v2.0"), tenant(count), std::string() })
+            {
+                CHECK(snapshot.find(miss) == nullptr);
+            }
+        }
+    }
+
+    TEST_CASE(reloadReturnsDroppedCaches)
+    {
+        std::shared_ptr<JWKSCache> a = startedCache("stand-in:a");
+        std::shared_ptr<JWKSCache> b = startedCache("stand-in:b");
+        std::shared_ptr<JWKSCache> c = startedCache("stand-in:c");
+        auto policy = [](std::string issuer, std::shared_ptr<JWKSCache> keys)
+        {
+            IssuerPolicy p;
+            p.issuer = std::move(issuer);
+            p.keys = std::move(keys);
+            return p;
+        };
+
+        IssuerRegistry registry;
+        CHECK(registry.reload({ policy(tenant(1), a), policy(tenant(2), b), policy(tenant(3), a) }).empty());
+        uint64_t generation = registry.snapshot().generation();
+
+        std::vector<std::shared_ptr<JWKSCache>> dropped =
+            registry.reload({ policy(tenant(1), a), policy(tenant(4), c) });
+        CHECK(dropped.size() == 1);
+        CHECK(!dropped.empty() && dropped.front() == b);
+        CHECK(registry.snapshot().generation() == generation + 1);
+        CHECK(registry.snapshot().find(tenant(2)) == nullptr);
+        CHECK(registry.snapshot().find(tenant(4))->keys == c);
+
+        // a repeated issuer is refused, and the registry stays as it was
+        bool threw = false;
+        try
+        {
+            (void)registry.reload({ policy(tenant(1), a), policy(tenant(1), b) });
+        }
+        catch (const JWTException&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(registry.snapshot().generation() == generation + 1);
+        CHECK(registry.snapshot().size() == 2);
+
+        dropped = registry.reload({});
+        std::sort(dropped.begin(), dropped.end());
+        std::vector<std::shared_ptr<JWKSCache>> expected = { a, c };
+        std::sort(expected.begin(), expected.end());
+        CHECK(dropped == expected);
+    }
+}
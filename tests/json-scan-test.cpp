@@ -0,0 +1,150 @@
+// JSON string scanning: every vector kernel the CPU runs stops where a
+// byte-by-byte scan would, with the special byte at each offset of and
+// around a block, and the reader decodes escapes and refuses control
+// characters wherever they fall
+
+#include "check.hpp"
+
+#include "json-scan-kernels.hpp"
+
+#include <ncbi/json-reader.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    struct Kernel
+    {
+        const char* name;
+        detail::JSONStringScanKernel scan;
+    };
+
+    std::vector<Kernel> kernels()
+    {
+        std::vector<Kernel> all { { "SSE2", detail::scanJSONStringSSE2 } };
+        if (__builtin_cpu_supports("avx2"))
+            all.push_back({ "AVX2", detail::scanJSONStringAVX2 });
+        return all;
+    }
+
+    // the scalar answer: the first '"', '\\' or control character
+    size_t firstSpecial(std::string_view s)
+    {
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            unsigned char ch = static_cast<unsigned char>(s[i]);
+            if (ch == '"' || ch == '\\' || ch < 0x20)
+                return i;
+        }
+        return s.size();
+    }
+
+    // ordinary bytes near the edges of what the kernels compare
+    std::string ordinary(size_t size)
+    {
+        constexpr char filler[] = { 'a', ' ', '\x7f', '\x80', '\xff', '!', '#', '[', ']', '\xc3', '\xa9' };
+        std::string s;
+        for (size_t i = 0; i < size; ++i)
+            s += filler[i % sizeof filler];
+        return s;
+    }
+
+    TEST_CASE(kernelsStopLikeScalarScan)
+    {
+        constexpr char specials[] = { '"', '\\', '\0', '\x01', '\x1f', '\n' };
+        for (const Kernel& kernel : kernels())
+        {
+            for (size_t size = 0; size <= 100; ++size)
+            {
+                std::vector<std::string> inputs { ordinary(size) };
+                for (size_t at = 0; at < size; ++at)
+                {
+                    for (char special : specials)
+                    {
+                        inputs.push_back(ordinary(size));
+                        inputs.back()[at] = special;
+                    }
+                }
+
+                for (const std::string& input : inputs)
+                {
+                    size_t expected = firstSpecial(input);
+                    const char* begin = input.data();
+                    size_t stop = static_cast<size_t>(kernel.scan(begin, begin + input.size()) - begin);
+
+                    // a kernel may leave a tail shorter than 16 bytes to the scalar code
+                    if (stop > expected || (stop != expected && input.size() - stop >= 16))
+                    {
+                        ncbi::test::fail(__FILE__, __LINE__, std::string(kernel.name) + ": size " +
+                            std::to_string(size) + ", special at " + std::to_string(expected) +
+                            ", stopped at " + std::to_string(stop));
+                    }
+                }
+            }
+        }
+    }
+
+    bool readString(const std::string& json, std::string& value)
+    {
+        JSONReader reader(json);
+        std::string_view name;
+        JSONValueView view;
+        if (!reader.enterObject() || !reader.nextMember(name) || !reader.readValue(view) ||
+            view.type() != JSONType::string)
+        {
+            return false;
+        }
+        value.assign(view.rawString().size(), '\0');
+        size_t written;
+        if (!view.getString(value.data(), written))
+            return false;
+        value.resize(written);
+        return !reader.nextMember(name) && !reader.failed() && reader.atEnd();
+    }
+
+    TEST_CASE(readerDecodesAtEveryOffset)
+    {
+        struct Escape
+        {
+            std::string_view raw;
+            std::string_view decoded;
+        };
+        constexpr Escape escapes[] =
+        {
+            { R"(\")", "\"" }, { R"(\\)", "\\" }, { R"(\n)", "\n" }, { R"(\/)", "/" }, { R"(\u00e9)", "\xc3\xa9" }
+        };
+
+        for (size_t size = 0; size <= 80; ++size)
+        {
+            std::string plain(size, 'x');
+            std::string value;
+            CHECK(readString(R"({"k":")" + plain + R"("})", value) && value == plain);
+
+            for (size_t at = 0; at <= size; ++at)
+            {
+                for (const Escape& escape : escapes)
+                {
+                    std::string raw = plain;
+                    raw.insert(at, escape.raw);
+                    std::string decoded = plain;
+                    decoded.insert(at, escape.decoded);
+                    if (!readString(R"({"k":")" + raw + R"("})", value) || value != decoded)
+                    {
+                        ncbi::test::fail(__FILE__, __LINE__, "escape " + std::string(escape.raw) +
+                            " at " + std::to_string(at) + " of " + std::to_string(size));
+                    }
+                }
+
+                // a raw control character, and a string left open
+                std::string control = plain;
+                control.insert(at, 1, '\t');
+                CHECK(!readString(R"({"k":")" + control + R"("})", value));
+                CHECK(!readString(R"({"k":")" + plain.substr(0, at), value));
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+// JWE decryption for every key management algorithm and content
+// encryption pair, on every curve ECDH-ES supports, and the refusal of
+// tokens whose tag, protected header or encrypted key was altered
+
+#include "check.hpp"
+#include "jwe-fixtures.hpp"
+
+#include <ncbi/jwe.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr std::string_view plaintext = R"({"iss":"https://login.example.org","sub":"user-1"})";
+
+    // a recipient: its decrypter, and what an encryptor needs to reach it
+    struct Recipient
+    {
+        std::string name;
+        PKey pkey;
+        std::string secret;
+        std::unique_ptr<JWEDecrypter> decrypter;
+    };
+
+    std::vector<Recipient> recipients(JWEEnc enc)
+    {
+        std::vector<Recipient> all;
+        auto symmetric = [&](JWEAlg alg, size_t size)
+        {
+            Recipient& r = all.emplace_back();
+            r.name = std::string(jweAlgName(alg));
+            r.secret = randomBytes(size);
+            r.decrypter = std::make_unique<SymmetricJWEDecrypter>(alg, r.secret);
+        };
+        auto asymmetric = [&](JWEAlg alg, PKey pkey, std::string_view curve)
+        {
+            Recipient& r = all.emplace_back();
+            r.name = std::string(jweAlgName(alg)) + ' ' + std::string(curve);
+            r.pkey = std::move(pkey);
+            r.decrypter = std::make_unique<PrivateKeyJWEDecrypter>(alg, privatePEM(r.pkey.get()));
+        };
+
+        symmetric(JWEAlg::dir, jweKeySize(enc));
+        symmetric(JWEAlg::A128KW, 16);
+        symmetric(JWEAlg::A256KW, 32);
+        asymmetric(JWEAlg::RSA_OAEP, generateKey(JWTAlg::RS256), "RSA");
+        asymmetric(JWEAlg::RSA_OAEP_256, generateKey(JWTAlg::RS256), "RSA");
+        for (JWEAlg alg : { JWEAlg::ECDH_ES, JWEAlg::ECDH_ES_A128KW, JWEAlg::ECDH_ES_A256KW })
+        {
+            asymmetric(alg, generateKey(JWTAlg::ES256), "P-256");
+            asymmetric(alg, generateKey(JWTAlg::ES384), "P-384");
+            asymmetric(alg, generateKey(JWTAlg::ES512), "P-521");
+            asymmetric(alg, PKey(EVP_PKEY_Q_keygen(nullptr, nullptr, "X25519")), "X25519");
+        }
+        return all;
+    }
+
+    JWTStatus decrypt(const JWEDecrypter& decrypter, std::string_view token, std::string& out)
+    {
+        JWEView view;
+        JWTStatus status = JWEView::parse(token, view);
+        if (status != JWTStatus::ok)
+            return status;
+        std::string buf(view.plaintextSize(), '\0');
+        std::string_view decrypted;
+        status = decrypter.decrypt(token, buf.data(), buf.size(), decrypted);
+        out.assign(decrypted);
+        return status;
+    }
+
+    // "token" with the first character of segment "index" changed, so
+    // that the decoded bytes change whatever the padding bits
+    std::string alterSegment(std::string token, size_t index)
+    {
+        size_t at = 0;
+        for (size_t i = 0; i < index; ++i)
+            at = token.find('.', at) + 1;
+        token[at] = token[at] == 'A' ? 'B' : 'A';
+        return token;
+    }
+
+    // "token" with its protected header, the AAD, re-encoded with another "kid"
+    std::string alterHeader(const std::string& token)
+    {
+        size_t dot = token.find('.');
+        std::string header(base64urlDecodedSize(dot), '\0');
+        size_t written = 0;
+        base64urlDecode(std::string_view(token).substr(0, dot), header.data(), written);
+        header.resize(written);
+        header.replace(header.find("test-jwe"), 8, "test-jwf");
+        return base64url(header) + token.substr(dot);
+    }
+
+    TEST_CASE(decryptsEveryPair)
+    {
+        for (JWEEnc enc : { JWEEnc::A128GCM, JWEEnc::A256GCM })
+        {
+            for (const Recipient& r : recipients(enc))
+            {
+                std::string token = makeJWE(r.decrypter->alg(), enc, r.pkey.get(), r.secret, plaintext, "test-jwe");
+                std::string out;
+                if (decrypt(*r.decrypter, token, out) != JWTStatus::ok || out != plaintext)
+                    ncbi::test::fail(__FILE__, __LINE__, r.name + ' ' + std::string(jweEncName(enc)));
+            }
+        }
+    }
+
+    // a bad RSA-OAEP key block goes on with a random key, so it fails at
+    // the tag like everything else
+    TEST_CASE(refusesAlteredTokens)
+    {
+        for (JWEEnc enc : { JWEEnc::A128GCM, JWEEnc::A256GCM })
+        {
+            for (const Recipient& r : recipients(enc))
+            {
+                std::string token = makeJWE(r.decrypter->alg(), enc, r.pkey.get(), r.secret, plaintext, "test-jwe");
+                std::vector<std::string> altered = { alterSegment(token, 4), alterSegment(token, 3), alterHeader(token) };
+                JWEView view;
+                REQUIRE(JWEView::parse(token, view) == JWTStatus::ok);
+                if (!view.encryptedKeySegment().empty())
+                    altered.push_back(alterSegment(token, 1));
+
+                for (const std::string& t : altered)
+                {
+                    std::string out;
+                    if (decrypt(*r.decrypter, t, out) != JWTStatus::decryptionFailed || !out.empty())
+                        ncbi::test::fail(__FILE__, __LINE__, r.name + ' ' + std::string(jweEncName(enc)));
+                }
+            }
+        }
+    }
+
+    // another recipient's key of the same kind does not open the token
+    TEST_CASE(refusesOtherKey)
+    {
+        std::vector<Recipient> mine = recipients(JWEEnc::A256GCM);
+        std::vector<Recipient> theirs = recipients(JWEEnc::A256GCM);
+        for (size_t i = 0; i < mine.size(); ++i)
+        {
+            std::string token = makeJWE(mine[i].decrypter->alg(), JWEEnc::A256GCM, mine[i].pkey.get(),
+                mine[i].secret, plaintext, "test-jwe");
+            std::string out;
+            if (decrypt(*theirs[i].decrypter, token, out) != JWTStatus::decryptionFailed)
+                ncbi::test::fail(__FILE__, __LINE__, mine[i].name);
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// verifiers JWKSet builds at load: a signature of every public-key
+// algorithm round-trips, from many threads at once, and agrees with the
+// one-shot import; altered input, keys for another algorithm and short
+// RSA moduli are refused
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwk.hpp>
+#include <ncbi/jws.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr JWTAlg publicKeyAlgs[] =
+    {
+        JWTAlg::RS256, JWTAlg::RS384, JWTAlg::RS512,
+        JWTAlg::PS256, JWTAlg::PS384, JWTAlg::PS512,
+        JWTAlg::ES256, JWTAlg::ES384, JWTAlg::ES512,
+        JWTAlg::EdDSA
+    };
+
+    const unsigned char* bytes(const std::string& s) { return reinterpret_cast<const unsigned char*>(s.data()); }
+
+    std::unique_ptr<const JWKSet> keySet(const std::string& jwk)
+    {
+        return JWKSet::parse(R"({"keys":[)" + jwk + "]}");
+    }
+
+    TEST_CASE(roundTripsEveryAlgorithm)
+    {
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        for (JWTAlg alg : publicKeyAlgs)
+        {
+            PKey key = generateKey(alg);
+            std::unique_ptr<const JWKSet> keys = keySet(publicJWK(alg, key.get(), "bench-1"));
+            const JWK* jwk = keys->find("bench-1", alg);
+            REQUIRE(jwk != nullptr);
+            const JWSVerifier* verifier = keys->verifier(*jwk, alg);
+            REQUIRE(verifier != nullptr);
+            CHECK(verifier->alg() == alg);
+
+            // the context copied per call must not be used up by the calls before
+            std::string signature = signJWS(alg, key.get(), signingInput);
+            for (int i = 0; i < 3; ++i)
+                CHECK(verifier->verify(signingInput, bytes(signature), signature.size()));
+            CHECK(verifyWithJWK(*jwk, alg, signingInput, bytes(signature), signature.size()));
+
+            std::string altered = signingInput;
+            altered.back() ^= 1;
+            CHECK(!verifier->verify(altered, bytes(signature), signature.size()));
+            CHECK(!verifyWithJWK(*jwk, alg, altered, bytes(signature), signature.size()));
+            CHECK(!verifier->verify(signingInput, bytes(signature), signature.size() - 1));
+            CHECK(verifier->verify(signingInput, bytes(signature), signature.size()));
+        }
+    }
+
+    TEST_CASE(verifiesFromManyThreads)
+    {
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        for (JWTAlg alg : { JWTAlg::PS256, JWTAlg::ES256, JWTAlg::EdDSA })
+        {
+            PKey key = generateKey(alg);
+            std::unique_ptr<const JWKSet> keys = keySet(publicJWK(alg, key.get(), "bench-1"));
+            const JWSVerifier* verifier = keys->verifier(*keys->begin(), alg);
+            REQUIRE(verifier != nullptr);
+            std::string signature = signJWS(alg, key.get(), signingInput);
+
+            std::atomic<int> verified { 0 };
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&]
+                {
+                    for (int i = 0; i < 50; ++i)
+                    {
+                        if (verifier->verify(signingInput, bytes(signature), signature.size()))
+                            verified.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+            for (std::thread& thread : threads)
+                thread.join();
+            CHECK(verified == 200);
+        }
+    }
+
+    // an RSA key without "alg" gets one verifier per RSA algorithm, and
+    // each keeps to its own padding
+    TEST_CASE(keyWithoutAlgKeepsPadding)
+    {
+        PKey key = generateKey(JWTAlg::RS256);
+        std::string jwk = publicJWK(JWTAlg::RS256, key.get(), "bench-1");
+        jwk.erase(jwk.find(R"("alg":"RS256",)"), 14);
+        std::unique_ptr<const JWKSet> keys = keySet(jwk);
+
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        std::string pkcs1 = signJWS(JWTAlg::RS256, key.get(), signingInput);
+        std::string pss = signJWS(JWTAlg::PS256, key.get(), signingInput);
+        const JWSVerifier* rs256 = keys->verifier(*keys->begin(), JWTAlg::RS256);
+        const JWSVerifier* ps256 = keys->verifier(*keys->begin(), JWTAlg::PS256);
+        REQUIRE(rs256 != nullptr && ps256 != nullptr);
+        CHECK(rs256->verify(signingInput, bytes(pkcs1), pkcs1.size()));
+        CHECK(!rs256->verify(signingInput, bytes(pss), pss.size()));
+        CHECK(ps256->verify(signingInput, bytes(pss), pss.size()));
+        CHECK(!ps256->verify(signingInput, bytes(pkcs1), pkcs1.size()));
+        CHECK(keys->verifier(*keys->begin(), JWTAlg::ES256) == nullptr);
+    }
+
+    TEST_CASE(refusesUnusableKeys)
+    {
+        // a key for ES256 is not found for ES384, nor a signature of another key accepted
+        PKey ec = generateKey(JWTAlg::ES256);
+        std::unique_ptr<const JWKSet> keys = keySet(publicJWK(JWTAlg::ES256, ec.get(), "bench-1"));
+        CHECK(keys->find("bench-1", JWTAlg::ES384) == nullptr);
+        CHECK(keys->find("bench-2", JWTAlg::ES256) == nullptr);
+
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        PKey other = generateKey(JWTAlg::ES256);
+        std::string signature = signJWS(JWTAlg::ES256, other.get(), signingInput);
+        CHECK(!keys->verifier(*keys->begin(), JWTAlg::ES256)->verify(signingInput, bytes(signature), signature.size()));
+
+        // an RSA modulus under 2048 bits stays in the set without a verifier
+        PKey small(EVP_RSA_gen(1024));
+        REQUIRE(small != nullptr);
+        keys = keySet(publicJWK(JWTAlg::RS256, small.get(), "small"));
+        const JWK* jwk = keys->find("small", JWTAlg::RS256);
+        REQUIRE(jwk != nullptr);
+        CHECK(keys->verifier(*jwk, JWTAlg::RS256) == nullptr);
+        signature = signJWS(JWTAlg::RS256, small.get(), signingInput);
+        CHECK(!verifyWithJWK(*jwk, JWTAlg::RS256, signingInput, bytes(signature), signature.size()));
+    }
+}
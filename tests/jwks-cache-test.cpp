@@ -0,0 +1,128 @@
+// the JWKS cache keeps serving its last good key set whatever a refresh
+// runs into, and never lets an exception out of its refresher
+
+#include "check.hpp"
+
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-error.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr std::string_view keySet =
+        R"({"keys":[{"kty":"oct","alg":"HS256","kid":"key-1","k":"MDEyMzQ1Njc4OWFiY2RlZjAxMjM0NTY3ODlhYmNkZWY"}]})";
+
+    // answers with the key set, then fails in the way "mode" says
+    struct Server
+    {
+        enum Mode { serve, status, garbage, badAlloc, runtimeError };
+        std::atomic<Mode> mode { serve };
+
+        std::shared_ptr<FunctionFetcher> fetcher()
+        {
+            return std::make_shared<FunctionFetcher>([this](const std::string&)
+            {
+                FetchResponse response;
+                response.status = 200;
+                response.body = keySet;
+                switch (mode.load())
+                {
+                case serve: break;
+                case status: response.status = 503; break;
+                case garbage: response.body = "{\"keys\":"; break;
+                case badAlloc: throw std::bad_alloc();
+                case runtimeError: throw std::runtime_error("connection reset");
+                }
+                return response;
+            });
+        }
+    };
+
+    JWKSCacheOptions eager()
+    {
+        JWKSCacheOptions options;
+        options.minRefreshInterval = std::chrono::seconds(0);
+        options.retryInterval = std::chrono::seconds(0);
+        return options;
+    }
+
+    TEST_CASE(failedRefreshKeepsKeys)
+    {
+        Server server;
+        JWKSCache cache("stand-in:jwks", server.fetcher(), eager());
+        REQUIRE(cache.refresh());
+        uint64_t generation = cache.generation();
+
+        for (Server::Mode mode : { Server::status, Server::garbage, Server::badAlloc, Server::runtimeError })
+        {
+            server.mode = mode;
+            CHECK(!cache.refresh());
+            CHECK(cache.snapshot().find("key-1", JWTAlg::HS256) != nullptr);
+        }
+        CHECK(cache.failures() == 4);
+        CHECK(cache.generation() == generation);
+
+        server.mode = Server::serve;
+        CHECK(cache.refresh());
+        CHECK(cache.generation() == generation + 1);
+    }
+
+    // the refresher thread survives fetchers that throw anything at all
+    TEST_CASE(refresherSurvivesExceptions)
+    {
+        Server server;
+        JWKSCache cache("stand-in:jwks", server.fetcher(), eager());
+        cache.start();
+
+        for (Server::Mode mode : { Server::badAlloc, Server::runtimeError })
+        {
+            server.mode = mode;
+            uint64_t failures = cache.failures();
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (cache.failures() < failures + 3 && std::chrono::steady_clock::now() < deadline)
+            {
+                cache.requestRefresh();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK(cache.failures() >= failures + 3);
+            CHECK(cache.snapshot().find("key-1", JWTAlg::HS256) != nullptr);
+        }
+
+        server.mode = Server::serve;
+        uint64_t generation = cache.generation();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (cache.generation() == generation && std::chrono::steady_clock::now() < deadline)
+        {
+            cache.requestRefresh();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(cache.generation() > generation);
+    }
+
+    TEST_CASE(startThrowsWithoutKeys)
+    {
+        Server server;
+        server.mode = Server::badAlloc;
+        JWKSCache cache("stand-in:jwks", server.fetcher(), eager());
+        bool threw = false;
+        try
+        {
+            cache.start();
+        }
+        catch (const JWTException&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(cache.snapshot().keys() == nullptr);
+    }
+}
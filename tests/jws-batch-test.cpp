@@ -0,0 +1,145 @@
+// verifyJWSBatch: for a mix of keys, algorithms and failures, the batch
+// reports for each token what JWTVerifier reports for it alone, in input
+// order, with or without a pool and for any grain size
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jws-batch.hpp>
+#include <ncbi/jwt-verifier.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    constexpr JWTAlg batchAlgs[] = { JWTAlg::HS256, JWTAlg::RS256, JWTAlg::PS384, JWTAlg::ES256, JWTAlg::EdDSA };
+
+    struct Corpus
+    {
+        std::string jwks;
+        std::vector<std::string> tokens;
+    };
+
+    // two keys per algorithm; each token is valid, altered, signed by a
+    // stranger, names an unknown kid or an algorithm its key refuses, or
+    // is not a JWS at all
+    Corpus corpus()
+    {
+        Corpus c;
+        std::vector<PKey> keys, strangers;
+        std::vector<std::string> kids;
+        for (JWTAlg alg : batchAlgs)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                keys.push_back(generateKey(alg));
+                strangers.push_back(generateKey(alg));
+                kids.push_back(std::string(algName(alg)) + '-' + std::to_string(k));
+                if (!c.jwks.empty())
+                    c.jwks += ',';
+                c.jwks += publicJWK(alg, keys.back().get(), kids.back());
+            }
+        }
+        c.jwks = R"({"keys":[)" + c.jwks + "]}";
+
+        for (size_t i = 0; i < 600; ++i)
+        {
+            size_t k = i % keys.size();
+            JWTAlg alg = batchAlgs[k / 2];
+            std::string payload = R"({"sub":"user-)" + std::to_string(i) + R"(","exp":4102444800})";
+            std::string token;
+            switch (i / keys.size() % 6)
+            {
+            case 0:
+            case 1:
+                token = makeToken(alg, keys[k].get(), kids[k], payload);
+                break;
+            case 2:
+                token = makeToken(alg, keys[k].get(), kids[k], payload);
+                token[token.find('.') + 2] ^= 1;
+                break;
+            case 3:
+                token = makeToken(alg, strangers[k].get(), kids[k], payload, "another-secret-0123456789abcdefg");
+                break;
+            case 4:
+                token = makeToken(alg, keys[k].get(), i % 2 ? "missing" : kids[(k + 2) % kids.size()], payload);
+                break;
+            default:
+                token = i % 2 ? "not-a-token" : makeToken(alg, keys[k].get(), kids[k], payload) + ".extra";
+                break;
+            }
+            c.tokens.push_back(std::move(token));
+        }
+        return c;
+    }
+
+    std::vector<JWTStatus> single(const Corpus& c)
+    {
+        std::string jwks = c.jwks;
+        JWKSCache keys("stand-in:jwks", std::make_shared<FunctionFetcher>([jwks](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = jwks;
+            return response;
+        }));
+        keys.start();
+        JWTVerifier verifier(keys);
+
+        std::vector<JWTStatus> statuses;
+        for (const std::string& token : c.tokens)
+        {
+            std::shared_ptr<const VerifiedToken> result;
+            statuses.push_back(verifier.verify(token, testNow, result));
+        }
+        return statuses;
+    }
+
+    TEST_CASE(batchMatchesSingleVerification)
+    {
+        Corpus c = corpus();
+        std::vector<JWTStatus> expected = single(c);
+        size_t ok = 0;
+        for (JWTStatus status : expected)
+            ok += status == JWTStatus::ok;
+        CHECK(ok == 200);
+
+        std::unique_ptr<const JWKSet> keys = JWKSet::parse(c.jwks);
+        std::vector<std::string_view> tokens(c.tokens.begin(), c.tokens.end());
+        ThreadPool pool(3);
+        for (ThreadPool* p : { static_cast<ThreadPool*>(nullptr), &pool })
+        {
+            for (size_t grain : { 1, 7, 256, 1000 })
+            {
+                JWSBatchOptions options;
+                options.pool = p;
+                options.grainSize = grain;
+                std::vector<JWTStatus> statuses = verifyJWSBatch(tokens, *keys, options);
+                REQUIRE(statuses.size() == expected.size());
+                for (size_t i = 0; i < tokens.size(); ++i)
+                {
+                    if (statuses[i] != expected[i])
+                    {
+                        ncbi::test::fail(__FILE__, __LINE__, "token " + std::to_string(i) + ": " +
+                            toString(statuses[i]) + ", alone " + toString(expected[i]));
+                    }
+                }
+            }
+        }
+    }
+
+    TEST_CASE(emptyBatch)
+    {
+        JWKSet keys;
+        CHECK(verifyJWSBatch({}, keys).empty());
+    }
+}
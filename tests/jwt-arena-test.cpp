@@ -0,0 +1,120 @@
+// the arena-backed token object model: what verification and decoding
+// fill in, and that with a large enough arena neither touches the heap
+
+#include "alloc-counter.hpp"
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/request-arena.hpp>
+
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    struct Fixture
+    {
+        std::string token = makeToken(JWTAlg::HS256, nullptr, "bench-1", benchPayload);
+        std::unique_ptr<JWKSCache> keys;
+
+        Fixture()
+        {
+            std::string jwks = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            keys = std::make_unique<JWKSCache>("stand-in:jwks", std::make_shared<FunctionFetcher>(
+                [jwks](const std::string&)
+                {
+                    FetchResponse response;
+                    response.status = 200;
+                    response.body = jwks;
+                    return response;
+                }));
+            keys->start();
+        }
+    };
+
+    TEST_CASE(verifyFillsModel)
+    {
+        Fixture f;
+        JWTVerifier verifier(*f.keys);
+        RequestArena arena(4096);
+
+        ArenaJWT result(arena.resource());
+        REQUIRE(verifier.verify(f.token, testNow, result) == JWTStatus::ok);
+        CHECK(result.verified);
+        CHECK(result.iss == "https://auth.ncbi.nlm.nih.gov");
+        CHECK(result.sub == "user-1234567");
+        CHECK(result.audiences.size() == 2);
+        CHECK(result.hasAudience("https://sra.ncbi.nlm.nih.gov"));
+        CHECK(result.scopes.size() == 4);
+        CHECK(result.hasScope("sra:read"));
+        CHECK(!result.hasScope("sra:write"));
+        CHECK(result.exp == 4102444800);
+        CHECK(result.find("email") != nullptr);
+        CHECK(result.find("missing") == nullptr);
+
+        std::string forged = f.token;
+        forged.back() = forged.back() == 'A' ? 'B' : 'A';
+        arena.release();
+        ArenaJWT refused(arena.resource());
+        CHECK(verifier.verify(forged, testNow, refused) == JWTStatus::badSignature);
+        CHECK(!refused.verified);
+    }
+
+    // the request path allocates from the arena only, request after request
+    TEST_CASE(verifyIntoArenaDoesNotAllocate)
+    {
+        Fixture f;
+        JWTVerifier verifier(*f.keys);
+        RequestArena arena(4096);
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (int i = 0; i < 100; ++i)
+        {
+            arena.release();
+            ArenaJWT result(arena.resource());
+            REQUIRE(verifier.verify(f.token, testNow, result) == JWTStatus::ok);
+            CHECK(result.hasScope("sra:read"));
+        }
+        AllocationSnapshot after = AllocationSnapshot::take();
+        CHECK(after.cxx == before.cxx);
+        CHECK(arena.spills() == 0);
+    }
+
+    TEST_CASE(decodeIntoArenaDoesNotAllocate)
+    {
+        Fixture f;
+        RequestArena arena(4096);
+
+        AllocationSnapshot before = AllocationSnapshot::take();
+        for (int i = 0; i < 100; ++i)
+        {
+            arena.release();
+            ArenaJWT result(arena.resource());
+            REQUIRE(decodeJWT(f.token, result) == JWTStatus::ok);
+            CHECK(!result.verified);
+            CHECK(result.find("email") != nullptr);
+        }
+        AllocationSnapshot after = AllocationSnapshot::take();
+        CHECK(after.cxx == before.cxx);
+        CHECK(after.crypto == before.crypto);
+        CHECK(arena.spills() == 0);
+    }
+
+    // an arena too small for the request spills to the heap, and says so
+    TEST_CASE(smallArenaSpills)
+    {
+        Fixture f;
+        RequestArena arena(64);
+
+        ArenaJWT result(arena.resource());
+        REQUIRE(decodeJWT(f.token, result) == JWTStatus::ok);
+        CHECK(result.sub == "user-1234567");
+        CHECK(arena.spills() != 0);
+    }
+}
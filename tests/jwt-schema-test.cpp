@@ -0,0 +1,102 @@
+// JWTSchema: what the compiler settles, indices and perfect hashes, and
+// what validation reports for required, missing and mistyped claims and
+// for an audience outside those allowed
+
+#include "check.hpp"
+
+#include <ncbi/jwt-schema.hpp>
+
+#include <array>
+#include <string_view>
+
+using namespace ncbi;
+
+namespace
+{
+    using TestSchema = JWTSchema<
+        RequiredClaim<"iss", ClaimType::string, Allowed<"https://login.example.org">>,
+        RequiredClaim<"sub", ClaimType::string>,
+        RequiredClaim<"aud", ClaimType::audience, Allowed<"api-a", "api-b">>,
+        RequiredClaim<"exp", ClaimType::numericDate>,
+        OptionalClaim<"nbf", ClaimType::numericDate>,
+        OptionalClaim<"admin", ClaimType::boolean>,
+        OptionalClaim<"groups", ClaimType::array>,
+        OptionalClaim<"cnf", ClaimType::object>>;
+
+    static_assert(TestSchema::size == 8);
+    static_assert(TestSchema::indexOf<"iss">() == 0);
+    static_assert(TestSchema::indexOf<"exp">() == 3);
+    static_assert(TestSchema::indexOf<"cnf">() == 7);
+
+    // the perfect hash finds every key, and nothing else, at compile time
+    constexpr std::array<std::string_view, 4> hashKeys { "iss", "sub", "aud", "exp" };
+    constexpr detail::PerfectHash<4> hash { hashKeys };
+    static_assert(hash.find("iss") == 0 && hash.find("sub") == 1 && hash.find("aud") == 2 && hash.find("exp") == 3);
+    static_assert(hash.find("is") < 0 && hash.find("isss") < 0 && hash.find("nbf") < 0 && hash.find("") < 0);
+
+    constexpr std::string_view valid =
+        R"({"iss":"https://login.example.org","sub":"user-1","aud":["api-x","api-b"],"exp":1800000000.5,)"
+        R"("admin":false,"groups":["g"],"cnf":{"jkt":"x"},"other":[1,{"a":null}]})";
+
+    JWTStatus validate(std::string_view payload)
+    {
+        TestSchema::Claims claims;
+        return TestSchema::validate(payload, claims);
+    }
+
+    TEST_CASE(acceptsValidPayload)
+    {
+        TestSchema::Claims claims;
+        REQUIRE(TestSchema::validate(valid, claims) == JWTStatus::ok);
+        CHECK(claims.has<"iss">());
+        CHECK(!claims.has<"nbf">());
+        CHECK(claims.date<"exp">() == 1800000000);
+        CHECK(claims.get<"sub">().rawString() == "user-1");
+
+        // only the required claims, audience as a single string, a name escaped
+        CHECK(validate(R"({"\u0069ss":"https://login.example.org","sub":"u","aud":"api-a","exp":1})") ==
+            JWTStatus::ok);
+    }
+
+    TEST_CASE(refusesMissingRequiredClaim)
+    {
+        CHECK(validate(R"({"iss":"https://login.example.org","aud":"api-a","exp":1})") == JWTStatus::missingClaim);
+        CHECK(validate(R"({"iss":"https://login.example.org","sub":"u","aud":"api-a"})") == JWTStatus::missingClaim);
+        CHECK(validate("{}") == JWTStatus::missingClaim);
+    }
+
+    TEST_CASE(refusesWrongType)
+    {
+        constexpr std::string_view wrong[] =
+        {
+            R"({"iss":"https://login.example.org","sub":7,"aud":"api-a","exp":1})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":"1"})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":["api-a",1],"exp":1})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":{},"exp":1})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":1,"admin":"yes"})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":1,"groups":"g"})",
+            R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":1,"cnf":[]})",
+            R"({"iss":"https://login.example.org","sub":"u","sub":"v","aud":"api-a","exp":1})"
+        };
+        for (std::string_view payload : wrong)
+            CHECK(validate(payload) == JWTStatus::badClaim);
+    }
+
+    TEST_CASE(refusesValuesNotAllowed)
+    {
+        CHECK(validate(R"({"iss":"https://login.example.org","sub":"u","aud":"api-c","exp":1})") ==
+            JWTStatus::rejectedClaim);
+        CHECK(validate(R"({"iss":"https://login.example.org","sub":"u","aud":["api-c","api-d"],"exp":1})") ==
+            JWTStatus::rejectedClaim);
+        CHECK(validate(R"({"iss":"https://login.example.org/","sub":"u","aud":"api-a","exp":1})") ==
+            JWTStatus::rejectedClaim);
+    }
+
+    TEST_CASE(refusesMalformedPayload)
+    {
+        CHECK(validate(R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":1)") == JWTStatus::badJSON);
+        CHECK(validate(R"([])") == JWTStatus::badJSON);
+        CHECK(validate(R"({"iss":"https://login.example.org","sub":"u","aud":"api-a","exp":1,"x":})") ==
+            JWTStatus::badJSON);
+    }
+}
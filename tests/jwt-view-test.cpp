@@ -0,0 +1,115 @@
+// the zero-copy token view: splitting, segment decoding, signature
+// verification and lazy claim lookup, and that none of it allocates
+
+#include "alloc-counter.hpp"
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jws.hpp>
+#include <ncbi/jwt.hpp>
+
+#include <string>
+
+using namespace ncbi;
+
+namespace
+{
+    const std::string token = bench::makeHS256Token(bench::benchHeader, bench::benchPayload, bench::benchSecret);
+
+    TEST_CASE(splitsSegments)
+    {
+        JWTView view;
+        REQUIRE(JWTView::parse(token, view) == JWTStatus::ok);
+        CHECK(view.headerSegment() == bench::base64url(bench::benchHeader));
+        CHECK(view.payloadSegment() == bench::base64url(bench::benchPayload));
+        CHECK(view.signingInput().size() == view.headerSegment().size() + 1 + view.payloadSegment().size());
+        CHECK(view.token().data() == token.data());
+    }
+
+    TEST_CASE(rejectsMalformed)
+    {
+        JWTView view;
+        CHECK(JWTView::parse("", view) == JWTStatus::malformed);
+        CHECK(JWTView::parse("abc.def", view) == JWTStatus::malformed);
+        CHECK(JWTView::parse("a.b.c.d", view) == JWTStatus::malformed);
+    }
+
+    TEST_CASE(decodesSegments)
+    {
+        JWTView view;
+        REQUIRE(JWTView::parse(token, view) == JWTStatus::ok);
+
+        char header[256];
+        std::string_view json;
+        REQUIRE(view.decodeHeader(header, sizeof header, json) == JWTStatus::ok);
+        CHECK(json == bench::benchHeader);
+
+        char small[8];
+        CHECK(view.decodePayload(small, sizeof small, json) == JWTStatus::bufferTooSmall);
+
+        std::string tampered = token;
+        tampered[1] = '*';
+        REQUIRE(JWTView::parse(tampered, view) == JWTStatus::ok);
+        CHECK(view.decodeHeader(header, sizeof header, json) == JWTStatus::badEncoding);
+    }
+
+    TEST_CASE(verifiesAndLooksUpClaims)
+    {
+        HMACVerifier verifier(JWTAlg::HS256, bench::benchSecret);
+
+        JWTView view;
+        REQUIRE(JWTView::parse(token, view) == JWTStatus::ok);
+        char headerBuf[256];
+        std::string_view headerJSON;
+        REQUIRE(view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON) == JWTStatus::ok);
+        JWTHeader header;
+        REQUIRE(JWTHeader::parse(headerJSON, header) == JWTStatus::ok);
+        CHECK(header.alg == JWTAlg::HS256);
+        CHECK(verifyJWS(view, header, verifier) == JWTStatus::ok);
+
+        char payloadBuf[1024];
+        std::string_view payloadJSON;
+        REQUIRE(view.decodePayload(payloadBuf, sizeof payloadBuf, payloadJSON) == JWTStatus::ok);
+        JWTClaimsView claims(payloadJSON);
+        int64_t exp = 0;
+        CHECK(claims.getNumericDate("exp", exp));
+        CHECK(exp == 4102444800);
+        std::string_view sub;
+        CHECK(claims.getString("sub", sub));
+        CHECK(sub == "user-1234567");
+        CHECK(!claims.getString("missing", sub));
+
+        std::string forged = token;
+        forged.back() = forged.back() == 'A' ? 'B' : 'A';
+        REQUIRE(JWTView::parse(forged, view) == JWTStatus::ok);
+        CHECK(verifyJWS(view, header, verifier) == JWTStatus::badSignature);
+    }
+
+    // the verify-only path and the expiry lookup make no heap allocation
+    TEST_CASE(verifyingDoesNotAllocate)
+    {
+        HMACVerifier verifier(JWTAlg::HS256, bench::benchSecret);
+
+        bench::AllocationSnapshot before = bench::AllocationSnapshot::take();
+        for (int i = 0; i < 100; ++i)
+        {
+            JWTView view;
+            JWTView::parse(token, view);
+            char headerBuf[256];
+            std::string_view headerJSON;
+            view.decodeHeader(headerBuf, sizeof headerBuf, headerJSON);
+            JWTHeader header;
+            JWTHeader::parse(headerJSON, header);
+            REQUIRE(verifyJWS(view, header, verifier) == JWTStatus::ok);
+
+            char payloadBuf[1024];
+            std::string_view payloadJSON;
+            view.decodePayload(payloadBuf, sizeof payloadBuf, payloadJSON);
+            int64_t exp = 0;
+            JWTClaimsView(payloadJSON).getNumericDate("exp", exp);
+        }
+        bench::AllocationSnapshot after = bench::AllocationSnapshot::take();
+        CHECK(after.cxx == before.cxx);
+        CHECK(after.crypto == before.crypto);
+    }
+}
@@ -0,0 +1,164 @@
+// tokens written by JWTWriter: byte for byte what OpenSSL produces for
+// HS256, verifiable for the asymmetric algorithms, exactly as long as
+// size() says, and written without a heap allocation
+
+#include "alloc-counter.hpp"
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/jwt-writer.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    // a JSON array of group names of about "bytes" bytes
+    std::string groups(size_t bytes)
+    {
+        std::string json = "[";
+        for (size_t i = 0; json.size() < bytes; ++i)
+        {
+            if (i != 0)
+                json += ',';
+            json += "\"phs" + std::to_string(100000 + i) + ".v1.p1.c1\"";
+        }
+        return json + ']';
+    }
+
+    // the claims TokenEndpoint issues, optionally with groups, and the
+    // JSON they should come out as
+    struct Claims
+    {
+        std::string groupsJSON;
+        std::vector<JWTClaimValue> claims;
+
+        explicit Claims(size_t extra)
+            : groupsJSON(groups(extra))
+        {
+            claims = {
+                JWTClaimValue("iss", "https://auth.ncbi.nlm.nih.gov"),
+                JWTClaimValue("sub", "user-1234567"),
+                JWTClaimValue("client_id", "test-client"),
+                JWTClaimValue("iat", testNow),
+                JWTClaimValue("exp", testNow + 300),
+                JWTClaimValue("jti", "b7c1e3a45d2f4e8a9b3c1f2e"),
+                JWTClaimValue("scope", "openid profile email sra:read"),
+                JWTClaimValue::boolean("mfa", true)
+            };
+            if (extra != 0)
+                claims.push_back(JWTClaimValue::json("groups", groupsJSON));
+        }
+
+        std::string json() const
+        {
+            return R"({"iss":"https://auth.ncbi.nlm.nih.gov","sub":"user-1234567","client_id":"test-client",)"
+                R"("iat":)" + std::to_string(testNow) + R"(,"exp":)" + std::to_string(testNow + 300) +
+                R"(,"jti":"b7c1e3a45d2f4e8a9b3c1f2e","scope":"openid profile email sra:read","mfa":true)" +
+                (claims.size() > 8 ? R"(,"groups":)" + groupsJSON : std::string()) + '}';
+        }
+    };
+
+    std::string write(const JWTWriter& writer, std::span<const JWTClaimValue> claims)
+    {
+        std::unique_ptr<SigningContext> context = writer.signer().newContext();
+        std::string token(writer.size(claims), '\0');
+        if (writer.write(claims, *context, token.data(), token.size()) != token.size())
+            return {};
+        return token;
+    }
+
+    // sizes that keep everything on the stack, and some that do not
+    TEST_CASE(matchesOpenSSL)
+    {
+        JWTWriter writer(std::make_shared<HMACSigner>(JWTAlg::HS256, benchSecret, "test-1"));
+        for (size_t extra : { size_t(0), size_t(1000), size_t(8000), size_t(40000) })
+        {
+            Claims c(extra);
+            CHECK(write(writer, c.claims) ==
+                makeHS256Token(R"({"alg":"HS256","typ":"JWT","kid":"test-1"})", c.json(), benchSecret));
+        }
+    }
+
+    TEST_CASE(escapesStrings)
+    {
+        JWTWriter writer(std::make_shared<HMACSigner>(JWTAlg::HS256, benchSecret, "test-1"), "");
+        std::string text = std::string("quote \" backslash \\ newline \n nul ") + '\0' + " end";
+        JWTClaimValue claims[] = { JWTClaimValue("name", text), JWTClaimValue("n", int64_t(-42)) };
+        CHECK(write(writer, claims) == makeHS256Token(R"({"alg":"HS256","kid":"test-1"})",
+            R"({"name":"quote \" backslash \\ newline \u000a nul \u0000 end","n":-42})", benchSecret));
+    }
+
+    TEST_CASE(refusesSmallBuffer)
+    {
+        JWTWriter writer(std::make_shared<HMACSigner>(JWTAlg::HS256, benchSecret, "test-1"));
+        Claims c(0);
+        std::unique_ptr<SigningContext> context = writer.signer().newContext();
+        std::string token(writer.size(c.claims) - 1, '\0');
+        CHECK(writer.write(c.claims, *context, token.data(), token.size()) == 0);
+    }
+
+    // tokens signed with a private key verify against its public JWK
+    TEST_CASE(asymmetricTokensVerify)
+    {
+        for (JWTAlg alg : { JWTAlg::ES256, JWTAlg::RS256, JWTAlg::PS256, JWTAlg::EdDSA })
+        {
+            PKey key = generateKey(alg);
+            JWTWriter writer(std::make_shared<PrivateKeySigner>(alg, privatePEM(key.get()), "test-1"));
+            std::string jwks = R"({"keys":[)" + publicJWK(alg, key.get(), "test-1") + "]}";
+            JWKSCache keys("stand-in:jwks", std::make_shared<FunctionFetcher>([jwks](const std::string&)
+            {
+                FetchResponse response;
+                response.status = 200;
+                response.body = jwks;
+                return response;
+            }));
+            keys.start();
+            JWTVerifier verifier(keys);
+
+            for (size_t extra : { size_t(0), size_t(8000) })
+            {
+                Claims c(extra);
+                std::string token = write(writer, c.claims);
+                REQUIRE(!token.empty());
+                std::shared_ptr<const VerifiedToken> result;
+                CHECK(verifier.verify(token, testNow, result) == JWTStatus::ok);
+            }
+        }
+    }
+
+    // issuing into a reused buffer allocates nothing, large tokens included
+    TEST_CASE(writingDoesNotAllocate)
+    {
+        for (JWTAlg alg : { JWTAlg::HS256, JWTAlg::ES256, JWTAlg::EdDSA })
+        {
+            std::shared_ptr<const JWSSigner> signer;
+            if (alg == JWTAlg::HS256)
+                signer = std::make_shared<HMACSigner>(alg, benchSecret, "test-1");
+            else
+                signer = std::make_shared<PrivateKeySigner>(alg, privatePEM(generateKey(alg).get()), "test-1");
+            JWTWriter writer(signer);
+            std::unique_ptr<SigningContext> context = writer.signer().newContext();
+
+            for (size_t extra : { size_t(0), size_t(8000) })
+            {
+                Claims c(extra);
+                std::vector<char> buffer(writer.size(c.claims));
+                AllocationSnapshot before = AllocationSnapshot::take();
+                for (int i = 0; i < 20; ++i)
+                {
+                    size_t size = writer.size(c.claims);
+                    CHECK(writer.write(c.claims, *context, buffer.data(), buffer.size()) == size);
+                }
+                CHECK(AllocationSnapshot::take().cxx == before.cxx);
+            }
+        }
+    }
+}
@@ -0,0 +1,221 @@
+// the log-backed refresh token store: rotation, reuse detection, replay
+// of the log, a rotation whose commit fails, and compaction
+
+#include "check.hpp"
+
+#include <ncbi/jwt-error.hpp>
+#include <ncbi/refresh-log.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace ncbi;
+
+namespace
+{
+    constexpr int64_t testNow = 1700000000;
+
+    struct TempLog
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() /
+            ("refresh-log-test-" + std::to_string(getpid()) + ".log");
+
+        TempLog() { std::filesystem::remove(path); }
+        ~TempLog() { std::filesystem::remove(path); }
+    };
+
+    LogRefreshTokenStoreOptions small(bool sync)
+    {
+        LogRefreshTokenStoreOptions options;
+        options.growBy = size_t(1) << 20;
+        options.maxSize = size_t(64) << 20;
+        options.sync = sync;
+        return options;
+    }
+
+    AuthorizationGrant grant(int64_t expires = testNow + 600)
+    {
+        return AuthorizationGrant { "spa", "user-1", "openid", "", "", expires };
+    }
+
+    // the descriptor this process holds open on "path"
+    int descriptorOf(const std::filesystem::path& path)
+    {
+        std::filesystem::path target = std::filesystem::canonical(path);
+        for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fd"))
+        {
+            std::error_code ec;
+            if (std::filesystem::read_symlink(entry.path(), ec) == target)
+                return std::stoi(entry.path().filename().string());
+        }
+        return -1;
+    }
+
+    TEST_CASE(rotatesAndDetectsReuse)
+    {
+        TempLog log;
+        LogRefreshTokenStore store(log.path.string(), small(false));
+
+        std::string token = store.issue(grant());
+        AuthorizationGrant granted;
+        std::string successor;
+        REQUIRE(store.rotate(token, "spa", {}, testNow, granted, successor) == RotateResult::rotated);
+        CHECK(granted.subject == "user-1");
+        CHECK(store.rotate(token, "other", {}, testNow, granted, successor) == RotateResult::invalidGrant);
+
+        // the retired token again: the whole family goes
+        std::string next;
+        CHECK(store.rotate(token, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.rotate(successor, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.stats().reuseDetected == 1);
+    }
+
+    TEST_CASE(replaysLog)
+    {
+        TempLog log;
+        std::string token, successor;
+        {
+            LogRefreshTokenStore store(log.path.string(), small(true));
+            token = store.issue(grant());
+            AuthorizationGrant granted;
+            REQUIRE(store.rotate(token, "spa", {}, testNow, granted, successor) == RotateResult::rotated);
+        }
+
+        LogRefreshTokenStore store(log.path.string(), small(true));
+        AuthorizationGrant granted;
+        std::string next;
+        CHECK(store.rotate(successor, "spa", {}, testNow, granted, next) == RotateResult::rotated);
+        CHECK(granted.scope == "openid");
+        CHECK(store.rotate(token, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.stats().reuseDetected == 1);
+    }
+
+    // fdatasync fails, as it does on a descriptor that cannot be synced:
+    // the client gets an error and no successor, so the presented token
+    // must stay usable, after a restart too, and retrying with it is no
+    // reuse
+    TEST_CASE(failedCommitKeepsToken)
+    {
+        TempLog log;
+        std::optional<LogRefreshTokenStore> store;
+        store.emplace(log.path.string(), small(true));
+        std::string token = store->issue(grant());
+
+        int fd = descriptorOf(log.path);
+        REQUIRE(fd >= 0);
+        int saved = ::dup(fd);
+        int null = ::open("/dev/null", O_RDWR);
+        REQUIRE(saved >= 0 && null >= 0);
+        REQUIRE(::dup2(null, fd) == fd);
+
+        AuthorizationGrant granted;
+        std::string successor;
+        bool threw = false;
+        try
+        {
+            store->rotate(token, "spa", {}, testNow, granted, successor);
+        }
+        catch (const JWTException&)
+        {
+            threw = true;
+        }
+
+        ::dup2(saved, fd);
+        ::close(saved);
+        ::close(null);
+        CHECK(threw);
+        CHECK(successor.empty());
+
+        store.reset();
+        store.emplace(log.path.string(), small(true));
+        CHECK(store->stats().live == 1);
+        CHECK(store->rotate(token, "spa", {}, testNow, granted, successor) == RotateResult::rotated);
+        CHECK(store->stats().reuseDetected == 0);
+        std::string next;
+        CHECK(store->rotate(successor, "spa", {}, testNow, granted, next) == RotateResult::rotated);
+    }
+
+    // compaction keeps live tokens and retired ones, so reuse is still
+    // caught after it and after a restart, and drops expired tokens and
+    // revoked families
+    TEST_CASE(compactKeepsWhatMatters)
+    {
+        TempLog log;
+        AuthorizationGrant granted;
+        std::string retired, live, expired, revoked, next;
+        {
+            LogRefreshTokenStore store(log.path.string(), small(true));
+            retired = store.issue(grant());
+            REQUIRE(store.rotate(retired, "spa", {}, testNow, granted, live) == RotateResult::rotated);
+            expired = store.issue(grant(testNow + 10));
+            revoked = store.issue(grant());
+            REQUIRE(store.rotate(revoked, "spa", {}, testNow, granted, next) == RotateResult::rotated);
+            CHECK(store.rotate(revoked, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+
+            uint64_t before = store.stats().logBytes;
+            store.compact(testNow + 60);
+            LogRefreshTokenStore::Stats stats = store.stats();
+            CHECK(stats.logBytes < before);
+            CHECK(stats.live == 1);
+            CHECK(stats.retired == 1);
+            CHECK(stats.revokedFamilies == 0);
+        }
+
+        LogRefreshTokenStore store(log.path.string(), small(true));
+        CHECK(store.rotate(expired, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.rotate(revoked, "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.rotate(live, "spa", {}, testNow + 60, granted, next) == RotateResult::rotated);
+        CHECK(granted.subject == "user-1");
+        CHECK(store.rotate(retired, "spa", {}, testNow + 60, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.stats().reuseDetected == 1);
+    }
+
+    // a compaction that cannot finish, here because the new file would
+    // outgrow the address space reserved for it, leaves the old log in
+    // place and the index rebuilt from it
+    TEST_CASE(failedCompactionReplaysLog)
+    {
+        TempLog log;
+        std::vector<std::string> tokens;
+        {
+            LogRefreshTokenStoreOptions roomy = small(true);
+            roomy.growBy = size_t(64) << 10;
+            LogRefreshTokenStore store(log.path.string(), roomy);
+            for (int i = 0; i < 100; ++i)
+                tokens.push_back(store.issue(grant()));
+        }
+
+        LogRefreshTokenStoreOptions cramped = small(true);
+        cramped.growBy = 4096;
+        cramped.maxSize = 8192;
+        LogRefreshTokenStore store(log.path.string(), cramped);
+        AuthorizationGrant granted;
+        std::string successor;
+        REQUIRE(store.rotate(tokens[0], "spa", {}, testNow, granted, successor) == RotateResult::rotated);
+
+        bool threw = false;
+        try
+        {
+            store.compact(testNow);
+        }
+        catch (const JWTException&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(!std::filesystem::exists(log.path.string() + ".compact"));
+        CHECK(store.stats().live == 100);
+        CHECK(store.stats().retired == 1);
+
+        std::string next;
+        CHECK(store.rotate(successor, "spa", {}, testNow, granted, next) == RotateResult::rotated);
+        CHECK(store.rotate(tokens[99], "spa", {}, testNow, granted, next) == RotateResult::rotated);
+        CHECK(store.rotate(tokens[0], "spa", {}, testNow, granted, next) == RotateResult::invalidGrant);
+        CHECK(store.stats().reuseDetected == 1);
+    }
+}
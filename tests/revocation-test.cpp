@@ -0,0 +1,158 @@
+// RevocationList and RevocationFeed: full and delta documents, a gap
+// filled from the full list, malformed documents, pruning, and a revoked
+// token refused even when its result is cached
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-error.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/revocation.hpp>
+#include <ncbi/verified-cache.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    TEST_CASE(appliesFullAndDeltaDocuments)
+    {
+        RevocationList list;
+        CHECK(list.apply("revocations 5\n+ jti-a 4102444800\n+ jti-b 4102444800\n") ==
+            RevocationList::Update::applied);
+        CHECK(list.serial() == 5);
+        CHECK(list.size() == 2);
+        CHECK(list.revoked("jti-a"));
+        CHECK(!list.revoked("jti-c"));
+
+        CHECK(list.apply("revocations 6 after 5\n- jti-a\n+ jti-c 4102444800\n") == RevocationList::Update::applied);
+        CHECK(list.serial() == 6);
+        CHECK(!list.revoked("jti-a"));
+        CHECK(list.revoked("jti-b"));
+        CHECK(list.revoked("jti-c"));
+
+        CHECK(list.apply("revocations 6\n") == RevocationList::Update::current);
+        CHECK(list.apply("revocations 8 after 7\n+ jti-d 4102444800\n") == RevocationList::Update::gap);
+        CHECK(!list.revoked("jti-d"));
+
+        // a full document replaces the list
+        CHECK(list.apply("revocations 9\n+ jti-d 4102444800\n") == RevocationList::Update::applied);
+        CHECK(list.size() == 1);
+        CHECK(!list.revoked("jti-b"));
+        CHECK(list.revoked("jti-d"));
+    }
+
+    TEST_CASE(malformedDocumentChangesNothing)
+    {
+        RevocationList list;
+        list.apply("revocations 5\n+ jti-a 4102444800\n");
+
+        for (std::string_view document : {
+            "revocations 6 after 5\n+ jti-b\n",
+            "revocations 6 after 5\n+ jti-b 4102444800\n* jti-a\n",
+            "revocations 6 after 5\n- jti-a extra\n",
+            "+ jti-b 4102444800\n",
+            "" })
+        {
+            bool threw = false;
+            try
+            {
+                list.apply(document);
+            }
+            catch (const JWTException&)
+            {
+                threw = true;
+            }
+            CHECK(threw);
+            CHECK(list.serial() == 5);
+            CHECK(list.size() == 1);
+            CHECK(list.revoked("jti-a"));
+            CHECK(!list.revoked("jti-b"));
+        }
+    }
+
+    TEST_CASE(prunesExpiredEntries)
+    {
+        RevocationList list;
+        list.apply("revocations 1\n+ jti-a 100\n+ jti-b 200\n");
+        list.revoke("jti-c", 300);
+        CHECK(list.size() == 3);
+        CHECK(list.serial() == 1);
+
+        list.prune(200);
+        CHECK(list.size() == 1);
+        CHECK(!list.revoked("jti-a"));
+        CHECK(!list.revoked("jti-b"));
+        CHECK(list.revoked("jti-c"));
+    }
+
+    // the feed serves a delta after a serial the list never had, so the
+    // full list is fetched instead
+    TEST_CASE(feedFillsGapFromFullList)
+    {
+        std::atomic<int> fullFetches { 0 };
+        auto fetcher = std::make_shared<FunctionFetcher>([&](const std::string& uri)
+        {
+            FetchResponse response;
+            response.status = 200;
+            if (uri == "stand-in:full")
+            {
+                fullFetches.fetch_add(1, std::memory_order_relaxed);
+                response.body = "revocations 12\n+ jti-a 4102444800\n+ jti-b 4102444800\n";
+            }
+            else
+                response.body = "revocations 12 after 11\n+ jti-b 4102444800\n";
+            return response;
+        });
+
+        RevocationList list;
+        RevocationFeedOptions options;
+        options.fullURI = "stand-in:full";
+        RevocationFeed feed(list, "stand-in:feed", fetcher, options);
+        CHECK(feed.poll());
+        CHECK(fullFetches == 1);
+        CHECK(list.serial() == 12);
+        CHECK(list.revoked("jti-a"));
+        CHECK(list.revoked("jti-b"));
+
+        // the list is current now, and the delta is not needed
+        CHECK(feed.poll());
+        CHECK(fullFetches == 1);
+    }
+
+    TEST_CASE(cachedResultOfRevokedTokenIsRefused)
+    {
+        JWKSCache keys("stand-in:jwks", std::make_shared<FunctionFetcher>([](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            return response;
+        }));
+        keys.start();
+
+        RevocationList list;
+        VerifiedTokenCache cache;
+        JWTVerifierOptions options;
+        options.cache = &cache;
+        options.revocations = &list;
+        JWTVerifier verifier(keys, options);
+
+        std::string token = makeHS256Token(benchHeader,
+            R"({"iss":"https://login.example.org","sub":"user-1","exp":4102444800,"jti":"jti-a"})", benchSecret);
+        std::shared_ptr<const VerifiedToken> result;
+        REQUIRE(verifier.verify(token, testNow, result) == JWTStatus::ok);
+        REQUIRE(cache.find(token, testNow) != nullptr);
+
+        list.revoke("jti-a", 4102444800);
+        CHECK(verifier.verify(token, testNow, result) == JWTStatus::revoked);
+        CHECK(result == nullptr);
+    }
+}
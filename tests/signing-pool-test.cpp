@@ -0,0 +1,143 @@
+// presigned ECDSA nonces and SigningPool: signatures made from the
+// reserve and past it verify, no nonce is spent twice, a forked child
+// throws away the reserve it inherited, and a pool signs from many
+// threads at once
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwk.hpp>
+#include <ncbi/jws-signer.hpp>
+#include <ncbi/signing-pool.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    std::shared_ptr<const PrivateKeySigner> presigned(JWTAlg alg, size_t nonces)
+    {
+        PKey key = generateKey(alg);
+        PrivateKeySignerOptions options;
+        options.presignedNonces = nonces;
+        return std::make_shared<PrivateKeySigner>(alg, privatePEM(key.get()), "bench-1", options);
+    }
+
+    TEST_CASE(presignedSignaturesVerify)
+    {
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        for (JWTAlg alg : { JWTAlg::ES256, JWTAlg::ES384, JWTAlg::ES512 })
+        {
+            std::shared_ptr<const PrivateKeySigner> signer = presigned(alg, 8);
+            std::unique_ptr<const JWKSet> keys = JWKSet::parse(R"({"keys":[)" + signer->publicJWK() + "]}");
+            const JWSVerifier* verifier = keys->verifier(*keys->begin(), alg);
+            REQUIRE(verifier != nullptr);
+
+            std::unique_ptr<SigningContext> context = signer->newContext();
+            CHECK(context->precompute() == 8);
+            CHECK(context->precompute() == 0);
+
+            // eight from the reserve, then two with fresh nonces; no r twice
+            std::set<std::string> rs;
+            for (int i = 0; i < 10; ++i)
+            {
+                unsigned char signature[132];
+                size_t size = 0;
+                REQUIRE(context->sign(signingInput, signature, size));
+                CHECK(size == signer->signatureSize());
+                CHECK(verifier->verify(signingInput, signature, size));
+                rs.insert(std::string(reinterpret_cast<const char*>(signature), size / 2));
+            }
+            CHECK(rs.size() == 10);
+            CHECK(context->precompute() == 8);
+        }
+    }
+
+    // were the reserve kept, parent and child would sign with the same
+    // nonce, and the two signatures would give the key away
+    TEST_CASE(forkedChildDiscardsReserve)
+    {
+        std::shared_ptr<const PrivateKeySigner> signer = presigned(JWTAlg::ES256, 4);
+        std::unique_ptr<SigningContext> context = signer->newContext();
+        REQUIRE(context->precompute() == 4);
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+
+        int pipes[2];
+        REQUIRE(::pipe(pipes) == 0);
+        pid_t child = ::fork();
+        REQUIRE(child >= 0);
+        if (child == 0)
+        {
+            unsigned char signature[64];
+            size_t size = 0;
+            bool signedOK = context->sign(signingInput, signature, size) && size == sizeof signature;
+            // the reserve was emptied rather than drawn on, so all of it is refilled
+            bool refilled = context->precompute() == 4;
+            ssize_t written = ::write(pipes[1], signature, sizeof signature);
+            ::_exit(signedOK && refilled && written == sizeof signature ? 0 : 1);
+        }
+        ::close(pipes[1]);
+
+        unsigned char parent[64], fromChild[64];
+        size_t size = 0;
+        CHECK(context->sign(signingInput, parent, size));
+        CHECK(::read(pipes[0], fromChild, sizeof fromChild) == sizeof fromChild);
+        ::close(pipes[0]);
+        int status = 0;
+        CHECK(::waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        CHECK(std::string(reinterpret_cast<const char*>(parent), 32) !=
+            std::string(reinterpret_cast<const char*>(fromChild), 32));
+
+        // the parent still draws on its own reserve
+        CHECK(context->precompute() == 1);
+    }
+
+    TEST_CASE(poolSignsFromManyThreads)
+    {
+        std::shared_ptr<const PrivateKeySigner> signer = presigned(JWTAlg::ES256, 16);
+        std::unique_ptr<const JWKSet> keys = JWKSet::parse(R"({"keys":[)" + signer->publicJWK() + "]}");
+        const JWSVerifier* verifier = keys->verifier(*keys->begin(), JWTAlg::ES256);
+        REQUIRE(verifier != nullptr);
+
+        SigningPoolOptions options;
+        options.slots = 2;
+        SigningPool pool(signer, options);
+        CHECK(pool.slots() == 2);
+        CHECK(pool.precompute() == 32);
+
+        std::string signingInput = base64url(benchHeader) + '.' + base64url(benchPayload);
+        std::atomic<int> verified { 0 };
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&]
+            {
+                for (int i = 0; i < 25; ++i)
+                {
+                    unsigned char signature[64];
+                    size_t size = 0;
+                    if (pool.sign(signingInput, signature, size) && verifier->verify(signingInput, signature, size))
+                        verified.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        CHECK(verified == 100);
+
+        // which slots the signatures drew on is up to the scheduler
+        size_t refilled = pool.precompute();
+        CHECK(refilled > 0 && refilled <= 32);
+    }
+}
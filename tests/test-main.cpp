@@ -0,0 +1,43 @@
+#include "check.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+int main(int argc, char** argv)
+{
+    using namespace ncbi::test;
+
+    unsigned run = 0;
+    for (const Case& c : cases())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = std::strcmp(argv[i], c.name) == 0;
+        if (!selected)
+            continue;
+
+        unsigned before = failures;
+        try
+        {
+            c.run();
+        }
+        catch (const std::exception& e)
+        {
+            fail(c.name, 0, std::string("threw ") + e.what());
+        }
+        catch (...)
+        {
+            fail(c.name, 0, "threw");
+        }
+        std::printf("%-40s %s\n", c.name, failures == before ? "ok" : "FAILED");
+        ++run;
+    }
+
+    if (run == 0)
+    {
+        std::fprintf(stderr, "no test cases selected\n");
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// the refresh_token grant of the token endpoint, against both stores:
+// rotation, narrowing and widening the scope, and reuse
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/refresh-log.hpp>
+#include <ncbi/token-endpoint.hpp>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1700000000;
+
+    // the "refresh_token" member of a successful response
+    std::string refreshTokenOf(std::string_view body)
+    {
+        constexpr std::string_view member = R"("refresh_token":")";
+        size_t at = body.find(member);
+        if (at == std::string_view::npos)
+            return {};
+        at += member.size();
+        return std::string(body.substr(at, body.find('"', at) - at));
+    }
+
+    // an endpoint for one public client, with refresh tokens in memory or
+    // in a log file
+    class Server
+    {
+    public:
+        explicit Server(bool log)
+        {
+            if (log)
+            {
+                path_ = std::filesystem::temp_directory_path() /
+                    ("token-endpoint-test-" + std::to_string(getpid()) + ".log");
+                std::filesystem::remove(path_);
+                LogRefreshTokenStoreOptions options;
+                options.sync = false;
+                store_ = std::make_shared<LogRefreshTokenStore>(path_.string(), options);
+            }
+            else
+                store_ = std::make_shared<MemoryRefreshTokenStore>();
+
+            auto clients = std::make_shared<ClientRegistry>(std::vector<OAuthClient>
+            {
+                { "spa", "", { "openid", "sra:read", "sra:write" },
+                    { GrantType::authorizationCode, GrantType::refreshToken } }
+            });
+            endpoint_ = std::make_unique<TokenEndpoint>(
+                std::make_shared<HMACSigner>(JWTAlg::HS256, benchSecret, "test-1"), clients,
+                std::make_shared<MemoryCodeStore>(), store_,
+                TokenEndpointOptions { .issuer = "https://auth.example.org", .audience = "" });
+            worker_ = std::make_unique<TokenEndpoint::Worker>(*endpoint_);
+        }
+
+        ~Server()
+        {
+            worker_.reset();
+            endpoint_.reset();
+            store_.reset();
+            if (!path_.empty())
+                std::filesystem::remove(path_);
+        }
+
+        std::string issue(std::string scope)
+        {
+            return store_->issue(AuthorizationGrant { "spa", "user-1", std::move(scope), "", "", testNow + 600 });
+        }
+
+        // "scope" is form-encoded
+        TokenResponse refresh(std::string_view token, std::string_view scope = {})
+        {
+            body_ = "grant_type=refresh_token&client_id=spa&refresh_token=" + std::string(token);
+            if (!scope.empty())
+                body_ += "&scope=" + std::string(scope);
+            return worker_->handle({ {}, body_ }, testNow);
+        }
+
+    private:
+        std::filesystem::path path_;
+        std::shared_ptr<RefreshTokenStore> store_;
+        std::unique_ptr<TokenEndpoint> endpoint_;
+        std::unique_ptr<TokenEndpoint::Worker> worker_;
+        std::string body_;
+    };
+
+    TEST_CASE(rotates)
+    {
+        for (bool log : { false, true })
+        {
+            Server server(log);
+            std::string token = server.issue("openid sra:read");
+            TokenResponse response = server.refresh(token);
+            REQUIRE(response.status == 200);
+            std::string successor = refreshTokenOf(response.body);
+            CHECK(!successor.empty());
+            CHECK(successor != token);
+            CHECK(server.refresh(successor).status == 200);
+        }
+    }
+
+    TEST_CASE(narrowsScope)
+    {
+        for (bool log : { false, true })
+        {
+            Server server(log);
+            TokenResponse response = server.refresh(server.issue("openid sra:read"), "sra%3Aread");
+            REQUIRE(response.status == 200);
+            CHECK(response.body.find(R"("scope":"sra:read")") != std::string_view::npos);
+        }
+    }
+
+    // a widened scope is refused without retiring the presented token,
+    // which then still rotates, and is not taken for reuse
+    TEST_CASE(widenedScopeKeepsToken)
+    {
+        for (bool log : { false, true })
+        {
+            Server server(log);
+            std::string token = server.issue("openid sra:read");
+            TokenResponse response = server.refresh(token, "sra%3Aread+sra%3Awrite");
+            CHECK(response.status == 400);
+            CHECK(response.body.find("invalid_scope") != std::string_view::npos);
+            CHECK(refreshTokenOf(response.body).empty());
+
+            response = server.refresh(token);
+            REQUIRE(response.status == 200);
+            CHECK(server.refresh(refreshTokenOf(response.body)).status == 200);
+        }
+    }
+
+    TEST_CASE(refusesUnknownAndReused)
+    {
+        for (bool log : { false, true })
+        {
+            Server server(log);
+            CHECK(server.refresh("no-such-token").status == 400);
+
+            std::string token = server.issue("openid");
+            REQUIRE(server.refresh(token).status == 200);
+            TokenResponse response = server.refresh(token);
+            CHECK(response.status == 400);
+            CHECK(response.body.find("invalid_grant") != std::string_view::npos);
+        }
+    }
+
+    TEST_CASE(scopeWithinComparesValues)
+    {
+        CHECK(scopeWithin("a", "a b"));
+        CHECK(scopeWithin("b a", "a b"));
+        CHECK(!scopeWithin("a c", "a b"));
+        CHECK(!scopeWithin("", "a b"));
+        CHECK(!scopeWithin("a  b", "a b"));
+        CHECK(!scopeWithin("ab", "a b"));
+    }
+}
@@ -0,0 +1,101 @@
+// VerifiedTokenCache: CLOCK eviction past capacity, no hit once a token
+// has expired, and results verified by a key rotated out are purged
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwk.hpp>
+#include <ncbi/verified-cache.hpp>
+
+#include <memory>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    std::shared_ptr<const VerifiedToken> entry(size_t i, int64_t exp = testNow + 600, uint64_t fingerprint = 0)
+    {
+        auto token = std::make_shared<VerifiedToken>();
+        token->token = "token-" + std::to_string(i);
+        token->exp = exp;
+        token->keyFingerprint = fingerprint;
+        return token;
+    }
+
+    VerifiedTokenCacheOptions oneShard(size_t capacity)
+    {
+        VerifiedTokenCacheOptions options;
+        options.capacity = capacity;
+        options.shards = 1;
+        return options;
+    }
+
+    // the hand passes over entries looked up since it last went by, and
+    // evicts the first it finds untouched
+    TEST_CASE(clockEvictsUnreferenced)
+    {
+        VerifiedTokenCache cache(oneShard(8));
+        for (size_t i = 0; i < 8; ++i)
+            cache.insert(entry(i), testNow);
+        for (size_t i = 0; i < 4; ++i)
+            CHECK(cache.find("token-" + std::to_string(i), testNow) != nullptr);
+
+        for (size_t i = 8; i < 12; ++i)
+            cache.insert(entry(i), testNow);
+        CHECK(cache.size() == 8);
+        CHECK(cache.stats().evictions == 4);
+        for (size_t i = 0; i < 12; ++i)
+            CHECK((cache.find("token-" + std::to_string(i), testNow) != nullptr) == (i < 4 || i >= 8));
+    }
+
+    // an expired entry goes before any live one, referenced or not
+    TEST_CASE(evictsExpiredFirst)
+    {
+        VerifiedTokenCache cache(oneShard(4));
+        for (size_t i = 0; i < 4; ++i)
+            cache.insert(entry(i, i == 2 ? testNow + 10 : testNow + 600), testNow);
+        for (size_t i = 0; i < 4; ++i)
+            CHECK(cache.find("token-" + std::to_string(i), testNow) != nullptr);
+        cache.insert(entry(4), testNow + 10);
+        CHECK(cache.find("token-2", testNow) == nullptr);
+        for (size_t i : { 0, 1, 3, 4 })
+            CHECK(cache.find("token-" + std::to_string(i), testNow + 10) != nullptr);
+    }
+
+    TEST_CASE(noHitAfterExp)
+    {
+        VerifiedTokenCache cache;
+        cache.insert(entry(1, testNow + 100), testNow);
+        CHECK(cache.find("token-1", testNow + 99) != nullptr);
+        CHECK(cache.find("token-1", testNow + 100) == nullptr);
+        CHECK(cache.find("token-2", testNow) == nullptr);
+
+        // nor is an expired token taken in
+        cache.insert(entry(2, testNow), testNow);
+        CHECK(cache.find("token-2", testNow - 1) == nullptr);
+    }
+
+    TEST_CASE(retainKeysPurgesDroppedKey)
+    {
+        std::string kept = publicJWK(JWTAlg::HS256, nullptr, "kept", "kept-secret-0123456789abcdef0123");
+        std::string dropped = publicJWK(JWTAlg::HS256, nullptr, "dropped", "dropped-secret-0123456789abcdef0");
+        uint64_t keptPrint = jwkFingerprint(JWK::parse(kept));
+        uint64_t droppedPrint = jwkFingerprint(JWK::parse(dropped));
+        CHECK(keptPrint != droppedPrint);
+
+        VerifiedTokenCache cache;
+        cache.insert(entry(1, testNow + 600, keptPrint), testNow);
+        cache.insert(entry(2, testNow + 600, droppedPrint), testNow);
+        cache.retainKeys(*JWKSet::parse(R"({"keys":[)" + kept + "]}"));
+
+        CHECK(cache.find("token-1", testNow) != nullptr);
+        CHECK(cache.find("token-2", testNow) == nullptr);
+        cache.insert(entry(3, testNow + 600, droppedPrint), testNow);
+        CHECK(cache.find("token-3", testNow) == nullptr);
+        CHECK(cache.size() == 1);
+    }
+}
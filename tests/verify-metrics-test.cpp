@@ -0,0 +1,162 @@
+// verification metrics: LatencyHistogram buckets tile the range within
+// the promised error, the Prometheus text carries cumulative buckets and
+// counters by stage and status, and JWTVerifier charges outcomes and
+// failures to the stage they happened in
+
+#include "check.hpp"
+#include "token-fixtures.hpp"
+
+#include <ncbi/jwks-cache.hpp>
+#include <ncbi/jwt-verifier.hpp>
+#include <ncbi/verify-metrics.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace ncbi;
+using namespace ncbi::bench;
+
+namespace
+{
+    constexpr int64_t testNow = 1800000000;
+
+    TEST_CASE(bucketsTileTheRange)
+    {
+        using H = LatencyHistogram;
+        CHECK(H::bucketLow(0) == 0);
+        CHECK(H::bucketHigh(H::bucketCount - 1) == uint64_t(1) << H::maxValueBits);
+        for (size_t b = 0; b < H::bucketCount; ++b)
+        {
+            uint64_t low = H::bucketLow(b);
+            uint64_t high = H::bucketHigh(b);
+            if (b + 1 < H::bucketCount && H::bucketLow(b + 1) != high)
+                ncbi::test::fail(__FILE__, __LINE__, "gap after bucket " + std::to_string(b));
+            if (H::bucketOf(low) != b || H::bucketOf(high - 1) != b)
+                ncbi::test::fail(__FILE__, __LINE__, "bucket " + std::to_string(b) + " misplaces its bounds");
+
+            // exact below 16, and then no wider than 1/16 of its low bound
+            if (low < 16 ? high - low != 1 : (high - low) * 16 > low)
+                ncbi::test::fail(__FILE__, __LINE__, "bucket " + std::to_string(b) + " too wide");
+        }
+        CHECK(H::bucketOf(uint64_t(1) << H::maxValueBits) == H::bucketCount - 1);
+        CHECK(H::bucketOf(UINT64_MAX) == H::bucketCount - 1);
+    }
+
+    TEST_CASE(percentilesWithinBucketError)
+    {
+        LatencyHistogram histogram;
+        CHECK(histogram.percentile(0.5) == 0);
+        for (uint64_t v = 1; v <= 1000; ++v)
+            histogram.add(v * 1000);
+        CHECK(histogram.count() == 1000);
+
+        for (double q : { 0.01, 0.5, 0.9, 0.99, 1.0 })
+        {
+            double exact = q * 1000 * 1000;
+            double found = static_cast<double>(histogram.percentile(q));
+            CHECK(found > exact * 0.96 && found < exact * 1.04);
+        }
+
+        LatencyHistogram other;
+        other.add(5, 10);
+        histogram.merge(other);
+        CHECK(histogram.count() == 1010);
+        CHECK(histogram.countAtOrBelow(5) == 10);
+        CHECK(histogram.countAtOrBelow(4) == 0);
+        CHECK(histogram.percentile(0) == 5);
+    }
+
+    TEST_CASE(prometheusText)
+    {
+        VerifyMetrics metrics;
+        StageMetrics& signature = metrics.stages[static_cast<size_t>(VerifyStage::signature)];
+        signature.count = 3;
+        signature.failures = 1;
+        signature.totalNanos = 1500;
+        for (uint64_t nanos : { 200, 300, 900000 })
+            signature.latency.add(nanos);
+        metrics.outcomes[static_cast<size_t>(JWTStatus::ok)] = 2;
+        metrics.outcomes[static_cast<size_t>(JWTStatus::badSignature)] = 1;
+
+        std::string text = toPrometheus(metrics, "test");
+        for (std::string_view line : {
+            "# TYPE test_verify_stage_seconds histogram\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"1e-07\"} 0\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"2.5e-07\"} 1\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"5e-07\"} 2\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"0.0005\"} 2\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"0.001\"} 3\n",
+            "test_verify_stage_seconds_bucket{stage=\"signature\",le=\"+Inf\"} 3\n",
+            "test_verify_stage_seconds_sum{stage=\"signature\"} 0.000001500\n",
+            "test_verify_stage_seconds_count{stage=\"signature\"} 3\n",
+            "test_verify_stage_seconds_count{stage=\"key_resolve\"} 0\n",
+            "# TYPE test_verify_stage_failures_total counter\n",
+            "test_verify_stage_failures_total{stage=\"signature\"} 1\n",
+            "test_verify_stage_failures_total{stage=\"claims\"} 0\n",
+            "# TYPE test_verify_total counter\n",
+            "test_verify_total{status=\"ok\"} 2\n",
+            "test_verify_total{status=\"bad_signature\"} 1\n",
+            "test_verify_total{status=\"server_error\"} 0\n" })
+        {
+            if (text.find(line) == std::string::npos)
+                ncbi::test::fail(__FILE__, __LINE__, "missing: " + std::string(line));
+        }
+
+        // 19 bounds, +Inf, sum and count per stage, then a counter per
+        // stage and per status, each family with HELP and TYPE
+        size_t lines = 0;
+        std::istringstream in(text);
+        for (std::string line; std::getline(in, line);)
+            ++lines;
+        CHECK(lines == verifyStageCount * 22 + verifyStageCount + jwtStatusCount + 6);
+        CHECK(text.back() == '\n');
+    }
+
+    TEST_CASE(verifierChargesStages)
+    {
+        if (!NCBI_OAUTH_METRICS)
+            return;
+
+        JWKSCache keys("stand-in:jwks", std::make_shared<FunctionFetcher>([](const std::string&)
+        {
+            FetchResponse response;
+            response.status = 200;
+            response.body = R"({"keys":[)" + publicJWK(JWTAlg::HS256, nullptr, "bench-1") + "]}";
+            return response;
+        }));
+        keys.start();
+        JWTVerifier verifier(keys);
+
+        std::string valid = makeHS256Token(benchHeader, benchPayload, benchSecret);
+        std::string forged = makeHS256Token(benchHeader, benchPayload, "another-secret-0123456789abcdefg");
+        std::string expired = makeHS256Token(benchHeader, R"({"sub":"user-1","exp":1700000000})", benchSecret);
+
+        VerifyMetrics before = verifyMetrics();
+        std::shared_ptr<const VerifiedToken> result;
+        CHECK(verifier.verify(valid, testNow, result) == JWTStatus::ok);
+        CHECK(verifier.verify(forged, testNow, result) == JWTStatus::badSignature);
+        CHECK(verifier.verify(expired, testNow, result) == JWTStatus::expired);
+        VerifyMetrics after = verifyMetrics();
+
+        auto outcome = [&](JWTStatus status)
+        {
+            size_t i = static_cast<size_t>(status);
+            return after.outcomes[i] - before.outcomes[i];
+        };
+        auto stage = [&](VerifyStage s, uint64_t StageMetrics::* member)
+        {
+            return after[s].*member - before[s].*member;
+        };
+        CHECK(after.verifications() - before.verifications() == 3);
+        CHECK(outcome(JWTStatus::ok) == 1);
+        CHECK(outcome(JWTStatus::badSignature) == 1);
+        CHECK(outcome(JWTStatus::expired) == 1);
+        CHECK(stage(VerifyStage::signature, &StageMetrics::count) == 3);
+        CHECK(stage(VerifyStage::signature, &StageMetrics::failures) == 1);
+        CHECK(stage(VerifyStage::claims, &StageMetrics::count) == 2);
+        CHECK(stage(VerifyStage::claims, &StageMetrics::failures) == 1);
+        CHECK(after[VerifyStage::signature].latency.count() - before[VerifyStage::signature].latency.count() == 3);
+    }
+}